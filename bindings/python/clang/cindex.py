@@ -1544,6 +1544,21 @@ class Cursor(Structure):
             for descendant in child.walk_preorder():
                 yield descendant
 
+    def get_records(self, file=None, include_usrs=True):
+        """Describe all the descendants of this cursor in one call.
+
+        Returns a CursorRecordList holding one CursorRecord per descendant,
+        in depth-first preorder. If file is given, only the cursors whose
+        extent starts in that file, and their descendants, are described.
+        """
+        options = 0
+        if include_usrs:
+            options |= 0x1
+        if file is not None and not isinstance(file, File):
+            file = File.from_name(self._tu, file)
+        ptr = conf.lib.clang_getCursorRecords(self, file, options)
+        return CursorRecordList(ptr, self._tu)
+
     def get_tokens(self):
         """Obtain Token instances formulating that compose this Cursor.
 
@@ -2255,6 +2270,86 @@ class CodeCompletionResults(ClangObject):
         return DiagnosticsItr(self)
 
 
+class CursorRecord(Structure):
+    """
+    A CursorRecord describes a cursor returned by Cursor.get_records().
+    """
+    _fields_ = [('_cursor', Cursor), ('_referenced_cursor', Cursor),
+                ('_kind_id', c_int), ('spelling', c_char_p),
+                ('usr', c_char_p), ('_file', c_object_p),
+                ('start_line', c_uint), ('start_column', c_uint),
+                ('start_offset', c_uint), ('end_line', c_uint),
+                ('end_column', c_uint), ('end_offset', c_uint),
+                ('parent', c_int), ('referenced', c_int)]
+
+    @property
+    def kind(self):
+        """Return the kind of the cursor."""
+        return CursorKind.from_id(self._kind_id)
+
+    @property
+    def file(self):
+        """Return the file in which the extent of the cursor starts, if any."""
+        if not self._file:
+            return None
+        return File(self._file)
+
+    @property
+    def cursor(self):
+        """Return the cursor this record describes."""
+        cursor = Cursor.from_buffer_copy(self._cursor)
+        cursor._tu = self._tu
+        return cursor
+
+    @property
+    def referenced_cursor(self):
+        """Return the cursor referenced by the cursor, or None."""
+        cursor = Cursor.from_buffer_copy(self._referenced_cursor)
+        if cursor == conf.lib.clang_getNullCursor():
+            return None
+        cursor._tu = self._tu
+        return cursor
+
+    def __repr__(self):
+        return "<CursorRecord: %s %r [%d:%d - %d:%d]>" % (
+            self.kind, self.spelling, self.start_line, self.start_column,
+            self.end_line, self.end_column)
+
+class _CXCursorRecordList(Structure):
+    _fields_ = [('count', c_uint), ('records', POINTER(CursorRecord))]
+
+class CursorRecordList(ClangObject):
+    """
+    The records returned by Cursor.get_records(). Indices in the parent and
+    referenced fields of a record refer to this list; -1 means none.
+    """
+    def __init__(self, ptr, tu):
+        assert isinstance(ptr, POINTER(_CXCursorRecordList)) and ptr
+        self.ptr = self._as_parameter_ = ptr
+        # Keep the TranslationUnit alive for as long as the records are.
+        self._tu = tu
+
+    def from_param(self):
+        return self._as_parameter_
+
+    def __del__(self):
+        conf.lib.clang_disposeCursorRecordList(self)
+
+    def __len__(self):
+        return self.ptr.contents.count
+
+    def __getitem__(self, key):
+        if key < 0:
+            key += len(self)
+        if key < 0 or len(self) <= key:
+            raise IndexError
+
+        record = self.ptr.contents.records[key]
+        # Keep this list, which owns the record, alive with it.
+        record._list = self
+        record._tu = self._tu
+        return record
+
 class Index(ClangObject):
     """
     The Index type provides the primary interface to the Clang CIndex library,
@@ -3019,6 +3114,9 @@ functionList = [
   ("clang_disposeCodeCompleteResults",
    [CodeCompletionResults]),
 
+  ("clang_disposeCursorRecordList",
+   [CursorRecordList]),
+
 # ("clang_disposeCXTUResourceUsage",
 #  [CXTUResourceUsage]),
 
@@ -3140,6 +3238,10 @@ functionList = [
    [Cursor],
    SourceLocation),
 
+  ("clang_getCursorRecords",
+   [Cursor, c_object_p, c_uint],
+   POINTER(_CXCursorRecordList)),
+
   ("clang_getCursorReferenced",
    [Cursor],
    Cursor,
@@ -3731,6 +3833,8 @@ __all__ = [
     'CompileCommand',
     'CursorKind',
     'Cursor',
+    'CursorRecord',
+    'CursorRecordList',
     'Diagnostic',
     'File',
     'FixIt',
@@ -0,0 +1,75 @@
+from clang.cindex import CursorKind
+from clang.cindex import TranslationUnit
+
+from .util import get_cursor
+from .util import get_tu
+
+kInput = """\
+struct S { int x; };
+int f(struct S *s) { return s->x; }
+"""
+
+def test_get_records():
+    tu = get_tu(kInput)
+    records = tu.cursor.get_records()
+
+    assert len(records) > 0
+    assert records[0].kind == CursorKind.STRUCT_DECL
+    assert records[0].spelling == 'S'
+    assert records[0].usr == 'c:@S@S'
+    assert records[0].parent == -1
+    assert (records[0].start_line, records[0].start_column) == (1, 1)
+    assert (records[0].end_line, records[0].end_column) == (1, 20)
+    assert records[0].cursor == get_cursor(tu, 'S')
+
+    assert records[1].kind == CursorKind.FIELD_DECL
+    assert records[1].spelling == 'x'
+    assert records[1].parent == 0
+
+def test_references():
+    tu = get_tu(kInput)
+    records = tu.cursor.get_records()
+
+    members = [r for r in records if r.kind == CursorKind.MEMBER_REF_EXPR]
+    assert len(members) == 1
+    field = records[members[0].referenced]
+    assert field.kind == CursorKind.FIELD_DECL
+    assert field.spelling == 'x'
+    assert members[0].referenced_cursor == field.cursor
+
+def test_parents_precede_children():
+    tu = get_tu(kInput)
+    records = tu.cursor.get_records()
+
+    for i in range(len(records)):
+        assert records[i].parent < i
+        if records[i].parent >= 0:
+            parent = records[records[i].parent]
+            assert parent.start_offset <= records[i].start_offset
+
+def test_without_usrs():
+    tu = get_tu(kInput)
+    records = tu.cursor.get_records(include_usrs=False)
+
+    assert len(records) > 0
+    assert all(r.usr == '' for r in records)
+
+def test_file_filter():
+    tu = TranslationUnit.from_source('t.c', unsaved_files=[
+            ('t.c', '#include "header.h"\nint y;'),
+            ('header.h', 'int x;')])
+    records = tu.cursor.get_records(file='t.c')
+
+    assert [r.spelling for r in records] == ['y']
+
+def test_file_filter_keeps_descendants():
+    tu = TranslationUnit.from_source('t.c', unsaved_files=[
+            ('t.c', '#include "header.h"\nstruct T {\n#include "fields.h"\n};'),
+            ('header.h', 'int x;'),
+            ('fields.h', 'int y;')])
+    records = tu.cursor.get_records(file='t.c')
+
+    assert [r.spelling for r in records] == ['T', 'y']
+    assert records[1].kind == CursorKind.FIELD_DECL
+    assert records[1].parent == 0
+    assert records[1].file.name == 'fields.h'
@@ -32,7 +32,7 @@
  * compatible, thus CINDEX_VERSION_MAJOR is expected to remain stable.
  */
 #define CINDEX_VERSION_MAJOR 0
-#define CINDEX_VERSION_MINOR 35
+#define CINDEX_VERSION_MINOR 38
 
 #define CINDEX_VERSION_ENCODE(major, minor) ( \
       ((major) * 10000)                       \
@@ -274,6 +274,19 @@ CINDEX_LINKAGE void clang_CXIndex_setGlobalOptions(CXIndex, unsigned options);
  */
 CINDEX_LINKAGE unsigned clang_CXIndex_getGlobalOptions(CXIndex);
 
+/**
+ * \brief Sets the maximum number of bytes of precompiled preambles that the
+ * translation units of a CXIndex keep in memory.
+ *
+ * This only affects translation units parsed with
+ * \c CXTranslationUnit_StorePreamblesInMemory. When storing a preamble would
+ * exceed the limit, the least recently used preambles are dropped; their
+ * translation units precompile them again the next time they are reparsed.
+ * A preamble larger than the limit itself is written to a temporary file.
+ */
+CINDEX_LINKAGE void clang_CXIndex_setInMemoryPreambleLimit(CXIndex,
+                                                  unsigned long long MaxBytes);
+
 /**
  * \defgroup CINDEX_FILES File manipulation routines
  *
@@ -1219,7 +1232,16 @@ enum CXTranslationUnit_Flags {
    * purposes of an IDE, this is undesirable behavior and as much information
    * as possible should be reported. Use this flag to enable this behavior.
    */
-  CXTranslationUnit_KeepGoing = 0x200
+  CXTranslationUnit_KeepGoing = 0x200,
+
+  /**
+   * \brief Used to indicate that the precompiled preamble should be kept in
+   * memory rather than in a temporary file.
+   *
+   * The preambles of the translation units of a CXIndex share a memory budget,
+   * see \c clang_CXIndex_setInMemoryPreambleLimit().
+   */
+  CXTranslationUnit_StorePreamblesInMemory = 0x400
 };
 
 /**
@@ -1478,6 +1500,20 @@ CINDEX_LINKAGE int clang_reparseTranslationUnit(CXTranslationUnit TU,
                                           struct CXUnsavedFile *unsaved_files,
                                                 unsigned options);
 
+/**
+ * \brief Returns the version of the snapshot of the last successful parse of
+ * the translation unit, or 0 if there was none.
+ *
+ * Every successful parse or reparse of the translation unit publishes a new
+ * snapshot, with a version one higher than the previous one. Code completion
+ * with \c CXCodeComplete_UseSnapshot runs against the latest snapshot.
+ *
+ * This routine may be called while the translation unit is being reparsed on
+ * another thread.
+ */
+CINDEX_LINKAGE unsigned
+clang_getTranslationUnitSnapshotVersion(CXTranslationUnit TU);
+
 /**
   * \brief Categorizes how memory is being used by a translation unit.
   */
@@ -3714,6 +3750,116 @@ CINDEX_LINKAGE unsigned clang_visitChildrenWithBlock(CXCursor parent,
 #  endif
 #endif
 
+/**
+ * \brief Describes a cursor found by \c clang_getCursorRecords(), along with
+ * the information most often queried about it.
+ */
+typedef struct {
+  /** \brief The cursor itself. */
+  CXCursor cursor;
+
+  /**
+   * \brief The cursor referenced by this cursor, as returned by
+   * \c clang_getCursorReferenced().
+   */
+  CXCursor referencedCursor;
+
+  /** \brief The kind of the cursor. */
+  enum CXCursorKind kind;
+
+  /** \brief The spelling of the cursor, as by \c clang_getCursorSpelling(). */
+  const char *spelling;
+
+  /**
+   * \brief The USR of the cursor, as by \c clang_getCursorUSR(), or an empty
+   * string if USRs were not requested.
+   */
+  const char *usr;
+
+  /** \brief The file in which the extent of the cursor starts, if any. */
+  CXFile file;
+
+  /**
+   * \brief The expansion locations of the start and end of the extent of the
+   * cursor.
+   */
+  unsigned startLine;
+  unsigned startColumn;
+  unsigned startOffset;
+  unsigned endLine;
+  unsigned endColumn;
+  unsigned endOffset;
+
+  /**
+   * \brief The index of the record of the parent of this cursor, or -1 if
+   * its parent is the cursor whose descendants were requested.
+   */
+  int parent;
+
+  /**
+   * \brief The index of the record of \c referencedCursor, or -1 if it has
+   * none among the records.
+   */
+  int referenced;
+} CXCursorRecord;
+
+/**
+ * \brief Identifies an array of cursor records.
+ */
+typedef struct {
+  /** \brief The number of records in the \c records array. */
+  unsigned count;
+  /**
+   * \brief An array of \c CXCursorRecords, in depth-first preorder.
+   */
+  CXCursorRecord *records;
+} CXCursorRecordList;
+
+/**
+ * \brief Flags that control which information \c clang_getCursorRecords()
+ * collects.
+ */
+enum CXCursorRecordFlags {
+  /**
+   * \brief Used to indicate that no special options are requested.
+   */
+  CXCursorRecord_None = 0x0,
+
+  /**
+   * \brief Compute the USR of each cursor.
+   */
+  CXCursorRecord_IncludeUSRs = 0x1
+};
+
+/**
+ * \brief Describe all the descendants of a cursor in one call.
+ *
+ * This visits the descendants of \p parent as \c clang_visitChildren() would
+ * with a visitor that always recurses, and returns one record per cursor
+ * visited. Clients that would otherwise query each cursor separately, e.g.
+ * through bindings for which each call is expensive, can use it to walk a
+ * whole translation unit at once.
+ *
+ * \param parent the cursor whose descendants should be described, e.g. the
+ * translation unit cursor.
+ *
+ * \param file if non-NULL, only the cursors whose extent starts in this file,
+ * and their descendants, are described.
+ *
+ * \param options a bitmask of options, from \c CXCursorRecordFlags.
+ *
+ * \returns the records, which remain valid until they are disposed of with
+ * \c clang_disposeCursorRecordList() or the translation unit is destroyed.
+ */
+CINDEX_LINKAGE CXCursorRecordList *clang_getCursorRecords(CXCursor parent,
+                                                          CXFile file,
+                                                          unsigned options);
+
+/**
+ * \brief Destroy the given \c CXCursorRecordList.
+ */
+CINDEX_LINKAGE void clang_disposeCursorRecordList(CXCursorRecordList *records);
+
 /**
  * @}
  */
@@ -4836,7 +4982,18 @@ enum CXCodeComplete_Flags {
    * \brief Whether to include brief documentation within the set of code
    * completions returned.
    */
-  CXCodeComplete_IncludeBriefComments = 0x04
+  CXCodeComplete_IncludeBriefComments = 0x04,
+
+  /**
+   * \brief Whether to perform code completion against the snapshot of the
+   * last successful parse of the translation unit, rather than against the
+   * translation unit itself.
+   *
+   * Code completion with this flag may run on one thread while
+   * \c clang_reparseTranslationUnit() runs on another. It does not use the
+   * code-completion results cached by the translation unit.
+   */
+  CXCodeComplete_UseSnapshot = 0x08
 };
 
 /**
@@ -5149,6 +5306,21 @@ CXString clang_codeCompleteGetContainerUSR(CXCodeCompleteResults *Results);
  */
 CINDEX_LINKAGE
 CXString clang_codeCompleteGetObjCSelector(CXCodeCompleteResults *Results);
+
+/**
+ * \brief Returns the version of the translation unit snapshot the
+ * code-completion results were computed against.
+ *
+ * For code completion performed without \c CXCodeComplete_UseSnapshot, this is
+ * the version of the translation unit's latest snapshot at the time.
+ *
+ * \param Results the code completion results to query
+ *
+ * \returns the snapshot version, or 0 if the translation unit had not been
+ * parsed successfully.
+ */
+CINDEX_LINKAGE
+unsigned clang_codeCompleteGetSnapshotVersion(CXCodeCompleteResults *Results);
   
 /**
  * @}
@@ -53,6 +53,8 @@ namespace clang {
   class ASTRecordLayout;
   class BlockExpr;
   class CharUnits;
+  class ConstexprCallCache;
+  class ConstexprInterpreter;
   class DiagnosticsEngine;
   class Expr;
   class ASTMutationListener;
@@ -187,6 +189,14 @@ class ASTContext : public RefCountedBase<ASTContext> {
   llvm::DenseMap<const MaterializeTemporaryExpr *, APValue *>
     MaterializedTemporaryValues;
 
+  /// \brief The memoized results of constexpr function calls, created on
+  /// first use.
+  std::unique_ptr<ConstexprCallCache> ConstexprCalls;
+
+  /// \brief The bytecode interpreter for constexpr function calls, created on
+  /// first use.
+  std::unique_ptr<ConstexprInterpreter> ConstexprInterp;
+
   /// \brief Representation of a "canonical" template template parameter that
   /// is used in canonical template names.
   class CanonicalTemplateTemplateParm : public llvm::FoldingSetNode {
@@ -2438,6 +2448,12 @@ public:
   APValue *getMaterializedTemporaryValue(const MaterializeTemporaryExpr *E,
                                          bool MayCreate);
 
+  /// \brief Get the cache of the results of constexpr function calls.
+  ConstexprCallCache &getConstexprCallCache();
+
+  /// \brief Get the bytecode interpreter for constexpr function calls.
+  ConstexprInterpreter &getConstexprInterpreter();
+
   //===--------------------------------------------------------------------===//
   //                    Statistics
   //===--------------------------------------------------------------------===//
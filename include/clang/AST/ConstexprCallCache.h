@@ -0,0 +1,74 @@
+//===--- ConstexprCallCache.h - Memoized constexpr calls --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the ConstexprCallCache class, which remembers the results
+//  of constexpr function calls.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_AST_CONSTEXPRCALLCACHE_H
+#define LLVM_CLANG_AST_CONSTEXPRCALLCACHE_H
+
+#include "clang/AST/APValue.h"
+#include "llvm/ADT/FoldingSet.h"
+#include <deque>
+
+namespace clang {
+
+/// \brief The results of constexpr function calls, keyed by a profile of the
+/// call.
+///
+/// The constant evaluator decides which calls can be memoized and how to
+/// profile them: the key must identify the callee, the evaluation mode and
+/// the values of the arguments, and the result must not depend on anything
+/// else. Once the cache is full, the oldest results are evicted first.
+class ConstexprCallCache {
+  class Entry : public llvm::FastFoldingSetNode {
+  public:
+    Entry(const llvm::FoldingSetNodeID &Key, const APValue &Result)
+        : FastFoldingSetNode(Key), Result(Result) {}
+
+    APValue Result;
+  };
+
+  llvm::FoldingSet<Entry> Entries;
+
+  /// \brief The entries, oldest first.
+  std::deque<Entry *> InsertionOrder;
+
+  unsigned MaxEntries;
+
+  unsigned NumHits;
+  unsigned NumMisses;
+  unsigned NumEvictions;
+
+  ConstexprCallCache(const ConstexprCallCache &) = delete;
+  void operator=(const ConstexprCallCache &) = delete;
+
+public:
+  /// \brief Create a cache holding at most \p MaxEntries results.
+  explicit ConstexprCallCache(unsigned MaxEntries);
+  ~ConstexprCallCache();
+
+  /// \brief Retrieve the result of the call with the given key, or null if it
+  /// has not been memoized.
+  const APValue *lookup(const llvm::FoldingSetNodeID &Key);
+
+  /// \brief Memoize the result of the call with the given key.
+  void insert(const llvm::FoldingSetNodeID &Key, const APValue &Result);
+
+  /// \brief The number of results in the cache.
+  unsigned size() const { return InsertionOrder.size(); }
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,89 @@
+//===--- ConstexprInterpreter.h - Bytecode for constexpr calls --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the ConstexprInterpreter class, which evaluates calls to
+//  constexpr functions by compiling their bodies to bytecode.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_AST_CONSTEXPRINTERPRETER_H
+#define LLVM_CLANG_AST_CONSTEXPRINTERPRETER_H
+
+#include "clang/AST/APValue.h"
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include <memory>
+
+namespace clang {
+
+class ASTContext;
+class FunctionDecl;
+
+/// \brief Evaluates calls to constexpr functions by compiling each function
+/// body to bytecode once, and then interpreting the bytecode on a stack of
+/// 64-bit integers.
+///
+/// Only a subset of the language is supported: functions whose parameters,
+/// local variables and result all have integral or enumeration type, and
+/// whose bodies consist of the arithmetic, control flow and calls to other
+/// such functions. The interpreter never diagnoses anything. Whenever a
+/// function is outside of that subset, or evaluating a call would not produce
+/// a constant (because of an overflow, a division by zero, or exhausting the
+/// step or depth limit, for instance), it gives up, and the caller evaluates
+/// the call with the tree-walking evaluator instead, which produces the
+/// diagnostics.
+class ConstexprInterpreter {
+public:
+  class Function;
+
+private:
+  ASTContext &Ctx;
+
+  /// \brief The compiled functions, keyed by their definition. Functions
+  /// outside of the supported subset are mapped to null.
+  llvm::DenseMap<const FunctionDecl *, std::unique_ptr<Function>> Functions;
+
+  unsigned NumCompiled;
+  unsigned NumRejected;
+  unsigned NumCalls;
+  unsigned NumBailouts;
+
+  ConstexprInterpreter(const ConstexprInterpreter &) = delete;
+  void operator=(const ConstexprInterpreter &) = delete;
+
+  bool run(const Function *F, ArrayRef<int64_t> Args, unsigned &StepsLeft,
+           unsigned MaxDepth, int64_t &Result);
+
+public:
+  explicit ConstexprInterpreter(ASTContext &Ctx);
+  ~ConstexprInterpreter();
+
+  /// \brief Retrieve the compiled form of the given function definition,
+  /// compiling it if needed, or null if it cannot be compiled.
+  const Function *getFunction(const FunctionDecl *Definition);
+
+  /// \brief Evaluate a call to \p Callee, which must be a function
+  /// definition, with the given arguments.
+  ///
+  /// \param StepsLeft The number of statements that may still be evaluated;
+  /// updated as they are.
+  /// \param MaxDepth The number of nested calls the call may still make.
+  ///
+  /// \returns true and sets \p Result if the call was evaluated, or false if
+  /// the call has to be evaluated by other means.
+  bool evaluateCall(const FunctionDecl *Callee, ArrayRef<APValue> Args,
+                    unsigned &StepsLeft, unsigned MaxDepth, APValue &Result);
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
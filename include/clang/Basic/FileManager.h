@@ -34,6 +34,7 @@ class MemoryBuffer;
 namespace clang {
 class FileManager;
 class FileSystemStatCache;
+class SharedFileSystemCache;
 
 /// \brief Cached information about one directory (either on disk or in
 /// the virtual file system).
@@ -165,6 +166,10 @@ class FileManager : public RefCountedBase<FileManager> {
   // Caching.
   std::unique_ptr<FileSystemStatCache> StatCache;
 
+  /// \brief A stat and file content cache shared with other FileManagers,
+  /// if any.
+  IntrusiveRefCntPtr<SharedFileSystemCache> SharedCache;
+
   bool getStatValue(const char *Path, FileData &Data, bool isFile,
                     std::unique_ptr<vfs::File> *F);
 
@@ -197,6 +202,14 @@ public:
   /// \brief Removes all FileSystemStatCache objects from the manager.
   void clearStatCaches();
 
+  /// \brief Use \p Cache, which may be shared with other FileManagers, to
+  /// avoid repeated stats and reads of the same files.
+  ///
+  /// Unlike the stat caches above, this is not removed by clearStatCaches().
+  void setSharedCache(IntrusiveRefCntPtr<SharedFileSystemCache> Cache);
+
+  SharedFileSystemCache *getSharedCache() const { return SharedCache.get(); }
+
   /// \brief Lookup, cache, and verify the specified directory (real or
   /// virtual).
   ///
@@ -236,9 +249,14 @@ public:
 
   /// \brief Open the specified file as a MemoryBuffer, returning a new
   /// MemoryBuffer if successful, otherwise returning null.
+  ///
+  /// Files that do not need a null terminator, such as AST files, can always
+  /// be memory-mapped, and are then shared through the shared cache without
+  /// being copied.
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
   getBufferForFile(const FileEntry *Entry, bool isVolatile = false,
-                   bool ShouldCloseOpenFile = true);
+                   bool ShouldCloseOpenFile = true,
+                   bool RequiresNullTerminator = true);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
   getBufferForFile(StringRef Filename);
 
@@ -254,6 +272,11 @@ public:
   /// \brief Remove the real file \p Entry from the cache.
   void invalidateCache(const FileEntry *Entry);
 
+  /// \brief Remove what the shared cache, if any, knows about the file at
+  /// \p Filename, because it was replaced (e.g. a rebuilt module file). The
+  /// FileEntry of this FileManager, if any, is kept.
+  void invalidateSharedCache(StringRef Filename);
+
   /// \brief If path is not absolute and FileSystemOptions set the working
   /// directory, the path is modified to be relative to the given
   /// working directory.
@@ -16,9 +16,19 @@
 #define LLVM_CLANG_BASIC_FILESYSTEMSTATCACHE_H
 
 #include "clang/Basic/LLVM.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/FileSystem.h"
+#include <atomic>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace llvm {
+class MemoryBuffer;
+}
 
 namespace clang {
 
@@ -126,6 +136,135 @@ public:
                        vfs::FileSystem &FS) override;
 };
 
+/// \brief A thread-safe cache of 'stat' results and file contents that can be
+/// shared by the FileManagers of several compilations in one process, e.g.
+/// the translation units processed by a \c ClangTool or the ASTUnits of one
+/// libclang index.
+///
+/// Entries are kept separately for each virtual file system, so that
+/// FileManagers over different overlays never see each other's files. Like
+/// \c MemorizeStatCalls, only successful stats are recorded, and only for
+/// absolute paths. File contents are keyed by (unique ID, modification
+/// time); every FileManager reading the same header gets a reference to the
+/// same buffer instead of rereading it. Contents read without a null
+/// terminator, such as memory-mapped AST files, are cached separately from
+/// the others, and are only handed out to clients that do not need the
+/// terminator either.
+///
+/// Cached contents are trusted without statting the file again, so files that
+/// change while the cache is in use must be invalidated, which
+/// \c FileManager::invalidateCache() and
+/// \c FileManager::invalidateSharedCache() do. The total size of the cached
+/// contents is bounded; the least recently used ones are dropped first.
+/// Buffers handed out stay valid after their entry is dropped.
+class SharedFileSystemCache
+    : public llvm::ThreadSafeRefCountedBase<SharedFileSystemCache> {
+  /// The unique ID, modification time and whether the buffer is
+  /// null-terminated.
+  typedef std::tuple<llvm::sys::fs::UniqueID, time_t, bool> BufferKey;
+
+  /// The keys of the cached contents, in order of use.
+  typedef std::list<std::pair<vfs::FileSystem *, BufferKey>> UseOrderList;
+
+  struct BufferEntry {
+    std::shared_ptr<llvm::MemoryBuffer> Buffer;
+    /// The position of the entry in \c UseOrder.
+    UseOrderList::iterator UseOrderPos;
+  };
+
+  /// \brief The entries of one virtual file system.
+  struct FileSystemEntries {
+    /// Keeps the file system alive, so that its address is not reused for
+    /// another one while entries are cached for it.
+    IntrusiveRefCntPtr<vfs::FileSystem> FS;
+    llvm::StringMap<FileData, llvm::BumpPtrAllocator> StatCalls;
+    std::map<BufferKey, BufferEntry> Buffers;
+  };
+
+  mutable std::mutex Lock;
+  std::map<vfs::FileSystem *, FileSystemEntries> Entries;
+  /// The cached contents, most recently used first.
+  UseOrderList UseOrder;
+  uint64_t BufferBytes;
+  uint64_t MaxBufferBytes;
+
+  // Statistics.
+  std::atomic<unsigned> NumStatHits, NumStatMisses;
+  std::atomic<unsigned> NumBufferHits, NumBufferMisses;
+  unsigned NumBufferEvictions;
+
+  FileSystemEntries &getEntries(vfs::FileSystem &FS);
+  void dropBuffers(FileSystemEntries &E,
+                   const llvm::sys::fs::UniqueID &UniqueID);
+  void evictBuffers();
+
+public:
+  /// \brief The default bound on the total size of the cached contents.
+  static const uint64_t DefaultMaxBufferBytes = 256 << 20;
+
+  explicit SharedFileSystemCache(
+      uint64_t MaxBufferBytes = DefaultMaxBufferBytes);
+  ~SharedFileSystemCache();
+
+  /// \brief Look up the cached 'stat' information for the absolute path
+  /// \p Path in \p FS.
+  ///
+  /// \returns \c true and fills in \p Data if the path is cached.
+  bool lookupStat(vfs::FileSystem &FS, StringRef Path, FileData &Data);
+
+  /// \brief Record the 'stat' information of the existing absolute path
+  /// \p Path in \p FS.
+  void addStat(vfs::FileSystem &FS, StringRef Path, const FileData &Data);
+
+  /// \brief Return a reference to the cached contents of the file of \p FS
+  /// with the given identity, or null if it is not cached.
+  ///
+  /// \param Name The buffer identifier to use for the returned buffer.
+  ///
+  /// \param RequiresNullTerminator Whether the returned buffer must be
+  /// null-terminated. If not, a buffer cached without a terminator is
+  /// preferred.
+  std::unique_ptr<llvm::MemoryBuffer>
+  lookupBuffer(vfs::FileSystem &FS, const llvm::sys::fs::UniqueID &UniqueID,
+               time_t ModTime, uint64_t Size, StringRef Name,
+               bool RequiresNullTerminator = true);
+
+  /// \brief Take ownership of \p Buffer, the contents of the file of \p FS
+  /// with the given identity, and return a reference to the cached contents.
+  ///
+  /// If another thread cached the same file first, its buffer is kept and
+  /// \p Buffer is discarded.
+  ///
+  /// \param IsNullTerminated Whether \p Buffer was read with a null
+  /// terminator.
+  std::unique_ptr<llvm::MemoryBuffer>
+  addBuffer(vfs::FileSystem &FS, const llvm::sys::fs::UniqueID &UniqueID,
+            time_t ModTime, std::unique_ptr<llvm::MemoryBuffer> Buffer,
+            bool IsNullTerminated = true);
+
+  /// \brief Drop the cached 'stat' information of the absolute path \p Path
+  /// in \p FS, and all of the cached contents of the file with the given
+  /// identity, because the file changed.
+  void invalidate(vfs::FileSystem &FS, StringRef Path,
+                  const llvm::sys::fs::UniqueID &UniqueID);
+
+  /// \brief Drop the cached 'stat' information of the absolute path \p Path
+  /// in \p FS, and the cached contents of the file it described, because
+  /// the file was replaced.
+  void invalidate(vfs::FileSystem &FS, StringRef Path);
+
+  /// \brief Drop all cached 'stat' information and file contents.
+  void clear();
+
+  /// \brief The number of cached file contents.
+  unsigned getNumBuffers() const;
+
+  /// \brief The total size of the cached file contents.
+  uint64_t getBufferBytes() const;
+
+  void PrintStats() const;
+};
+
 } // end namespace clang
 
 #endif
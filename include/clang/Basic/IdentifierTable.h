@@ -17,11 +17,15 @@
 #define LLVM_CLANG_BASIC_IDENTIFIERTABLE_H
 
 #include "clang/Basic/LLVM.h"
+#include "clang/Basic/SharedIdentifierPool.h"
 #include "clang/Basic/TokenKinds.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include <algorithm>
 #include <cassert>
+#include <iterator>
 #include <string>
+#include <vector>
 
 namespace llvm {
   template <typename T> struct DenseMapInfo;
@@ -103,7 +107,8 @@ public:
     // of the PTH file format here.
     // The 'this' pointer really points to a
     // std::pair<IdentifierInfo, const char*>, where internal pointer
-    // points to the external string data.
+    // points to the external string data (in a PTH file or a
+    // SharedIdentifierPool).
     typedef std::pair<IdentifierInfo, const char*> actualtype;
     return ((const actualtype*) this)->second;
   }
@@ -451,11 +456,64 @@ class IdentifierTable {
 
   IdentifierInfoLookup* ExternalLookup;
 
+  /// \brief The pool holding the names of the identifiers, if any.
+  ///
+  /// With a pool, \c HashTable only holds identifiers whose names are too
+  /// long for the pool.
+  IntrusiveRefCntPtr<SharedIdentifierPool> Pool;
+
+  /// \brief The identifiers whose names are in \c Pool, indexed by the ID of
+  /// their pool entry.
+  std::vector<IdentifierInfo*> PoolIdentifiers;
+  unsigned NumPoolIdentifiers;
+
+  IdentifierInfo &getPooled(const SharedIdentifierPool::Entry &PE, bool Own) {
+    unsigned ID = PE.getID();
+    if (ID >= PoolIdentifiers.size())
+      PoolIdentifiers.resize(std::max<size_t>(ID + 1,
+                                              PoolIdentifiers.size() * 2));
+    if (IdentifierInfo *II = PoolIdentifiers[ID])
+      return *II;
+
+    // No entry; if we have an external lookup, look there first.  It may add
+    // the identifier itself through getOwn().
+    if (!Own && ExternalLookup) {
+      if (IdentifierInfo *II = ExternalLookup->get(PE.getName())) {
+        if (!PoolIdentifiers[ID])
+          ++NumPoolIdentifiers;
+        PoolIdentifiers[ID] = II;
+        return *II;
+      }
+    }
+
+    // Lookups failed, make a new IdentifierInfo that refers to the name in
+    // the pool.
+    typedef std::pair<IdentifierInfo, const char*> PooledInfo;
+    PooledInfo *Mem = getAllocator().Allocate<PooledInfo>();
+    Mem->second = PE.getNameStart();
+    IdentifierInfo *II = new ((void*) Mem) IdentifierInfo();
+    PoolIdentifiers[ID] = II;
+    ++NumPoolIdentifiers;
+
+    // If this is the 'import' contextual keyword, mark it as such.
+    if (Own && PE.getName().equals("import"))
+      II->setModulesImport(true);
+
+    return *II;
+  }
+
 public:
   /// \brief Create the identifier table, populating it with info about the
   /// language keywords for the language specified by \p LangOpts.
+  ///
+  /// If \p Pool is given, the names of the identifiers are interned in it
+  /// rather than copied into this table.
   IdentifierTable(const LangOptions &LangOpts,
-                  IdentifierInfoLookup* externalLookup = nullptr);
+                  IdentifierInfoLookup* externalLookup = nullptr,
+                  IntrusiveRefCntPtr<SharedIdentifierPool> Pool = nullptr);
+
+  /// \brief Retrieve the pool holding the names of the identifiers, if any.
+  SharedIdentifierPool *getIdentifierPool() const { return Pool.get(); }
 
   /// \brief Set the external identifier lookup mechanism.
   void setExternalIdentifierLookup(IdentifierInfoLookup *IILookup) {
@@ -474,6 +532,10 @@ public:
   /// \brief Return the identifier token info for the specified named
   /// identifier.
   IdentifierInfo &get(StringRef Name) {
+    if (Pool)
+      if (const SharedIdentifierPool::Entry *PE = Pool->intern(Name))
+        return getPooled(*PE, /*Own=*/false);
+
     auto &Entry = *HashTable.insert(std::make_pair(Name, nullptr)).first;
 
     IdentifierInfo *&II = Entry.second;
@@ -511,6 +573,10 @@ public:
   /// introduce or modify an identifier. If they called get(), they would
   /// likely end up in a recursion.
   IdentifierInfo &getOwn(StringRef Name) {
+    if (Pool)
+      if (const SharedIdentifierPool::Entry *PE = Pool->intern(Name))
+        return getPooled(*PE, /*Own=*/true);
+
     auto &Entry = *HashTable.insert(std::make_pair(Name, nullptr)).first;
 
     IdentifierInfo *&II = Entry.second;
@@ -532,12 +598,70 @@ public:
     return *II;
   }
 
-  typedef HashTableTy::const_iterator iterator;
-  typedef HashTableTy::const_iterator const_iterator;
+  /// \brief Iterates over the (name, identifier) pairs in the table, in no
+  /// particular order.
+  class const_iterator
+      : public std::iterator<std::forward_iterator_tag,
+                             const std::pair<StringRef, IdentifierInfo *>> {
+    HashTableTy::const_iterator HashI, HashE;
+    std::vector<IdentifierInfo*>::const_iterator PoolI, PoolE;
+    std::pair<StringRef, IdentifierInfo *> Current;
+
+    void settle() {
+      if (HashI != HashE) {
+        Current = std::make_pair(HashI->getKey(), HashI->getValue());
+        return;
+      }
+      while (PoolI != PoolE && !*PoolI)
+        ++PoolI;
+      if (PoolI != PoolE)
+        Current = std::make_pair((*PoolI)->getName(), *PoolI);
+    }
+
+  public:
+    const_iterator(HashTableTy::const_iterator HashI,
+                   HashTableTy::const_iterator HashE,
+                   std::vector<IdentifierInfo*>::const_iterator PoolI,
+                   std::vector<IdentifierInfo*>::const_iterator PoolE)
+        : HashI(HashI), HashE(HashE), PoolI(PoolI), PoolE(PoolE) {
+      settle();
+    }
+
+    reference operator*() const { return Current; }
+    pointer operator->() const { return &Current; }
 
-  iterator begin() const { return HashTable.begin(); }
-  iterator end() const   { return HashTable.end(); }
-  unsigned size() const { return HashTable.size(); }
+    const_iterator &operator++() {
+      if (HashI != HashE)
+        ++HashI;
+      else
+        ++PoolI;
+      settle();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator Tmp = *this;
+      ++*this;
+      return Tmp;
+    }
+
+    bool operator==(const const_iterator &RHS) const {
+      return HashI == RHS.HashI && PoolI == RHS.PoolI;
+    }
+    bool operator!=(const const_iterator &RHS) const {
+      return !(*this == RHS);
+    }
+  };
+  typedef const_iterator iterator;
+
+  iterator begin() const {
+    return const_iterator(HashTable.begin(), HashTable.end(),
+                          PoolIdentifiers.begin(), PoolIdentifiers.end());
+  }
+  iterator end() const {
+    return const_iterator(HashTable.end(), HashTable.end(),
+                          PoolIdentifiers.end(), PoolIdentifiers.end());
+  }
+  unsigned size() const { return HashTable.size() + NumPoolIdentifiers; }
 
   /// \brief Print some statistics to stderr that indicate how well the
   /// hashing is doing.
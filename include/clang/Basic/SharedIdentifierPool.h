@@ -0,0 +1,118 @@
+//===--- SharedIdentifierPool.h - Thread-safe identifier names --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the clang::SharedIdentifierPool interface.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_BASIC_SHAREDIDENTIFIERPOOL_H
+#define LLVM_CLANG_BASIC_SHAREDIDENTIFIERPOOL_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace clang {
+
+/// \brief A thread-safe pool of interned identifier names that can be shared
+/// by the identifier tables of several compilations in one process, e.g. the
+/// translation units processed by a \c ClangTool.
+///
+/// Each \c IdentifierTable using the pool still owns its \c IdentifierInfo
+/// objects, since those record per-compilation state such as macro
+/// definitions, but their names, and the hash table used to look them up,
+/// live in the pool. Lookups of names already in the pool take no locks;
+/// adding a name takes a lock. Names are never removed, so the pool only
+/// suits processes that see broadly the same identifiers over and over.
+class SharedIdentifierPool
+    : public llvm::ThreadSafeRefCountedBase<SharedIdentifierPool> {
+public:
+  /// \brief An interned name.
+  ///
+  /// The name is stored after the entry, prefixed by its length plus one as a
+  /// 16-bit little-endian value and followed by a nul, which is the layout
+  /// \c IdentifierInfo expects of names it does not own.
+  class Entry {
+    unsigned Hash;
+    unsigned ID;
+
+    friend class SharedIdentifierPool;
+    Entry(unsigned Hash, unsigned ID) : Hash(Hash), ID(ID) {}
+
+  public:
+    /// \brief A dense, pool-wide index for this name, assigned in the order
+    /// names are added.
+    unsigned getID() const { return ID; }
+
+    const char *getNameStart() const {
+      return reinterpret_cast<const char *>(this + 1) + 2;
+    }
+
+    unsigned getLength() const {
+      const unsigned char *P =
+          reinterpret_cast<const unsigned char *>(this + 1);
+      return (P[0] | (P[1] << 8)) - 1;
+    }
+
+    StringRef getName() const { return StringRef(getNameStart(), getLength()); }
+  };
+
+  /// \brief The length of the longest name the pool can hold.
+  enum { MaxNameLength = 0xFFFE };
+
+private:
+  struct Table {
+    unsigned NumBuckets;
+    std::unique_ptr<std::atomic<const Entry *>[]> Buckets;
+
+    explicit Table(unsigned NumBuckets);
+    const Entry *find(StringRef Name, unsigned Hash) const;
+    void insert(const Entry *E);
+  };
+
+  /// The table readers use. Replaced tables are kept in \c Tables until the
+  /// pool is destroyed, since a concurrent reader may still be probing one.
+  std::atomic<Table *> Current;
+  std::vector<std::unique_ptr<Table>> Tables;
+
+  /// Guards adding names.
+  mutable std::mutex Lock;
+  llvm::BumpPtrAllocator Alloc;
+  std::atomic<unsigned> NumEntries;
+
+public:
+  /// \brief Create a pool with room for about \p InitialSize names before it
+  /// needs to grow.
+  explicit SharedIdentifierPool(unsigned InitialSize = 16384);
+  ~SharedIdentifierPool();
+
+  /// \brief Return the entry for \p Name, or null if it is not in the pool.
+  const Entry *find(StringRef Name) const;
+
+  /// \brief Return the entry for \p Name, adding it to the pool if needed.
+  ///
+  /// \returns null if \p Name is longer than \c MaxNameLength.
+  const Entry *intern(StringRef Name);
+
+  /// \brief The number of names in the pool.
+  unsigned size() const { return NumEntries; }
+
+  /// \brief The number of bytes allocated for names and hash tables.
+  size_t getMemorySize() const;
+};
+
+} // end namespace clang
+
+#endif
@@ -114,15 +114,20 @@ namespace SrcMgr {
 
     /// \brief A bump pointer allocated array of offsets for each source line.
     ///
-    /// This is lazily computed.  This is owned by the SourceManager
-    /// BumpPointerAllocator object.
+    /// This is lazily computed, a chunk at a time, so it may only cover a
+    /// prefix of the file; see \c LineTableComplete.  This is owned by the
+    /// SourceManager BumpPointerAllocator object.
     unsigned *SourceLineCache;
 
     /// \brief The number of lines in this ContentCache.
     ///
-    /// This is only valid if SourceLineCache is non-null.
+    /// This is only valid if SourceLineCache is non-null, and is the number
+    /// of lines computed so far unless \c LineTableComplete is set.
     unsigned NumLines;
 
+    /// \brief The number of entries allocated for SourceLineCache.
+    unsigned LineTableCapacity;
+
     /// \brief Indicates whether the buffer itself was provided to override
     /// the actual file contents.
     ///
@@ -139,12 +144,16 @@ namespace SrcMgr {
     /// after serialization and deserialization.
     unsigned IsTransient : 1;
 
+    /// \brief True if SourceLineCache covers every line of the buffer.
+    unsigned LineTableComplete : 1;
+
     ContentCache(const FileEntry *Ent = nullptr) : ContentCache(Ent, Ent) {}
 
     ContentCache(const FileEntry *Ent, const FileEntry *contentEnt)
       : Buffer(nullptr, false), OrigEntry(Ent), ContentsEntry(contentEnt),
-        SourceLineCache(nullptr), NumLines(0), BufferOverridden(false),
-        IsSystemFile(false), IsTransient(false) {}
+        SourceLineCache(nullptr), NumLines(0), LineTableCapacity(0),
+        BufferOverridden(false), IsSystemFile(false), IsTransient(false),
+        LineTableComplete(false) {}
     
     ~ContentCache();
     
@@ -153,7 +162,8 @@ namespace SrcMgr {
     /// is not transferred, so this is a logical error.
     ContentCache(const ContentCache &RHS)
       : Buffer(nullptr, false), SourceLineCache(nullptr),
-        BufferOverridden(false), IsSystemFile(false), IsTransient(false) {
+        LineTableCapacity(0), BufferOverridden(false), IsSystemFile(false),
+        IsTransient(false), LineTableComplete(false) {
       OrigEntry = RHS.OrigEntry;
       ContentsEntry = RHS.ContentsEntry;
 
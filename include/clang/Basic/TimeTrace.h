@@ -0,0 +1,128 @@
+//===--- TimeTrace.h - Hierarchical compilation time trace ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the TimeTraceProfiler, which records how long each part of
+/// a compilation takes and writes the result in the Chrome trace event
+/// format, for viewing in chrome://tracing.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_BASIC_TIMETRACE_H
+#define LLVM_CLANG_BASIC_TIMETRACE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace clang {
+
+/// \brief Records nested time intervals of a compilation, such as the parsing
+/// of a header or the instantiation of a template.
+///
+/// Besides the individual intervals, the profiler keeps the total time and
+/// the number of occurrences of each kind of interval, so that the cost of,
+/// e.g., all template instantiations of a translation unit can be read at a
+/// glance.
+class TimeTraceProfiler {
+public:
+  typedef std::chrono::steady_clock Clock;
+  typedef std::chrono::microseconds Duration;
+
+private:
+  struct Entry {
+    Clock::time_point Start;
+    Duration Length;
+    std::string Name;
+    std::string Detail;
+  };
+
+  /// \brief The intervals that have begun but not ended, innermost last.
+  std::vector<Entry> Stack;
+
+  /// \brief The intervals that have ended and are long enough to be kept.
+  std::vector<Entry> Entries;
+
+  /// \brief The number of occurrences and the total length of the intervals
+  /// with each name. Intervals nested in one with the same name, such as
+  /// recursive instantiations, are only counted as part of the outermost
+  /// one.
+  llvm::StringMap<std::pair<unsigned, Duration>> Totals;
+
+  Clock::time_point StartTime;
+
+  /// \brief The minimum length of the intervals that are kept.
+  Duration Granularity;
+
+public:
+  explicit TimeTraceProfiler(unsigned GranularityInMicroseconds);
+
+  /// \brief Begin an interval. \p Detail describes the interval, e.g. by
+  /// naming the header or the template; it is a callback so that describing
+  /// intervals costs nothing when no trace is being recorded.
+  void begin(StringRef Name, llvm::function_ref<std::string()> Detail);
+
+  /// \brief End the innermost interval that has begun, which must be named
+  /// \p Name: intervals must be properly nested.
+  void end(StringRef Name);
+
+  /// \brief Write the intervals that have ended, and the totals, as a Chrome
+  /// trace.
+  void write(raw_ostream &OS);
+};
+
+/// \brief Start recording a time trace on this thread.
+void timeTraceProfilerInitialize(unsigned GranularityInMicroseconds);
+
+/// \brief Stop recording and discard the time trace of this thread.
+void timeTraceProfilerCleanup();
+
+/// \brief Retrieve the profiler recording the time trace of this thread, or
+/// null if there is none.
+TimeTraceProfiler *getTimeTraceProfiler();
+
+/// \brief Whether a time trace is being recorded on this thread.
+inline bool timeTraceProfilerEnabled() {
+  return getTimeTraceProfiler() != nullptr;
+}
+
+/// \brief Records the lifetime of a scope as an interval of the time trace,
+/// if one is being recorded.
+class TimeTraceScope {
+  TimeTraceProfiler *Profiler;
+  StringRef Name;
+
+  TimeTraceScope(const TimeTraceScope &) = delete;
+  void operator=(const TimeTraceScope &) = delete;
+
+public:
+  TimeTraceScope(StringRef Name, StringRef Detail)
+      : Profiler(getTimeTraceProfiler()), Name(Name) {
+    if (Profiler)
+      Profiler->begin(Name, [&]() { return Detail.str(); });
+  }
+
+  TimeTraceScope(StringRef Name, llvm::function_ref<std::string()> Detail)
+      : Profiler(getTimeTraceProfiler()), Name(Name) {
+    if (Profiler)
+      Profiler->begin(Name, Detail);
+  }
+
+  ~TimeTraceScope() {
+    if (Profiler)
+      Profiler->end(Name);
+  }
+};
+
+} // end namespace clang
+
+#endif
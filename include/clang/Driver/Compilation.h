@@ -239,8 +239,12 @@ public:
 
   /// ExecuteJob - Execute a single job.
   ///
+  /// When more than one parallel job is requested (via -j), commands which do
+  /// not depend on each other's outputs are run concurrently.
+  ///
   /// \param FailingCommands - For non-zero results, this will be a vector of
-  /// failing commands and their associated result code.
+  /// failing commands and their associated result code, in the order the
+  /// commands appear in \p Jobs.
   void ExecuteJobs(
       const JobList &Jobs,
       SmallVectorImpl<std::pair<int, const Command *>> &FailingCommands) const;
@@ -261,6 +265,24 @@ public:
   /// corresponding paths. This compilation instance becomes
   /// the owner of Redirects and will delete the array and StringRef's.
   void Redirect(const StringRef** Redirects);
+
+private:
+  /// PrintCommand - Print \p C if -v or CC_PRINT_OPTIONS was requested.
+  ///
+  /// \return False if the CC_PRINT_OPTIONS log file could not be opened.
+  bool PrintCommand(const Command &C) const;
+
+  /// FinishCommand - Diagnose the result of running \p C and compute the
+  /// result code reported by ExecuteCommand.
+  int FinishCommand(const Command &C, int Res, const std::string &Error,
+                    bool ExecutionFailed,
+                    const Command *&FailingCommand) const;
+
+  /// ExecuteJobsInParallel - Run \p Jobs on up to \p NumThreads threads,
+  /// respecting the dependencies between their source actions.
+  void ExecuteJobsInParallel(
+      const JobList &Jobs, unsigned NumThreads,
+      SmallVectorImpl<std::pair<int, const Command *>> &FailingCommands) const;
 };
 
 } // end namespace driver
@@ -92,6 +92,10 @@ class Driver {
   /// LTO mode selected via -f(no-)?lto(=.*)? options.
   LTOKind LTOMode;
 
+  /// Maximum number of jobs to execute concurrently, selected via
+  /// -j / --parallel-jobs=.
+  unsigned NumParallelJobs;
+
 public:
   // Diag - Forwarding function for diagnostics.
   DiagnosticBuilder Diag(unsigned DiagID) const {
@@ -271,6 +275,8 @@ public:
   bool embedBitcodeEnabled() const { return BitcodeEmbed == EmbedBitcode; }
   bool embedBitcodeMarkerOnly() const { return BitcodeEmbed == EmbedMarker; }
 
+  unsigned getNumParallelJobs() const { return NumParallelJobs; }
+
   /// @}
   /// @name Primary Functionality
   /// @{
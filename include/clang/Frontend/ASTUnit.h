@@ -18,9 +18,11 @@
 #include "clang/AST/ASTContext.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/FileSystemOptions.h"
+#include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetOptions.h"
+#include "clang/Frontend/InMemoryPreambleStore.h"
 #include "clang/Lex/HeaderSearchOptions.h"
 #include "clang/Lex/ModuleLoader.h"
 #include "clang/Lex/PreprocessingRecord.h"
@@ -34,6 +36,7 @@
 #include <cassert>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <sys/types.h>
 #include <utility>
@@ -253,6 +256,53 @@ public:
     }
   };
 
+  /// \brief What code completion needs from a successful parse of the
+  /// translation unit, so that it can run while the unit is being reparsed on
+  /// another thread.
+  ///
+  /// A snapshot never changes once it has been published; each successful
+  /// parse publishes a new one with a higher version. The precompiled preamble
+  /// a snapshot refers to is kept until the last snapshot referring to it is
+  /// destroyed, even if the translation unit has replaced it in the meantime.
+  class CompletionSnapshot {
+    friend class ASTUnit;
+
+    unsigned Version;
+    IntrusiveRefCntPtr<CompilerInvocation> Invocation;
+    FileSystemOptions FileSystemOpts;
+    IntrusiveRefCntPtr<vfs::FileSystem> VFS;
+
+    /// \brief The contents of the preamble precompiled to \c PreambleFile, if
+    /// the parse used one.
+    std::vector<char> Preamble;
+    bool PreambleEndsAtStartOfLine;
+    llvm::StringMap<PreambleFileHash> FilesInPreamble;
+    std::string PreambleFile;
+    std::string PreambleBaseFile;
+    IntrusiveRefCntPtr<InMemoryPreambleStore> PreambleStore;
+
+    CompletionSnapshot();
+    CompletionSnapshot(const CompletionSnapshot &) = delete;
+    void operator=(const CompletionSnapshot &) = delete;
+
+    std::unique_ptr<llvm::MemoryBuffer> getMainBufferWithPrecompiledPreamble(
+        CompilerInvocation &CCInvocation, FileManager &FileMgr,
+        unsigned MaxLines,
+        std::vector<std::shared_ptr<const InMemoryPreambleStore::Entry>>
+            &Pins) const;
+
+  public:
+    ~CompletionSnapshot();
+
+    /// \brief The number of successful parses of the translation unit up to
+    /// and including the one this snapshot was taken from.
+    unsigned getVersion() const { return Version; }
+
+    /// \brief Create a file manager that reads files the way the parse the
+    /// snapshot was taken from did, to perform code completion with.
+    FileManager *createFileManager() const;
+  };
+
 private:
   /// \brief The contents of the preamble that has been precompiled to
   /// \c PreambleFile.
@@ -292,7 +342,65 @@ private:
   /// \brief A list of the serialization ID numbers for each of the top-level
   /// declarations parsed within the precompiled preamble.
   std::vector<serialization::DeclID> TopLevelDeclsInPreamble;
-  
+
+  /// \brief If non-null, the store keeping the precompiled preamble in
+  /// memory instead of in a temporary file.
+  IntrusiveRefCntPtr<InMemoryPreambleStore> PreambleStore;
+
+  /// \brief The preambles kept in memory that the current parse uses, pinned
+  /// so that they are not evicted before it has read them.
+  std::vector<std::shared_ptr<const InMemoryPreambleStore::Entry>>
+      PreamblePins;
+
+  /// \brief Whether the precompiled preamble is split into two layers when
+  /// it is rebuilt, so that later rebuilds only need to reparse the top one.
+  bool LayeredPreamble;
+
+  /// \brief The base layer of a layered precompiled preamble.
+  ///
+  /// The base layer is the precompiled form of the preamble up to a top-level
+  /// directive of the main file. The precompiled preamble proper is then a
+  /// PCH chained onto it, covering the rest of the preamble. When the preamble
+  /// has to be rebuilt because of a change after the base layer, e.g. in a
+  /// header included by a later directive, only the top layer is rebuilt.
+  struct PreambleLayer {
+    PreambleLayer() : Size(0), NumWarnings(0), TopLevelHashValue(0) {}
+
+    /// \brief The number of bytes of the main file covered by the layer, or
+    /// zero if there is no base layer.
+    unsigned Size;
+    llvm::StringMap<PreambleFileHash> Files;
+    SmallVector<StandaloneDiagnostic, 4> Diagnostics;
+    unsigned NumWarnings;
+    std::vector<serialization::DeclID> TopLevelDecls;
+    unsigned TopLevelHashValue;
+  };
+  PreambleLayer PreambleBase;
+
+  /// \brief The offsets of the top-level directives of the main file at which
+  /// the preamble can be split into layers, in increasing order.
+  std::vector<unsigned> PreambleSplitPoints;
+
+  /// \brief For each file used by the preamble, the offset of the top-level
+  /// directive of the main file that first led to it being included.
+  ///
+  /// A base layer ending at or before that offset does not depend on it.
+  llvm::StringMap<unsigned> PreambleFileSplitPoints;
+
+  /// \brief The number of times the precompiled preamble was built, the
+  /// number of times a base layer was built for it, and the number of times
+  /// it was chained onto the base layer built by an earlier rebuild.
+  unsigned NumPreamblesPrecompiled;
+  unsigned NumPreambleBasesPrecompiled;
+  unsigned NumPreambleBasesReused;
+
+  /// \brief Guards \c Snapshot, which code completion may read while the
+  /// translation unit is being reparsed.
+  mutable std::mutex SnapshotLock;
+
+  /// \brief The snapshot of the last successful parse, if any.
+  std::shared_ptr<const CompletionSnapshot> Snapshot;
+
   /// \brief Whether we should be caching code-completion results.
   bool ShouldCacheCodeCompletionResults : 1;
 
@@ -441,13 +549,22 @@ private:
         : Buffer(C.Buffer), Owner(std::move(C.Owner)), Size(C.Size),
           PreambleEndsAtStartOfLine(C.PreambleEndsAtStartOfLine) {}
   };
-  ComputedPreamble ComputePreamble(CompilerInvocation &Invocation,
-                                   unsigned MaxLines);
+  static ComputedPreamble ComputePreamble(CompilerInvocation &Invocation,
+                                          unsigned MaxLines,
+                                          FileManager &FileMgr);
 
   std::unique_ptr<llvm::MemoryBuffer> getMainBufferWithPrecompiledPreamble(
       std::shared_ptr<PCHContainerOperations> PCHContainerOps,
       const CompilerInvocation &PreambleInvocationIn, bool AllowRebuild = true,
       unsigned MaxLines = 0);
+  bool PrecompilePreamble(
+      std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+      CompilerInvocation &PreambleInvocation, unsigned StartOffset,
+      llvm::StringMap<PreambleFileHash> &Files);
+  void clearPreambleBase();
+  bool pinStoredPreamble(StringRef File);
+  FileID getPreambleBaseFileID();
+  void publishCompletionSnapshot();
   void RealizeTopLevelDeclsFromPreamble();
 
   /// \brief Transfers ownership of the objects (like SourceManager) from
@@ -544,6 +661,31 @@ public:
   bool getOwnsRemappedFileBuffers() const { return OwnsRemappedFileBuffers; }
   void setOwnsRemappedFileBuffers(bool val) { OwnsRemappedFileBuffers = val; }
 
+  /// \brief The store keeping the precompiled preamble in memory, if any.
+  InMemoryPreambleStore *getInMemoryPreambleStore() const {
+    return PreambleStore.get();
+  }
+
+  /// \brief Whether to split the precompiled preamble into layers when it is
+  /// rebuilt, so that later rebuilds can keep its unchanged first part.
+  bool getLayeredPreamble() const { return LayeredPreamble; }
+  void setLayeredPreamble(bool Layered) { LayeredPreamble = Layered; }
+
+  /// \brief Print how often the precompiled preamble and its layers were
+  /// built and reused.
+  void PrintPreambleStats() const;
+
+  /// \brief Returns the snapshot of the last successful parse, or null if
+  /// there was none.
+  ///
+  /// Unlike the rest of the ASTUnit interface, this may be called while the
+  /// translation unit is being reparsed on another thread.
+  std::shared_ptr<const CompletionSnapshot> getCompletionSnapshot() const;
+
+  /// \brief Returns the version of the snapshot of the last successful parse,
+  /// or zero if there was none.
+  unsigned getSnapshotVersion() const;
+
   StringRef getMainFileName() const;
 
   /// \brief If this ASTUnit came from an AST file, returns the filename for it.
@@ -836,6 +978,12 @@ public:
   /// (e.g. because the PCH could not be loaded), this accepts the ASTUnit
   /// mainly to allow the caller to see the diagnostics.
   ///
+  /// \param SharedFileCache - If non-null, a stat and file content cache
+  /// shared with other ASTUnits.
+  ///
+  /// \param PreambleStore - If non-null, the precompiled preamble is kept in
+  /// this store rather than in a temporary file.
+  ///
   // FIXME: Move OnlyLocalDecls, UseBumpAllocator to setters on the ASTUnit, we
   // shouldn't need to specify them at construction time.
   static ASTUnit *LoadFromCommandLine(
@@ -852,7 +1000,9 @@ public:
       bool AllowPCHWithCompilerErrors = false, bool SkipFunctionBodies = false,
       bool UserFilesAreVolatile = false, bool ForSerialization = false,
       llvm::Optional<StringRef> ModuleFormat = llvm::None,
-      std::unique_ptr<ASTUnit> *ErrAST = nullptr);
+      std::unique_ptr<ASTUnit> *ErrAST = nullptr,
+      IntrusiveRefCntPtr<SharedFileSystemCache> SharedFileCache = nullptr,
+      IntrusiveRefCntPtr<InMemoryPreambleStore> PreambleStore = nullptr);
 
   /// \brief Reparse the source files using the same command-line options that
   /// were originally used to produce this translation unit.
@@ -892,6 +1042,26 @@ public:
                     SmallVectorImpl<StoredDiagnostic> &StoredDiagnostics,
                     SmallVectorImpl<const llvm::MemoryBuffer *> &OwnedBuffers);
 
+  /// \brief Perform code completion at the given file, line, and column
+  /// against a snapshot of a translation unit.
+  ///
+  /// This does not touch the ASTUnit the snapshot was taken from, so it may
+  /// run while that unit is being reparsed on another thread. \p FileMgr must
+  /// not be shared with the unit either; \c
+  /// CompletionSnapshot::createFileManager() creates a suitable one. Cached
+  /// completion results are not used.
+  static void
+  CodeComplete(const CompletionSnapshot &Snapshot, StringRef File,
+               unsigned Line, unsigned Column,
+               ArrayRef<RemappedFile> RemappedFiles, bool IncludeMacros,
+               bool IncludeCodePatterns, bool IncludeBriefComments,
+               CodeCompleteConsumer &Consumer,
+               std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+               DiagnosticsEngine &Diag, LangOptions &LangOpts,
+               SourceManager &SourceMgr, FileManager &FileMgr,
+               SmallVectorImpl<StoredDiagnostic> &StoredDiagnostics,
+               SmallVectorImpl<const llvm::MemoryBuffer *> &OwnedBuffers);
+
   /// \brief Save this translation unit to a file with the given name.
   ///
   /// \returns true if there was a file error or false if the save was
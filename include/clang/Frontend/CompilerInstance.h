@@ -45,6 +45,7 @@ class FileEntry;
 class FileManager;
 class FrontendAction;
 class Module;
+class ModuleBuildScheduler;
 class Preprocessor;
 class Sema;
 class SourceManager;
@@ -117,6 +118,9 @@ class CompilerInstance : public ModuleLoader {
   /// \brief The module dependency collector for crashdumps
   std::shared_ptr<ModuleDependencyCollector> ModuleDepCollector;
 
+  /// \brief The scheduler of concurrent implicit module builds, if any.
+  std::shared_ptr<ModuleBuildScheduler> ModuleBuilds;
+
   /// \brief The module provider.
   std::shared_ptr<PCHContainerOperations> ThePCHContainerOperations;
 
@@ -509,6 +513,13 @@ public:
   void setModuleDepCollector(
       std::shared_ptr<ModuleDependencyCollector> Collector);
 
+  std::shared_ptr<ModuleBuildScheduler> getModuleBuildScheduler() const {
+    return ModuleBuilds;
+  }
+  void setModuleBuildScheduler(std::shared_ptr<ModuleBuildScheduler> Builds) {
+    ModuleBuilds = std::move(Builds);
+  }
+
   std::shared_ptr<PCHContainerOperations> getPCHContainerOperations() const {
     return ThePCHContainerOperations;
   }
@@ -243,6 +243,23 @@ public:
   /// The list of module file extensions.
   std::vector<IntrusiveRefCntPtr<ModuleFileExtension>> ModuleFileExtensions;
 
+  /// \brief The number of implicit modules that may be built at the same
+  /// time; 0 or 1 builds them one at a time, as they are imported.
+  unsigned ModulesBuildJobs;
+
+  /// \brief The number of threads that may be used to compress the files
+  /// embedded in a precompiled header or module; 0 or 1 compresses them on
+  /// the main thread.
+  unsigned PCHWriteJobs;
+
+  /// \brief If non-empty, the file to which a trace of the time spent in
+  /// each part of the compilation is written, in the Chrome trace format.
+  std::string TimeTraceFile;
+
+  /// \brief The minimum duration, in microseconds, of the intervals recorded
+  /// in the time trace.
+  unsigned TimeTraceGranularity;
+
   /// \brief The list of module map files to load before processing the input.
   std::vector<std::string> ModuleMapFiles;
 
@@ -281,7 +298,8 @@ public:
     GenerateGlobalModuleIndex(true), ASTDumpDecls(false), ASTDumpLookups(false),
     BuildingImplicitModule(false), ModulesEmbedAllFiles(false),
     IncludeTimestamps(true), ARCMTAction(ARCMT_None),
-    ObjCMTAction(ObjCMT_None), ProgramAction(frontend::ParseSyntaxOnly)
+    ObjCMTAction(ObjCMT_None), ProgramAction(frontend::ParseSyntaxOnly),
+    ModulesBuildJobs(0), PCHWriteJobs(0), TimeTraceGranularity(500)
   {}
 
   /// getInputKindForExtension - Return the appropriate input kind for a file
@@ -0,0 +1,114 @@
+//===--- InMemoryPreambleStore.h - Preambles kept in memory -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the InMemoryPreambleStore interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_FRONTEND_INMEMORYPREAMBLESTORE_H
+#define LLVM_CLANG_FRONTEND_INMEMORYPREAMBLESTORE_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/VirtualFileSystem.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace clang {
+
+/// \brief Keeps the precompiled preambles of a set of translation units in
+/// memory, instead of in temporary files.
+///
+/// Each preamble is stored under a path that does not exist on disk, and is
+/// read back through the file system returned by \c getFileSystem(). The
+/// total size of the stored preambles is bounded: storing a preamble evicts
+/// the least recently used ones that are not pinned until it fits. A
+/// translation unit whose preamble was evicted has to precompile it again.
+///
+/// The store may be shared by translation units used on different threads.
+class InMemoryPreambleStore
+    : public llvm::ThreadSafeRefCountedBase<InMemoryPreambleStore> {
+public:
+  /// \brief A stored preamble.
+  struct Entry {
+    std::shared_ptr<llvm::MemoryBuffer> Buffer;
+    llvm::sys::fs::UniqueID UniqueID;
+    llvm::sys::TimeValue ModTime;
+  };
+
+private:
+  mutable std::mutex Lock;
+  llvm::StringMap<Entry> Preambles;
+  /// The number of pins of each pinned preamble.
+  llvm::StringMap<unsigned> Pins;
+  /// The paths of the stored preambles, most recently used first.
+  std::list<std::string> UseOrder;
+  uint64_t MaxSize;
+  uint64_t Size;
+
+  void touch(StringRef Path);
+  void removeLocked(StringRef Path);
+  void evictLocked(uint64_t Needed);
+  void unpin(StringRef Path);
+
+public:
+  /// \brief Create a store holding up to \p MaxSize bytes of preambles.
+  explicit InMemoryPreambleStore(uint64_t MaxSize);
+  ~InMemoryPreambleStore();
+
+  /// \brief Returns a new path to store a preamble under.
+  std::string createPath();
+
+  /// \brief Store \p Buffer as the preamble at \p Path, evicting other
+  /// preambles as needed. \p Buffer must be null-terminated, like the
+  /// buffers MemoryBuffer creates, since clients may require it.
+  ///
+  /// \returns false if the preamble does not fit in the store, next to the
+  /// pinned preambles.
+  bool store(StringRef Path, std::unique_ptr<llvm::MemoryBuffer> Buffer);
+
+  /// \brief Returns whether a preamble is stored at \p Path, and makes it the
+  /// most recently used one if so.
+  bool contains(StringRef Path);
+
+  /// \brief Get the preamble stored at \p Path, if any.
+  bool lookup(StringRef Path, Entry &Result);
+
+  /// \brief Get the preamble stored at \p Path, if any, and make it the most
+  /// recently used one.
+  ///
+  /// The preamble is not evicted for as long as the returned pointer, or a
+  /// copy of it, exists, so that it can still be read through the store's
+  /// file system.
+  std::shared_ptr<const Entry> pin(StringRef Path);
+
+  /// \brief Forget the preamble stored at \p Path, if any.
+  void remove(StringRef Path);
+
+  /// \brief The maximum number of bytes of preambles kept.
+  uint64_t getMaxSize() const;
+  void setMaxSize(uint64_t Size);
+
+  /// \brief The number of bytes of preambles kept.
+  uint64_t getSize() const;
+
+  /// \brief Returns a file system that serves the stored preambles, and
+  /// forwards everything else to \p Base.
+  IntrusiveRefCntPtr<vfs::FileSystem>
+  getFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> Base);
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,127 @@
+//===--- ModuleBuildScheduler.h - Parallel module builds --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the ModuleBuildScheduler interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_FRONTEND_MODULEBUILDSCHEDULER_H
+#define LLVM_CLANG_FRONTEND_MODULEBUILDSCHEDULER_H
+
+#include "clang/Basic/FileSystemStatCache.h"
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/VirtualFileSystem.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/ADT/StringSet.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace clang {
+
+class PCHContainerOperations;
+
+/// \brief Builds implicit modules ahead of the compilations that import them,
+/// on a small pool of worker threads.
+///
+/// When a compilation finds that it has to build a module, it schedules
+/// builds of the modules that the module map says that module depends on,
+/// and those build concurrently with it. The scheduled builds are
+/// speculative: they take the module's lock file like any other build, skip
+/// modules whose file already exists, and discard their diagnostics. A
+/// module whose scheduled build fails or has not started yet is simply built
+/// again, as usual, by the compilation that needs it.
+///
+/// A compilation waiting for another one to release a module's lock runs
+/// pending scheduled builds in the meantime. It holds the locks of the
+/// modules it is building itself, so those builds also continue its module
+/// build stack, and one that imports any of those modules is abandoned as a
+/// cycle instead of waiting for a lock that its own thread holds.
+///
+/// A scheduled build starts from the module build stack of the compilation
+/// that scheduled it, so that an import cycle through a module that is still
+/// being built is diagnosed (and the build abandoned) instead of waiting for
+/// that module's lock.
+///
+/// One scheduler is shared by a compilation and all the compiler instances
+/// it creates to build modules. Destroying it waits for the builds that have
+/// started.
+class ModuleBuildScheduler {
+public:
+  /// \brief A scheduled build of one module.
+  struct Job {
+    /// The invocation building the module; it is only used by the job.
+    IntrusiveRefCntPtr<CompilerInvocation> Invocation;
+    std::string ModuleName;
+    /// The modules being built by the compilation that scheduled the job,
+    /// outermost first, ending with the module it is building.
+    std::vector<std::string> BuildStack;
+    std::string ModuleFileName;
+    /// The module map used to unique the module, if not the input file.
+    std::string ModuleMapFileForUniquing;
+    bool IsSystem;
+    IntrusiveRefCntPtr<vfs::FileSystem> VFS;
+    IntrusiveRefCntPtr<SharedFileSystemCache> SharedCache;
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps;
+  };
+
+private:
+  const unsigned MaxWorkers;
+
+  std::mutex Lock;
+  /// Signalled when a job is scheduled, or the scheduler shuts down.
+  std::condition_variable JobsAvailable;
+  std::deque<Job> Pending;
+  /// The module files of all the jobs ever scheduled.
+  llvm::StringSet<> Scheduled;
+  /// The worker threads; there are never more than MaxWorkers of them, and
+  /// they wait for more jobs until the scheduler shuts down.
+  std::vector<std::thread> Workers;
+  unsigned NumIdleWorkers;
+  bool ShuttingDown;
+  unsigned NumBuilt;
+
+  void runWorker();
+  bool takeJob(Job &J);
+  static bool build(Job &J);
+
+public:
+  /// \brief Create a scheduler running up to \p MaxWorkers builds at the same
+  /// time as the compilations using it.
+  explicit ModuleBuildScheduler(unsigned MaxWorkers);
+  ~ModuleBuildScheduler();
+
+  /// \brief Schedule \p J, unless a job for the same module file was
+  /// scheduled before.
+  ///
+  /// \returns true if the job was scheduled.
+  bool schedule(Job J);
+
+  /// \brief Run pending jobs on the calling thread for as long as the lock
+  /// file \p LockFileName exists.
+  ///
+  /// \param BuildStack The modules being built on the calling thread,
+  /// outermost first, whose locks it holds.
+  void runPendingWhileLocked(StringRef LockFileName,
+                             ArrayRef<std::string> BuildStack);
+
+  /// \brief Drop the jobs that have not started, and wait for the others.
+  void shutDown();
+
+  void PrintStats();
+};
+
+} // end namespace clang
+
+#endif
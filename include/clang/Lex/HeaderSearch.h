@@ -17,6 +17,8 @@
 #include "clang/Lex/DirectoryLookup.h"
 #include "clang/Lex/ModuleMap.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
@@ -199,6 +201,38 @@ class HeaderSearch {
   };
   llvm::StringMap<LookupFileCacheInfo, llvm::BumpPtrAllocator> LookupFileCache;
 
+  /// \brief Whether LookupFileCache has been seeded from the persistent lookup
+  /// cache (HeaderSearchOptions::HeaderLookupCachePath), if any.
+  bool LookupCacheLoaded;
+
+  /// \brief Whether a lookup missed LookupFileCache since it was seeded, so
+  /// the persistent lookup cache needs to be rewritten.
+  bool LookupCacheChanged;
+
+  /// \brief The modification times of the entries of SearchDirs at the time
+  /// the persistent lookup cache was loaded.
+  SmallVector<uint64_t, 16> LookupCacheDirModTimes;
+
+  /// \brief A header guard recorded in the persistent guard database, valid
+  /// as long as the header's size and modification time are unchanged.
+  struct GuardDBEntry {
+    uint64_t Size;
+    uint64_t ModTime;
+    std::string ControllingMacro;
+  };
+
+  /// \brief The header guards recorded by earlier compilations, keyed by
+  /// absolute file name (HeaderSearchOptions::HeaderGuardDBPath).
+  llvm::StringMap<GuardDBEntry> GuardDB;
+
+  /// \brief Whether GuardDB has been loaded.
+  bool GuardDBLoaded;
+
+  /// \brief The hashes of the contents of the module maps used to name module
+  /// files when input files are validated by content (see
+  /// getModuleFileName()), so that each module map is only read once.
+  llvm::DenseMap<const FileEntry *, llvm::hash_code> ModuleMapContentHashes;
+
   /// \brief Collection mapping a framework or subframework
   /// name like "Carbon" to the Carbon.framework directory.
   llvm::StringMap<FrameworkCacheEntry, llvm::BumpPtrAllocator> FrameworkMap;
@@ -240,6 +274,8 @@ class HeaderSearch {
   unsigned NumIncluded;
   unsigned NumMultiIncludeFileOptzn;
   unsigned NumFrameworkLookups, NumSubFrameworkLookups;
+  unsigned NumLookupCacheEntriesLoaded;
+  unsigned NumGuardDBEntriesLoaded, NumGuardDBIncludesSkipped;
 
   // HeaderSearch doesn't support default or copy construction.
   HeaderSearch(const HeaderSearch&) = delete;
@@ -539,6 +575,28 @@ public:
   void loadTopLevelSystemModules();
 
 private:
+  /// \brief Seed LookupFileCache from the persistent lookup cache, if one is
+  /// in use and is valid for the current search paths.
+  void loadLookupCache();
+
+  /// \brief Compute a signature of the current search paths, used to key the
+  /// persistent lookup cache.
+  uint64_t getSearchPathSignature() const;
+
+  /// \brief Compute the modification times of the current search paths.
+  void getSearchDirModTimes(SmallVectorImpl<uint64_t> &ModTimes);
+
+  /// \brief Load the persistent guard database, if one is in use.
+  void loadGuardDB();
+
+  /// \brief Return the controlling macro recorded in the guard database for
+  /// \p File, if it is still valid.
+  const IdentifierInfo *lookupGuardDB(Preprocessor &PP, const FileEntry *File);
+
+  /// \brief Return the absolute name of \p File, used to key the guard
+  /// database.
+  void getGuardDBKey(const FileEntry *File, SmallVectorImpl<char> &Key) const;
+
   /// \brief Retrieve a module with the given name, which may be part of the
   /// given framework.
   ///
@@ -645,6 +703,15 @@ public:
   
   size_t getTotalMemory() const;
 
+  /// \brief Write the results of the \#include lookups performed so far to
+  /// the persistent lookup cache, if one is in use.
+  void writeLookupCache();
+
+  /// \brief Merge the header guards detected by the multiple-include
+  /// optimization so far into the persistent guard database, if one is in
+  /// use.
+  void writeGuardDB();
+
 private:
   /// \brief Describes what happened when we tried to load a module map file.
   enum LoadModuleMapResult {
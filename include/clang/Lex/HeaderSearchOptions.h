@@ -87,6 +87,12 @@ public:
   /// etc.).
   std::string ResourceDir;
 
+  /// \brief The file holding the persistent #include lookup cache, if any.
+  std::string HeaderLookupCachePath;
+
+  /// \brief The file holding the persistent header guard database, if any.
+  std::string HeaderGuardDBPath;
+
   /// \brief The directory used for the module cache.
   std::string ModuleCachePath;
 
@@ -169,6 +175,16 @@ public:
   /// \brief Whether to validate system input files when a module is loaded.
   unsigned ModulesValidateSystemHeaders : 1;
 
+  /// \brief Whether modules record a hash of the contents of their input
+  /// files, and are validated against it rather than against modification
+  /// times.
+  ///
+  /// Such modules are also named after the contents of their module map
+  /// rather than its location, and may be used from a different directory
+  /// than the one they were built in, so that a module cache can be shared
+  /// across source trees.
+  unsigned ValidateASTInputFilesContent : 1;
+
   /// Whether the module includes debug information (-gmodules).
   unsigned UseDebugInfo : 1;
 
@@ -181,6 +197,7 @@ public:
         UseStandardCXXIncludes(true), UseLibcxx(false), Verbose(false),
         ModulesValidateOncePerBuildSession(false),
         ModulesValidateSystemHeaders(false),
+        ValidateASTInputFilesContent(false),
         UseDebugInfo(false) {}
 
   /// AddPath - Add the \p Path path to the specified \p Group list.
@@ -83,6 +83,15 @@ class PTHManager : public IdentifierInfoLookup {
   ///  if the file (if any) that was to used to generate the PTH cache.
   const char* OriginalSourceFile;
 
+  /// LangOptsSignature - The signature of the language options the cached
+  ///  tokens were lexed with; see getLangOptsSignature().
+  const uint32_t LangOptsSignature;
+
+  /// UseCachedTokens - Whether the cached tokens can be used with the
+  ///  preprocessor's language options.  If not, every file is lexed from
+  ///  source.
+  bool UseCachedTokens;
+
   /// This constructor is intended to only be called by the static 'Create'
   /// method.
   PTHManager(std::unique_ptr<const llvm::MemoryBuffer> buf,
@@ -90,7 +99,8 @@ class PTHManager : public IdentifierInfoLookup {
              const unsigned char *idDataTable,
              std::unique_ptr<IdentifierInfo *[], llvm::FreeDeleter> perIDCache,
              std::unique_ptr<PTHStringIdLookup> stringIdLookup, unsigned numIds,
-             const unsigned char *spellingBase, const char *originalSourceFile);
+             const unsigned char *spellingBase, const char *originalSourceFile,
+             uint32_t langOptsSignature);
 
   PTHManager(const PTHManager &) = delete;
   void operator=(const PTHManager &) = delete;
@@ -111,7 +121,7 @@ class PTHManager : public IdentifierInfoLookup {
 
 public:
   // The current PTH version.
-  enum { Version = 10 };
+  enum { Version = 12 };
 
   ~PTHManager() override;
 
@@ -131,18 +141,32 @@ public:
   ///  is the name of the PTH file.  This method returns NULL upon failure.
   static PTHManager *Create(StringRef file, DiagnosticsEngine &Diags);
 
-  void setPreprocessor(Preprocessor *pp) { PP = pp; }
+  /// setPreprocessor - Set the preprocessor that will use the cached tokens.
+  ///  Warns, and disables the cached tokens, if they were lexed with language
+  ///  options that produce different tokens.
+  void setPreprocessor(Preprocessor *pp);
 
   /// CreateLexer - Return a PTHLexer that "lexes" the cached tokens for the
-  ///  specified file.  This method returns NULL if no cached tokens exist.
-  ///  It is the responsibility of the caller to 'delete' the returned object.
+  ///  specified file.  This method returns NULL if no cached tokens exist,
+  ///  or if the contents of the file no longer match the ones the tokens
+  ///  were cached from.  It is the responsibility of the caller to 'delete'
+  ///  the returned object.
   PTHLexer *CreateLexer(FileID FID);
 
   /// createStatCache - Returns a FileSystemStatCache object for use with
   ///  FileManager objects.  These objects use the PTH data to speed up
-  ///  calls to stat by memoizing their results from when the PTH file
-  ///  was generated.
+  ///  calls to stat on directories by memoizing their results from when the
+  ///  PTH file was generated.
   std::unique_ptr<FileSystemStatCache> createStatCache();
+
+  /// getContentHash - Return the hash (the low 64 bits of the MD5) of a
+  ///  file's contents stored in the PTH file and used to validate its cached
+  ///  tokens.
+  static uint64_t getContentHash(StringRef Contents);
+
+  /// getLangOptsSignature - Return a signature of the language options that
+  ///  affect which tokens are lexed.
+  static uint32_t getLangOptsSignature(const LangOptions &LangOpts);
 };
 
 }  // end namespace clang
@@ -10,6 +10,7 @@
 #ifndef LLVM_CLANG_LEX_PREPROCESSOROPTIONS_H_
 #define LLVM_CLANG_LEX_PREPROCESSOROPTIONS_H_
 
+#include "clang/Basic/SharedIdentifierPool.h"
 #include "clang/Basic/SourceLocation.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/SmallVector.h"
@@ -55,6 +56,11 @@ public:
   /// definitions and expansions.
   unsigned DetailedRecord : 1;
 
+  /// \brief Whether file lexers should skip every line that isn't part of a
+  /// preprocessor directive. Only directives are processed, which is enough
+  /// to compute the dependencies of a translation unit.
+  unsigned DependencyDirectivesOnly : 1;
+
   /// The implicit PCH included at the start of the translation unit, or empty.
   std::string ImplicitPCHInclude;
 
@@ -139,8 +145,17 @@ public:
   /// build it again.
   IntrusiveRefCntPtr<FailedModulesSet> FailedModules;
 
+  /// \brief The pool holding the names of the preprocessor's identifiers, if
+  /// any.
+  ///
+  /// Like \c FailedModules, this is shared with the compiler instances created
+  /// to build modules, and it may also be shared between compilations running
+  /// concurrently in one process.
+  IntrusiveRefCntPtr<SharedIdentifierPool> IdentifierPool;
+
 public:
   PreprocessorOptions() : UsePredefines(true), DetailedRecord(false),
+                          DependencyDirectivesOnly(false),
                           DisablePCHValidation(false),
                           AllowPCHWithCompilerErrors(false),
                           DumpDeserializedPCHDecls(false),
@@ -23,6 +23,7 @@
 #include "clang/AST/UnresolvedSet.h"
 #include "clang/Sema/SemaFixItUtils.h"
 #include "clang/Sema/TemplateDeduction.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/AlignOf.h"
@@ -714,6 +715,15 @@ namespace clang {
     SmallVector<OverloadCandidate, 16> Candidates;
     llvm::SmallPtrSet<Decl *, 16> Functions;
 
+    /// \brief The key of a cached argument conversion: the argument, the
+    /// parameter type, and the flags the conversion was computed with.
+    typedef std::pair<std::pair<Expr *, void *>, unsigned> ConversionKey;
+
+    /// \brief The implicit conversion sequences computed for the arguments of
+    /// the candidates, so that candidates sharing a parameter type, such as
+    /// the many built-in operator candidates, convert each argument once.
+    llvm::DenseMap<ConversionKey, ImplicitConversionSequence> CachedConversions;
+
     // Allocator for OverloadCandidate::Conversions. We store the first few
     // elements inline to avoid allocation for small sets.
     llvm::BumpPtrAllocator ConversionSequenceAllocator;
@@ -747,6 +757,25 @@ namespace clang {
     /// \brief Clear out all of the candidates.
     void clear();
 
+    /// \brief Retrieve the conversion of \p Arg to \p ParamType previously
+    /// recorded with the same \p Flags, or null if there is none.
+    const ImplicitConversionSequence *
+    getCachedConversion(Expr *Arg, QualType ParamType, unsigned Flags) const {
+      ConversionKey Key(std::make_pair(Arg, ParamType.getAsOpaquePtr()),
+                        Flags);
+      auto Known = CachedConversions.find(Key);
+      return Known == CachedConversions.end() ? nullptr : &Known->second;
+    }
+
+    /// \brief Record the conversion of \p Arg to \p ParamType computed with
+    /// the given \p Flags.
+    void addCachedConversion(Expr *Arg, QualType ParamType, unsigned Flags,
+                             const ImplicitConversionSequence &ICS) {
+      ConversionKey Key(std::make_pair(Arg, ParamType.getAsOpaquePtr()),
+                        Flags);
+      CachedConversions.insert(std::make_pair(Key, ICS));
+    }
+
     typedef SmallVectorImpl<OverloadCandidate>::iterator iterator;
     iterator begin() { return Candidates.begin(); }
     iterator end() { return Candidates.end(); }
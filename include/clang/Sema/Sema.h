@@ -958,6 +958,24 @@ public:
   /// \brief The number of SFINAE diagnostics that have been trapped.
   unsigned NumSFINAEErrors;
 
+  /// \brief The number of overload candidates rejected because they cannot
+  /// accept the number of arguments of the call, before any argument was
+  /// converted.
+  unsigned NumCandidatesRejectedByArity;
+
+  /// \brief The number of implicit conversion sequences from the arguments of
+  /// a call to the parameters of its overload candidates that were computed.
+  unsigned NumCandidateConversions;
+
+  /// \brief The number of those implicit conversion sequences that were found
+  /// to be impossible from the type classes of the argument and the parameter
+  /// alone, without attempting the conversion.
+  unsigned NumCandidateConversionsPruned;
+
+  /// \brief The number of those implicit conversion sequences that were
+  /// reused from another candidate with the same parameter type.
+  unsigned NumCandidateConversionsReused;
+
   typedef llvm::DenseMap<ParmVarDecl *, llvm::TinyPtrVector<ParmVarDecl *>>
     UnparsedDefaultArgInstantiationsMap;
 
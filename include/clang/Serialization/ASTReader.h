@@ -402,6 +402,10 @@ private:
   /// \brief A timer used to track the time spent deserializing.
   std::unique_ptr<llvm::Timer> ReadTimer;
 
+  /// \brief A timer used to track the time spent loading the global module
+  /// index.
+  std::unique_ptr<llvm::Timer> GlobalIndexTimer;
+
   /// \brief The location where the module file will be considered as
   /// imported from. For non-module AST types it should be invalid.
   SourceLocation CurrentImportLoc;
@@ -867,6 +871,11 @@ private:
   /// in the chain.
   unsigned TotalNumStatements;
 
+  /// \brief The global offsets of the function and method bodies attached
+  /// to declarations, each mapped to the size in bits of the body if it has
+  /// been deserialized, or zero if it has not.
+  llvm::DenseMap<uint64_t, uint64_t> LazyFunctionBodies;
+
   /// \brief The number of macros de-serialized from the chain.
   unsigned NumMacrosRead;
 
@@ -1055,12 +1064,20 @@ private:
   /// \brief Reads a statement from the specified cursor.
   Stmt *ReadStmtFromStream(ModuleFile &F);
 
+  /// \brief Skips over a statement at the current position of the decls
+  /// cursor of \p F, without deserializing it.
+  ///
+  /// \returns the size of the statement, in bits.
+  uint64_t SkipStmtFromStream(ModuleFile &F);
+
   struct InputFileInfo {
     std::string Filename;
     off_t StoredSize;
     time_t StoredTime;
     bool Overridden;
     bool Transient;
+    /// The hash of the file's contents, or zero if none was recorded.
+    uint64_t ContentHash;
   };
 
   /// \brief Reads the stored information about an input file.
@@ -1315,6 +1332,9 @@ public:
   ///
   /// \param ReadTimer If non-null, a timer used to track the time spent
   /// deserializing.
+  ///
+  /// \param GlobalIndexTimer If non-null, a timer used to track the time
+  /// spent loading the global module index.
   ASTReader(Preprocessor &PP, ASTContext &Context,
             const PCHContainerReader &PCHContainerRdr,
             ArrayRef<IntrusiveRefCntPtr<ModuleFileExtension>> Extensions,
@@ -1322,7 +1342,8 @@ public:
             bool AllowASTWithCompilerErrors = false,
             bool AllowConfigurationMismatch = false,
             bool ValidateSystemInputs = false, bool UseGlobalIndex = true,
-            std::unique_ptr<llvm::Timer> ReadTimer = {});
+            std::unique_ptr<llvm::Timer> ReadTimer = {},
+            std::unique_ptr<llvm::Timer> GlobalIndexTimer = {});
 
   ~ASTReader() override;
 
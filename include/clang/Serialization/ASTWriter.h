@@ -130,6 +130,11 @@ private:
   /// file is up to date, but not otherwise.
   bool IncludeTimestamps;
 
+  /// \brief The number of threads that may be used to compress the contents
+  /// of the files and buffers embedded in the AST file; 0 or 1 compresses
+  /// them on the calling thread.
+  unsigned WriteJobs;
+
   /// \brief Indicates when the AST writing is actively performing
   /// serialization, rather than just queueing updates.
   bool WritingAST;
@@ -498,7 +503,7 @@ public:
   /// the given bitstream.
   ASTWriter(llvm::BitstreamWriter &Stream,
             ArrayRef<llvm::IntrusiveRefCntPtr<ModuleFileExtension>> Extensions,
-            bool IncludeTimestamps = true);
+            bool IncludeTimestamps = true, unsigned WriteJobs = 0);
   ~ASTWriter() override;
 
   const LangOptions &getLangOpts() const;
@@ -931,7 +936,8 @@ public:
     std::shared_ptr<PCHBuffer> Buffer,
     ArrayRef<llvm::IntrusiveRefCntPtr<ModuleFileExtension>> Extensions,
     bool AllowASTWithErrors = false,
-    bool IncludeTimestamps = true);
+    bool IncludeTimestamps = true,
+    unsigned WriteJobs = 0);
   ~PCHGenerator() override;
   void InitializeSema(Sema &S) override { SemaPtr = &S; }
   void HandleTranslationUnit(ASTContext &Ctx) override;
@@ -63,12 +63,16 @@ class GlobalModuleIndex {
   /// as the global module index is live.
   std::unique_ptr<llvm::MemoryBuffer> Buffer;
 
-  /// \brief The hash table.
+  /// \brief The identifier index, which points into \c Buffer.
   ///
-  /// This pointer actually points to a IdentifierIndexTable object,
-  /// but that type is only accessible within the implementation of
-  /// GlobalModuleIndex.
-  void *IdentifierIndex;
+  /// The index is a table of (hash, offset) pairs sorted by hash, followed by
+  /// the identifiers and the IDs of the module files that know about each of
+  /// them. Lookups binary-search the table in place, so only the pages of
+  /// the index that a lookup touches are ever read.
+  StringRef IdentifierIndex;
+
+  /// \brief The number of identifiers in \c IdentifierIndex.
+  unsigned NumIdentifiers;
 
   /// \brief Information about a given module file.
   struct ModuleInfo {
@@ -123,6 +127,10 @@ class GlobalModuleIndex {
   GlobalModuleIndex(const GlobalModuleIndex &) = delete;
   GlobalModuleIndex &operator=(const GlobalModuleIndex &) = delete;
 
+  /// \brief Determine whether every entry of the identifier index can be
+  /// read; if not, the index is out of date.
+  bool identifierIndexIsWellFormed() const;
+
 public:
   ~GlobalModuleIndex();
 
@@ -191,16 +199,34 @@ public:
   /// \brief Print debugging view to standard error.
   void dump();
 
-  /// \brief Write a global index into the given
+  /// \brief The number of module files carried over from the previous index
+  /// and read again by writeIndex().
+  struct WriteStats {
+    unsigned NumCarriedOver;
+    unsigned NumRead;
+
+    WriteStats() : NumCarriedOver(0), NumRead(0) {}
+
+    /// \brief Print the statistics to standard error.
+    void print() const;
+  };
+
+  /// \brief Write a global index into the given directory.
+  ///
+  /// If an index already exists in that directory, the module files it lists
+  /// that have not changed since, and whose dependencies have not changed
+  /// either, are carried over from it; only the other module files are read.
   ///
   /// \param FileMgr The file manager to use to load module files.
   /// \param PCHContainerRdr - The PCHContainerOperations to use for loading and
   /// creating modules.
   /// \param Path The path to the directory containing module files, into
   /// which the global index will be written.
+  /// \param Stats If non-null, receives the number of module files carried
+  /// over and read if the index was written.
   static ErrorCode writeIndex(FileManager &FileMgr,
                               const PCHContainerReader &PCHContainerRdr,
-                              StringRef Path);
+                              StringRef Path, WriteStats *Stats = nullptr);
 };
 }
 
@@ -133,7 +133,7 @@ public:
   std::string ActualOriginalSourceFileName;
 
   /// \brief The file ID for the original source file that was used to
-  /// build this AST file.
+  /// build this AST file, in the source manager once the file is loaded.
   FileID OriginalSourceFileID;
 
   /// \brief The directory that the PCH was originally created in. Used to
@@ -21,6 +21,7 @@
 
 #include "clang/Tooling/Core/Replacement.h"
 #include "clang/Tooling/Tooling.h"
+#include <mutex>
 #include <string>
 
 namespace clang {
@@ -46,12 +47,26 @@ public:
   /// be added during the run of the tool.
   Replacements &getReplacements();
 
+  /// \brief Adds \p Replaces to the set of replacements of this tool.
+  ///
+  /// Unlike modifying getReplacements() directly, this may be called
+  /// concurrently, e.g. by actions run through runConcurrently() which
+  /// collect the replacements of each translation unit separately.
+  void addReplacements(const Replacements &Replaces);
+
   /// \brief Call run(), apply all generated replacements, and immediately save
   /// the results to disk.
   ///
   /// \returns 0 upon success. Non-zero upon failure.
   int runAndSave(FrontendActionFactory *ActionFactory);
 
+  /// \brief Like runAndSave(), but processes up to \p ThreadCount
+  /// translation units concurrently (see \c ClangTool::runConcurrently).
+  ///
+  /// \returns 0 upon success. Non-zero upon failure.
+  int runConcurrentlyAndSave(FrontendActionFactory *ActionFactory,
+                             unsigned ThreadCount = 0);
+
   /// \brief Apply all stored replacements to the given Rewriter.
   ///
   /// Replacement applications happen independently of the success of other
@@ -64,8 +79,12 @@ private:
   /// \brief Write all refactored files to disk.
   int saveRewrittenFiles(Rewriter &Rewrite);
 
+  /// \brief Apply all replacements and save the results to disk.
+  int applyAndSave();
+
 private:
   Replacements Replace;
+  std::mutex ReplaceLock;
 };
 
 /// \brief Groups \p Replaces by the file path and applies each group of
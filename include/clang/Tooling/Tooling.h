@@ -34,7 +34,9 @@
 #include "clang/Frontend/PCHContainerOperations.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/LLVM.h"
+#include "clang/Basic/SharedIdentifierPool.h"
 #include "clang/Driver/Util.h"
 #include "clang/Frontend/FrontendAction.h"
 #include "clang/Lex/ModuleLoader.h"
@@ -244,6 +246,11 @@ public:
     this->DiagConsumer = DiagConsumer;
   }
 
+  /// \brief Intern the names of the invocation's identifiers in \p Pool.
+  void setIdentifierPool(IntrusiveRefCntPtr<SharedIdentifierPool> Pool) {
+    IdentifierPool = std::move(Pool);
+  }
+
   /// \brief Map a virtual file to be used while running the tool.
   ///
   /// \param FilePath The path at which the content will be mapped.
@@ -272,6 +279,7 @@ public:
   // Maps <file name> -> <file content>.
   llvm::StringMap<StringRef> MappedFileContents;
   DiagnosticConsumer *DiagConsumer;
+  IntrusiveRefCntPtr<SharedIdentifierPool> IdentifierPool;
 };
 
 /// \brief Utility to run a FrontendAction over a set of files.
@@ -323,6 +331,24 @@ class ClangTool {
   /// \param Action Tool action.
   int run(ToolAction *Action);
 
+  /// \brief Runs an action over all files specified in the command line,
+  /// processing up to \p ThreadCount translation units at a time.
+  ///
+  /// All compile commands are fetched from the compilation database before
+  /// any translation unit is processed. Commands are grouped by working
+  /// directory, and only commands sharing a directory run concurrently.
+  /// Each worker thread uses its own \c FileManager.
+  ///
+  /// \p Action, and the \c DiagnosticConsumer if one was set, are invoked
+  /// concurrently from several threads and must be thread-safe. Results
+  /// should be collected per translation unit and merged under a lock (see
+  /// \c RefactoringTool::addReplacements).
+  ///
+  /// \param Action Tool action.
+  /// \param ThreadCount The number of worker threads, or 0 to use one per
+  ///        hardware thread.
+  int runConcurrently(ToolAction *Action, unsigned ThreadCount = 0);
+
   /// \brief Create an AST for each file specified in the command line and
   /// append them to ASTs.
   int buildASTs(std::vector<std::unique_ptr<ASTUnit>> &ASTs);
@@ -332,6 +358,19 @@ class ClangTool {
   /// The file manager is shared between all translation units.
   FileManager &getFiles() { return *Files; }
 
+  /// \brief Share \p Cache between the file managers used to process the
+  /// translation units, including those of the worker threads of
+  /// runConcurrently(), so headers are stat'ed and read only once.
+  void setSharedFileSystemCache(
+      IntrusiveRefCntPtr<SharedFileSystemCache> Cache);
+
+  /// \brief Intern the names of the identifiers of all translation units,
+  /// including those processed concurrently by runConcurrently(), in
+  /// \p Pool, so the names they have in common are stored once.
+  void setSharedIdentifierPool(IntrusiveRefCntPtr<SharedIdentifierPool> Pool) {
+    IdentifierPool = std::move(Pool);
+  }
+
  private:
   const CompilationDatabase &Compilations;
   std::vector<std::string> SourcePaths;
@@ -340,6 +379,8 @@ class ClangTool {
   llvm::IntrusiveRefCntPtr<vfs::OverlayFileSystem> OverlayFileSystem;
   llvm::IntrusiveRefCntPtr<vfs::InMemoryFileSystem> InMemoryFileSystem;
   llvm::IntrusiveRefCntPtr<FileManager> Files;
+  llvm::IntrusiveRefCntPtr<SharedFileSystemCache> SharedCache;
+  llvm::IntrusiveRefCntPtr<SharedIdentifierPool> IdentifierPool;
   // Contains a list of pairs (<file name>, <file content>).
   std::vector< std::pair<StringRef, StringRef> > MappedFileContents;
   llvm::StringSet<> SeenWorkingDirectories;
@@ -347,6 +388,16 @@ class ClangTool {
   ArgumentsAdjuster ArgsAdjuster;
 
   DiagnosticConsumer *DiagConsumer;
+
+  /// \brief Adds the mapped virtual files to the in-memory file system the
+  /// first time \p Directory is used as a working directory; "/" adds the
+  /// absolute mappings.
+  void mapVirtualFilesForDirectory(StringRef Directory);
+
+  /// \brief Returns the command line of \p Command after running the
+  /// arguments adjusters and adding the tool's resource directory.
+  std::vector<std::string>
+  getAdjustedCommandLine(const CompileCommand &Command);
 };
 
 template <typename T>
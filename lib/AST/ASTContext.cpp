@@ -18,6 +18,8 @@
 #include "clang/AST/CharUnits.h"
 #include "clang/AST/Comment.h"
 #include "clang/AST/CommentCommandTraits.h"
+#include "clang/AST/ConstexprCallCache.h"
+#include "clang/AST/ConstexprInterpreter.h"
 #include "clang/AST/DeclCXX.h"
 #include "clang/AST/DeclContextInternals.h"
 #include "clang/AST/DeclObjC.h"
@@ -869,6 +871,11 @@ void ASTContext::PrintStats() const {
                << NumImplicitDestructors
                << " implicit destructors created\n";
 
+  if (ConstexprCalls)
+    ConstexprCalls->PrintStats();
+  if (ConstexprInterp)
+    ConstexprInterp->PrintStats();
+
   if (ExternalSource) {
     llvm::errs() << "\n";
     ExternalSource->PrintStats();
@@ -8865,6 +8872,19 @@ ASTContext::getMaterializedTemporaryValue(const MaterializeTemporaryExpr *E,
   return MaterializedTemporaryValues.lookup(E);
 }
 
+ConstexprCallCache &ASTContext::getConstexprCallCache() {
+  if (!ConstexprCalls)
+    ConstexprCalls.reset(
+        new ConstexprCallCache(getLangOpts().ConstexprCacheSize));
+  return *ConstexprCalls;
+}
+
+ConstexprInterpreter &ASTContext::getConstexprInterpreter() {
+  if (!ConstexprInterp)
+    ConstexprInterp.reset(new ConstexprInterpreter(*this));
+  return *ConstexprInterp;
+}
+
 bool ASTContext::AtomicUsesUnsupportedLibcall(const AtomicExpr *E) const {
   const llvm::Triple &T = getTargetInfo().getTriple();
   if (!T.isOSDarwin())
@@ -0,0 +1,66 @@
+//===--- ConstexprCallCache.cpp - Memoized constexpr calls ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the ConstexprCallCache class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/AST/ConstexprCallCache.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+ConstexprCallCache::ConstexprCallCache(unsigned MaxEntries)
+    : MaxEntries(MaxEntries), NumHits(0), NumMisses(0), NumEvictions(0) {}
+
+ConstexprCallCache::~ConstexprCallCache() {
+  for (Entry *E : InsertionOrder)
+    delete E;
+}
+
+const APValue *ConstexprCallCache::lookup(const llvm::FoldingSetNodeID &Key) {
+  void *InsertPos;
+  if (Entry *E = Entries.FindNodeOrInsertPos(Key, InsertPos)) {
+    ++NumHits;
+    return &E->Result;
+  }
+  ++NumMisses;
+  return nullptr;
+}
+
+void ConstexprCallCache::insert(const llvm::FoldingSetNodeID &Key,
+                                const APValue &Result) {
+  if (!MaxEntries)
+    return;
+
+  void *InsertPos;
+  if (Entries.FindNodeOrInsertPos(Key, InsertPos))
+    return;
+
+  while (InsertionOrder.size() >= MaxEntries) {
+    Entry *Oldest = InsertionOrder.front();
+    InsertionOrder.pop_front();
+    Entries.RemoveNode(Oldest);
+    delete Oldest;
+    ++NumEvictions;
+  }
+
+  // Evictions may have invalidated the insert position.
+  Entry *E = new Entry(Key, Result);
+  Entries.InsertNode(E);
+  InsertionOrder.push_back(E);
+}
+
+void ConstexprCallCache::PrintStats() const {
+  llvm::errs() << "\n*** Constexpr Call Cache Stats:\n";
+  llvm::errs() << "  " << size() << "/" << MaxEntries
+               << " memoized constexpr calls\n";
+  llvm::errs() << "  " << NumHits << " hits, " << NumMisses << " misses, "
+               << NumEvictions << " evictions\n";
+}
@@ -0,0 +1,1118 @@
+//===--- ConstexprInterpreter.cpp - Bytecode for constexpr calls ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the ConstexprInterpreter class, which compiles the
+//  bodies of constexpr functions to bytecode and interprets it.
+//
+//  The interpreter must produce exactly the results of the tree-walking
+//  evaluator in ExprConstant.cpp, or none at all: it counts evaluation steps
+//  and nested calls the same way, and gives up on every operation for which
+//  the tree-walking evaluator would produce a diagnostic.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/AST/ConstexprInterpreter.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/ExprCXX.h"
+#include "clang/AST/Stmt.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using namespace clang;
+
+namespace {
+
+/// \brief An integral type, as the interpreter represents it: values of the
+/// type are held in 64 bits, sign-extended or zero-extended from Width bits.
+struct IntType {
+  unsigned Width;
+  bool Signed;
+
+  uint32_t encode() const { return Width << 1 | Signed; }
+  static IntType decode(uint32_t Operand) {
+    IntType T = {Operand >> 1, (Operand & 1) != 0};
+    return T;
+  }
+};
+
+/// \brief The instructions of the bytecode. Each instruction is one word,
+/// followed by the operand word described in its comment, if any.
+enum Opcode : uint32_t {
+  OP_Const,       // <constant>: push a value from the constant pool.
+  OP_Load,        // <slot>: push the value of a local variable.
+  OP_Store,       // <slot>: pop a value into a local variable.
+  OP_Dup,         // Push a copy of the value on top of the stack.
+  OP_Pop,         // Discard the value on top of the stack.
+  OP_Swap,        // Exchange the two values on top of the stack.
+  OP_Convert,     // <type>: convert the value on top of the stack.
+  OP_ToBool,      // Convert the value on top of the stack to bool.
+  OP_Add,         // <type>: binary operators, on operands of the given type,
+  OP_Sub,         // or on a left operand of the given type for shifts.
+  OP_Mul,
+  OP_Div,
+  OP_Rem,
+  OP_Shl,
+  OP_Shr,
+  OP_And,
+  OP_Or,
+  OP_Xor,
+  OP_LT,
+  OP_GT,
+  OP_LE,
+  OP_GE,
+  OP_EQ,
+  OP_NE,
+  OP_Neg,         // <type>: unary operators.
+  OP_Not,
+  OP_LNot,        // Negate the bool on top of the stack.
+  OP_Jump,        // <target>: continue at the given instruction.
+  OP_JumpIfFalse, // <target>: pop a bool, and jump if it is false.
+  OP_Call,        // <callee>: call a function, popping its arguments.
+  OP_Ret,         // Return the value on top of the stack.
+  OP_Step,        // Count one evaluation step.
+  OP_Fail         // Give up on the evaluation.
+};
+
+} // end anonymous namespace
+
+/// \brief A function compiled to bytecode.
+class ConstexprInterpreter::Function {
+public:
+  std::vector<IntType> ParamTypes;
+  IntType ResultType;
+
+  /// \brief The number of local variables, including the parameters, which
+  /// come first.
+  unsigned NumSlots;
+
+  std::vector<uint32_t> Code;
+  std::vector<int64_t> Constants;
+
+  /// \brief The functions called by the bytecode, and their compiled forms
+  /// once they have been resolved.
+  mutable std::vector<std::pair<const FunctionDecl *, const Function *>>
+      Callees;
+
+  Function() : NumSlots(0) {}
+};
+
+//===----------------------------------------------------------------------===//
+// Compilation
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// \brief Compiles the body of a constexpr function to bytecode.
+class BytecodeCompiler {
+  ASTContext &Ctx;
+  ConstexprInterpreter::Function &F;
+  QualType ResultType;
+
+  /// \brief The slots of the parameters and of the local variables that have
+  /// been declared.
+  llvm::DenseMap<const VarDecl *, unsigned> Slots;
+
+  /// \brief The jumps out of a loop, to be patched once the loop is compiled.
+  struct LoopExits {
+    SmallVector<size_t, 4> Breaks;
+    SmallVector<size_t, 4> Continues;
+  };
+
+  /// \brief The exits of the enclosing loops, innermost last.
+  SmallVector<LoopExits *, 4> Loops;
+
+  bool getType(QualType T, IntType &Result);
+
+  void emit(Opcode Op) { F.Code.push_back(Op); }
+  void emit(Opcode Op, uint32_t Operand) {
+    F.Code.push_back(Op);
+    F.Code.push_back(Operand);
+  }
+  void emitConst(int64_t Value) {
+    emit(OP_Const, F.Constants.size());
+    F.Constants.push_back(Value);
+  }
+  bool emitConversion(QualType DestType);
+
+  /// \brief Emit a jump whose target is not known yet, and return the
+  /// position of its target for patchJump.
+  size_t emitJump(Opcode Op) {
+    emit(Op, 0);
+    return F.Code.size() - 1;
+  }
+
+  /// \brief Make a jump emitted by emitJump continue at the next instruction.
+  void patchJump(size_t Fixup) { F.Code[Fixup] = F.Code.size(); }
+
+  bool compileStmt(const Stmt *S);
+  bool compileLoopBody(const Stmt *Body, LoopExits &Exits);
+  void patchLoopExits(const LoopExits &Exits, size_t ContinueTarget);
+  bool compileDecl(const Decl *D);
+
+  bool compileExpr(const Expr *E);
+  bool compileCondition(const Expr *E);
+  bool compileIgnored(const Expr *E);
+  bool compileLValue(const Expr *E, unsigned &Slot);
+  bool compileCast(const CastExpr *E);
+  bool compileUnaryOperator(const UnaryOperator *E, IntType T);
+  bool compileBinaryOperator(const BinaryOperator *E);
+  bool compileAssignment(const BinaryOperator *E, unsigned &Slot);
+  bool compileIncDec(const UnaryOperator *E, unsigned &Slot);
+  bool compileCall(const CallExpr *E);
+
+public:
+  BytecodeCompiler(ASTContext &Ctx, ConstexprInterpreter::Function &F)
+      : Ctx(Ctx), F(F) {}
+
+  bool compileFunction(const FunctionDecl *FD);
+};
+
+} // end anonymous namespace
+
+/// \brief Sign-extend or zero-extend the low bits of a value, as a value of
+/// the given type.
+static int64_t normalize(uint64_t Value, IntType T) {
+  if (T.Width < 64) {
+    uint64_t Mask = (uint64_t(1) << T.Width) - 1;
+    Value &= Mask;
+    if (T.Signed && (Value >> (T.Width - 1)))
+      Value |= ~Mask;
+  }
+  return static_cast<int64_t>(Value);
+}
+
+bool BytecodeCompiler::getType(QualType T, IntType &Result) {
+  if (T.isVolatileQualified() || !T->isIntegralOrEnumerationType())
+    return false;
+  if (const EnumType *ET = T->getAs<EnumType>())
+    if (!ET->getDecl()->isComplete())
+      return false;
+
+  uint64_t Width = Ctx.getIntWidth(T);
+  if (Width == 0 || Width > 64)
+    return false;
+  Result.Width = Width;
+  Result.Signed = T->isSignedIntegerOrEnumerationType();
+  return true;
+}
+
+bool BytecodeCompiler::emitConversion(QualType DestType) {
+  IntType T;
+  if (!getType(DestType, T))
+    return false;
+  // As in HandleIntToIntCast, conversions to bool compare with zero rather
+  // than truncate.
+  if (DestType->isBooleanType())
+    emit(OP_ToBool);
+  else
+    emit(OP_Convert, T.encode());
+  return true;
+}
+
+bool BytecodeCompiler::compileFunction(const FunctionDecl *FD) {
+  const Stmt *Body = FD->getBody();
+  if (!Body || FD->isVariadic())
+    return false;
+  if (const CXXMethodDecl *MD = dyn_cast<CXXMethodDecl>(FD))
+    if (!MD->isStatic())
+      return false;
+
+  ResultType = FD->getReturnType();
+  if (!getType(ResultType, F.ResultType))
+    return false;
+  for (const ParmVarDecl *PD : FD->parameters()) {
+    IntType T;
+    if (!getType(PD->getType(), T))
+      return false;
+    F.ParamTypes.push_back(T);
+    Slots[PD] = F.NumSlots++;
+  }
+
+  if (!compileStmt(Body))
+    return false;
+  // Flowing off the end of the function is not a constant expression.
+  emit(OP_Fail);
+  return true;
+}
+
+bool BytecodeCompiler::compileStmt(const Stmt *S) {
+  // Like EvaluateStmt, count one step for every statement executed.
+  emit(OP_Step);
+
+  switch (S->getStmtClass()) {
+  default:
+    if (const Expr *E = dyn_cast<Expr>(S))
+      return compileIgnored(E);
+    return false;
+
+  case Stmt::NullStmtClass:
+    return true;
+
+  case Stmt::CompoundStmtClass:
+    for (const Stmt *Child : cast<CompoundStmt>(S)->body())
+      if (!compileStmt(Child))
+        return false;
+    return true;
+
+  case Stmt::DeclStmtClass:
+    for (const Decl *D : cast<DeclStmt>(S)->decls())
+      if (!compileDecl(D))
+        return false;
+    return true;
+
+  case Stmt::ReturnStmtClass: {
+    const Expr *RetExpr = cast<ReturnStmt>(S)->getRetValue();
+    if (!RetExpr ||
+        !Ctx.hasSameUnqualifiedType(RetExpr->getType(), ResultType) ||
+        !compileExpr(RetExpr))
+      return false;
+    emit(OP_Ret);
+    return true;
+  }
+
+  case Stmt::IfStmtClass: {
+    const IfStmt *IS = cast<IfStmt>(S);
+    if (IS->getConditionVariable())
+      return false;
+    if (IS->getInit() && !compileStmt(IS->getInit()))
+      return false;
+    if (!compileCondition(IS->getCond()))
+      return false;
+    size_t ToElse = emitJump(OP_JumpIfFalse);
+    if (!compileStmt(IS->getThen()))
+      return false;
+    if (const Stmt *Else = IS->getElse()) {
+      size_t ToEnd = emitJump(OP_Jump);
+      patchJump(ToElse);
+      if (!compileStmt(Else))
+        return false;
+      patchJump(ToEnd);
+    } else {
+      patchJump(ToElse);
+    }
+    return true;
+  }
+
+  case Stmt::WhileStmtClass: {
+    const WhileStmt *WS = cast<WhileStmt>(S);
+    if (WS->getConditionVariable())
+      return false;
+    size_t Start = F.Code.size();
+    if (!compileCondition(WS->getCond()))
+      return false;
+    size_t ToEnd = emitJump(OP_JumpIfFalse);
+    LoopExits Exits;
+    if (!compileLoopBody(WS->getBody(), Exits))
+      return false;
+    emit(OP_Jump, Start);
+    patchJump(ToEnd);
+    patchLoopExits(Exits, Start);
+    return true;
+  }
+
+  case Stmt::DoStmtClass: {
+    const DoStmt *DS = cast<DoStmt>(S);
+    size_t Start = F.Code.size();
+    LoopExits Exits;
+    if (!compileLoopBody(DS->getBody(), Exits))
+      return false;
+    size_t Cond = F.Code.size();
+    if (!compileCondition(DS->getCond()))
+      return false;
+    size_t ToEnd = emitJump(OP_JumpIfFalse);
+    emit(OP_Jump, Start);
+    patchJump(ToEnd);
+    patchLoopExits(Exits, Cond);
+    return true;
+  }
+
+  case Stmt::ForStmtClass: {
+    const ForStmt *FS = cast<ForStmt>(S);
+    if (FS->getConditionVariable())
+      return false;
+    if (FS->getInit() && !compileStmt(FS->getInit()))
+      return false;
+    size_t Start = F.Code.size();
+    size_t ToEnd = 0;
+    if (FS->getCond()) {
+      if (!compileCondition(FS->getCond()))
+        return false;
+      ToEnd = emitJump(OP_JumpIfFalse);
+    }
+    LoopExits Exits;
+    if (!compileLoopBody(FS->getBody(), Exits))
+      return false;
+    size_t Inc = F.Code.size();
+    if (FS->getInc() && !compileIgnored(FS->getInc()))
+      return false;
+    emit(OP_Jump, Start);
+    if (FS->getCond())
+      patchJump(ToEnd);
+    patchLoopExits(Exits, Inc);
+    return true;
+  }
+
+  case Stmt::BreakStmtClass:
+    if (Loops.empty())
+      return false;
+    Loops.back()->Breaks.push_back(emitJump(OP_Jump));
+    return true;
+
+  case Stmt::ContinueStmtClass:
+    if (Loops.empty())
+      return false;
+    Loops.back()->Continues.push_back(emitJump(OP_Jump));
+    return true;
+  }
+}
+
+bool BytecodeCompiler::compileLoopBody(const Stmt *Body, LoopExits &Exits) {
+  Loops.push_back(&Exits);
+  bool Success = compileStmt(Body);
+  Loops.pop_back();
+  return Success;
+}
+
+/// \brief Make the breaks out of a loop continue at the next instruction, and
+/// its continues at \p ContinueTarget.
+void BytecodeCompiler::patchLoopExits(const LoopExits &Exits,
+                                      size_t ContinueTarget) {
+  for (size_t Fixup : Exits.Breaks)
+    patchJump(Fixup);
+  for (size_t Fixup : Exits.Continues)
+    F.Code[Fixup] = ContinueTarget;
+}
+
+bool BytecodeCompiler::compileDecl(const Decl *D) {
+  // Like EvaluateDecl, ignore everything but local variables.
+  const VarDecl *VD = dyn_cast<VarDecl>(D);
+  if (!VD || !VD->hasLocalStorage())
+    return true;
+
+  IntType T;
+  const Expr *Init = VD->getInit();
+  if (!getType(VD->getType(), T) || !Init || !compileExpr(Init))
+    return false;
+
+  // Only make the variable visible once its initializer has been compiled,
+  // so that an initializer reading the variable is rejected.
+  unsigned Slot = F.NumSlots++;
+  emit(OP_Store, Slot);
+  Slots[VD] = Slot;
+  return true;
+}
+
+bool BytecodeCompiler::compileCondition(const Expr *E) {
+  if (!compileExpr(E))
+    return false;
+  if (!E->getType()->isBooleanType())
+    emit(OP_ToBool);
+  return true;
+}
+
+bool BytecodeCompiler::compileIgnored(const Expr *E) {
+  if (E->isGLValue()) {
+    unsigned Slot;
+    return compileLValue(E, Slot);
+  }
+  if (const CastExpr *CE = dyn_cast<CastExpr>(E))
+    if (CE->getCastKind() == CK_ToVoid)
+      return compileIgnored(CE->getSubExpr());
+
+  if (!compileExpr(E))
+    return false;
+  emit(OP_Pop);
+  return true;
+}
+
+/// \brief Compile an lvalue that designates a local variable, emitting the
+/// side effects of the expression and returning the slot of the variable.
+bool BytecodeCompiler::compileLValue(const Expr *E, unsigned &Slot) {
+  E = E->IgnoreParens();
+  if (const DeclRefExpr *DRE = dyn_cast<DeclRefExpr>(E)) {
+    const VarDecl *VD = dyn_cast<VarDecl>(DRE->getDecl());
+    if (!VD)
+      return false;
+    llvm::DenseMap<const VarDecl *, unsigned>::iterator Known =
+        Slots.find(VD);
+    if (Known == Slots.end())
+      return false;
+    Slot = Known->second;
+    return true;
+  }
+
+  if (const BinaryOperator *BO = dyn_cast<BinaryOperator>(E))
+    if (BO->isAssignmentOp())
+      return compileAssignment(BO, Slot);
+
+  if (const UnaryOperator *UO = dyn_cast<UnaryOperator>(E))
+    if (UO->isPrefix() && UO->isIncrementDecrementOp())
+      return compileIncDec(UO, Slot);
+
+  return false;
+}
+
+bool BytecodeCompiler::compileExpr(const Expr *E) {
+  IntType T;
+  if (!E->isRValue() || !getType(E->getType(), T))
+    return false;
+
+  switch (E->getStmtClass()) {
+  default:
+    return false;
+
+  case Stmt::ParenExprClass:
+    return compileExpr(cast<ParenExpr>(E)->getSubExpr());
+
+  case Stmt::ExprWithCleanupsClass:
+    return compileExpr(cast<ExprWithCleanups>(E)->getSubExpr());
+
+  case Stmt::SubstNonTypeTemplateParmExprClass:
+    return compileExpr(
+        cast<SubstNonTypeTemplateParmExpr>(E)->getReplacement());
+
+  case Stmt::IntegerLiteralClass:
+    emitConst(normalize(cast<IntegerLiteral>(E)->getValue().getZExtValue(), T));
+    return true;
+
+  case Stmt::CharacterLiteralClass:
+    emitConst(normalize(cast<CharacterLiteral>(E)->getValue(), T));
+    return true;
+
+  case Stmt::CXXBoolLiteralExprClass:
+    emitConst(cast<CXXBoolLiteralExpr>(E)->getValue());
+    return true;
+
+  case Stmt::CXXScalarValueInitExprClass:
+  case Stmt::ImplicitValueInitExprClass:
+    emitConst(0);
+    return true;
+
+  case Stmt::InitListExprClass: {
+    const InitListExpr *ILE = cast<InitListExpr>(E);
+    if (ILE->getNumInits() == 0) {
+      emitConst(0);
+      return true;
+    }
+    return ILE->getNumInits() == 1 && compileExpr(ILE->getInit(0));
+  }
+
+  case Stmt::DeclRefExprClass: {
+    const EnumConstantDecl *ECD =
+        dyn_cast<EnumConstantDecl>(cast<DeclRefExpr>(E)->getDecl());
+    if (!ECD)
+      return false;
+    llvm::APSInt Value = ECD->getInitVal().extOrTrunc(64);
+    emitConst(normalize(Value.getZExtValue(), T));
+    return true;
+  }
+
+  case Stmt::ImplicitCastExprClass:
+  case Stmt::CStyleCastExprClass:
+  case Stmt::CXXFunctionalCastExprClass:
+  case Stmt::CXXStaticCastExprClass:
+    return compileCast(cast<CastExpr>(E));
+
+  case Stmt::UnaryOperatorClass:
+    return compileUnaryOperator(cast<UnaryOperator>(E), T);
+
+  case Stmt::BinaryOperatorClass:
+    return compileBinaryOperator(cast<BinaryOperator>(E));
+
+  case Stmt::ConditionalOperatorClass: {
+    const ConditionalOperator *CO = cast<ConditionalOperator>(E);
+    if (!compileCondition(CO->getCond()))
+      return false;
+    size_t ToFalse = emitJump(OP_JumpIfFalse);
+    if (!compileExpr(CO->getTrueExpr()))
+      return false;
+    size_t ToEnd = emitJump(OP_Jump);
+    patchJump(ToFalse);
+    if (!compileExpr(CO->getFalseExpr()))
+      return false;
+    patchJump(ToEnd);
+    return true;
+  }
+
+  case Stmt::CallExprClass:
+    return compileCall(cast<CallExpr>(E));
+  }
+}
+
+bool BytecodeCompiler::compileCast(const CastExpr *E) {
+  const Expr *SubExpr = E->getSubExpr();
+  switch (E->getCastKind()) {
+  default:
+    return false;
+
+  case CK_LValueToRValue: {
+    unsigned Slot;
+    if (!compileLValue(SubExpr, Slot))
+      return false;
+    emit(OP_Load, Slot);
+    return true;
+  }
+
+  case CK_NoOp:
+    return compileExpr(SubExpr);
+
+  case CK_IntegralCast:
+  case CK_IntegralToBoolean:
+    return compileExpr(SubExpr) && emitConversion(E->getType());
+  }
+}
+
+bool BytecodeCompiler::compileUnaryOperator(const UnaryOperator *E,
+                                            IntType T) {
+  switch (E->getOpcode()) {
+  default:
+    return false;
+
+  case UO_Plus:
+  case UO_Extension:
+    return compileExpr(E->getSubExpr());
+
+  case UO_Minus:
+  case UO_Not:
+    if (!compileExpr(E->getSubExpr()))
+      return false;
+    emit(E->getOpcode() == UO_Minus ? OP_Neg : OP_Not, T.encode());
+    return true;
+
+  case UO_LNot:
+    if (!compileCondition(E->getSubExpr()))
+      return false;
+    emit(OP_LNot);
+    return true;
+
+  case UO_PostInc:
+  case UO_PostDec: {
+    unsigned Slot;
+    return compileIncDec(E, Slot);
+  }
+  }
+}
+
+bool BytecodeCompiler::compileBinaryOperator(const BinaryOperator *E) {
+  const Expr *LHS = E->getLHS();
+  const Expr *RHS = E->getRHS();
+
+  switch (E->getOpcode()) {
+  case BO_Comma:
+    return compileIgnored(LHS) && compileExpr(RHS);
+
+  case BO_LAnd: {
+    if (!compileCondition(LHS))
+      return false;
+    size_t ToFalse = emitJump(OP_JumpIfFalse);
+    if (!compileCondition(RHS))
+      return false;
+    size_t ToEnd = emitJump(OP_Jump);
+    patchJump(ToFalse);
+    emitConst(0);
+    patchJump(ToEnd);
+    return true;
+  }
+
+  case BO_LOr: {
+    if (!compileCondition(LHS))
+      return false;
+    emit(OP_LNot);
+    size_t ToTrue = emitJump(OP_JumpIfFalse);
+    if (!compileCondition(RHS))
+      return false;
+    size_t ToEnd = emitJump(OP_Jump);
+    patchJump(ToTrue);
+    emitConst(1);
+    patchJump(ToEnd);
+    return true;
+  }
+
+  default:
+    break;
+  }
+
+  Opcode Op;
+  switch (E->getOpcode()) {
+  case BO_Mul: Op = OP_Mul; break;
+  case BO_Div: Op = OP_Div; break;
+  case BO_Rem: Op = OP_Rem; break;
+  case BO_Add: Op = OP_Add; break;
+  case BO_Sub: Op = OP_Sub; break;
+  case BO_Shl: Op = OP_Shl; break;
+  case BO_Shr: Op = OP_Shr; break;
+  case BO_LT:  Op = OP_LT;  break;
+  case BO_GT:  Op = OP_GT;  break;
+  case BO_LE:  Op = OP_LE;  break;
+  case BO_GE:  Op = OP_GE;  break;
+  case BO_EQ:  Op = OP_EQ;  break;
+  case BO_NE:  Op = OP_NE;  break;
+  case BO_And: Op = OP_And; break;
+  case BO_Xor: Op = OP_Xor; break;
+  case BO_Or:  Op = OP_Or;  break;
+  default:
+    return false;
+  }
+
+  // Apart from shifts, both operands have the same type after the usual
+  // arithmetic conversions.
+  IntType LHSType, RHSType;
+  if (!getType(LHS->getType(), LHSType) || !getType(RHS->getType(), RHSType))
+    return false;
+  if (!E->isShiftOp() && (LHSType.Width != RHSType.Width ||
+                          LHSType.Signed != RHSType.Signed))
+    return false;
+
+  if (!compileExpr(LHS) || !compileExpr(RHS))
+    return false;
+  emit(Op, LHSType.encode());
+  return true;
+}
+
+bool BytecodeCompiler::compileAssignment(const BinaryOperator *E,
+                                         unsigned &Slot) {
+  // Before C++14, constant expressions cannot modify objects.
+  if (!Ctx.getLangOpts().CPlusPlus14)
+    return false;
+
+  QualType LHSType = E->getLHS()->getType();
+  IntType T;
+  if (LHSType.isConstQualified() || !getType(LHSType, T))
+    return false;
+  if (!compileLValue(E->getLHS(), Slot) || !compileExpr(E->getRHS()))
+    return false;
+
+  if (E->getOpcode() != BO_Assign) {
+    // Like handleCompoundAssignment, read the left-hand side only once the
+    // right-hand side has been evaluated.
+    const CompoundAssignOperator *CAO = cast<CompoundAssignOperator>(E);
+    Opcode Op;
+    switch (CAO->getOpcode()) {
+    case BO_MulAssign: Op = OP_Mul; break;
+    case BO_DivAssign: Op = OP_Div; break;
+    case BO_RemAssign: Op = OP_Rem; break;
+    case BO_AddAssign: Op = OP_Add; break;
+    case BO_SubAssign: Op = OP_Sub; break;
+    case BO_ShlAssign: Op = OP_Shl; break;
+    case BO_ShrAssign: Op = OP_Shr; break;
+    case BO_AndAssign: Op = OP_And; break;
+    case BO_XorAssign: Op = OP_Xor; break;
+    case BO_OrAssign:  Op = OP_Or;  break;
+    default:
+      return false;
+    }
+
+    QualType ComputationType = CAO->getComputationLHSType();
+    IntType ComputationT, RHST;
+    if (!getType(ComputationType, ComputationT) ||
+        !getType(E->getRHS()->getType(), RHST))
+      return false;
+    if (!CAO->isShiftAssignOp() && (ComputationT.Width != RHST.Width ||
+                                    ComputationT.Signed != RHST.Signed))
+      return false;
+
+    emit(OP_Load, Slot);
+    if (!emitConversion(ComputationType))
+      return false;
+    emit(OP_Swap);
+    emit(Op, ComputationT.encode());
+    if (!emitConversion(LHSType))
+      return false;
+  }
+
+  emit(OP_Store, Slot);
+  return true;
+}
+
+/// \brief Compile an increment or decrement of a local variable. A postfix
+/// operator leaves the old value of the variable on the stack.
+bool BytecodeCompiler::compileIncDec(const UnaryOperator *E, unsigned &Slot) {
+  if (!Ctx.getLangOpts().CPlusPlus14)
+    return false;
+
+  QualType Type = E->getSubExpr()->getType();
+  IntType T;
+  if (Type.isConstQualified() || Type->isBooleanType() || !getType(Type, T))
+    return false;
+  if (!compileLValue(E->getSubExpr(), Slot))
+    return false;
+
+  emit(OP_Load, Slot);
+  if (E->isPostfix())
+    emit(OP_Dup);
+  emitConst(1);
+  emit(E->isIncrementOp() ? OP_Add : OP_Sub, T.encode());
+  emit(OP_Store, Slot);
+  return true;
+}
+
+bool BytecodeCompiler::compileCall(const CallExpr *E) {
+  const FunctionDecl *Callee = E->getDirectCallee();
+  if (!Callee || Callee->getBuiltinID() ||
+      Callee->getNumParams() != E->getNumArgs())
+    return false;
+
+  for (const Expr *Arg : E->arguments())
+    if (!compileExpr(Arg))
+      return false;
+
+  // The callee is resolved and compiled when the call is first executed: its
+  // definition may follow the caller.
+  emit(OP_Call, F.Callees.size());
+  F.Callees.push_back(std::make_pair(Callee, nullptr));
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Interpretation
+//===----------------------------------------------------------------------===//
+
+/// \brief Whether a value is representable in a signed type.
+static bool isRepresentable(int64_t Value, IntType T) {
+  return normalize(Value, T) == Value;
+}
+
+/// \brief The smallest value of a signed type.
+static int64_t getMinValue(IntType T) {
+  return T.Width == 64 ? INT64_MIN : -(int64_t(1) << (T.Width - 1));
+}
+
+/// \brief Evaluate a binary operator as handleIntIntBinOp does. Returns false
+/// in every case for which handleIntIntBinOp would produce a diagnostic.
+static bool evaluateBinaryOp(Opcode Op, IntType T, int64_t LHS, int64_t RHS,
+                             int64_t &Result) {
+  uint64_t ULHS = LHS, URHS = RHS;
+
+  switch (Op) {
+  default:
+    llvm_unreachable("not a binary operator");
+
+  case OP_Add:
+    if (!T.Signed) {
+      Result = normalize(ULHS + URHS, T);
+      return true;
+    }
+    if ((RHS > 0 && LHS > INT64_MAX - RHS) ||
+        (RHS < 0 && LHS < INT64_MIN - RHS))
+      return false;
+    Result = LHS + RHS;
+    return isRepresentable(Result, T);
+
+  case OP_Sub:
+    if (!T.Signed) {
+      Result = normalize(ULHS - URHS, T);
+      return true;
+    }
+    if ((RHS < 0 && LHS > INT64_MAX + RHS) ||
+        (RHS > 0 && LHS < INT64_MIN + RHS))
+      return false;
+    Result = LHS - RHS;
+    return isRepresentable(Result, T);
+
+  case OP_Mul:
+    if (!T.Signed) {
+      Result = normalize(ULHS * URHS, T);
+      return true;
+    }
+    if (LHS > 0 ? (RHS > 0 ? LHS > INT64_MAX / RHS : RHS < INT64_MIN / LHS)
+                : (RHS > 0 ? LHS < INT64_MIN / RHS
+                           : LHS != 0 && RHS < INT64_MAX / LHS))
+      return false;
+    Result = LHS * RHS;
+    return isRepresentable(Result, T);
+
+  case OP_Div:
+  case OP_Rem:
+    if (RHS == 0)
+      return false;
+    if (!T.Signed) {
+      Result = static_cast<int64_t>(Op == OP_Div ? ULHS / URHS : ULHS % URHS);
+      return true;
+    }
+    // INT_MIN / -1 and INT_MIN % -1 overflow.
+    if (RHS == -1 && LHS == getMinValue(T))
+      return false;
+    Result = Op == OP_Div ? LHS / RHS : LHS % RHS;
+    return true;
+
+  case OP_Shl:
+    if (RHS < 0 || RHS >= static_cast<int64_t>(T.Width))
+      return false;
+    // A signed left shift must have a non-negative operand, and must not
+    // shift out any set bit.
+    if (T.Signed &&
+        (LHS < 0 ||
+         T.Width - (64 - llvm::countLeadingZeros(ULHS)) < uint64_t(RHS)))
+      return false;
+    Result = normalize(ULHS << RHS, T);
+    return true;
+
+  case OP_Shr:
+    if (RHS < 0 || RHS >= static_cast<int64_t>(T.Width))
+      return false;
+    Result = T.Signed ? LHS >> RHS : static_cast<int64_t>(ULHS >> RHS);
+    return true;
+
+  case OP_And: Result = LHS & RHS; return true;
+  case OP_Or:  Result = LHS | RHS; return true;
+  case OP_Xor: Result = LHS ^ RHS; return true;
+
+  case OP_LT: Result = T.Signed ? LHS < RHS : ULHS < URHS; return true;
+  case OP_GT: Result = T.Signed ? LHS > RHS : ULHS > URHS; return true;
+  case OP_LE: Result = T.Signed ? LHS <= RHS : ULHS <= URHS; return true;
+  case OP_GE: Result = T.Signed ? LHS >= RHS : ULHS >= URHS; return true;
+  case OP_EQ: Result = LHS == RHS; return true;
+  case OP_NE: Result = LHS != RHS; return true;
+  }
+}
+
+namespace {
+/// \brief The state of a caller, saved while its callee is interpreted.
+struct SavedFrame {
+  const ConstexprInterpreter::Function *F;
+  size_t PC;
+  size_t Locals;
+};
+} // end anonymous namespace
+
+ConstexprInterpreter::ConstexprInterpreter(ASTContext &Ctx)
+    : Ctx(Ctx), NumCompiled(0), NumRejected(0), NumCalls(0), NumBailouts(0) {}
+
+ConstexprInterpreter::~ConstexprInterpreter() {}
+
+const ConstexprInterpreter::Function *
+ConstexprInterpreter::getFunction(const FunctionDecl *Definition) {
+  llvm::DenseMap<const FunctionDecl *, std::unique_ptr<Function>>::iterator
+      Known = Functions.find(Definition);
+  if (Known != Functions.end())
+    return Known->second.get();
+
+  std::unique_ptr<Function> F(new Function);
+  if (BytecodeCompiler(Ctx, *F).compileFunction(Definition)) {
+    ++NumCompiled;
+  } else {
+    F.reset();
+    ++NumRejected;
+  }
+  const Function *Result = F.get();
+  Functions[Definition] = std::move(F);
+  return Result;
+}
+
+/// \brief Resolve a function called by the bytecode to its compiled form, as
+/// CheckConstexprFunction would, or return null if it cannot be called.
+static const ConstexprInterpreter::Function *
+resolveCallee(ConstexprInterpreter &Interp, const FunctionDecl *Callee) {
+  const FunctionDecl *Definition = nullptr;
+  if (Callee->isInvalidDecl() || !Callee->getBody(Definition) ||
+      !Definition->isConstexpr() || Definition->isInvalidDecl())
+    return nullptr;
+  return Interp.getFunction(Definition);
+}
+
+bool ConstexprInterpreter::run(const Function *F, ArrayRef<int64_t> Args,
+                               unsigned &StepsLeft, unsigned MaxDepth,
+                               int64_t &Result) {
+  SmallVector<int64_t, 32> Stack;
+  SmallVector<int64_t, 32> Locals(F->NumSlots);
+  std::copy(Args.begin(), Args.end(), Locals.begin());
+  SmallVector<SavedFrame, 8> Callers;
+
+  const uint32_t *Code = F->Code.data();
+  size_t PC = 0;
+  size_t LocalsBase = 0;
+
+  while (true) {
+    Opcode Op = static_cast<Opcode>(Code[PC++]);
+    switch (Op) {
+    case OP_Const:
+      Stack.push_back(F->Constants[Code[PC++]]);
+      break;
+
+    case OP_Load:
+      Stack.push_back(Locals[LocalsBase + Code[PC++]]);
+      break;
+
+    case OP_Store:
+      Locals[LocalsBase + Code[PC++]] = Stack.pop_back_val();
+      break;
+
+    case OP_Dup: {
+      int64_t Value = Stack.back();
+      Stack.push_back(Value);
+      break;
+    }
+
+    case OP_Pop:
+      Stack.pop_back();
+      break;
+
+    case OP_Swap:
+      std::swap(Stack[Stack.size() - 1], Stack[Stack.size() - 2]);
+      break;
+
+    case OP_Convert:
+      Stack.back() = normalize(Stack.back(), IntType::decode(Code[PC++]));
+      break;
+
+    case OP_ToBool:
+      Stack.back() = Stack.back() != 0;
+      break;
+
+    case OP_Add:
+    case OP_Sub:
+    case OP_Mul:
+    case OP_Div:
+    case OP_Rem:
+    case OP_Shl:
+    case OP_Shr:
+    case OP_And:
+    case OP_Or:
+    case OP_Xor:
+    case OP_LT:
+    case OP_GT:
+    case OP_LE:
+    case OP_GE:
+    case OP_EQ:
+    case OP_NE: {
+      IntType T = IntType::decode(Code[PC++]);
+      int64_t RHS = Stack.pop_back_val();
+      if (!evaluateBinaryOp(Op, T, Stack.back(), RHS, Stack.back()))
+        return false;
+      break;
+    }
+
+    case OP_Neg: {
+      IntType T = IntType::decode(Code[PC++]);
+      int64_t &Value = Stack.back();
+      if (!T.Signed)
+        Value = normalize(-static_cast<uint64_t>(Value), T);
+      else if (Value == getMinValue(T))
+        return false;
+      else
+        Value = -Value;
+      break;
+    }
+
+    case OP_Not: {
+      IntType T = IntType::decode(Code[PC++]);
+      Stack.back() = normalize(~static_cast<uint64_t>(Stack.back()), T);
+      break;
+    }
+
+    case OP_LNot:
+      Stack.back() = !Stack.back();
+      break;
+
+    case OP_Jump:
+      PC = Code[PC];
+      break;
+
+    case OP_JumpIfFalse: {
+      uint32_t Target = Code[PC++];
+      if (!Stack.pop_back_val())
+        PC = Target;
+      break;
+    }
+
+    case OP_Call: {
+      std::pair<const FunctionDecl *, const Function *> &Callee =
+          F->Callees[Code[PC++]];
+      if (!Callee.second)
+        Callee.second = resolveCallee(*this, Callee.first);
+      // Like CheckCallLimit, count the frames of all the calls in progress.
+      if (!Callee.second || Callers.size() + 1 > MaxDepth)
+        return false;
+
+      SavedFrame Caller = {F, PC, LocalsBase};
+      Callers.push_back(Caller);
+      F = Callee.second;
+      Code = F->Code.data();
+      PC = 0;
+      LocalsBase = Locals.size();
+      Locals.resize(LocalsBase + F->NumSlots);
+      size_t NumArgs = F->ParamTypes.size();
+      std::copy(Stack.end() - NumArgs, Stack.end(),
+                Locals.begin() + LocalsBase);
+      Stack.resize(Stack.size() - NumArgs);
+      break;
+    }
+
+    case OP_Ret: {
+      int64_t Value = Stack.pop_back_val();
+      if (Callers.empty()) {
+        Result = Value;
+        return true;
+      }
+      Locals.resize(LocalsBase);
+      SavedFrame Caller = Callers.pop_back_val();
+      F = Caller.F;
+      Code = F->Code.data();
+      PC = Caller.PC;
+      LocalsBase = Caller.Locals;
+      Stack.push_back(Value);
+      break;
+    }
+
+    case OP_Step:
+      if (!StepsLeft)
+        return false;
+      --StepsLeft;
+      break;
+
+    case OP_Fail:
+      return false;
+    }
+  }
+}
+
+bool ConstexprInterpreter::evaluateCall(const FunctionDecl *Callee,
+                                        ArrayRef<APValue> Args,
+                                        unsigned &StepsLeft, unsigned MaxDepth,
+                                        APValue &Result) {
+  const Function *F = getFunction(Callee);
+  if (!F || Args.size() != F->ParamTypes.size())
+    return false;
+
+  SmallVector<int64_t, 8> ArgValues;
+  for (unsigned I = 0, N = Args.size(); I != N; ++I) {
+    IntType T = F->ParamTypes[I];
+    if (!Args[I].isInt() || Args[I].getInt().getBitWidth() != T.Width)
+      return false;
+    const llvm::APSInt &Value = Args[I].getInt();
+    ArgValues.push_back(T.Signed ? Value.getSExtValue()
+                                 : static_cast<int64_t>(Value.getZExtValue()));
+  }
+
+  ++NumCalls;
+  int64_t Value;
+  if (!run(F, ArgValues, StepsLeft, MaxDepth, Value)) {
+    ++NumBailouts;
+    return false;
+  }
+
+  IntType T = F->ResultType;
+  Result = APValue(llvm::APSInt(llvm::APInt(T.Width, Value, T.Signed),
+                                !T.Signed));
+  return true;
+}
+
+void ConstexprInterpreter::PrintStats() const {
+  llvm::errs() << "\n*** Constexpr Interpreter Stats:\n";
+  llvm::errs() << "  " << NumCompiled << " functions compiled, "
+               << NumRejected << " not supported\n";
+  llvm::errs() << "  " << NumCalls << " calls interpreted, " << NumBailouts
+               << " left to the evaluator\n";
+}
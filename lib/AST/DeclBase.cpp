@@ -1335,6 +1335,41 @@ static bool shouldBeHidden(NamedDecl *D) {
   return false;
 }
 
+/// \brief Determine whether buildLookupImpl adds \p ND, a declaration within
+/// \p DCtx, to the lookup table of \p LookupCtx.
+static bool isLocalLookupCandidate(const DeclContext *LookupCtx,
+                                   const DeclContext *DCtx, NamedDecl *ND) {
+  // Only add the declaration if it's semantically within its decl context.
+  // Any other decls which should be found in this context are added eagerly.
+  //
+  // If it's from an AST file, don't add it now. It'll get handled by
+  // FindExternalVisibleDeclsByName if needed. Exception: if we're not
+  // in C++, we do not track external visible decls for the TU, so in
+  // that case we need to collect them all here.
+  return ND->getDeclContext() == DCtx && !shouldBeHidden(ND) &&
+         (!ND->isFromASTFile() ||
+          (LookupCtx->isTranslationUnit() &&
+           !LookupCtx->getParentASTContext().getLangOpts().CPlusPlus));
+}
+
+/// \brief Count the declarations that buildLookupImpl adds to the lookup
+/// table of \p LookupCtx for \p DCtx. This is an upper bound: declarations
+/// that redeclare one another are counted too.
+static unsigned countLookupCandidates(const DeclContext *LookupCtx,
+                                      DeclContext *DCtx) {
+  unsigned Count = 0;
+  for (Decl *D : DCtx->noload_decls()) {
+    if (NamedDecl *ND = dyn_cast<NamedDecl>(D))
+      if (isLocalLookupCandidate(LookupCtx, DCtx, ND))
+        ++Count;
+
+    if (DeclContext *InnerCtx = dyn_cast<DeclContext>(D))
+      if (InnerCtx->isTransparentContext() || InnerCtx->isInlineNamespace())
+        Count += countLookupCandidates(LookupCtx, InnerCtx);
+  }
+  return Count;
+}
+
 /// buildLookup - Build the lookup data structure with all of the
 /// declarations in this DeclContext (and any other contexts linked
 /// to it or transparent contexts nested within it) and return it.
@@ -1363,6 +1398,19 @@ StoredDeclsMap *DeclContext::buildLookup() {
       return LookupPtr;
   }
 
+  // Size the lookup table for all of the declarations up front, rather than
+  // rehashing it over and over again as they are added: contexts such as
+  // large namespaces can have many thousands of members.
+  unsigned NumDecls = 0;
+  for (auto *DC : Contexts)
+    NumDecls += countLookupCandidates(this, DC);
+  if (NumDecls) {
+    StoredDeclsMap *Map = LookupPtr;
+    if (!Map)
+      Map = CreateStoredDeclsMap(getParentASTContext());
+    Map->reserve(NumDecls);
+  }
+
   for (auto *DC : Contexts)
     buildLookupImpl(DC, hasExternalVisibleStorage());
 
@@ -1377,19 +1425,9 @@ StoredDeclsMap *DeclContext::buildLookup() {
 /// nested within it.
 void DeclContext::buildLookupImpl(DeclContext *DCtx, bool Internal) {
   for (Decl *D : DCtx->noload_decls()) {
-    // Insert this declaration into the lookup structure, but only if
-    // it's semantically within its decl context. Any other decls which
-    // should be found in this context are added eagerly.
-    //
-    // If it's from an AST file, don't add it now. It'll get handled by
-    // FindExternalVisibleDeclsByName if needed. Exception: if we're not
-    // in C++, we do not track external visible decls for the TU, so in
-    // that case we need to collect them all here.
+    // Insert this declaration into the lookup structure, if it belongs there.
     if (NamedDecl *ND = dyn_cast<NamedDecl>(D))
-      if (ND->getDeclContext() == DCtx && !shouldBeHidden(ND) &&
-          (!ND->isFromASTFile() ||
-           (isTranslationUnit() &&
-            !getParentASTContext().getLangOpts().CPlusPlus)))
+      if (isLocalLookupCandidate(this, DCtx, ND))
         makeDeclVisibleInContextImpl(ND, Internal);
 
     // If this declaration is itself a transparent declaration context
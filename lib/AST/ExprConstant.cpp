@@ -38,6 +38,8 @@
 #include "clang/AST/ASTDiagnostic.h"
 #include "clang/AST/ASTLambda.h"
 #include "clang/AST/CharUnits.h"
+#include "clang/AST/ConstexprCallCache.h"
+#include "clang/AST/ConstexprInterpreter.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/RecordLayout.h"
 #include "clang/AST/StmtVisitor.h"
@@ -45,6 +47,7 @@
 #include "clang/Basic/Builtins.h"
 #include "clang/Basic/TargetInfo.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/SaveAndRestore.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstring>
 #include <functional>
@@ -470,6 +473,20 @@ namespace {
     /// declaration whose initializer is being evaluated, if any.
     APValue *EvaluatingDeclValue;
 
+    /// EvaluatingDeclAccesses - The number of times the value being
+    /// constructed for EvaluatingDecl has been accessed.
+    unsigned EvaluatingDeclAccesses;
+
+    /// NumDiagnostics - The number of diagnostics produced so far, including
+    /// those that were not recorded because an earlier one was kept or no
+    /// diagnostics are collected.
+    unsigned NumDiagnostics;
+
+    /// UseConstexprInterpreter - Whether calls may be evaluated by the
+    /// bytecode interpreter. Turned off while evaluating a call that the
+    /// interpreter gave up on.
+    bool UseConstexprInterpreter;
+
     /// HasActiveDiagnostic - Was the previous diagnostic stored? If so, further
     /// notes attached to it will also be stored, otherwise they will not be.
     bool HasActiveDiagnostic;
@@ -544,8 +561,11 @@ namespace {
         StepsLeft(getLangOpts().ConstexprStepLimit),
         BottomFrame(*this, SourceLocation(), nullptr, nullptr, nullptr),
         EvaluatingDecl((const ValueDecl *)nullptr),
-        EvaluatingDeclValue(nullptr), HasActiveDiagnostic(false),
-        HasFoldFailureDiagnostic(false), IsSpeculativelyEvaluating(false),
+        EvaluatingDeclValue(nullptr), EvaluatingDeclAccesses(0),
+        NumDiagnostics(0),
+        UseConstexprInterpreter(getLangOpts().ConstexprInterpreter),
+        HasActiveDiagnostic(false), HasFoldFailureDiagnostic(false),
+        IsSpeculativelyEvaluating(false),
         EvalMode(Mode) {}
 
     void setEvaluatingDecl(APValue::LValueBase Base, APValue &Value) {
@@ -605,7 +625,8 @@ namespace {
   private:
     OptionalDiagnostic Diag(SourceLocation Loc, diag::kind DiagId,
                             unsigned ExtraNotes, bool IsCCEDiag) {
-    
+      ++NumDiagnostics;
+
       if (EvalStatus.Diag) {
         // If we have a prior diagnostic, it will be noting that the expression
         // isn't a constant expression. This diagnostic is more important,
@@ -664,6 +685,7 @@ namespace {
                             unsigned ExtraNotes = 0) {
       if (EvalStatus.Diag)
         return Diag(E->getExprLoc(), DiagId, ExtraNotes, /*IsCCEDiag*/false);
+      ++NumDiagnostics;
       HasActiveDiagnostic = false;
       return OptionalDiagnostic();
     }
@@ -677,8 +699,10 @@ namespace {
                                  = diag::note_invalid_subexpr_in_const_expr,
                                unsigned ExtraNotes = 0) {
       // Don't override a previous diagnostic. Don't bother collecting
-      // diagnostics if we're evaluating for overflow.
+      // diagnostics if we're evaluating for overflow. The diagnostic still
+      // counts: a call that produced it must not be memoized.
       if (!EvalStatus.Diag || !EvalStatus.Diag->empty()) {
+        ++NumDiagnostics;
         HasActiveDiagnostic = false;
         return OptionalDiagnostic();
       }
@@ -2159,6 +2183,7 @@ static bool evaluateVarDeclInit(EvalInfo &Info, const Expr *E,
   // in-flight value.
   if (Info.EvaluatingDecl.dyn_cast<const ValueDecl*>() == VD) {
     Result = Info.EvaluatingDeclValue;
+    ++Info.EvaluatingDeclAccesses;
     return true;
   }
 
@@ -2837,6 +2862,8 @@ static CompleteObject findCompleteObject(EvalInfo &Info, const Expr *E,
           Info.Note(MTE->getExprLoc(), diag::note_constexpr_temporary_here);
           return CompleteObject();
         }
+        if (VD && VD->getCanonicalDecl() == ED->getCanonicalDecl())
+          ++Info.EvaluatingDeclAccesses;
 
         BaseVal = Info.Ctx.getMaterializedTemporaryValue(MTE, false);
         assert(BaseVal && "got reference to unevaluated temporary");
@@ -3938,6 +3965,102 @@ static bool EvaluateArgs(ArrayRef<const Expr*> Args, ArgVector &ArgValues,
   return Success;
 }
 
+/// Add a value to the profile of a constexpr call. Returns false if the value
+/// refers to an object or a label, in which case the result of the call may
+/// depend on more than the value itself.
+static bool profileMemoizableValue(const APValue &V,
+                                   llvm::FoldingSetNodeID &ID) {
+  ID.AddInteger(V.getKind());
+  switch (V.getKind()) {
+  case APValue::Uninitialized:
+  case APValue::LValue:
+  case APValue::MemberPointer:
+  case APValue::AddrLabelDiff:
+    return false;
+  case APValue::Int:
+    V.getInt().Profile(ID);
+    return true;
+  case APValue::Float:
+    V.getFloat().bitcastToAPInt().Profile(ID);
+    return true;
+  case APValue::ComplexInt:
+    V.getComplexIntReal().Profile(ID);
+    V.getComplexIntImag().Profile(ID);
+    return true;
+  case APValue::ComplexFloat:
+    V.getComplexFloatReal().bitcastToAPInt().Profile(ID);
+    V.getComplexFloatImag().bitcastToAPInt().Profile(ID);
+    return true;
+  case APValue::Vector:
+    ID.AddInteger(V.getVectorLength());
+    for (unsigned I = 0, N = V.getVectorLength(); I != N; ++I)
+      if (!profileMemoizableValue(V.getVectorElt(I), ID))
+        return false;
+    return true;
+  case APValue::Array:
+    ID.AddInteger(V.getArraySize());
+    ID.AddInteger(V.getArrayInitializedElts());
+    for (unsigned I = 0, N = V.getArrayInitializedElts(); I != N; ++I)
+      if (!profileMemoizableValue(V.getArrayInitializedElt(I), ID))
+        return false;
+    return !V.hasArrayFiller() ||
+           profileMemoizableValue(V.getArrayFiller(), ID);
+  case APValue::Struct:
+    ID.AddInteger(V.getStructNumBases());
+    ID.AddInteger(V.getStructNumFields());
+    for (unsigned I = 0, N = V.getStructNumBases(); I != N; ++I)
+      if (!profileMemoizableValue(V.getStructBase(I), ID))
+        return false;
+    for (unsigned I = 0, N = V.getStructNumFields(); I != N; ++I)
+      if (!profileMemoizableValue(V.getStructField(I), ID))
+        return false;
+    return true;
+  case APValue::Union:
+    ID.AddPointer(V.getUnionField());
+    return profileMemoizableValue(V.getUnionValue(), ID);
+  }
+  llvm_unreachable("Unknown APValue kind!");
+}
+
+/// Whether the result of a call evaluated in the current mode depends only on
+/// the callee and the arguments, so that the call can be evaluated without
+/// the tree-walking evaluator's call stack.
+static bool isCallIndependentOfEvalState(EvalInfo &Info) {
+  switch (Info.EvalMode) {
+  case EvalInfo::EM_ConstantExpression:
+  case EvalInfo::EM_ConstantExpressionUnevaluated:
+  case EvalInfo::EM_ConstantFold:
+  case EvalInfo::EM_IgnoreSideEffects:
+    return true;
+  case EvalInfo::EM_PotentialConstantExpression:
+  case EvalInfo::EM_PotentialConstantExpressionUnevaluated:
+  case EvalInfo::EM_EvaluateForOverflow:
+  case EvalInfo::EM_DesignatorFold:
+    return false;
+  }
+  llvm_unreachable("Missed EvalMode case");
+}
+
+/// Compute the key under which the result of a constexpr call is memoized.
+/// Returns false if the call must not be memoized: if it has an object
+/// argument, takes an argument by reference, or is evaluated in a mode whose
+/// results depend on more than the callee and the arguments.
+static bool profileConstexprCall(EvalInfo &Info, const FunctionDecl *Callee,
+                                 const LValue *This,
+                                 ArrayRef<APValue> ArgValues,
+                                 llvm::FoldingSetNodeID &ID) {
+  if (!Info.getLangOpts().ConstexprCacheSize || This ||
+      !isCallIndependentOfEvalState(Info))
+    return false;
+
+  ID.AddPointer(Callee);
+  ID.AddInteger(Info.EvalMode);
+  for (const APValue &Arg : ArgValues)
+    if (!profileMemoizableValue(Arg, ID))
+      return false;
+  return true;
+}
+
 /// Evaluate a function call.
 static bool HandleFunctionCall(SourceLocation CallLoc,
                                const FunctionDecl *Callee, const LValue *This,
@@ -3951,6 +4074,43 @@ static bool HandleFunctionCall(SourceLocation CallLoc,
   if (!Info.CheckCallLimit(CallLoc))
     return false;
 
+  // If this call has been evaluated with the same arguments before, reuse its
+  // result.
+  llvm::FoldingSetNodeID CallKey;
+  bool Memoize = profileConstexprCall(Info, Callee, This, ArgValues, CallKey);
+  if (Memoize) {
+    if (const APValue *Memoized =
+            Info.Ctx.getConstexprCallCache().lookup(CallKey)) {
+      Result = *Memoized;
+      return true;
+    }
+  }
+
+  // Try the bytecode interpreter. It gives up, without any effect, on every
+  // call that would need a diagnostic, leaving the call to be evaluated below.
+  // The calls nested in such a call are evaluated without the interpreter:
+  // they would likely make it give up again, after repeating the same work.
+  llvm::SaveAndRestore<bool> UseInterpreter(Info.UseConstexprInterpreter);
+  if (Info.UseConstexprInterpreter && !This &&
+      isCallIndependentOfEvalState(Info)) {
+    ConstexprInterpreter &Interp = Info.Ctx.getConstexprInterpreter();
+    if (Interp.getFunction(Callee)) {
+      unsigned StepsLeft = Info.StepsLeft;
+      unsigned MaxDepth = Info.getLangOpts().ConstexprCallDepth;
+      MaxDepth = Info.CallStackDepth < MaxDepth
+                     ? MaxDepth - Info.CallStackDepth
+                     : 0;
+      if (Interp.evaluateCall(Callee, ArgValues, StepsLeft, MaxDepth,
+                              Result)) {
+        Info.StepsLeft = StepsLeft;
+        if (Memoize)
+          Info.Ctx.getConstexprCallCache().insert(CallKey, Result);
+        return true;
+      }
+      Info.UseConstexprInterpreter = false;
+    }
+  }
+
   CallStackFrame Frame(Info, CallLoc, Callee, This, ArgValues.data());
 
   // For a trivial copy or move assignment, perform an APValue copy. This is
@@ -3978,6 +4138,9 @@ static bool HandleFunctionCall(SourceLocation CallLoc,
     return true;
   }
 
+  unsigned NumDiagnostics = Info.NumDiagnostics;
+  unsigned EvaluatingDeclAccesses = Info.EvaluatingDeclAccesses;
+
   StmtResult Ret = {Result, ResultSlot};
   EvalStmtResult ESR = EvaluateStmt(Ret, Info, Body);
   if (ESR == ESR_Succeeded) {
@@ -3985,7 +4148,20 @@ static bool HandleFunctionCall(SourceLocation CallLoc,
       return true;
     Info.FFDiag(Callee->getLocEnd(), diag::note_constexpr_no_return);
   }
-  return ESR == ESR_Returned;
+  if (ESR != ESR_Returned)
+    return false;
+
+  // Only memoize the result if the call had no effect that a later call with
+  // the same arguments would not reproduce: no diagnostic, no side effect or
+  // undefined behavior, and no access to the object being initialized.
+  llvm::FoldingSetNodeID ResultProfile;
+  if (Memoize && NumDiagnostics == Info.NumDiagnostics &&
+      EvaluatingDeclAccesses == Info.EvaluatingDeclAccesses &&
+      !Info.EvalStatus.HasSideEffects &&
+      !Info.EvalStatus.HasUndefinedBehavior &&
+      profileMemoizableValue(Result, ResultProfile))
+    Info.Ctx.getConstexprCallCache().insert(CallKey, Result);
+  return true;
 }
 
 /// Evaluate a constructor call.
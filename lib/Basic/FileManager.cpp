@@ -76,6 +76,11 @@ void FileManager::addStatCache(std::unique_ptr<FileSystemStatCache> statCache,
   LastCache->setNextStatCache(std::move(statCache));
 }
 
+void FileManager::setSharedCache(
+    IntrusiveRefCntPtr<SharedFileSystemCache> Cache) {
+  SharedCache = std::move(Cache);
+}
+
 void FileManager::removeStatCache(FileSystemStatCache *statCache) {
   if (!statCache)
     return;
@@ -413,7 +418,8 @@ bool FileManager::makeAbsolutePath(SmallVectorImpl<char> &Path) const {
 
 llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
 FileManager::getBufferForFile(const FileEntry *Entry, bool isVolatile,
-                              bool ShouldCloseOpenFile) {
+                              bool ShouldCloseOpenFile,
+                              bool RequiresNullTerminator) {
   uint64_t FileSize = Entry->getSize();
   // If there's a high enough chance that the file have changed since we
   // got its size, force a stat before opening it.
@@ -421,28 +427,49 @@ FileManager::getBufferForFile(const FileEntry *Entry, bool isVolatile,
     FileSize = -1;
 
   const char *Filename = Entry->getName();
-  // If the file is already open, use the open file descriptor.
+
+  // Non-volatile files with a real identity can be shared with the other
+  // users of the shared cache.
+  bool UseSharedCache = SharedCache && !isVolatile && !Entry->isNamedPipe() &&
+                        Entry->getUniqueID() != llvm::sys::fs::UniqueID(0, 0);
+  if (UseSharedCache) {
+    // The contents are keyed by the identity and modification time the entry
+    // was created with, so there is no need to stat the file again; files
+    // that change while the cache is in use are invalidated explicitly.
+    if (std::unique_ptr<llvm::MemoryBuffer> Buffer = SharedCache->lookupBuffer(
+            *FS, Entry->getUniqueID(), Entry->getModificationTime(), FileSize,
+            Filename, RequiresNullTerminator)) {
+      if (ShouldCloseOpenFile)
+        Entry->closeFile();
+      return std::move(Buffer);
+    }
+  }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Result = nullptr;
   if (Entry->File) {
-    auto Result =
-        Entry->File->getBuffer(Filename, FileSize,
-                               /*RequiresNullTerminator=*/true, isVolatile);
+    // If the file is already open, use the open file descriptor.
+    Result = Entry->File->getBuffer(Filename, FileSize, RequiresNullTerminator,
+                                    isVolatile);
     // FIXME: we need a set of APIs that can make guarantees about whether a
     // FileEntry is open or not.
     if (ShouldCloseOpenFile)
       Entry->closeFile();
-    return Result;
+  } else if (FileSystemOpts.WorkingDir.empty()) {
+    // Otherwise, open the file.
+    Result = FS->getBufferForFile(Filename, FileSize, RequiresNullTerminator,
+                                  isVolatile);
+  } else {
+    SmallString<128> FilePath(Entry->getName());
+    FixupRelativePath(FilePath);
+    Result = FS->getBufferForFile(FilePath, FileSize, RequiresNullTerminator,
+                                  isVolatile);
   }
 
-  // Otherwise, open the file.
-
-  if (FileSystemOpts.WorkingDir.empty())
-    return FS->getBufferForFile(Filename, FileSize,
-                                /*RequiresNullTerminator=*/true, isVolatile);
-
-  SmallString<128> FilePath(Entry->getName());
-  FixupRelativePath(FilePath);
-  return FS->getBufferForFile(FilePath, FileSize,
-                              /*RequiresNullTerminator=*/true, isVolatile);
+  if (UseSharedCache && Result)
+    return SharedCache->addBuffer(*FS, Entry->getUniqueID(),
+                                  Entry->getModificationTime(),
+                                  std::move(*Result), RequiresNullTerminator);
+  return Result;
 }
 
 llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
@@ -464,14 +491,24 @@ bool FileManager::getStatValue(const char *Path, FileData &Data, bool isFile,
                                std::unique_ptr<vfs::File> *F) {
   // FIXME: FileSystemOpts shouldn't be passed in here, all paths should be
   // absolute!
-  if (FileSystemOpts.WorkingDir.empty())
-    return FileSystemStatCache::get(Path, Data, isFile, F,StatCache.get(), *FS);
-
-  SmallString<128> FilePath(Path);
-  FixupRelativePath(FilePath);
+  SmallString<128> FilePath;
+  if (!FileSystemOpts.WorkingDir.empty()) {
+    FilePath = Path;
+    FixupRelativePath(FilePath);
+    Path = FilePath.c_str();
+  }
 
-  return FileSystemStatCache::get(FilePath.c_str(), Data, isFile, F,
-                                  StatCache.get(), *FS);
+  // The shared cache only holds absolute paths; relative ones depend on the
+  // working directory of the file system.
+  bool UseSharedCache = SharedCache && llvm::sys::path::is_absolute(Path);
+  if (UseSharedCache && SharedCache->lookupStat(*FS, Path, Data))
+    return Data.IsDirectory == isFile;
+
+  bool Missing =
+      FileSystemStatCache::get(Path, Data, isFile, F, StatCache.get(), *FS);
+  if (UseSharedCache && !Missing)
+    SharedCache->addStat(*FS, Path, Data);
+  return Missing;
 }
 
 bool FileManager::getNoncachedStatValue(StringRef Path,
@@ -495,6 +532,31 @@ void FileManager::invalidateCache(const FileEntry *Entry) {
   // caches. Possible alternatives are cache truncation (invalidate last N) or
   // invalidation of the whole cache.
   UniqueRealFiles.erase(Entry->getUniqueID());
+
+  // Other users of the shared cache must not see the old file either.
+  if (SharedCache) {
+    SmallString<128> FilePath(Entry->getName());
+    FixupRelativePath(FilePath);
+    if (llvm::sys::path::is_absolute(FilePath))
+      SharedCache->invalidate(*FS, FilePath, Entry->getUniqueID());
+  }
+}
+
+void FileManager::invalidateSharedCache(StringRef Filename) {
+  if (!SharedCache)
+    return;
+  SmallString<128> FilePath(Filename);
+  FixupRelativePath(FilePath);
+  if (!llvm::sys::path::is_absolute(FilePath))
+    return;
+  SharedCache->invalidate(*FS, FilePath);
+
+  // The shared stat may have been dropped already, while contents read
+  // through the entry this FileManager still has for the file are cached.
+  auto Known = SeenFileEntries.find(Filename);
+  if (Known != SeenFileEntries.end() && Known->second &&
+      Known->second != NON_EXISTENT_FILE)
+    SharedCache->invalidate(*FS, FilePath, Known->second->getUniqueID());
 }
 
 
@@ -564,5 +626,8 @@ void FileManager::PrintStats() const {
   llvm::errs() << NumFileLookups << " file lookups, "
                << NumFileCacheMisses << " file cache misses.\n";
 
+  if (SharedCache)
+    SharedCache->PrintStats();
+
   //llvm::errs() << PagesMapped << BytesOfPagesMapped << FSLookups;
 }
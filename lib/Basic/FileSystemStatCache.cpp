@@ -13,7 +13,9 @@
 
 #include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/VirtualFileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace clang;
 
@@ -124,3 +126,219 @@ MemorizeStatCalls::getStat(const char *Path, FileData &Data, bool isFile,
 
   return Result;
 }
+
+namespace {
+/// \brief A reference to contents owned by a SharedFileSystemCache, which
+/// keeps them alive even if the cache drops them.
+class SharedMemoryBuffer : public llvm::MemoryBuffer {
+  std::shared_ptr<llvm::MemoryBuffer> Owner;
+  std::string Name;
+
+public:
+  SharedMemoryBuffer(std::shared_ptr<llvm::MemoryBuffer> Owner, StringRef Name,
+                     bool RequiresNullTerminator)
+      : Owner(std::move(Owner)), Name(Name) {
+    init(this->Owner->getBufferStart(), this->Owner->getBufferEnd(),
+         RequiresNullTerminator);
+  }
+
+  const char *getBufferIdentifier() const override { return Name.c_str(); }
+
+  BufferKind getBufferKind() const override {
+    return Owner->getBufferKind();
+  }
+};
+} // end anonymous namespace
+
+SharedFileSystemCache::SharedFileSystemCache(uint64_t MaxBufferBytes)
+    : BufferBytes(0), MaxBufferBytes(MaxBufferBytes),
+      NumStatHits(0), NumStatMisses(0), NumBufferHits(0), NumBufferMisses(0),
+      NumBufferEvictions(0) {}
+
+SharedFileSystemCache::~SharedFileSystemCache() {}
+
+SharedFileSystemCache::FileSystemEntries &
+SharedFileSystemCache::getEntries(vfs::FileSystem &FS) {
+  FileSystemEntries &E = Entries[&FS];
+  if (!E.FS)
+    E.FS = &FS;
+  return E;
+}
+
+bool SharedFileSystemCache::lookupStat(vfs::FileSystem &FS, StringRef Path,
+                                       FileData &Data) {
+  assert(llvm::sys::path::is_absolute(Path) && "caching a relative path");
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    auto E = Entries.find(&FS);
+    if (E != Entries.end()) {
+      auto It = E->second.StatCalls.find(Path);
+      if (It != E->second.StatCalls.end()) {
+        Data = It->second;
+        ++NumStatHits;
+        return true;
+      }
+    }
+  }
+  ++NumStatMisses;
+  return false;
+}
+
+void SharedFileSystemCache::addStat(vfs::FileSystem &FS, StringRef Path,
+                                    const FileData &Data) {
+  assert(llvm::sys::path::is_absolute(Path) && "caching a relative path");
+  std::lock_guard<std::mutex> Guard(Lock);
+  getEntries(FS).StatCalls.insert(std::make_pair(Path, Data));
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+SharedFileSystemCache::lookupBuffer(vfs::FileSystem &FS,
+                                    const llvm::sys::fs::UniqueID &UniqueID,
+                                    time_t ModTime, uint64_t Size,
+                                    StringRef Name,
+                                    bool RequiresNullTerminator) {
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    auto E = Entries.find(&FS);
+    // A null-terminated buffer will do for clients that don't need the
+    // terminator, but not the other way around.
+    for (bool NullTerminated : {false, true}) {
+      if (E == Entries.end())
+        break;
+      if (RequiresNullTerminator && !NullTerminated)
+        continue;
+      auto It = E->second.Buffers.find(
+          std::make_tuple(UniqueID, ModTime, NullTerminated));
+      if (It != E->second.Buffers.end() &&
+          It->second.Buffer->getBufferSize() == Size) {
+        ++NumBufferHits;
+        UseOrder.splice(UseOrder.begin(), UseOrder, It->second.UseOrderPos);
+        return llvm::make_unique<SharedMemoryBuffer>(It->second.Buffer, Name,
+                                                     NullTerminated);
+      }
+    }
+  }
+  ++NumBufferMisses;
+  return nullptr;
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+SharedFileSystemCache::addBuffer(vfs::FileSystem &FS,
+                                 const llvm::sys::fs::UniqueID &UniqueID,
+                                 time_t ModTime,
+                                 std::unique_ptr<llvm::MemoryBuffer> Buffer,
+                                 bool IsNullTerminated) {
+  std::string Name = Buffer->getBufferIdentifier();
+  std::shared_ptr<llvm::MemoryBuffer> Result;
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    BufferKey Key = std::make_tuple(UniqueID, ModTime, IsNullTerminated);
+    BufferEntry &Entry = getEntries(FS).Buffers[Key];
+    if (!Entry.Buffer) {
+      UseOrder.push_front(std::make_pair(&FS, Key));
+      Entry.UseOrderPos = UseOrder.begin();
+    } else {
+      UseOrder.splice(UseOrder.begin(), UseOrder, Entry.UseOrderPos);
+    }
+    if (!Entry.Buffer ||
+        Entry.Buffer->getBufferSize() != Buffer->getBufferSize()) {
+      if (Entry.Buffer)
+        BufferBytes -= Entry.Buffer->getBufferSize();
+      BufferBytes += Buffer->getBufferSize();
+      Entry.Buffer = std::move(Buffer);
+    }
+    Result = Entry.Buffer;
+    evictBuffers();
+  }
+  return llvm::make_unique<SharedMemoryBuffer>(std::move(Result), Name,
+                                               IsNullTerminated);
+}
+
+/// \brief Drop the least recently used contents until the cached contents
+/// fit in the bound. Called with the lock held.
+void SharedFileSystemCache::evictBuffers() {
+  while (BufferBytes > MaxBufferBytes && !UseOrder.empty()) {
+    std::map<BufferKey, BufferEntry> &Buffers =
+        Entries[UseOrder.back().first].Buffers;
+    auto Oldest = Buffers.find(UseOrder.back().second);
+    assert(Oldest != Buffers.end() && "cached contents not in use order");
+    BufferBytes -= Oldest->second.Buffer->getBufferSize();
+    Buffers.erase(Oldest);
+    UseOrder.pop_back();
+    ++NumBufferEvictions;
+  }
+}
+
+void SharedFileSystemCache::dropBuffers(
+    FileSystemEntries &E, const llvm::sys::fs::UniqueID &UniqueID) {
+  std::map<BufferKey, BufferEntry> &Buffers = E.Buffers;
+  for (auto It = Buffers.begin(); It != Buffers.end();) {
+    if (std::get<0>(It->first) == UniqueID) {
+      BufferBytes -= It->second.Buffer->getBufferSize();
+      UseOrder.erase(It->second.UseOrderPos);
+      It = Buffers.erase(It);
+    } else {
+      ++It;
+    }
+  }
+}
+
+void
+SharedFileSystemCache::invalidate(vfs::FileSystem &FS, StringRef Path,
+                                  const llvm::sys::fs::UniqueID &UniqueID) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto E = Entries.find(&FS);
+  if (E == Entries.end())
+    return;
+  E->second.StatCalls.erase(Path);
+  dropBuffers(E->second, UniqueID);
+}
+
+void SharedFileSystemCache::invalidate(vfs::FileSystem &FS, StringRef Path) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto E = Entries.find(&FS);
+  if (E == Entries.end())
+    return;
+  auto Stat = E->second.StatCalls.find(Path);
+  if (Stat == E->second.StatCalls.end())
+    return;
+  llvm::sys::fs::UniqueID UniqueID = Stat->second.UniqueID;
+  E->second.StatCalls.erase(Stat);
+  dropBuffers(E->second, UniqueID);
+}
+
+void SharedFileSystemCache::clear() {
+  std::lock_guard<std::mutex> Guard(Lock);
+  Entries.clear();
+  UseOrder.clear();
+  BufferBytes = 0;
+}
+
+unsigned SharedFileSystemCache::getNumBuffers() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  unsigned NumBuffers = 0;
+  for (const auto &E : Entries)
+    NumBuffers += E.second.Buffers.size();
+  return NumBuffers;
+}
+
+uint64_t SharedFileSystemCache::getBufferBytes() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return BufferBytes;
+}
+
+void SharedFileSystemCache::PrintStats() const {
+  unsigned NumStats = 0, NumBuffers = getNumBuffers();
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    for (const auto &E : Entries)
+      NumStats += E.second.StatCalls.size();
+  }
+  llvm::errs() << "\n*** Shared File System Cache Stats:\n";
+  llvm::errs() << NumStats << " stats cached, " << NumStatHits
+               << " stat hits, " << NumStatMisses << " stat misses.\n";
+  llvm::errs() << NumBuffers << " buffers cached (" << getBufferBytes()
+               << " bytes), " << NumBufferHits << " buffer hits, "
+               << NumBufferMisses << " buffer misses, " << NumBufferEvictions
+               << " buffers evicted.\n";
+}
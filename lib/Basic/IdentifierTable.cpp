@@ -22,6 +22,7 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstdio>
 
 using namespace clang;
@@ -73,9 +74,13 @@ IdentifierIterator *IdentifierInfoLookup::getIdentifiers() {
 }
 
 IdentifierTable::IdentifierTable(const LangOptions &LangOpts,
-                                 IdentifierInfoLookup* externalLookup)
-  : HashTable(8192), // Start with space for 8K identifiers.
-    ExternalLookup(externalLookup) {
+                                 IdentifierInfoLookup* externalLookup,
+                                 IntrusiveRefCntPtr<SharedIdentifierPool> Pool)
+  : HashTable(Pool ? 0 : 8192), // Start with space for 8K identifiers.
+    ExternalLookup(externalLookup), Pool(std::move(Pool)),
+    NumPoolIdentifiers(0) {
+  if (this->Pool)
+    PoolIdentifiers.reserve(std::max(8192U, this->Pool->size()));
 
   // Populate the identifier table with info about keywords for the current
   // language.
@@ -334,6 +339,12 @@ void IdentifierTable::PrintStats() const {
           (AverageIdentifierSize/(double)NumIdentifiers));
   fprintf(stderr, "Max identifier length: %d\n", MaxIdentifierLength);
 
+  if (Pool) {
+    fprintf(stderr, "# Pooled identifiers: %d\n", NumPoolIdentifiers);
+    fprintf(stderr, "# Names in shared pool: %d (%u bytes)\n", Pool->size(),
+            (unsigned)Pool->getMemorySize());
+  }
+
   // Compute statistics about the memory allocated for identifiers.
   HashTable.getAllocator().PrintStats();
 }
@@ -0,0 +1,123 @@
+//===--- SharedIdentifierPool.cpp - Thread-safe identifier names ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the SharedIdentifierPool interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/SharedIdentifierPool.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/AlignOf.h"
+#include "llvm/Support/MathExtras.h"
+#include <cstring>
+
+using namespace clang;
+
+SharedIdentifierPool::Table::Table(unsigned NumBuckets)
+    : NumBuckets(NumBuckets),
+      Buckets(new std::atomic<const Entry *>[NumBuckets]) {
+  for (unsigned I = 0; I != NumBuckets; ++I)
+    Buckets[I].store(nullptr, std::memory_order_relaxed);
+}
+
+const SharedIdentifierPool::Entry *
+SharedIdentifierPool::Table::find(StringRef Name, unsigned Hash) const {
+  // Linear probing. Entries are published with a release store once they are
+  // fully written, and buckets are never cleared, so a reader that sees an
+  // entry sees all of it.
+  unsigned Mask = NumBuckets - 1;
+  for (unsigned I = Hash & Mask;; I = (I + 1) & Mask) {
+    const Entry *E = Buckets[I].load(std::memory_order_acquire);
+    if (!E)
+      return nullptr;
+    if (E->Hash == Hash && E->getLength() == Name.size() &&
+        !memcmp(E->getNameStart(), Name.data(), Name.size()))
+      return E;
+  }
+}
+
+void SharedIdentifierPool::Table::insert(const Entry *E) {
+  unsigned Mask = NumBuckets - 1;
+  for (unsigned I = E->Hash & Mask;; I = (I + 1) & Mask) {
+    if (!Buckets[I].load(std::memory_order_relaxed)) {
+      Buckets[I].store(E, std::memory_order_release);
+      return;
+    }
+  }
+}
+
+SharedIdentifierPool::SharedIdentifierPool(unsigned InitialSize)
+    : NumEntries(0) {
+  // Keep the load factor below 3/4.
+  unsigned NumBuckets = llvm::NextPowerOf2(InitialSize + InitialSize / 3);
+  Tables.emplace_back(new Table(NumBuckets));
+  Current.store(Tables.back().get(), std::memory_order_release);
+}
+
+SharedIdentifierPool::~SharedIdentifierPool() {}
+
+const SharedIdentifierPool::Entry *
+SharedIdentifierPool::find(StringRef Name) const {
+  return Current.load(std::memory_order_acquire)
+      ->find(Name, llvm::HashString(Name));
+}
+
+const SharedIdentifierPool::Entry *
+SharedIdentifierPool::intern(StringRef Name) {
+  unsigned Hash = llvm::HashString(Name);
+  if (const Entry *E =
+          Current.load(std::memory_order_acquire)->find(Name, Hash))
+    return E;
+
+  if (Name.size() > MaxNameLength)
+    return nullptr;
+
+  std::lock_guard<std::mutex> Guard(Lock);
+
+  // Another thread may have added the name, or grown the table, since the
+  // lookup above.
+  Table *T = Current.load(std::memory_order_relaxed);
+  if (const Entry *E = T->find(Name, Hash))
+    return E;
+
+  unsigned ID = NumEntries.load(std::memory_order_relaxed);
+  if ((ID + 1) * 4 > T->NumBuckets * 3) {
+    // Rehash into a table twice the size. Readers keep using the old table
+    // until the new one is published; a name they miss there is found again
+    // under the lock.
+    Table *NewT = new Table(T->NumBuckets * 2);
+    Tables.emplace_back(NewT);
+    for (unsigned I = 0; I != T->NumBuckets; ++I)
+      if (const Entry *E = T->Buckets[I].load(std::memory_order_relaxed))
+        NewT->insert(E);
+    Current.store(NewT, std::memory_order_release);
+    T = NewT;
+  }
+
+  void *Mem = Alloc.Allocate(sizeof(Entry) + 2 + Name.size() + 1,
+                             llvm::alignOf<Entry>());
+  Entry *E = new (Mem) Entry(Hash, ID);
+  unsigned char *Str = reinterpret_cast<unsigned char *>(E + 1);
+  Str[0] = (Name.size() + 1) & 0xFF;
+  Str[1] = ((Name.size() + 1) >> 8) & 0xFF;
+  memcpy(Str + 2, Name.data(), Name.size());
+  Str[2 + Name.size()] = '\0';
+
+  T->insert(E);
+  NumEntries.store(ID + 1, std::memory_order_release);
+  return E;
+}
+
+size_t SharedIdentifierPool::getMemorySize() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  size_t Size = Alloc.getTotalMemory();
+  for (const auto &T : Tables)
+    Size += T->NumBuckets * sizeof(std::atomic<const Entry *>);
+  return Size;
+}
@@ -1193,68 +1193,89 @@ unsigned SourceManager::getPresumedColumnNumber(SourceLocation Loc,
 #include <emmintrin.h>
 #endif
 
+/// Return a pointer to the first '\n', '\r' or '\0' at or after \p Ptr,
+/// which must be a byte in a null terminated buffer ending at \p End.  Null
+/// characters within the buffer may be skipped over.
+static const unsigned char *findLineEnd(const unsigned char *Ptr,
+                                        const unsigned char *End) {
+#ifdef __SSE2__
+  // Try to skip to the next newline using SSE instructions. This is very
+  // performance sensitive for programs with lots of diagnostics and in -E
+  // mode.  Unaligned loads avoid a scalar prologue on every (usually short)
+  // line.
+  const __m128i CRs = _mm_set1_epi8('\r');
+  const __m128i LFs = _mm_set1_epi8('\n');
+
+  // Scan 16 byte chunks for '\r' and '\n'. Ignore '\0'.
+  while (Ptr+16 <= End) {
+    const __m128i Chunk = _mm_loadu_si128((const __m128i*)Ptr);
+    __m128i Cmp = _mm_or_si128(_mm_cmpeq_epi8(Chunk, CRs),
+                               _mm_cmpeq_epi8(Chunk, LFs));
+    unsigned Mask = _mm_movemask_epi8(Cmp);
+
+    if (Mask != 0)
+      return Ptr + llvm::countTrailingZeros(Mask);
+    Ptr += 16;
+  }
+#endif
+
+  while (*Ptr != '\n' && *Ptr != '\r' && *Ptr != '\0')
+    ++Ptr;
+  return Ptr;
+}
+
+/// The minimum number of bytes scanned each time the line table of a file is
+/// extended, so that walking forward through a file doesn't rescan it in
+/// tiny pieces.
+static const unsigned LineTableChunkSize = 64 * 1024;
+
+/// Extend the line table of \p FI until it covers the line containing the
+/// file offset \p FilePos and has at least \p MinLines entries, or until it
+/// covers the whole buffer.  Line numbers are computed lazily so that a
+/// diagnostic near the top of a very large (often generated) file doesn't
+/// pay for scanning all of it.
 static LLVM_ATTRIBUTE_NOINLINE void
 ComputeLineNumbers(DiagnosticsEngine &Diag, ContentCache *FI,
                    llvm::BumpPtrAllocator &Alloc,
-                   const SourceManager &SM, bool &Invalid);
+                   const SourceManager &SM, unsigned FilePos,
+                   unsigned MinLines, bool &Invalid);
 static void ComputeLineNumbers(DiagnosticsEngine &Diag, ContentCache *FI,
                                llvm::BumpPtrAllocator &Alloc,
-                               const SourceManager &SM, bool &Invalid) {
+                               const SourceManager &SM, unsigned FilePos,
+                               unsigned MinLines, bool &Invalid) {
   // Note that calling 'getBuffer()' may lazily page in the file.
   MemoryBuffer *Buffer = FI->getBuffer(Diag, SM, SourceLocation(), &Invalid);
   if (Invalid)
     return;
 
+  if (FI->LineTableComplete)
+    return;
+
   // Find the file offsets of all of the *physical* source lines.  This does
   // not look at trigraphs, escaped newlines, or anything else tricky.
   SmallVector<unsigned, 256> LineOffsets;
 
-  // Line #1 starts at char 0.
-  LineOffsets.push_back(0);
+  // Resume from the start of the last line found so far; line #1 starts at
+  // char 0.
+  unsigned Offs = 0;
+  if (FI->SourceLineCache)
+    Offs = FI->SourceLineCache[FI->NumLines - 1];
+  else
+    LineOffsets.push_back(0);
 
-  const unsigned char *Buf = (const unsigned char *)Buffer->getBufferStart();
+  // Stop at the first line start past both FilePos and the end of this
+  // chunk once there are enough lines.
+  unsigned StopOffs = std::max(FilePos, Offs + LineTableChunkSize);
+  if (StopOffs < Offs)
+    StopOffs = ~0U;
+
+  const unsigned char *Buf =
+      (const unsigned char *)Buffer->getBufferStart() + Offs;
   const unsigned char *End = (const unsigned char *)Buffer->getBufferEnd();
-  unsigned Offs = 0;
+  bool Complete = false;
   while (1) {
     // Skip over the contents of the line.
-    const unsigned char *NextBuf = (const unsigned char *)Buf;
-
-#ifdef __SSE2__
-    // Try to skip to the next newline using SSE instructions. This is very
-    // performance sensitive for programs with lots of diagnostics and in -E
-    // mode.
-    __m128i CRs = _mm_set1_epi8('\r');
-    __m128i LFs = _mm_set1_epi8('\n');
-
-    // First fix up the alignment to 16 bytes.
-    while (((uintptr_t)NextBuf & 0xF) != 0) {
-      if (*NextBuf == '\n' || *NextBuf == '\r' || *NextBuf == '\0')
-        goto FoundSpecialChar;
-      ++NextBuf;
-    }
-
-    // Scan 16 byte chunks for '\r' and '\n'. Ignore '\0'.
-    while (NextBuf+16 <= End) {
-      const __m128i Chunk = *(const __m128i*)NextBuf;
-      __m128i Cmp = _mm_or_si128(_mm_cmpeq_epi8(Chunk, CRs),
-                                 _mm_cmpeq_epi8(Chunk, LFs));
-      unsigned Mask = _mm_movemask_epi8(Cmp);
-
-      // If we found a newline, adjust the pointer and jump to the handling code.
-      if (Mask != 0) {
-        NextBuf += llvm::countTrailingZeros(Mask);
-        goto FoundSpecialChar;
-      }
-      NextBuf += 16;
-    }
-#endif
-
-    while (*NextBuf != '\n' && *NextBuf != '\r' && *NextBuf != '\0')
-      ++NextBuf;
-
-#ifdef __SSE2__
-FoundSpecialChar:
-#endif
+    const unsigned char *NextBuf = findLineEnd(Buf, End);
     Offs += NextBuf-Buf;
     Buf = NextBuf;
 
@@ -1267,19 +1288,37 @@ FoundSpecialChar:
       ++Offs;
       ++Buf;
       LineOffsets.push_back(Offs);
+      if (Offs > StopOffs && FI->NumLines + LineOffsets.size() >= MinLines)
+        break;
     } else {
       // Otherwise, this is a null.  If end of file, exit.
-      if (Buf == End) break;
+      if (Buf == End) {
+        Complete = true;
+        break;
+      }
       // Otherwise, skip the null.
       ++Offs;
       ++Buf;
     }
   }
 
-  // Copy the offsets into the FileInfo structure.
-  FI->NumLines = LineOffsets.size();
-  FI->SourceLineCache = Alloc.Allocate<unsigned>(LineOffsets.size());
-  std::copy(LineOffsets.begin(), LineOffsets.end(), FI->SourceLineCache);
+  // Append the offsets to the FileInfo structure, growing it geometrically.
+  // The old array stays in the allocator; the waste is bounded by the final
+  // table size.
+  unsigned NumLines = FI->NumLines + LineOffsets.size();
+  if (NumLines > FI->LineTableCapacity) {
+    unsigned Capacity = std::max(NumLines, 2 * FI->LineTableCapacity);
+    unsigned *NewCache = Alloc.Allocate<unsigned>(Capacity);
+    if (FI->SourceLineCache)
+      std::copy(FI->SourceLineCache, FI->SourceLineCache + FI->NumLines,
+                NewCache);
+    FI->SourceLineCache = NewCache;
+    FI->LineTableCapacity = Capacity;
+  }
+  std::copy(LineOffsets.begin(), LineOffsets.end(),
+            FI->SourceLineCache + FI->NumLines);
+  FI->NumLines = NumLines;
+  FI->LineTableComplete = Complete;
 }
 
 /// getLineNumber - Given a SourceLocation, return the spelling line number
@@ -1309,11 +1348,14 @@ unsigned SourceManager::getLineNumber(FileID FID, unsigned FilePos,
     Content = const_cast<ContentCache*>(Entry.getFile().getContentCache());
   }
   
-  // If this is the first use of line information for this buffer, compute the
-  /// SourceLineCache for it on demand.
-  if (!Content->SourceLineCache) {
+  // If the line information computed so far for this buffer doesn't reach
+  // FilePos yet, extend the SourceLineCache on demand.
+  if (!Content->SourceLineCache ||
+      (!Content->LineTableComplete &&
+       Content->SourceLineCache[Content->NumLines - 1] <= FilePos)) {
     bool MyInvalid = false;
-    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid);
+    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, FilePos,
+                       /*MinLines=*/0, MyInvalid);
     if (Invalid)
       *Invalid = MyInvalid;
     if (MyInvalid)
@@ -1747,11 +1789,13 @@ SourceLocation SourceManager::translateLineCol(FileID FID,
   if (!Content)
     return SourceLocation();
 
-  // If this is the first use of line information for this buffer, compute the
-  // SourceLineCache for it on demand.
-  if (!Content->SourceLineCache) {
+  // If the line information computed so far for this buffer doesn't reach
+  // Line yet, extend the SourceLineCache on demand.
+  if (!Content->SourceLineCache ||
+      (!Content->LineTableComplete && Line > Content->NumLines)) {
     bool MyInvalid = false;
-    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid);
+    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this,
+                       /*FilePos=*/0, /*MinLines=*/Line, MyInvalid);
     if (MyInvalid)
       return SourceLocation();
   }
@@ -0,0 +1,144 @@
+//===--- TimeTrace.cpp - Hierarchical compilation time trace --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the TimeTraceProfiler class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/TimeTrace.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace clang;
+
+static LLVM_THREAD_LOCAL TimeTraceProfiler *TimeTraceProfilerInstance = nullptr;
+
+void clang::timeTraceProfilerInitialize(unsigned GranularityInMicroseconds) {
+  assert(!TimeTraceProfilerInstance && "time trace already initialized");
+  TimeTraceProfilerInstance = new TimeTraceProfiler(GranularityInMicroseconds);
+}
+
+void clang::timeTraceProfilerCleanup() {
+  delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = nullptr;
+}
+
+TimeTraceProfiler *clang::getTimeTraceProfiler() {
+  return TimeTraceProfilerInstance;
+}
+
+TimeTraceProfiler::TimeTraceProfiler(unsigned GranularityInMicroseconds)
+    : StartTime(Clock::now()), Granularity(GranularityInMicroseconds) {}
+
+void TimeTraceProfiler::begin(StringRef Name,
+                              llvm::function_ref<std::string()> Detail) {
+  Entry E;
+  E.Start = Clock::now();
+  E.Length = Duration::zero();
+  E.Name = Name;
+  E.Detail = Detail();
+  Stack.push_back(std::move(E));
+}
+
+void TimeTraceProfiler::end(StringRef Name) {
+  assert(!Stack.empty() && "ending an interval that has not begun");
+  Entry &E = Stack.back();
+  assert(E.Name == Name && "time trace intervals are not nested");
+  (void)Name;
+  E.Length = std::chrono::duration_cast<Duration>(Clock::now() - E.Start);
+
+  // Only count the outermost of nested intervals with the same name, so that
+  // the totals do not count the same time twice.
+  bool IsOutermost = std::none_of(
+      Stack.begin(), Stack.end() - 1,
+      [&](const Entry &Outer) { return Outer.Name == E.Name; });
+  if (IsOutermost) {
+    std::pair<unsigned, Duration> &Total = Totals[E.Name];
+    ++Total.first;
+    Total.second += E.Length;
+  }
+
+  if (E.Length >= Granularity)
+    Entries.push_back(std::move(E));
+  Stack.pop_back();
+}
+
+/// \brief Write a string as a JSON string literal.
+static void writeJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (char C : Str) {
+    switch (C) {
+    case '"':
+      OS << "\\\"";
+      break;
+    case '\\':
+      OS << "\\\\";
+      break;
+    case '\n':
+      OS << "\\n";
+      break;
+    case '\t':
+      OS << "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(C) < 0x20)
+        OS << llvm::format("\\u%04x", static_cast<unsigned char>(C));
+      else
+        OS << C;
+      break;
+    }
+  }
+  OS << '"';
+}
+
+void TimeTraceProfiler::write(raw_ostream &OS) {
+  OS << "{ \"traceEvents\": [\n";
+
+  // The intervals themselves, on the first row.
+  for (const Entry &E : Entries) {
+    Duration Start =
+        std::chrono::duration_cast<Duration>(E.Start - StartTime);
+    OS << "{ \"pid\": 1, \"tid\": 0, \"ph\": \"X\", \"ts\": "
+       << static_cast<long long>(Start.count())
+       << ", \"dur\": " << static_cast<long long>(E.Length.count())
+       << ", \"name\": ";
+    writeJSONString(OS, E.Name);
+    OS << ", \"args\": { \"detail\": ";
+    writeJSONString(OS, E.Detail);
+    OS << " } },\n";
+  }
+
+  // The totals, longest first, each on a row of its own.
+  typedef std::pair<StringRef, std::pair<unsigned, Duration>> NamedTotal;
+  std::vector<NamedTotal> SortedTotals;
+  for (const auto &Total : Totals)
+    SortedTotals.push_back(NamedTotal(Total.getKey(), Total.getValue()));
+  std::sort(SortedTotals.begin(), SortedTotals.end(),
+            [](const NamedTotal &A, const NamedTotal &B) {
+              if (A.second.second != B.second.second)
+                return A.second.second > B.second.second;
+              return A.first < B.first;
+            });
+
+  unsigned Row = 1;
+  for (const NamedTotal &Total : SortedTotals) {
+    OS << "{ \"pid\": 1, \"tid\": " << Row++ << ", \"ph\": \"X\", \"ts\": 0"
+       << ", \"dur\": " << static_cast<long long>(Total.second.second.count())
+       << ", \"name\": ";
+    writeJSONString(OS, "Total " + Total.first.str());
+    OS << ", \"args\": { \"count\": " << Total.second.first << " } },\n";
+  }
+
+  OS << "{ \"pid\": 1, \"tid\": 0, \"ph\": \"M\", \"name\": \"process_name\""
+     << ", \"args\": { \"name\": \"clang\" } }\n";
+  OS << "] }\n";
+}
@@ -11,6 +11,7 @@
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/LangOptions.h"
 #include "clang/Basic/TargetOptions.h"
+#include "clang/Basic/TimeTrace.h"
 #include "clang/Frontend/CodeGenOptions.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Frontend/Utils.h"
@@ -751,18 +752,22 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
 
     PerFunctionPasses->doInitialization();
     for (Function &F : *TheModule)
-      if (!F.isDeclaration())
+      if (!F.isDeclaration()) {
+        TimeTraceScope TimeScope("OptFunction", F.getName());
         PerFunctionPasses->run(F);
+      }
     PerFunctionPasses->doFinalization();
   }
 
   if (PerModulePasses) {
     PrettyStackTraceString CrashInfo("Per-module optimization passes");
+    TimeTraceScope TimeScope("OptModule", TheModule->getName());
     PerModulePasses->run(*TheModule);
   }
 
   if (CodeGenPasses) {
     PrettyStackTraceString CrashInfo("Code generation");
+    TimeTraceScope TimeScope("CodeGenPasses", TheModule->getName());
     CodeGenPasses->run(*TheModule);
   }
 }
@@ -773,6 +778,7 @@ void clang::EmitBackendOutput(DiagnosticsEngine &Diags,
                               const LangOptions &LOpts, const llvm::DataLayout &TDesc,
                               Module *M, BackendAction Action,
                               raw_pwrite_stream *OS) {
+  TimeTraceScope TimeScope("Backend", StringRef());
   EmitAssemblyHelper AsmHelper(Diags, CGOpts, TOpts, LOpts, M);
 
   AsmHelper.EmitAssembly(Action, OS);
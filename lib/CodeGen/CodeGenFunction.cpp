@@ -27,6 +27,7 @@
 #include "clang/AST/StmtCXX.h"
 #include "clang/Basic/Builtins.h"
 #include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/TimeTrace.h"
 #include "clang/CodeGen/CGFunctionInfo.h"
 #include "clang/Frontend/CodeGenOptions.h"
 #include "clang/Sema/SemaDiagnostic.h"
@@ -999,6 +1000,14 @@ void CodeGenFunction::GenerateCode(GlobalDecl GD, llvm::Function *Fn,
   const FunctionDecl *FD = cast<FunctionDecl>(GD.getDecl());
   CurGD = GD;
 
+  TimeTraceScope TimeScope("CodeGenFunction", [&]() {
+    std::string Name;
+    llvm::raw_string_ostream OS(Name);
+    FD->getNameForDiagnostic(OS, getContext().getPrintingPolicy(),
+                             /*Qualified=*/true);
+    return OS.str();
+  });
+
   FunctionArgList Args;
   QualType ResTy = BuildFunctionArgList(GD, Args);
 
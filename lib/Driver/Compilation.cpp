@@ -14,9 +14,16 @@
 #include "clang/Driver/Options.h"
 #include "clang/Driver/ToolChain.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 
 using namespace clang::driver;
 using namespace clang;
@@ -122,8 +129,7 @@ bool Compilation::CleanupFileMap(const ArgStringMap &Files,
   return Success;
 }
 
-int Compilation::ExecuteCommand(const Command &C,
-                                const Command *&FailingCommand) const {
+bool Compilation::PrintCommand(const Command &C) const {
   if ((getDriver().CCPrintOptions ||
        getArgs().hasArg(options::OPT_v)) && !getDriver().CCGenDiagnostics) {
     raw_ostream *OS = &llvm::errs();
@@ -138,9 +144,8 @@ int Compilation::ExecuteCommand(const Command &C,
       if (EC) {
         getDriver().Diag(clang::diag::err_drv_cc_print_options_failure)
             << EC.message();
-        FailingCommand = &C;
         delete OS;
-        return 1;
+        return false;
       }
     }
 
@@ -152,10 +157,12 @@ int Compilation::ExecuteCommand(const Command &C,
     if (OS != &llvm::errs())
       delete OS;
   }
+  return true;
+}
 
-  std::string Error;
-  bool ExecutionFailed;
-  int Res = C.Execute(Redirects, &Error, &ExecutionFailed);
+int Compilation::FinishCommand(const Command &C, int Res,
+                               const std::string &Error, bool ExecutionFailed,
+                               const Command *&FailingCommand) const {
   if (!Error.empty()) {
     assert(Res && "Error string set with 0 result code!");
     getDriver().Diag(clang::diag::err_drv_command_failure) << Error;
@@ -167,9 +174,28 @@ int Compilation::ExecuteCommand(const Command &C,
   return ExecutionFailed ? 1 : Res;
 }
 
+int Compilation::ExecuteCommand(const Command &C,
+                                const Command *&FailingCommand) const {
+  if (!PrintCommand(C)) {
+    FailingCommand = &C;
+    return 1;
+  }
+
+  std::string Error;
+  bool ExecutionFailed;
+  int Res = C.Execute(Redirects, &Error, &ExecutionFailed);
+  return FinishCommand(C, Res, Error, ExecutionFailed, FailingCommand);
+}
+
 void Compilation::ExecuteJobs(
     const JobList &Jobs,
     SmallVectorImpl<std::pair<int, const Command *>> &FailingCommands) const {
+#if LLVM_ENABLE_THREADS
+  unsigned NumThreads = getDriver().getNumParallelJobs();
+  if (NumThreads > 1 && Jobs.size() > 1)
+    return ExecuteJobsInParallel(Jobs, NumThreads, FailingCommands);
+#endif
+
   for (const auto &Job : Jobs) {
     const Command *FailingCommand = nullptr;
     if (int Res = ExecuteCommand(Job, FailingCommand)) {
@@ -181,6 +207,154 @@ void Compilation::ExecuteJobs(
   }
 }
 
+/// Compute, for each command in \p Jobs, the indices of the commands whose
+/// outputs it consumes. Command B depends on command A if A's source action is
+/// reachable from B's source action through action inputs; commands created
+/// for the same action (e.g. a compile followed by an objcopy for
+/// -gsplit-dwarf) keep their relative order.
+static void
+computeJobDependencies(const JobList &Jobs,
+                       std::vector<SmallVector<unsigned, 4>> &Dependencies) {
+  llvm::DenseMap<const Action *, SmallVector<unsigned, 2>> JobsForAction;
+  unsigned Index = 0;
+  for (const Command &Job : Jobs)
+    JobsForAction[&Job.getSource()].push_back(Index++);
+
+  Dependencies.resize(Jobs.size());
+  Index = 0;
+  for (const Command &Job : Jobs) {
+    SmallVectorImpl<unsigned> &Deps = Dependencies[Index];
+
+    // Order after earlier commands created for the same action.
+    for (unsigned Other : JobsForAction[&Job.getSource()]) {
+      if (Other >= Index)
+        break;
+      Deps.push_back(Other);
+    }
+
+    // Walk the inputs of the source action, stopping at the first action on
+    // each path which produced a command; its own dependencies are implied.
+    llvm::SmallPtrSet<const Action *, 16> Visited;
+    SmallVector<const Action *, 16> Worklist(Job.getSource().inputs().begin(),
+                                             Job.getSource().inputs().end());
+    while (!Worklist.empty()) {
+      const Action *A = Worklist.pop_back_val();
+      if (!Visited.insert(A).second)
+        continue;
+      auto It = JobsForAction.find(A);
+      if (It != JobsForAction.end()) {
+        Deps.append(It->second.begin(), It->second.end());
+        continue;
+      }
+      Worklist.append(A->inputs().begin(), A->inputs().end());
+    }
+    ++Index;
+  }
+}
+
+void Compilation::ExecuteJobsInParallel(
+    const JobList &Jobs, unsigned NumThreads,
+    SmallVectorImpl<std::pair<int, const Command *>> &FailingCommands) const {
+  std::vector<const Command *> Commands;
+  for (const Command &Job : Jobs)
+    Commands.push_back(&Job);
+
+  std::vector<SmallVector<unsigned, 4>> Dependencies;
+  computeJobDependencies(Jobs, Dependencies);
+
+  std::vector<unsigned> NumPendingDeps(Commands.size());
+  std::vector<SmallVector<unsigned, 4>> Dependents(Commands.size());
+  for (unsigned I = 0, E = Commands.size(); I != E; ++I) {
+    NumPendingDeps[I] = Dependencies[I].size();
+    for (unsigned Dep : Dependencies[I])
+      Dependents[Dep].push_back(I);
+  }
+
+  // Commands whose dependencies have all completed, launched in input order.
+  std::set<unsigned> Ready;
+  for (unsigned I = 0, E = Commands.size(); I != E; ++I)
+    if (!NumPendingDeps[I])
+      Ready.insert(I);
+
+  // The result of a finished command, as produced by a worker thread.
+  struct Result {
+    unsigned Index;
+    int Res;
+    std::string Error;
+    bool ExecutionFailed;
+  };
+
+  // Worker threads only run the subprocess; everything that touches the
+  // driver (printing, diagnostics) happens on this thread.
+  std::mutex Lock;
+  std::condition_variable Finished;
+  std::vector<Result> Completed;
+  std::map<unsigned, std::thread> Running;
+
+  SmallVector<std::pair<unsigned, std::pair<int, const Command *>>, 4> Failures;
+  while (!Ready.empty() || !Running.empty()) {
+    // Don't start any more commands once one has failed, so we don't output
+    // duplicate error messages if we die on e.g. the same file.
+    while (Failures.empty() && !Ready.empty() && Running.size() < NumThreads) {
+      unsigned Index = *Ready.begin();
+      Ready.erase(Ready.begin());
+
+      const Command *C = Commands[Index];
+      if (!PrintCommand(*C)) {
+        Failures.push_back(std::make_pair(Index, std::make_pair(1, C)));
+        break;
+      }
+
+      Running[Index] = std::thread([this, C, Index, &Lock, &Finished,
+                                    &Completed] {
+        Result R;
+        R.Index = Index;
+        R.Res = C->Execute(Redirects, &R.Error, &R.ExecutionFailed);
+        std::lock_guard<std::mutex> Guard(Lock);
+        Completed.push_back(std::move(R));
+        Finished.notify_one();
+      });
+    }
+
+    if (Running.empty())
+      break;
+
+    std::vector<Result> Done;
+    {
+      std::unique_lock<std::mutex> Guard(Lock);
+      Finished.wait(Guard, [&Completed] { return !Completed.empty(); });
+      Done.swap(Completed);
+    }
+
+    for (Result &R : Done) {
+      Running[R.Index].join();
+      Running.erase(R.Index);
+
+      const Command *C = Commands[R.Index];
+      const Command *FailingCommand = nullptr;
+      if (int Res = FinishCommand(*C, R.Res, R.Error, R.ExecutionFailed,
+                                  FailingCommand)) {
+        Failures.push_back(
+            std::make_pair(R.Index, std::make_pair(Res, FailingCommand)));
+        continue;
+      }
+
+      for (unsigned Dependent : Dependents[R.Index])
+        if (!--NumPendingDeps[Dependent])
+          Ready.insert(Dependent);
+    }
+  }
+
+  // Report failures in input order, independent of completion order.
+  std::sort(Failures.begin(), Failures.end(),
+            [](const std::pair<unsigned, std::pair<int, const Command *>> &LHS,
+               const std::pair<unsigned, std::pair<int, const Command *>> &RHS) {
+              return LHS.first < RHS.first;
+            });
+  for (const auto &F : Failures)
+    FailingCommands.push_back(F.second);
+}
+
 void Compilation::initCompilationForDiagnostics() {
   ForDiagnostics = true;
 
@@ -53,7 +53,7 @@ Driver::Driver(StringRef ClangExecutable, StringRef DefaultTargetTriple,
                IntrusiveRefCntPtr<vfs::FileSystem> VFS)
     : Opts(createDriverOptTable()), Diags(Diags), VFS(std::move(VFS)),
       Mode(GCCMode), SaveTemps(SaveTempsNone), BitcodeEmbed(EmbedNone),
-      LTOMode(LTOK_None), ClangExecutable(ClangExecutable),
+      LTOMode(LTOK_None), NumParallelJobs(1), ClangExecutable(ClangExecutable),
       SysRoot(DEFAULT_SYSROOT), UseStdLib(true),
       DefaultTargetTriple(DefaultTargetTriple),
       DriverTitle("clang LLVM compiler"), CCPrintOptionsFilename(nullptr),
@@ -531,6 +531,16 @@ Compilation *Driver::BuildCompilation(ArrayRef<const char *> ArgList) {
                     .Default(SaveTempsCwd);
   }
 
+  if (const Arg *A =
+          Args.getLastArg(options::OPT_j, options::OPT_parallel_jobs_EQ)) {
+    StringRef Value = A->getValue();
+    unsigned Jobs;
+    if (Value.getAsInteger(10, Jobs) || Jobs == 0)
+      Diag(diag::err_drv_invalid_int_value) << A->getAsString(Args) << Value;
+    else
+      NumParallelJobs = Jobs;
+  }
+
   setLTOMode(Args);
 
   // Ignore -fembed-bitcode options with LTO
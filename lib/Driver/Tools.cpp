@@ -3856,9 +3856,14 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   } else if (isa<MigrateJobAction>(JA)) {
     CmdArgs.push_back("-migrate");
   } else if (isa<PreprocessJobAction>(JA)) {
-    if (Output.getType() == types::TY_Dependencies)
+    if (Output.getType() == types::TY_Dependencies) {
       CmdArgs.push_back("-Eonly");
-    else {
+      // Only directives can affect the dependencies, unless modules are
+      // imported by declarations.
+      if (!Args.hasFlag(options::OPT_fmodules, options::OPT_fno_modules,
+                        false))
+        CmdArgs.push_back("-dependency-directives-only");
+    } else {
       CmdArgs.push_back("-E");
       if (Args.hasArg(options::OPT_rewrite_objc) &&
           !Args.hasArg(options::OPT_g_Group))
@@ -4877,6 +4882,11 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     CmdArgs.push_back(A->getValue());
   }
 
+  if (Arg *A = Args.getLastArg(options::OPT_fconstexpr_cache_size_EQ)) {
+    CmdArgs.push_back("-fconstexpr-cache-size");
+    CmdArgs.push_back(A->getValue());
+  }
+
   if (Arg *A = Args.getLastArg(options::OPT_fbracket_depth_EQ)) {
     CmdArgs.push_back("-fbracket-depth");
     CmdArgs.push_back(A->getValue());
@@ -5349,6 +5359,7 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddAllArgs(CmdArgs, options::OPT_fmodules_ignore_macro);
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_prune_interval);
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_prune_after);
+  Args.AddLastArg(CmdArgs, options::OPT_fmodules_build_jobs_EQ);
 
   Args.AddLastArg(CmdArgs, options::OPT_fbuild_session_timestamp);
 
@@ -5375,6 +5386,8 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   }
 
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_validate_system_headers);
+  Args.AddLastArg(CmdArgs,
+                  options::OPT_fmodules_validate_input_files_content);
 
   // -faccess-control is default.
   if (Args.hasFlag(options::OPT_fno_access_control,
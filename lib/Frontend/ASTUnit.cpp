@@ -34,6 +34,7 @@
 #include "clang/Serialization/ASTReader.h"
 #include "clang/Serialization/ASTWriter.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CrashRecoveryContext.h"
@@ -84,6 +85,13 @@ namespace {
     /// \brief The file in which the precompiled preamble is stored.
     std::string PreambleFile;
 
+    /// \brief The file in which the base layer of a layered precompiled
+    /// preamble is stored.
+    std::string PreambleBaseFile;
+
+    /// \brief The store keeping the preamble files in memory, if any.
+    IntrusiveRefCntPtr<InMemoryPreambleStore> PreambleStore;
+
     /// \brief Temporary files that should be removed when the ASTUnit is
     /// destroyed.
     SmallVector<std::string, 4> TemporaryFiles;
@@ -94,7 +102,10 @@ namespace {
     /// \brief Erase the preamble file.
     void CleanPreambleFile();
 
-    /// \brief Erase temporary files and the preamble file.
+    /// \brief Erase the base layer of the preamble.
+    void CleanPreambleBaseFile();
+
+    /// \brief Erase temporary files and the preamble files.
     void Cleanup();
   };
 }
@@ -118,6 +129,30 @@ static OnDiskDataMap &getOnDiskDataMap() {
   return M;
 }
 
+namespace {
+  /// \brief A preamble file that completion snapshots still refer to.
+  struct PinnedPreambleFile {
+    PinnedPreambleFile() : Pins(0), Erased(false) {}
+
+    /// \brief The number of snapshots referring to the file.
+    unsigned Pins;
+
+    /// \brief Whether the file should be erased once no snapshot refers to it.
+    bool Erased;
+
+    /// \brief The store keeping the file in memory, if any.
+    IntrusiveRefCntPtr<InMemoryPreambleStore> Store;
+  };
+}
+
+/// \brief The preamble files that completion snapshots still refer to.
+///
+/// Guarded by the on-disk mutex.
+static llvm::StringMap<PinnedPreambleFile> &getPinnedPreambleFiles() {
+  static llvm::StringMap<PinnedPreambleFile> M;
+  return M;
+}
+
 static void cleanupOnDiskMapAtExit() {
   // Use the mutex because there can be an alive thread destroying an ASTUnit.
   llvm::MutexGuard Guard(getOnDiskMutex());
@@ -126,6 +161,63 @@ static void cleanupOnDiskMapAtExit() {
     // All we care about is erasing stale files.
     I.second->Cleanup();
   }
+  for (const auto &I : getPinnedPreambleFiles())
+    if (I.second.Erased)
+      llvm::sys::fs::remove(I.first());
+}
+
+/// \brief Erase a preamble file, or, if a completion snapshot still refers to
+/// it, erase it once the last such snapshot is destroyed.
+static void erasePreambleFileWhenUnused(StringRef File,
+                                        InMemoryPreambleStore *Store) {
+  llvm::MutexGuard Guard(getOnDiskMutex());
+  llvm::StringMap<PinnedPreambleFile>::iterator Pinned =
+      getPinnedPreambleFiles().find(File);
+  if (Pinned != getPinnedPreambleFiles().end()) {
+    Pinned->second.Erased = true;
+    Pinned->second.Store = Store;
+    return;
+  }
+
+  if (Store)
+    Store->remove(File);
+  llvm::sys::fs::remove(File);
+}
+
+/// \brief Keep a preamble file from being erased until it is unpinned.
+static void pinPreambleFile(StringRef File) {
+  if (File.empty())
+    return;
+  llvm::MutexGuard Guard(getOnDiskMutex());
+  ++getPinnedPreambleFiles()[File].Pins;
+}
+
+static void unpinPreambleFile(StringRef File) {
+  if (File.empty())
+    return;
+  llvm::MutexGuard Guard(getOnDiskMutex());
+  llvm::StringMap<PinnedPreambleFile>::iterator Pinned =
+      getPinnedPreambleFiles().find(File);
+  assert(Pinned != getPinnedPreambleFiles().end() && "File is not pinned");
+  if (--Pinned->second.Pins)
+    return;
+
+  bool Erased = Pinned->second.Erased;
+  IntrusiveRefCntPtr<InMemoryPreambleStore> Store = Pinned->second.Store;
+  getPinnedPreambleFiles().erase(Pinned);
+  if (Erased)
+    erasePreambleFileWhenUnused(File, Store.get());
+}
+
+/// \brief Note that a preamble file is in use again, e.g. because a new
+/// preamble was written to the same path, so it must not be erased when the
+/// snapshots referring to its previous contents are destroyed.
+static void reclaimPreambleFile(StringRef File) {
+  llvm::MutexGuard Guard(getOnDiskMutex());
+  llvm::StringMap<PinnedPreambleFile>::iterator Pinned =
+      getPinnedPreambleFiles().find(File);
+  if (Pinned != getPinnedPreambleFiles().end())
+    Pinned->second.Erased = false;
 }
 
 static OnDiskData &getOnDiskData(const ASTUnit *AU) {
@@ -143,6 +235,10 @@ static void erasePreambleFile(const ASTUnit *AU) {
   getOnDiskData(AU).CleanPreambleFile();
 }
 
+static void erasePreambleBaseFile(const ASTUnit *AU) {
+  getOnDiskData(AU).CleanPreambleBaseFile();
+}
+
 static void removeOnDiskEntry(const ASTUnit *AU) {
   // We require the mutex since we are modifying the structure of the
   // DenseMap.
@@ -156,6 +252,7 @@ static void removeOnDiskEntry(const ASTUnit *AU) {
 }
 
 static void setPreambleFile(const ASTUnit *AU, StringRef preambleFile) {
+  reclaimPreambleFile(preambleFile);
   getOnDiskData(AU).PreambleFile = preambleFile;
 }
 
@@ -163,6 +260,15 @@ static const std::string &getPreambleFile(const ASTUnit *AU) {
   return getOnDiskData(AU).PreambleFile;  
 }
 
+static void setPreambleBaseFile(const ASTUnit *AU, StringRef BaseFile) {
+  reclaimPreambleFile(BaseFile);
+  getOnDiskData(AU).PreambleBaseFile = BaseFile;
+}
+
+static const std::string &getPreambleBaseFile(const ASTUnit *AU) {
+  return getOnDiskData(AU).PreambleBaseFile;
+}
+
 void OnDiskData::CleanTemporaryFiles() {
   for (StringRef File : TemporaryFiles)
     llvm::sys::fs::remove(File);
@@ -171,14 +277,22 @@ void OnDiskData::CleanTemporaryFiles() {
 
 void OnDiskData::CleanPreambleFile() {
   if (!PreambleFile.empty()) {
-    llvm::sys::fs::remove(PreambleFile);
+    erasePreambleFileWhenUnused(PreambleFile, PreambleStore.get());
     PreambleFile.clear();
   }
 }
 
+void OnDiskData::CleanPreambleBaseFile() {
+  if (!PreambleBaseFile.empty()) {
+    erasePreambleFileWhenUnused(PreambleBaseFile, PreambleStore.get());
+    PreambleBaseFile.clear();
+  }
+}
+
 void OnDiskData::Cleanup() {
   CleanTemporaryFiles();
   CleanPreambleFile();
+  CleanPreambleBaseFile();
 }
 
 struct ASTUnit::ASTWriterData {
@@ -220,7 +334,9 @@ ASTUnit::ASTUnit(bool _MainFileIsAST)
     OwnsRemappedFileBuffers(true),
     NumStoredDiagnosticsFromDriver(0),
     PreambleRebuildCounter(0),
-    NumWarningsInPreamble(0),
+    NumWarningsInPreamble(0), LayeredPreamble(false),
+    NumPreamblesPrecompiled(0), NumPreambleBasesPrecompiled(0),
+    NumPreambleBasesReused(0),
     ShouldCacheCodeCompletionResults(false),
     IncludeBriefCommentsInCodeCompletion(false), UserFilesAreVolatile(false),
     CompletionCacheTopLevelHashValue(0),
@@ -920,17 +1036,37 @@ class PrecompilePreambleConsumer : public PCHGenerator {
   unsigned &Hash;
   std::vector<Decl *> TopLevelDecls;
   PrecompilePreambleAction *Action;
+  /// The stream to write the preamble to, or null to keep it in the unit's
+  /// in-memory preamble store under OutputFile.
   raw_ostream *Out;
+  std::string OutputFile;
+
+  /// \brief Keep the preamble in the in-memory store, or write it to disk if
+  /// it doesn't fit there.
+  bool storePreamble() {
+    SmallVectorImpl<char> &PCH = getPCH();
+    if (Unit.getInMemoryPreambleStore()->store(
+            OutputFile, llvm::MemoryBuffer::getMemBufferCopy(
+                            StringRef(PCH.data(), PCH.size()), OutputFile)))
+      return true;
+
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(OutputFile, EC, llvm::sys::fs::F_None);
+    if (EC)
+      return false;
+    OS << PCH;
+    return true;
+  }
 
 public:
   PrecompilePreambleConsumer(ASTUnit &Unit, PrecompilePreambleAction *Action,
                              const Preprocessor &PP, StringRef isysroot,
-                             raw_ostream *Out)
+                             raw_ostream *Out, StringRef OutputFile)
       : PCHGenerator(PP, "", nullptr, isysroot, std::make_shared<PCHBuffer>(),
                      ArrayRef<llvm::IntrusiveRefCntPtr<ModuleFileExtension>>(),
                      /*AllowASTWithErrors=*/true),
         Unit(Unit), Hash(Unit.getCurrentTopLevelHashValue()), Action(Action),
-        Out(Out) {
+        Out(Out), OutputFile(OutputFile) {
     Hash = 0;
   }
 
@@ -951,10 +1087,14 @@ public:
   void HandleTranslationUnit(ASTContext &Ctx) override {
     PCHGenerator::HandleTranslationUnit(Ctx);
     if (hasEmittedPCH()) {
-      // Write the generated bitstream to "Out".
-      *Out << getPCH();
-      // Make sure it hits disk now.
-      Out->flush();
+      if (Out) {
+        // Write the generated bitstream to "Out".
+        *Out << getPCH();
+        // Make sure it hits disk now.
+        Out->flush();
+      } else if (!storePreamble()) {
+        return;
+      }
       // Free the buffer.
       llvm::SmallVector<char, 0> Empty;
       getPCH() = std::move(Empty);
@@ -975,6 +1115,96 @@ public:
   }
 };
 
+/// \brief Records the top-level directives of the main file at which a
+/// preamble could be split into layers, and which of them led to each file
+/// being included.
+class PreambleSplitPointCollector : public PPCallbacks {
+  const SourceManager &SM;
+  std::vector<unsigned> &SplitPoints;
+  llvm::StringMap<unsigned> &FileSplitPoints;
+
+  /// \brief The number of conditionals currently open in the main file.
+  unsigned Depth;
+
+  /// \brief The split point before the directive being processed.
+  unsigned Current;
+
+  /// \brief Enter the directive of the main file whose name is at \p Loc,
+  /// making it the current split point if it is at the top level.
+  void enterDirective(SourceLocation Loc) {
+    FileID FID;
+    unsigned Offset;
+    std::tie(FID, Offset) = SM.getDecomposedLoc(Loc);
+    if (FID != SM.getMainFileID() || Depth)
+      return;
+
+    // Find the '#' that starts the directive.
+    StringRef Buffer = SM.getBufferData(FID);
+    while (Offset && (Buffer[Offset - 1] == ' ' || Buffer[Offset - 1] == '\t'))
+      --Offset;
+    if (!Offset || Buffer[Offset - 1] != '#') {
+      // We can't tell where the directive starts; don't split before it.
+      Current = 0;
+      return;
+    }
+    Current = Offset - 1;
+    if (Current && (SplitPoints.empty() || SplitPoints.back() < Current))
+      SplitPoints.push_back(Current);
+  }
+
+  bool isInMainFile(SourceLocation Loc) const {
+    return SM.getFileID(Loc) == SM.getMainFileID();
+  }
+
+public:
+  PreambleSplitPointCollector(const SourceManager &SM,
+                              std::vector<unsigned> &SplitPoints,
+                              llvm::StringMap<unsigned> &FileSplitPoints,
+                              unsigned StartOffset)
+      : SM(SM), SplitPoints(SplitPoints), FileSplitPoints(FileSplitPoints),
+        Depth(0), Current(StartOffset) {}
+
+  void InclusionDirective(SourceLocation HashLoc, const Token &IncludeTok,
+                          StringRef FileName, bool IsAngled,
+                          CharSourceRange FilenameRange, const FileEntry *File,
+                          StringRef SearchPath, StringRef RelativePath,
+                          const Module *Imported) override {
+    if (isInMainFile(HashLoc))
+      enterDirective(HashLoc.getLocWithOffset(1));
+    if (File)
+      FileSplitPoints.insert(std::make_pair(File->getName(), Current));
+  }
+
+  void If(SourceLocation Loc, SourceRange ConditionRange,
+          ConditionValueKind ConditionValue) override {
+    if (isInMainFile(Loc)) {
+      enterDirective(Loc);
+      ++Depth;
+    }
+  }
+
+  void Ifdef(SourceLocation Loc, const Token &MacroNameTok,
+             const MacroDefinition &MD) override {
+    if (isInMainFile(Loc)) {
+      enterDirective(Loc);
+      ++Depth;
+    }
+  }
+
+  void Ifndef(SourceLocation Loc, const Token &MacroNameTok,
+              const MacroDefinition &MD) override {
+    if (isInMainFile(Loc)) {
+      enterDirective(Loc);
+      ++Depth;
+    }
+  }
+
+  void Endif(SourceLocation Loc, SourceLocation IfLoc) override {
+    if (Depth && isInMainFile(Loc))
+      --Depth;
+  }
+};
+
 } // anonymous namespace
 
 std::unique_ptr<ASTConsumer>
@@ -982,10 +1212,17 @@ PrecompilePreambleAction::CreateASTConsumer(CompilerInstance &CI,
                                             StringRef InFile) {
   std::string Sysroot;
   std::string OutputFile;
-  raw_ostream *OS = GeneratePCHAction::ComputeASTConsumerArguments(
-      CI, InFile, Sysroot, OutputFile);
-  if (!OS)
-    return nullptr;
+  raw_ostream *OS = nullptr;
+  if (Unit.getInMemoryPreambleStore()) {
+    // The consumer keeps the preamble in memory; there's no file to create.
+    Sysroot = CI.getHeaderSearchOpts().Sysroot;
+    OutputFile = CI.getFrontendOpts().OutputFile;
+  } else {
+    OS = GeneratePCHAction::ComputeASTConsumerArguments(CI, InFile, Sysroot,
+                                                        OutputFile);
+    if (!OS)
+      return nullptr;
+  }
 
   if (!CI.getFrontendOpts().RelocatablePCH)
     Sysroot.clear();
@@ -994,7 +1231,7 @@ PrecompilePreambleAction::CreateASTConsumer(CompilerInstance &CI,
       llvm::make_unique<MacroDefinitionTrackerPPCallbacks>(
                                            Unit.getCurrentTopLevelHashValue()));
   return llvm::make_unique<PrecompilePreambleConsumer>(
-      Unit, this, CI.getPreprocessor(), Sysroot, OS);
+      Unit, this, CI.getPreprocessor(), Sysroot, OS, OutputFile);
 }
 
 static bool isNonDriverDiag(const StoredDiagnostic &StoredDiag) {
@@ -1079,6 +1316,13 @@ bool ASTUnit::Parse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
   LangOpts = Clang->getInvocation().LangOpts;
   FileSystemOpts = Clang->getFileSystemOpts();
   if (!FileMgr) {
+    if (PreambleStore) {
+      IntrusiveRefCntPtr<vfs::FileSystem> VFS = createVFSFromCompilerInvocation(
+          Clang->getInvocation(), getDiagnostics());
+      if (!VFS)
+        return true;
+      Clang->setVirtualFileSystem(PreambleStore->getFileSystem(VFS));
+    }
     Clang->createFileManager();
     FileMgr = &Clang->getFileManager();
   }
@@ -1150,6 +1394,7 @@ bool ASTUnit::Parse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
   Act->EndSourceFile();
 
   FailedParseDiagnostics.clear();
+  publishCompletionSnapshot();
 
   return false;
 
@@ -1167,7 +1412,9 @@ error:
 }
 
 /// \brief Simple function to retrieve a path for a preamble precompiled header.
-static std::string GetPreamblePCHPath() {
+///
+/// If \p Store is non-null, the path is one to keep the preamble in it under.
+static std::string GetPreamblePCHPath(InMemoryPreambleStore *Store) {
   // FIXME: This is a hack so that we can override the preamble file during
   // crash-recovery testing, which is the only case where the preamble files
   // are not necessarily cleaned up.
@@ -1175,6 +1422,9 @@ static std::string GetPreamblePCHPath() {
   if (TmpFile)
     return TmpFile;
 
+  if (Store)
+    return Store->createPath();
+
   SmallString<128> Path;
   llvm::sys::fs::createTemporaryFile("preamble", "pch", Path);
 
@@ -1185,7 +1435,8 @@ static std::string GetPreamblePCHPath() {
 /// that corresponds to the main file along with a pair (bytes, start-of-line)
 /// that describes the preamble.
 ASTUnit::ComputedPreamble
-ASTUnit::ComputePreamble(CompilerInvocation &Invocation, unsigned MaxLines) {
+ASTUnit::ComputePreamble(CompilerInvocation &Invocation, unsigned MaxLines,
+                         FileManager &FileMgr) {
   FrontendOptions &FrontendOpts = Invocation.getFrontendOpts();
   PreprocessorOptions &PreprocessorOpts = Invocation.getPreprocessorOpts();
   
@@ -1204,9 +1455,10 @@ ASTUnit::ComputePreamble(CompilerInvocation &Invocation, unsigned MaxLines) {
       if (!llvm::sys::fs::getUniqueID(MPath, MID)) {
         if (MainFileID == MID) {
           // We found a remapping. Try to load the resulting, remapped source.
-          BufferOwner = getBufferForFile(RF.second);
-          if (!BufferOwner)
+          auto Remapped = FileMgr.getBufferForFile(RF.second);
+          if (!Remapped)
             return ComputedPreamble(nullptr, nullptr, 0, true);
+          BufferOwner = std::move(*Remapped);
         }
       }
     }
@@ -1228,9 +1480,10 @@ ASTUnit::ComputePreamble(CompilerInvocation &Invocation, unsigned MaxLines) {
   
   // If the main source file was not remapped, load it now.
   if (!Buffer && !BufferOwner) {
-    BufferOwner = getBufferForFile(FrontendOpts.Inputs[0].getFile());
-    if (!BufferOwner)
+    auto Main = FileMgr.getBufferForFile(FrontendOpts.Inputs[0].getFile());
+    if (!Main)
       return ComputedPreamble(nullptr, nullptr, 0, true);
+    BufferOwner = std::move(*Main);
   }
 
   if (!Buffer)
@@ -1316,6 +1569,66 @@ makeStandaloneDiagnostic(const LangOptions &LangOpts,
   return OutDiag;
 }
 
+typedef std::map<llvm::sys::fs::UniqueID, ASTUnit::PreambleFileHash>
+    OverriddenFilesMap;
+
+/// \brief Make a record of the files that have been overridden via remapping
+/// or unsaved_files.
+///
+/// \returns true if one of the overriding files could not be found, in which
+/// case the files used by the preamble must be assumed to have changed.
+static bool collectOverriddenFiles(FileManager &FileMgr,
+                                   const PreprocessorOptions &PPOpts,
+                                   OverriddenFilesMap &OverriddenFiles) {
+  for (const auto &R : PPOpts.RemappedFiles) {
+    vfs::Status Status;
+    if (FileMgr.getNoncachedStatValue(R.second, Status)) {
+      // If we can't stat the file we're remapping to, assume that something
+      // horrible happened.
+      return true;
+    }
+
+    OverriddenFiles[Status.getUniqueID()] =
+        ASTUnit::PreambleFileHash::createForFile(
+            Status.getSize(), Status.getLastModificationTime().toEpochTime());
+  }
+
+  for (const auto &RB : PPOpts.RemappedFileBuffers) {
+    vfs::Status Status;
+    if (FileMgr.getNoncachedStatValue(RB.first, Status))
+      return true;
+
+    OverriddenFiles[Status.getUniqueID()] =
+        ASTUnit::PreambleFileHash::createForMemoryBuffer(RB.second);
+  }
+  return false;
+}
+
+/// \brief Check whether a file used by a precompiled preamble has changed
+/// since the preamble was built.
+static bool hasPreambleFileChanged(FileManager &FileMgr, StringRef Filename,
+                                   const ASTUnit::PreambleFileHash &Hash,
+                                   const OverriddenFilesMap &OverriddenFiles) {
+  vfs::Status Status;
+  if (FileMgr.getNoncachedStatValue(Filename, Status)) {
+    // If we can't stat the file, assume that something horrible happened.
+    return true;
+  }
+
+  OverriddenFilesMap::const_iterator Overridden =
+      OverriddenFiles.find(Status.getUniqueID());
+  if (Overridden != OverriddenFiles.end()) {
+    // This file was remapped; check whether the newly-mapped file
+    // matches up with the previous mapping.
+    return Overridden->second != Hash;
+  }
+
+  // The file was not remapped; check whether it has changed on disk.
+  return Status.getSize() != uint64_t(Hash.Size) ||
+         Status.getLastModificationTime().toEpochTime() !=
+             uint64_t(Hash.ModTime);
+}
+
 /// \brief Attempt to build or re-use a precompiled preamble when (re-)parsing
 /// the source file.
 ///
@@ -1348,97 +1661,93 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
   PreprocessorOptions &PreprocessorOpts
     = PreambleInvocation->getPreprocessorOpts();
 
-  ComputedPreamble NewPreamble = ComputePreamble(*PreambleInvocation, MaxLines);
+  ComputedPreamble NewPreamble =
+      ComputePreamble(*PreambleInvocation, MaxLines, *FileMgr);
 
   if (!NewPreamble.Size) {
     // We couldn't find a preamble in the main source. Clear out the current
     // preamble, if we have one. It's obviously no good any more.
     Preamble.clear();
     erasePreambleFile(this);
+    clearPreambleBase();
 
     // The next time we actually see a preamble, precompile it.
     PreambleRebuildCounter = 1;
     return nullptr;
   }
-  
+
+  // Layers are chained onto each other, so they can't be chained onto a PCH
+  // the invocation already includes.
+  bool Layered = LayeredPreamble && PreprocessorOpts.ImplicitPCHInclude.empty();
+
+  // The number of bytes at the start of the preamble that did not change and
+  // do not depend on any file that changed, if the preamble is layered.
+  unsigned UnchangedBytes = 0;
+  // A preamble kept in memory may have been evicted to make room for those
+  // of other translation units. Those that are still there are pinned until
+  // the parse using them is done.
+  PreamblePins.clear();
+  if (PreambleStore && PreambleBase.Size &&
+      !pinStoredPreamble(getPreambleBaseFile(this)))
+    clearPreambleBase();
+  bool PreambleEvicted = PreambleStore && !Preamble.empty() &&
+                         !pinStoredPreamble(getPreambleFile(this));
+
   if (!Preamble.empty()) {
     // We've previously computed a preamble. Check whether we have the same
     // preamble now that we did before, and that there's enough space in
     // the main-file buffer within the precompiled preamble to fit the
     // new main file.
-    if (Preamble.size() == NewPreamble.Size &&
+    bool SamePreamble =
+        !PreambleEvicted && Preamble.size() == NewPreamble.Size &&
         PreambleEndsAtStartOfLine == NewPreamble.PreambleEndsAtStartOfLine &&
         memcmp(Preamble.getBufferStart(), NewPreamble.Buffer->getBufferStart(),
-               NewPreamble.Size) == 0) {
-      // The preamble has not changed. We may be able to re-use the precompiled
-      // preamble.
+               NewPreamble.Size) == 0;
+    if (Layered) {
+      const char *Old = Preamble.getBufferStart();
+      unsigned Common = std::min<unsigned>(Preamble.size(), NewPreamble.Size);
+      UnchangedBytes =
+          std::mismatch(Old, Old + Common, NewPreamble.Buffer->getBufferStart())
+              .first - Old;
+    }
+
+    if (SamePreamble || Layered) {
+      // The preamble has not changed, or only part of it has. We may be able
+      // to re-use the precompiled preamble, or its base layer.
 
       // Check that none of the files used by the preamble have changed.
-      bool AnyFileChanged = false;
-          
       // First, make a record of those files that have been overridden via
       // remapping or unsaved_files.
-      std::map<llvm::sys::fs::UniqueID, PreambleFileHash> OverriddenFiles;
-      for (const auto &R : PreprocessorOpts.RemappedFiles) {
-        if (AnyFileChanged)
-          break;
-
-        vfs::Status Status;
-        if (FileMgr->getNoncachedStatValue(R.second, Status)) {
-          // If we can't stat the file we're remapping to, assume that something
-          // horrible happened.
-          AnyFileChanged = true;
-          break;
-        }
-
-        OverriddenFiles[Status.getUniqueID()] = PreambleFileHash::createForFile(
-            Status.getSize(), Status.getLastModificationTime().toEpochTime());
-      }
-
-      for (const auto &RB : PreprocessorOpts.RemappedFileBuffers) {
-        if (AnyFileChanged)
-          break;
+      OverriddenFilesMap OverriddenFiles;
+      bool AnyFileChanged =
+          collectOverriddenFiles(*FileMgr, PreprocessorOpts, OverriddenFiles);
 
-        vfs::Status Status;
-        if (FileMgr->getNoncachedStatValue(RB.first, Status)) {
-          AnyFileChanged = true;
-          break;
-        }
+      // Without the remappings, we can't tell which files changed.
+      if (AnyFileChanged)
+        UnchangedBytes = 0;
 
-        OverriddenFiles[Status.getUniqueID()] =
-            PreambleFileHash::createForMemoryBuffer(RB.second);
-      }
-       
-      // Check whether anything has changed.
+      // Check whether anything has changed. When layering the preamble, keep
+      // looking for as long as part of it could be kept.
       for (llvm::StringMap<PreambleFileHash>::iterator
              F = FilesInPreamble.begin(), FEnd = FilesInPreamble.end();
-           !AnyFileChanged && F != FEnd; 
+           F != FEnd && (!AnyFileChanged || UnchangedBytes);
            ++F) {
-        vfs::Status Status;
-        if (FileMgr->getNoncachedStatValue(F->first(), Status)) {
-          // If we can't stat the file, assume that something horrible happened.
-          AnyFileChanged = true;
-          break;
-        }
-
-        std::map<llvm::sys::fs::UniqueID, PreambleFileHash>::iterator Overridden
-          = OverriddenFiles.find(Status.getUniqueID());
-        if (Overridden != OverriddenFiles.end()) {
-          // This file was remapped; check whether the newly-mapped file 
-          // matches up with the previous mapping.
-          if (Overridden->second != F->second)
-            AnyFileChanged = true;
+        if (!hasPreambleFileChanged(*FileMgr, F->first(), F->second,
+                                    OverriddenFiles))
           continue;
-        }
-        
-        // The file was not remapped; check whether it has changed on disk.
-        if (Status.getSize() != uint64_t(F->second.Size) ||
-            Status.getLastModificationTime().toEpochTime() !=
-                uint64_t(F->second.ModTime))
-          AnyFileChanged = true;
+
+        // Only the part of the preamble before the directive that included
+        // the file can be kept.
+        AnyFileChanged = true;
+        llvm::StringMap<unsigned>::iterator SplitPoint =
+            PreambleFileSplitPoints.find(F->first());
+        if (SplitPoint == PreambleFileSplitPoints.end())
+          UnchangedBytes = 0;
+        else
+          UnchangedBytes = std::min(UnchangedBytes, SplitPoint->second);
       }
           
-      if (!AnyFileChanged) {
+      if (SamePreamble && !AnyFileChanged) {
         // Okay! We can re-use the precompiled preamble.
 
         // Set the state of the diagnostic object to mimic its state
@@ -1479,7 +1788,7 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
 
   // Create a temporary file for the precompiled preamble. In rare 
   // circumstances, this can fail.
-  std::string PreamblePCHPath = GetPreamblePCHPath();
+  std::string PreamblePCHPath = GetPreamblePCHPath(PreambleStore.get());
   if (PreamblePCHPath.empty()) {
     // Try again next time.
     PreambleRebuildCounter = 1;
@@ -1511,7 +1820,142 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
   FrontendOpts.OutputFile = PreamblePCHPath;
   PreprocessorOpts.PrecompiledPreambleBytes.first = 0;
   PreprocessorOpts.PrecompiledPreambleBytes.second = false;
+
+  // Keep the base layer if nothing it covers changed. Otherwise, when
+  // layering, build a new one up to the last top-level directive before the
+  // first change.
+  unsigned BaseSize = 0;
+  bool BuildBase = false;
+  if (PreambleBase.Size && PreambleBase.Size <= UnchangedBytes &&
+      PreambleBase.Size < NewPreamble.Size) {
+    BaseSize = PreambleBase.Size;
+  } else {
+    if (Layered) {
+      std::vector<unsigned>::iterator Split = std::upper_bound(
+          PreambleSplitPoints.begin(), PreambleSplitPoints.end(),
+          std::min(UnchangedBytes, NewPreamble.Size - 1));
+      if (Split != PreambleSplitPoints.begin())
+        BaseSize = *--Split;
+      BuildBase = BaseSize != 0;
+    }
+    clearPreambleBase();
+  }
+
+  // Forget the split points past the base layer; building the layers above it
+  // records them again.
+  PreambleSplitPoints.erase(std::lower_bound(PreambleSplitPoints.begin(),
+                                             PreambleSplitPoints.end(),
+                                             PreambleBase.Size),
+                            PreambleSplitPoints.end());
+  for (llvm::StringMap<unsigned>::iterator
+         I = PreambleFileSplitPoints.begin(), E = PreambleFileSplitPoints.end();
+       I != E;) {
+    llvm::StringMap<unsigned>::iterator Current = I++;
+    if (Current->second >= PreambleBase.Size)
+      PreambleFileSplitPoints.erase(Current);
+  }
+
+  if (BuildBase) {
+    // Precompile the base layer from the start of the preamble, with the
+    // main file remapped to that part only.
+    std::string BasePCHPath = GetPreamblePCHPath(PreambleStore.get());
+    IntrusiveRefCntPtr<CompilerInvocation>
+      BaseInvocation(new CompilerInvocation(*PreambleInvocation));
+    std::unique_ptr<llvm::MemoryBuffer> BaseBuffer =
+        llvm::MemoryBuffer::getMemBufferCopy(
+            NewPreamble.Buffer->getBuffer().slice(0, BaseSize), MainFilename);
+    BaseInvocation->getPreprocessorOpts().RemappedFileBuffers.back().second =
+        BaseBuffer.get();
+    BaseInvocation->getFrontendOpts().OutputFile = BasePCHPath;
+
+    llvm::StringMap<PreambleFileHash> BaseFiles;
+    if (!BasePCHPath.empty() &&
+        PrecompilePreamble(PCHContainerOps, *BaseInvocation, 0, BaseFiles)) {
+      setPreambleBaseFile(this, BasePCHPath);
+      PreambleBase.Size = BaseSize;
+      PreambleBase.Files = std::move(BaseFiles);
+      PreambleBase.Diagnostics = PreambleDiagnostics;
+      PreambleBase.NumWarnings = getDiagnostics().getNumWarnings();
+      PreambleBase.TopLevelDecls = TopLevelDeclsInPreamble;
+      PreambleBase.TopLevelHashValue = CurrentTopLevelHashValue;
+      ++NumPreambleBasesPrecompiled;
+      // Keep the base layer from being evicted by the layer above it.
+      pinStoredPreamble(BasePCHPath);
+    } else {
+      // Fall back to precompiling the preamble in one piece.
+      BaseSize = 0;
+      PreambleSplitPoints.clear();
+      PreambleFileSplitPoints.clear();
+    }
+  }
+
+  if (BaseSize) {
+    // Chain the rest of the preamble onto the base layer.
+    PreprocessorOpts.ImplicitPCHInclude = getPreambleBaseFile(this);
+    PreprocessorOpts.PrecompiledPreambleBytes.first = BaseSize;
+    PreprocessorOpts.PrecompiledPreambleBytes.second = true;
+    PreprocessorOpts.DisablePCHValidation = true;
+  }
+
+  bool Precompiled = PrecompilePreamble(std::move(PCHContainerOps),
+                                        *PreambleInvocation, BaseSize,
+                                        FilesInPreamble);
+  PreprocessorOpts.RemappedFileBuffers.pop_back();
+  if (!Precompiled) {
+    // The preamble PCH failed (e.g. there was a module loading fatal error),
+    // so no precompiled header was generated. Forget that we even tried.
+    // FIXME: Should we leave a note for ourselves to try again?
+    Preamble.clear();
+    TopLevelDeclsInPreamble.clear();
+    clearPreambleBase();
+    PreambleRebuildCounter = DefaultPreambleRebuildInterval;
+    return nullptr;
+  }
   
+  // Keep track of the preamble we precompiled.
+  setPreambleFile(this, FrontendOpts.OutputFile);
+  pinStoredPreamble(FrontendOpts.OutputFile);
+  NumWarningsInPreamble = getDiagnostics().getNumWarnings();
+  ++NumPreamblesPrecompiled;
+  if (BaseSize && !BuildBase)
+    ++NumPreambleBasesReused;
+  if (BaseSize) {
+    // The preamble depends on everything its base layer does.
+    NumWarningsInPreamble += PreambleBase.NumWarnings;
+    for (const auto &F : PreambleBase.Files)
+      FilesInPreamble.insert(std::make_pair(F.first(), F.second));
+    CurrentTopLevelHashValue = llvm::hash_combine(
+        PreambleBase.TopLevelHashValue, CurrentTopLevelHashValue);
+  }
+
+  PreambleRebuildCounter = 1;
+
+  // If the hash of top-level entities differs from the hash of the top-level
+  // entities the last time we rebuilt the preamble, clear out the completion
+  // cache.
+  if (CurrentTopLevelHashValue != PreambleTopLevelHashValue) {
+    CompletionCacheTopLevelHashValue = 0;
+    PreambleTopLevelHashValue = CurrentTopLevelHashValue;
+  }
+
+  return llvm::MemoryBuffer::getMemBufferCopy(NewPreamble.Buffer->getBuffer(),
+                                              MainFilename);
+}
+
+/// \brief Precompile the preamble (or a layer of it) that \p PreambleInvocation
+/// describes, starting at offset \p StartOffset of the main file.
+///
+/// The diagnostics and top-level declarations of the preamble, including
+/// those of its base layer if \p StartOffset is not zero, replace the current
+/// ones, and the files the layer depends on are recorded in \p Files.
+///
+/// \returns true if the precompiled preamble was written.
+bool ASTUnit::PrecompilePreamble(
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+    CompilerInvocation &PreambleInvocation, unsigned StartOffset,
+    llvm::StringMap<PreambleFileHash> &Files) {
+  StringRef OutputFile = PreambleInvocation.getFrontendOpts().OutputFile;
+
   // Create the compiler instance to use for building the precompiled preamble.
   std::unique_ptr<CompilerInstance> Clang(
       new CompilerInstance(std::move(PCHContainerOps)));
@@ -1520,7 +1964,7 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
   llvm::CrashRecoveryContextCleanupRegistrar<CompilerInstance>
     CICleanup(Clang.get());
 
-  Clang->setInvocation(&*PreambleInvocation);
+  Clang->setInvocation(&PreambleInvocation);
   OriginalSourceFile = Clang->getFrontendOpts().Inputs[0].getFile();
   
   // Set up diagnostics, capturing all of the diagnostics produced.
@@ -1530,11 +1974,8 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
   Clang->setTarget(TargetInfo::CreateTargetInfo(
       Clang->getDiagnostics(), Clang->getInvocation().TargetOpts));
   if (!Clang->hasTarget()) {
-    llvm::sys::fs::remove(FrontendOpts.OutputFile);
-    Preamble.clear();
-    PreambleRebuildCounter = DefaultPreambleRebuildInterval;
-    PreprocessorOpts.RemappedFileBuffers.pop_back();
-    return nullptr;
+    llvm::sys::fs::remove(OutputFile);
+    return false;
   }
   
   // Inform the target of the language options.
@@ -1557,11 +1998,18 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
   TopLevelDecls.clear();
   TopLevelDeclsInPreamble.clear();
   PreambleDiagnostics.clear();
+  if (StartOffset) {
+    // Start from what the base layer has.
+    TopLevelDeclsInPreamble = PreambleBase.TopLevelDecls;
+    PreambleDiagnostics = PreambleBase.Diagnostics;
+  }
 
   IntrusiveRefCntPtr<vfs::FileSystem> VFS =
       createVFSFromCompilerInvocation(Clang->getInvocation(), getDiagnostics());
   if (!VFS)
-    return nullptr;
+    return false;
+  if (PreambleStore)
+    VFS = PreambleStore->getFileSystem(VFS);
 
   // Create a file manager object to provide access to and cache the filesystem.
   Clang->setFileManager(new FileManager(Clang->getFileSystemOpts(), VFS));
@@ -1576,13 +2024,16 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
   std::unique_ptr<PrecompilePreambleAction> Act;
   Act.reset(new PrecompilePreambleAction(*this));
   if (!Act->BeginSourceFile(*Clang.get(), Clang->getFrontendOpts().Inputs[0])) {
-    llvm::sys::fs::remove(FrontendOpts.OutputFile);
-    Preamble.clear();
-    PreambleRebuildCounter = DefaultPreambleRebuildInterval;
-    PreprocessorOpts.RemappedFileBuffers.pop_back();
-    return nullptr;
+    llvm::sys::fs::remove(OutputFile);
+    return false;
   }
-  
+
+  if (LayeredPreamble)
+    Clang->getPreprocessor().addPPCallbacks(
+        llvm::make_unique<PreambleSplitPointCollector>(
+            Clang->getSourceManager(), PreambleSplitPoints,
+            PreambleFileSplitPoints, StartOffset));
+
   Act->Execute();
 
   // Transfer any diagnostics generated when parsing the preamble into the set
@@ -1598,52 +2049,56 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
   checkAndRemoveNonDriverDiags(StoredDiagnostics);
 
   if (!Act->hasEmittedPreamblePCH()) {
-    // The preamble PCH failed (e.g. there was a module loading fatal error),
-    // so no precompiled header was generated. Forget that we even tried.
-    // FIXME: Should we leave a note for ourselves to try again?
-    llvm::sys::fs::remove(FrontendOpts.OutputFile);
-    Preamble.clear();
-    TopLevelDeclsInPreamble.clear();
-    PreambleRebuildCounter = DefaultPreambleRebuildInterval;
-    PreprocessorOpts.RemappedFileBuffers.pop_back();
-    return nullptr;
+    llvm::sys::fs::remove(OutputFile);
+    return false;
   }
-  
-  // Keep track of the preamble we precompiled.
-  setPreambleFile(this, FrontendOpts.OutputFile);
-  NumWarningsInPreamble = getDiagnostics().getNumWarnings();
-  
+
   // Keep track of all of the files that the source manager knows about,
   // so we can verify whether they have changed or not.
-  FilesInPreamble.clear();
+  Files.clear();
   SourceManager &SourceMgr = Clang->getSourceManager();
   for (auto &Filename : PreambleDepCollector->getDependencies()) {
     const FileEntry *File = Clang->getFileManager().getFile(Filename);
     if (!File || File == SourceMgr.getFileEntryForID(SourceMgr.getMainFileID()))
       continue;
     if (time_t ModTime = File->getModificationTime()) {
-      FilesInPreamble[File->getName()] = PreambleFileHash::createForFile(
+      Files[File->getName()] = PreambleFileHash::createForFile(
           File->getSize(), ModTime);
     } else {
       llvm::MemoryBuffer *Buffer = SourceMgr.getMemoryBufferForFile(File);
-      FilesInPreamble[File->getName()] =
+      Files[File->getName()] =
           PreambleFileHash::createForMemoryBuffer(Buffer);
     }
   }
+  return true;
+}
 
-  PreambleRebuildCounter = 1;
-  PreprocessorOpts.RemappedFileBuffers.pop_back();
+/// \brief Drop the base layer of the precompiled preamble, if there is one.
+void ASTUnit::clearPreambleBase() {
+  erasePreambleBaseFile(this);
+  PreambleBase = PreambleLayer();
+}
 
-  // If the hash of top-level entities differs from the hash of the top-level
-  // entities the last time we rebuilt the preamble, clear out the completion
-  // cache.
-  if (CurrentTopLevelHashValue != PreambleTopLevelHashValue) {
-    CompletionCacheTopLevelHashValue = 0;
-    PreambleTopLevelHashValue = CurrentTopLevelHashValue;
-  }
+/// \brief Keep the preamble stored in memory at \p File, if any, from being
+/// evicted until the current parse is done.
+///
+/// \returns false if the preamble is not stored in memory.
+bool ASTUnit::pinStoredPreamble(StringRef File) {
+  if (!PreambleStore)
+    return false;
+  std::shared_ptr<const InMemoryPreambleStore::Entry> Pin =
+      PreambleStore->pin(File);
+  if (!Pin)
+    return false;
+  PreamblePins.push_back(std::move(Pin));
+  return true;
+}
 
-  return llvm::MemoryBuffer::getMemBufferCopy(NewPreamble.Buffer->getBuffer(),
-                                              MainFilename);
+void ASTUnit::PrintPreambleStats() const {
+  llvm::errs() << "\n*** Preamble Stats:\n";
+  llvm::errs() << NumPreamblesPrecompiled << " preambles precompiled, "
+               << NumPreambleBasesPrecompiled << " base layers precompiled, "
+               << NumPreambleBasesReused << " base layers reused.\n";
 }
 
 void ASTUnit::RealizeTopLevelDeclsFromPreamble() {
@@ -1896,7 +2351,10 @@ bool ASTUnit::LoadFromCompilerInvocation(
   llvm::CrashRecoveryContextCleanupRegistrar<llvm::MemoryBuffer>
     MemBufferCleanup(OverrideMainBuffer.get());
 
-  return Parse(std::move(PCHContainerOps), std::move(OverrideMainBuffer));
+  bool Result =
+      Parse(std::move(PCHContainerOps), std::move(OverrideMainBuffer));
+  PreamblePins.clear();
+  return Result;
 }
 
 std::unique_ptr<ASTUnit> ASTUnit::LoadFromCompilerInvocation(
@@ -1945,7 +2403,9 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
     bool CacheCodeCompletionResults, bool IncludeBriefCommentsInCodeCompletion,
     bool AllowPCHWithCompilerErrors, bool SkipFunctionBodies,
     bool UserFilesAreVolatile, bool ForSerialization,
-    llvm::Optional<StringRef> ModuleFormat, std::unique_ptr<ASTUnit> *ErrAST) {
+    llvm::Optional<StringRef> ModuleFormat, std::unique_ptr<ASTUnit> *ErrAST,
+    IntrusiveRefCntPtr<SharedFileSystemCache> SharedFileCache,
+    IntrusiveRefCntPtr<InMemoryPreambleStore> PreambleStore) {
   assert(Diags.get() && "no DiagnosticsEngine was provided");
 
   SmallVector<StoredDiagnostic, 4> StoredDiagnostics;
@@ -1991,7 +2451,13 @@ ASTUnit *ASTUnit::LoadFromCommandLine(
       createVFSFromCompilerInvocation(*CI, *Diags);
   if (!VFS)
     return nullptr;
+  if (PreambleStore) {
+    VFS = PreambleStore->getFileSystem(VFS);
+    getOnDiskData(AST.get()).PreambleStore = PreambleStore;
+    AST->PreambleStore = std::move(PreambleStore);
+  }
   AST->FileMgr = new FileManager(AST->FileSystemOpts, VFS);
+  AST->FileMgr->setSharedCache(std::move(SharedFileCache));
   AST->OnlyLocalDecls = OnlyLocalDecls;
   AST->CaptureDiagnostics = CaptureDiagnostics;
   AST->TUKind = TUKind;
@@ -2064,6 +2530,7 @@ bool ASTUnit::Reparse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
   // Parse the sources
   bool Result =
       Parse(std::move(PCHContainerOps), std::move(OverrideMainBuffer));
+  PreamblePins.clear();
 
   // If we're caching global code-completion results, and the top-level 
   // declarations have changed, clear out the code-completion cache.
@@ -2074,10 +2541,120 @@ bool ASTUnit::Reparse(std::shared_ptr<PCHContainerOperations> PCHContainerOps,
   // We now need to clear out the completion info related to this translation
   // unit; it'll be recreated if necessary.
   CCTUInfo.reset();
-  
+
+  if (Invocation->getFrontendOpts().ShowStats)
+    PrintPreambleStats();
+
   return Result;
 }
 
+ASTUnit::CompletionSnapshot::CompletionSnapshot()
+  : Version(0), PreambleEndsAtStartOfLine(false) { }
+
+ASTUnit::CompletionSnapshot::~CompletionSnapshot() {
+  unpinPreambleFile(PreambleFile);
+  unpinPreambleFile(PreambleBaseFile);
+}
+
+FileManager *ASTUnit::CompletionSnapshot::createFileManager() const {
+  return new FileManager(FileSystemOpts, VFS);
+}
+
+/// \brief Check whether the precompiled preamble of the snapshot can be used to
+/// perform code completion with \p CCInvocation.
+///
+/// This is the snapshot's counterpart of \c
+/// ASTUnit::getMainBufferWithPrecompiledPreamble() when it is not allowed to
+/// rebuild the preamble.
+///
+/// \returns If the precompiled preamble can be used, returns a newly-allocated
+/// buffer that should be used in place of the main file when doing so.
+/// Otherwise, returns a NULL pointer.
+std::unique_ptr<llvm::MemoryBuffer>
+ASTUnit::CompletionSnapshot::getMainBufferWithPrecompiledPreamble(
+    CompilerInvocation &CCInvocation, FileManager &FileMgr, unsigned MaxLines,
+    std::vector<std::shared_ptr<const InMemoryPreambleStore::Entry>> &Pins)
+    const {
+  // A preamble kept in memory may have been evicted to make room for those
+  // of other translation units. Those that are still there are pinned in
+  // \p Pins, which the caller keeps until code completion is done.
+  if (PreambleStore) {
+    for (const std::string &File : {PreambleFile, PreambleBaseFile}) {
+      if (File.empty())
+        continue;
+      std::shared_ptr<const InMemoryPreambleStore::Entry> Pin =
+          PreambleStore->pin(File);
+      if (!Pin)
+        return nullptr;
+      Pins.push_back(std::move(Pin));
+    }
+  }
+
+  ComputedPreamble NewPreamble =
+      ComputePreamble(CCInvocation, MaxLines, FileMgr);
+  if (NewPreamble.Size != Preamble.size() ||
+      NewPreamble.PreambleEndsAtStartOfLine != PreambleEndsAtStartOfLine ||
+      memcmp(Preamble.data(), NewPreamble.Buffer->getBufferStart(),
+             NewPreamble.Size) != 0)
+    return nullptr;
+
+  OverriddenFilesMap OverriddenFiles;
+  if (collectOverriddenFiles(FileMgr, CCInvocation.getPreprocessorOpts(),
+                             OverriddenFiles))
+    return nullptr;
+  for (const auto &F : FilesInPreamble)
+    if (hasPreambleFileChanged(FileMgr, F.first(), F.second, OverriddenFiles))
+      return nullptr;
+
+  return llvm::MemoryBuffer::getMemBufferCopy(
+      NewPreamble.Buffer->getBuffer(),
+      CCInvocation.getFrontendOpts().Inputs[0].getFile());
+}
+
+/// \brief Publish a snapshot of the parse that just succeeded, for code
+/// completion to use while the translation unit is reparsed.
+void ASTUnit::publishCompletionSnapshot() {
+  std::shared_ptr<CompletionSnapshot> New(new CompletionSnapshot);
+  New->Invocation = new CompilerInvocation(*Invocation);
+  // The remapped buffers are owned by this translation unit, which frees them
+  // when it is reparsed; code completion provides its own.
+  New->Invocation->getPreprocessorOpts().clearRemappedFiles();
+  New->FileSystemOpts = FileSystemOpts;
+  New->VFS = FileMgr->getVirtualFileSystem();
+
+  // Only keep the precompiled preamble if the parse used it.
+  if (SavedMainFileBuffer) {
+    New->Preamble.assign(Preamble.getBufferStart(),
+                         Preamble.getBufferStart() + Preamble.size());
+    New->PreambleEndsAtStartOfLine = PreambleEndsAtStartOfLine;
+    New->FilesInPreamble = FilesInPreamble;
+    New->PreambleFile = getPreambleFile(this);
+    New->PreambleBaseFile = getPreambleBaseFile(this);
+    New->PreambleStore = PreambleStore;
+    pinPreambleFile(New->PreambleFile);
+    pinPreambleFile(New->PreambleBaseFile);
+  }
+
+  // Let the previous snapshot go outside of the lock; it may erase preamble
+  // files when destroyed.
+  std::shared_ptr<const CompletionSnapshot> Previous;
+  std::lock_guard<std::mutex> Guard(SnapshotLock);
+  New->Version = Snapshot ? Snapshot->Version + 1 : 1;
+  Previous = std::move(Snapshot);
+  Snapshot = std::move(New);
+}
+
+std::shared_ptr<const ASTUnit::CompletionSnapshot>
+ASTUnit::getCompletionSnapshot() const {
+  std::lock_guard<std::mutex> Guard(SnapshotLock);
+  return Snapshot;
+}
+
+unsigned ASTUnit::getSnapshotVersion() const {
+  std::lock_guard<std::mutex> Guard(SnapshotLock);
+  return Snapshot ? Snapshot->getVersion() : 0;
+}
+
 //----------------------------------------------------------------------------//
 // Code completion
 //----------------------------------------------------------------------------//
@@ -2314,41 +2891,97 @@ void AugmentedCodeCompleteConsumer::ProcessCodeCompleteResults(Sema &S,
                                   AllResults.size());
 }
 
-void ASTUnit::CodeComplete(
-    StringRef File, unsigned Line, unsigned Column,
-    ArrayRef<RemappedFile> RemappedFiles, bool IncludeMacros,
-    bool IncludeCodePatterns, bool IncludeBriefComments,
-    CodeCompleteConsumer &Consumer,
-    std::shared_ptr<PCHContainerOperations> PCHContainerOps,
-    DiagnosticsEngine &Diag, LangOptions &LangOpts, SourceManager &SourceMgr,
-    FileManager &FileMgr, SmallVectorImpl<StoredDiagnostic> &StoredDiagnostics,
-    SmallVectorImpl<const llvm::MemoryBuffer *> &OwnedBuffers) {
-  if (!Invocation)
-    return;
+namespace {
+  /// \brief Code completion consumer that passes the results on to a consumer
+  /// owned by the client.
+  class ForwardingCodeCompleteConsumer : public CodeCompleteConsumer {
+    CodeCompleteConsumer &Next;
 
-  SimpleTimer CompletionTimer(WantTiming);
-  CompletionTimer.setOutput("Code completion @ " + File + ":" +
-                            Twine(Line) + ":" + Twine(Column));
+  public:
+    ForwardingCodeCompleteConsumer(CodeCompleteConsumer &Next,
+                                   const CodeCompleteOptions &CodeCompleteOpts)
+      : CodeCompleteConsumer(CodeCompleteOpts, Next.isOutputBinary()),
+        Next(Next) { }
 
-  IntrusiveRefCntPtr<CompilerInvocation>
-    CCInvocation(new CompilerInvocation(*Invocation));
+    void ProcessCodeCompleteResults(Sema &S, CodeCompletionContext Context,
+                                    CodeCompletionResult *Results,
+                                    unsigned NumResults) override {
+      Next.ProcessCodeCompleteResults(S, Context, Results, NumResults);
+    }
+
+    void ProcessOverloadCandidates(Sema &S, unsigned CurrentArg,
+                                   OverloadCandidate *Candidates,
+                                   unsigned NumCandidates) override {
+      Next.ProcessOverloadCandidates(S, CurrentArg, Candidates, NumCandidates);
+    }
+
+    CodeCompletionAllocator &getAllocator() override {
+      return Next.getAllocator();
+    }
 
-  FrontendOptions &FrontendOpts = CCInvocation->getFrontendOpts();
+    CodeCompletionTUInfo &getCodeCompletionTUInfo() override {
+      return Next.getCodeCompletionTUInfo();
+    }
+  };
+} // anonymous namespace
+
+/// \brief Set up the code-completion options of \p CCInvocation and remap the
+/// given files.
+static void prepareCodeCompletion(
+    CompilerInvocation &CCInvocation, StringRef File, unsigned Line,
+    unsigned Column, ArrayRef<ASTUnit::RemappedFile> RemappedFiles,
+    bool IncludeMacros, bool IncludeCodePatterns, bool IncludeGlobals,
+    bool IncludeBriefComments,
+    SmallVectorImpl<const llvm::MemoryBuffer *> &OwnedBuffers) {
+  FrontendOptions &FrontendOpts = CCInvocation.getFrontendOpts();
   CodeCompleteOptions &CodeCompleteOpts = FrontendOpts.CodeCompleteOpts;
-  PreprocessorOptions &PreprocessorOpts = CCInvocation->getPreprocessorOpts();
+  PreprocessorOptions &PreprocessorOpts = CCInvocation.getPreprocessorOpts();
 
-  CodeCompleteOpts.IncludeMacros = IncludeMacros &&
-                                   CachedCompletionResults.empty();
+  CodeCompleteOpts.IncludeMacros = IncludeMacros;
   CodeCompleteOpts.IncludeCodePatterns = IncludeCodePatterns;
-  CodeCompleteOpts.IncludeGlobals = CachedCompletionResults.empty();
+  CodeCompleteOpts.IncludeGlobals = IncludeGlobals;
   CodeCompleteOpts.IncludeBriefComments = IncludeBriefComments;
 
-  assert(IncludeBriefComments == this->IncludeBriefCommentsInCodeCompletion);
-
   FrontendOpts.CodeCompletionAt.FileName = File;
   FrontendOpts.CodeCompletionAt.Line = Line;
   FrontendOpts.CodeCompletionAt.Column = Column;
 
+  // Remap files.
+  PreprocessorOpts.clearRemappedFiles();
+  PreprocessorOpts.RetainRemappedFileBuffers = true;
+  for (const auto &RemappedFile : RemappedFiles) {
+    PreprocessorOpts.addRemappedFile(RemappedFile.first, RemappedFile.second);
+    OwnedBuffers.push_back(RemappedFile.second);
+  }
+}
+
+/// \brief Check whether code completion at the given location may use the
+/// precompiled preamble of \p MainFile: only if the completion point is within
+/// the main file, after the end of the precompiled preamble.
+static bool canCompleteWithPreamble(StringRef File, unsigned Line,
+                                    StringRef MainFile) {
+  std::string CompleteFilePath(File);
+  llvm::sys::fs::UniqueID CompleteFileID;
+  if (llvm::sys::fs::getUniqueID(CompleteFilePath, CompleteFileID))
+    return false;
+
+  std::string MainPath(MainFile);
+  llvm::sys::fs::UniqueID MainID;
+  if (llvm::sys::fs::getUniqueID(MainPath, MainID))
+    return false;
+
+  return CompleteFileID == MainID && Line > 1;
+}
+
+/// \brief Perform code completion with \p CCInvocation, which has been set up
+/// by \c prepareCodeCompletion() and for the use of the precompiled preamble.
+static void
+runCodeCompletion(IntrusiveRefCntPtr<CompilerInvocation> CCInvocation,
+                  std::unique_ptr<CodeCompleteConsumer> Consumer,
+                  std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+                  DiagnosticsEngine &Diag, LangOptions &LangOpts,
+                  SourceManager &SourceMgr, FileManager &FileMgr,
+                  SmallVectorImpl<StoredDiagnostic> &StoredDiagnostics) {
   // Set the language options appropriately.
   LangOpts = *CCInvocation->getLangOpts();
 
@@ -2357,15 +2990,14 @@ void ASTUnit::CodeComplete(
   CCInvocation->getDiagnosticOpts().IgnoreWarnings = true;
 
   std::unique_ptr<CompilerInstance> Clang(
-      new CompilerInstance(PCHContainerOps));
+      new CompilerInstance(std::move(PCHContainerOps)));
 
   // Recover resources if we crash before exiting this method.
   llvm::CrashRecoveryContextCleanupRegistrar<CompilerInstance>
     CICleanup(Clang.get());
 
   Clang->setInvocation(&*CCInvocation);
-  OriginalSourceFile = Clang->getFrontendOpts().Inputs[0].getFile();
-    
+
   // Set up diagnostics, capturing any diagnostics produced.
   Clang->setDiagnostics(&Diag);
   CaptureDroppedDiagnostics Capture(true, 
@@ -2399,42 +3031,63 @@ void ASTUnit::CodeComplete(
   Clang->setFileManager(&FileMgr);
   Clang->setSourceManager(&SourceMgr);
 
-  // Remap files.
-  PreprocessorOpts.clearRemappedFiles();
-  PreprocessorOpts.RetainRemappedFileBuffers = true;
-  for (const auto &RemappedFile : RemappedFiles) {
-    PreprocessorOpts.addRemappedFile(RemappedFile.first, RemappedFile.second);
-    OwnedBuffers.push_back(RemappedFile.second);
+  Clang->setCodeCompletionConsumer(Consumer.release());
+
+  // Disable the preprocessing record if modules are not enabled.
+  if (!Clang->getLangOpts().Modules)
+    CCInvocation->getPreprocessorOpts().DetailedRecord = false;
+
+  std::unique_ptr<SyntaxOnlyAction> Act;
+  Act.reset(new SyntaxOnlyAction);
+  if (Act->BeginSourceFile(*Clang.get(), Clang->getFrontendOpts().Inputs[0])) {
+    Act->Execute();
+    Act->EndSourceFile();
   }
+}
+
+void ASTUnit::CodeComplete(
+    StringRef File, unsigned Line, unsigned Column,
+    ArrayRef<RemappedFile> RemappedFiles, bool IncludeMacros,
+    bool IncludeCodePatterns, bool IncludeBriefComments,
+    CodeCompleteConsumer &Consumer,
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+    DiagnosticsEngine &Diag, LangOptions &LangOpts, SourceManager &SourceMgr,
+    FileManager &FileMgr, SmallVectorImpl<StoredDiagnostic> &StoredDiagnostics,
+    SmallVectorImpl<const llvm::MemoryBuffer *> &OwnedBuffers) {
+  if (!Invocation)
+    return;
+
+  SimpleTimer CompletionTimer(WantTiming);
+  CompletionTimer.setOutput("Code completion @ " + File + ":" +
+                            Twine(Line) + ":" + Twine(Column));
+
+  IntrusiveRefCntPtr<CompilerInvocation>
+    CCInvocation(new CompilerInvocation(*Invocation));
+
+  assert(IncludeBriefComments == this->IncludeBriefCommentsInCodeCompletion);
+
+  prepareCodeCompletion(*CCInvocation, File, Line, Column, RemappedFiles,
+                        IncludeMacros && CachedCompletionResults.empty(),
+                        IncludeCodePatterns, CachedCompletionResults.empty(),
+                        IncludeBriefComments, OwnedBuffers);
+  OriginalSourceFile = CCInvocation->getFrontendOpts().Inputs[0].getFile();
 
   // Use the code completion consumer we were given, but adding any cached
   // code-completion results.
-  AugmentedCodeCompleteConsumer *AugmentedConsumer
-    = new AugmentedCodeCompleteConsumer(*this, Consumer, CodeCompleteOpts);
-  Clang->setCodeCompletionConsumer(AugmentedConsumer);
-
-  // If we have a precompiled preamble, try to use it. We only allow
-  // the use of the precompiled preamble if we're if the completion
-  // point is within the main file, after the end of the precompiled
-  // preamble.
+  std::unique_ptr<CodeCompleteConsumer> AugmentedConsumer(
+      new AugmentedCodeCompleteConsumer(
+          *this, Consumer, CCInvocation->getFrontendOpts().CodeCompleteOpts));
+
+  // If we have a precompiled preamble, try to use it.
   std::unique_ptr<llvm::MemoryBuffer> OverrideMainBuffer;
-  if (!getPreambleFile(this).empty()) {
-    std::string CompleteFilePath(File);
-    llvm::sys::fs::UniqueID CompleteFileID;
-
-    if (!llvm::sys::fs::getUniqueID(CompleteFilePath, CompleteFileID)) {
-      std::string MainPath(OriginalSourceFile);
-      llvm::sys::fs::UniqueID MainID;
-      if (!llvm::sys::fs::getUniqueID(MainPath, MainID)) {
-        if (CompleteFileID == MainID && Line > 1)
-          OverrideMainBuffer = getMainBufferWithPrecompiledPreamble(
-              PCHContainerOps, *CCInvocation, false, Line - 1);
-      }
-    }
-  }
+  if (!getPreambleFile(this).empty() &&
+      canCompleteWithPreamble(File, Line, OriginalSourceFile))
+    OverrideMainBuffer = getMainBufferWithPrecompiledPreamble(
+        PCHContainerOps, *CCInvocation, false, Line - 1);
 
   // If the main file has been overridden due to the use of a preamble,
   // make that override happen and introduce the preamble.
+  PreprocessorOptions &PreprocessorOpts = CCInvocation->getPreprocessorOpts();
   if (OverrideMainBuffer) {
     PreprocessorOpts.addRemappedFile(OriginalSourceFile,
                                      OverrideMainBuffer.get());
@@ -2450,16 +3103,61 @@ void ASTUnit::CodeComplete(
     PreprocessorOpts.PrecompiledPreambleBytes.second = false;
   }
 
-  // Disable the preprocessing record if modules are not enabled.
-  if (!Clang->getLangOpts().Modules)
-    PreprocessorOpts.DetailedRecord = false;
+  runCodeCompletion(CCInvocation, std::move(AugmentedConsumer),
+                    std::move(PCHContainerOps), Diag, LangOpts, SourceMgr,
+                    FileMgr, StoredDiagnostics);
+  PreamblePins.clear();
+}
 
-  std::unique_ptr<SyntaxOnlyAction> Act;
-  Act.reset(new SyntaxOnlyAction);
-  if (Act->BeginSourceFile(*Clang.get(), Clang->getFrontendOpts().Inputs[0])) {
-    Act->Execute();
-    Act->EndSourceFile();
+void ASTUnit::CodeComplete(
+    const CompletionSnapshot &Snapshot, StringRef File, unsigned Line,
+    unsigned Column, ArrayRef<RemappedFile> RemappedFiles, bool IncludeMacros,
+    bool IncludeCodePatterns, bool IncludeBriefComments,
+    CodeCompleteConsumer &Consumer,
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+    DiagnosticsEngine &Diag, LangOptions &LangOpts, SourceManager &SourceMgr,
+    FileManager &FileMgr, SmallVectorImpl<StoredDiagnostic> &StoredDiagnostics,
+    SmallVectorImpl<const llvm::MemoryBuffer *> &OwnedBuffers) {
+  IntrusiveRefCntPtr<CompilerInvocation>
+    CCInvocation(new CompilerInvocation(*Snapshot.Invocation));
+
+  // The completion results cached by the translation unit may be replaced by
+  // a concurrent reparse, so always ask for global results.
+  prepareCodeCompletion(*CCInvocation, File, Line, Column, RemappedFiles,
+                        IncludeMacros, IncludeCodePatterns,
+                        /*IncludeGlobals=*/true, IncludeBriefComments,
+                        OwnedBuffers);
+  std::unique_ptr<CodeCompleteConsumer> ForwardingConsumer(
+      new ForwardingCodeCompleteConsumer(
+          Consumer, CCInvocation->getFrontendOpts().CodeCompleteOpts));
+
+  // If the snapshot has a precompiled preamble, try to use it.
+  StringRef MainFile = CCInvocation->getFrontendOpts().Inputs[0].getFile();
+  std::unique_ptr<llvm::MemoryBuffer> OverrideMainBuffer;
+  std::vector<std::shared_ptr<const InMemoryPreambleStore::Entry>> Pins;
+  if (!Snapshot.PreambleFile.empty() &&
+      canCompleteWithPreamble(File, Line, MainFile))
+    OverrideMainBuffer = Snapshot.getMainBufferWithPrecompiledPreamble(
+        *CCInvocation, FileMgr, Line - 1, Pins);
+
+  PreprocessorOptions &PreprocessorOpts = CCInvocation->getPreprocessorOpts();
+  if (OverrideMainBuffer) {
+    PreprocessorOpts.addRemappedFile(MainFile, OverrideMainBuffer.get());
+    PreprocessorOpts.PrecompiledPreambleBytes.first = Snapshot.Preamble.size();
+    PreprocessorOpts.PrecompiledPreambleBytes.second =
+        Snapshot.PreambleEndsAtStartOfLine;
+    PreprocessorOpts.ImplicitPCHInclude = Snapshot.PreambleFile;
+    PreprocessorOpts.DisablePCHValidation = true;
+
+    OwnedBuffers.push_back(OverrideMainBuffer.release());
+  } else {
+    PreprocessorOpts.PrecompiledPreambleBytes.first = 0;
+    PreprocessorOpts.PrecompiledPreambleBytes.second = false;
   }
+
+  runCodeCompletion(CCInvocation, std::move(ForwardingConsumer),
+                    std::move(PCHContainerOps), Diag, LangOpts, SourceMgr,
+                    FileMgr, StoredDiagnostics);
 }
 
 bool ASTUnit::Save(StringRef File) {
@@ -2685,7 +3383,10 @@ SourceLocation ASTUnit::mapLocationFromPreamble(SourceLocation Loc) {
     return Loc;
 
   unsigned Offs;
-  if (SourceMgr->isInFileID(Loc, PreambleID, &Offs) && Offs < Preamble.size()) {
+  FileID BaseID = getPreambleBaseFileID();
+  if ((SourceMgr->isInFileID(Loc, PreambleID, &Offs) ||
+       (BaseID.isValid() && SourceMgr->isInFileID(Loc, BaseID, &Offs))) &&
+      Offs < Preamble.size()) {
     SourceLocation FileLoc
         = SourceMgr->getLocForStartOfFile(SourceMgr->getMainFileID());
     return FileLoc.getLocWithOffset(Offs);
@@ -2708,6 +3409,12 @@ SourceLocation ASTUnit::mapLocationToPreamble(SourceLocation Loc) {
   unsigned Offs;
   if (SourceMgr->isInFileID(Loc, SourceMgr->getMainFileID(), &Offs) &&
       Offs < Preamble.size()) {
+    // Locations in the base layer of the preamble were loaded from it.
+    if (Offs < PreambleBase.Size) {
+      FileID BaseID = getPreambleBaseFileID();
+      if (BaseID.isValid())
+        PreambleID = BaseID;
+    }
     SourceLocation FileLoc = SourceMgr->getLocForStartOfFile(PreambleID);
     return FileLoc.getLocWithOffset(Offs);
   }
@@ -2723,7 +3430,23 @@ bool ASTUnit::isInPreambleFileID(SourceLocation Loc) {
   if (Loc.isInvalid() || FID.isInvalid())
     return false;
   
-  return SourceMgr->isInFileID(Loc, FID);
+  if (SourceMgr->isInFileID(Loc, FID))
+    return true;
+  FileID BaseID = getPreambleBaseFileID();
+  return BaseID.isValid() && SourceMgr->isInFileID(Loc, BaseID);
+}
+
+/// \brief Returns the file ID of the main file as loaded from the base layer
+/// of the precompiled preamble, if the preamble is layered.
+FileID ASTUnit::getPreambleBaseFileID() {
+  if (!PreambleBase.Size || !Reader)
+    return FileID();
+
+  const std::string &BaseFile = getPreambleBaseFile(this);
+  for (serialization::ModuleFile *M : Reader->getModuleManager().pch_modules())
+    if (M->FileName == BaseFile)
+      return M->OriginalSourceFileID;
+  return FileID();
 }
 
 bool ASTUnit::isInMainFileID(SourceLocation Loc) {
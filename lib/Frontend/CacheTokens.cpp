@@ -46,15 +46,19 @@ typedef uint32_t Offset;
 namespace {
 class PTHEntry {
   Offset TokenData, PPCondData;
+  uint64_t ContentHash;
 
 public:
   PTHEntry() {}
 
   PTHEntry(Offset td, Offset ppcd)
-    : TokenData(td), PPCondData(ppcd) {}
+    : TokenData(td), PPCondData(ppcd), ContentHash(0) {}
 
   Offset getTokenOffset() const { return TokenData; }
   Offset getPPCondTableOffset() const { return PPCondData; }
+
+  uint64_t getContentHash() const { return ContentHash; }
+  void setContentHash(uint64_t H) { ContentHash = H; }
 };
 
 
@@ -134,7 +138,7 @@ public:
     unsigned n = V.getString().size() + 1 + 1;
     LE.write<uint16_t>(n);
 
-    unsigned m = V.getRepresentationLength() + (V.isFile() ? 4 + 4 : 0);
+    unsigned m = V.getRepresentationLength() + (V.isFile() ? 4 + 4 + 8 : 0);
     LE.write<uint8_t>(m);
 
     return std::make_pair(n, m);
@@ -154,10 +158,12 @@ public:
     endian::Writer<little> LE(Out);
 
     // For file entries emit the offsets into the PTH file for token data
-    // and the preprocessor blocks table.
+    // and the preprocessor blocks table, and the hash of the file contents
+    // used to validate the tokens.
     if (V.isFile()) {
       LE.write<uint32_t>(E.getTokenOffset());
       LE.write<uint32_t>(E.getPPCondTableOffset());
+      LE.write<uint64_t>(E.getContentHash());
     }
 
     // Emit any other data associated with the key (i.e., stat information).
@@ -484,9 +490,9 @@ void PTHWriter::GeneratePTH(StringRef MainFile) {
   Out << "cfe-pth" << '\0';
   Emit32(PTHManager::Version);
 
-  // Leave 4 words for the prologue.
+  // Leave 5 words for the prologue.
   Offset PrologueOffset = Out.tell();
-  for (unsigned i = 0; i < 4; ++i)
+  for (unsigned i = 0; i < 5; ++i)
     Emit32(0);
 
   // Write the name of the MainFile.
@@ -518,7 +524,9 @@ void PTHWriter::GeneratePTH(StringRef MainFile) {
     FileID FID = SM.createFileID(FE, SourceLocation(), SrcMgr::C_User);
     const llvm::MemoryBuffer *FromFile = SM.getBuffer(FID);
     Lexer L(FID, FromFile, SM, LOpts);
-    PM.insert(FE, LexTokens(L));
+    PTHEntry Entry = LexTokens(L);
+    Entry.setContentHash(PTHManager::getContentHash(B->getBuffer()));
+    PM.insert(FE, Entry);
   }
 
   // Write out the identifier table.
@@ -536,6 +544,7 @@ void PTHWriter::GeneratePTH(StringRef MainFile) {
   pwrite32le(Out, IdTableOff.second, Off);
   pwrite32le(Out, FileTableOff, Off);
   pwrite32le(Out, SpellingOff, Off);
+  pwrite32le(Out, PTHManager::getLangOptsSignature(LOpts), Off);
 }
 
 namespace {
@@ -22,6 +22,7 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Frontend/LogDiagnosticPrinter.h"
+#include "clang/Frontend/ModuleBuildScheduler.h"
 #include "clang/Frontend/SerializedDiagnosticPrinter.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Frontend/Utils.h"
@@ -33,6 +34,7 @@
 #include "clang/Sema/Sema.h"
 #include "clang/Serialization/ASTReader.h"
 #include "clang/Serialization/GlobalModuleIndex.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/Errc.h"
@@ -45,6 +47,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <sys/stat.h>
 #include <system_error>
 #include <time.h>
@@ -878,6 +881,16 @@ bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
     }
   }
 
+  // Wait for any module builds that were scheduled but are still running,
+  // since they write to the module cache. The instances building modules
+  // share the scheduler of the one that created it, which finishes last.
+  if (ModuleBuilds && ModuleBuilds.use_count() == 1) {
+    ModuleBuilds->shutDown();
+    if (getFrontendOpts().ShowStats)
+      ModuleBuilds->PrintStats();
+  }
+  ModuleBuilds.reset();
+
   // Notify the diagnostic client that all files were processed.
   getDiagnostics().getClient()->finish();
 
@@ -917,16 +930,12 @@ static InputKind getSourceInputKindFromOptions(const LangOptions &LangOpts) {
   return LangOpts.CPlusPlus? IK_CXX : IK_C;
 }
 
-/// \brief Compile a module file for the given module, using the options 
-/// provided by the importing compiler instance. Returns true if the module
-/// was built without errors.
-static bool compileModuleImpl(CompilerInstance &ImportingInstance,
-                              SourceLocation ImportLoc,
-                              Module *Module,
-                              StringRef ModuleFileName) {
-  ModuleMap &ModMap 
-    = ImportingInstance.getPreprocessor().getHeaderSearchInfo().getModuleMap();
-    
+/// \brief Create the invocation that compiles the given module into
+/// \p ModuleFileName, using the options provided by the importing compiler
+/// instance. The caller sets up the input.
+static IntrusiveRefCntPtr<CompilerInvocation>
+createModuleInvocation(CompilerInstance &ImportingInstance, Module *Module,
+                       StringRef ModuleFileName) {
   // Construct a compiler invocation for creating this module.
   IntrusiveRefCntPtr<CompilerInvocation> Invocation
     (new CompilerInvocation(ImportingInstance.getInvocation()));
@@ -952,25 +961,13 @@ static bool compileModuleImpl(CompilerInstance &ImportingInstance,
   // Note the name of the module we're building.
   Invocation->getLangOpts()->CurrentModule = Module->getTopLevelModuleName();
 
-  // Make sure that the failed-module structure has been allocated in
-  // the importing instance, and propagate the pointer to the newly-created
-  // instance.
-  PreprocessorOptions &ImportingPPOpts
-    = ImportingInstance.getInvocation().getPreprocessorOpts();
-  if (!ImportingPPOpts.FailedModules)
-    ImportingPPOpts.FailedModules = new PreprocessorOptions::FailedModulesSet;
-  PPOpts.FailedModules = ImportingPPOpts.FailedModules;
-
-  // If there is a module map file, build the module using the module map.
-  // Set up the inputs/outputs so that we build the module from its umbrella
-  // header.
+  // Set up the output; the caller adds the module map as the input.
   FrontendOptions &FrontendOpts = Invocation->getFrontendOpts();
   FrontendOpts.OutputFile = ModuleFileName.str();
   FrontendOpts.DisableFree = false;
   FrontendOpts.GenerateGlobalModuleIndex = false;
   FrontendOpts.BuildingImplicitModule = true;
   FrontendOpts.Inputs.clear();
-  InputKind IK = getSourceInputKindFromOptions(*Invocation->getLangOpts());
 
   // Don't free the remapped file buffers; they are owned by our caller.
   PPOpts.RetainRemappedFileBuffers = true;
@@ -978,7 +975,35 @@ static bool compileModuleImpl(CompilerInstance &ImportingInstance,
   Invocation->getDiagnosticOpts().VerifyDiagnostics = 0;
   assert(ImportingInstance.getInvocation().getModuleHash() ==
          Invocation->getModuleHash() && "Module hash mismatch!");
-  
+
+  return Invocation;
+}
+
+/// \brief Compile a module file for the given module, using the options 
+/// provided by the importing compiler instance. Returns true if the module
+/// was built without errors.
+static bool compileModuleImpl(CompilerInstance &ImportingInstance,
+                              SourceLocation ImportLoc,
+                              Module *Module,
+                              StringRef ModuleFileName) {
+  ModuleMap &ModMap 
+    = ImportingInstance.getPreprocessor().getHeaderSearchInfo().getModuleMap();
+
+  IntrusiveRefCntPtr<CompilerInvocation> Invocation =
+      createModuleInvocation(ImportingInstance, Module, ModuleFileName);
+  PreprocessorOptions &PPOpts = Invocation->getPreprocessorOpts();
+  FrontendOptions &FrontendOpts = Invocation->getFrontendOpts();
+  InputKind IK = getSourceInputKindFromOptions(*Invocation->getLangOpts());
+
+  // Make sure that the failed-module structure has been allocated in
+  // the importing instance, and propagate the pointer to the newly-created
+  // instance.
+  PreprocessorOptions &ImportingPPOpts
+    = ImportingInstance.getInvocation().getPreprocessorOpts();
+  if (!ImportingPPOpts.FailedModules)
+    ImportingPPOpts.FailedModules = new PreprocessorOptions::FailedModulesSet;
+  PPOpts.FailedModules = ImportingPPOpts.FailedModules;
+
   // Construct a compiler instance that will be used to actually create the
   // module.
   CompilerInstance Instance(ImportingInstance.getPCHContainerOperations(),
@@ -1007,6 +1032,11 @@ static bool compileModuleImpl(CompilerInstance &ImportingInstance,
   Instance.setModuleDepCollector(ImportingInstance.getModuleDepCollector());
   Invocation->getDependencyOutputOpts() = DependencyOutputOptions();
 
+  // Modules imported while building this one can be scheduled, or picked up
+  // while waiting for a lock, like those of the importing instance.
+  Instance.setModuleBuildScheduler(
+      ImportingInstance.getModuleBuildScheduler());
+
   // Get or create the module map that we'll use to build this module.
   std::string InferredModuleMapContent;
   if (const FileEntry *ModuleMapFile =
@@ -1099,8 +1129,17 @@ static bool compileAndLoadModule(CompilerInstance &ImportingInstance,
       break;
 
     case llvm::LockFileManager::LFS_Shared:
-      // Someone else is responsible for building the module. Wait for them to
-      // finish.
+      // Someone else is responsible for building the module. Build any other
+      // modules that are waiting to be built in the meantime, then wait for
+      // them to finish. LockFileManager locks "<file>.lock".
+      if (auto Builds = ImportingInstance.getModuleBuildScheduler()) {
+        std::vector<std::string> BuildStack;
+        for (const auto &Building :
+             ImportingInstance.getSourceManager().getModuleBuildStack())
+          BuildStack.push_back(Building.first);
+        Builds->runPendingWhileLocked((ModuleFileName + ".lock").str(),
+                                      BuildStack);
+      }
       switch (Locked.waitForUnlock()) {
       case llvm::LockFileManager::Res_Success:
         ModuleLoadCapabilities |= ASTReader::ARR_OutOfDate;
@@ -1117,6 +1156,10 @@ static bool compileAndLoadModule(CompilerInstance &ImportingInstance,
       break;
     }
 
+    // The module file was just written, here or by another process, perhaps
+    // over an older one that the shared file cache still knows about.
+    ImportingInstance.getFileManager().invalidateSharedCache(ModuleFileName);
+
     // Try to read the module file, now that we've compiled it.
     ASTReader::ASTReadResult ReadResult =
         ImportingInstance.getModuleManager()->ReadAST(
@@ -1140,6 +1183,129 @@ static bool compileAndLoadModule(CompilerInstance &ImportingInstance,
   }
 }
 
+/// \brief Collect the top-level modules that \p M depends on according to the
+/// module map (its uses, exports and known imports, and those of its
+/// submodules), transitively, dependencies first. \p M itself comes last.
+static void collectModuleMapDependencies(ModuleMap &ModMap, Module *M,
+                                         SmallPtrSetImpl<Module *> &Visited,
+                                         SmallVectorImpl<Module *> &Deps) {
+  M = M->getTopLevelModule();
+  if (!Visited.insert(M).second)
+    return;
+
+  SmallVector<Module *, 8> Direct;
+  SmallVector<Module *, 8> Stack(1, M);
+  while (!Stack.empty()) {
+    Module *Sub = Stack.pop_back_val();
+    ModMap.resolveUses(Sub, /*Complain=*/false);
+    ModMap.resolveExports(Sub, /*Complain=*/false);
+    Direct.append(Sub->DirectUses.begin(), Sub->DirectUses.end());
+    for (const Module::ExportDecl &Export : Sub->Exports)
+      if (Module *Exported = Export.getPointer())
+        Direct.push_back(Exported);
+    Direct.append(Sub->Imports.begin(), Sub->Imports.end());
+    Stack.append(Sub->submodule_begin(), Sub->submodule_end());
+  }
+
+  for (Module *D : Direct)
+    collectModuleMapDependencies(ModMap, D, Visited, Deps);
+  Deps.push_back(M);
+}
+
+/// \brief Schedule concurrent builds of the modules that \p Module depends on
+/// and that have no module file yet, if -fmodules-build-jobs allows it.
+static void scheduleDependencyBuilds(CompilerInstance &ImportingInstance,
+                                     Module *Module) {
+  unsigned Jobs = ImportingInstance.getFrontendOpts().ModulesBuildJobs;
+  const PreprocessorOptions &ImportingPPOpts =
+      ImportingInstance.getPreprocessorOpts();
+  // The dependency collector is not thread-safe, and remapped buffers are
+  // owned by our caller, who may free them before scheduled builds finish.
+  if (Jobs < 2 || ImportingInstance.getModuleDepCollector() ||
+      !ImportingPPOpts.RemappedFileBuffers.empty())
+    return;
+
+  HeaderSearch &HS = ImportingInstance.getPreprocessor().getHeaderSearchInfo();
+  ModuleMap &ModMap = HS.getModuleMap();
+  SmallVector<clang::Module *, 16> Deps;
+  llvm::SmallPtrSet<clang::Module *, 16> Visited;
+  collectModuleMapDependencies(ModMap, Module, Visited, Deps);
+  Deps.pop_back();
+  if (Deps.empty())
+    return;
+
+  // The importing instance builds its own module, so use one worker fewer
+  // than there are jobs.
+  std::shared_ptr<ModuleBuildScheduler> Builds =
+      ImportingInstance.getModuleBuildScheduler();
+  if (!Builds) {
+    Builds = std::make_shared<ModuleBuildScheduler>(Jobs - 1);
+    ImportingInstance.setModuleBuildScheduler(Builds);
+  }
+
+  // The modules being built, ending with the one about to be. A dependency
+  // among them is part of a cycle, which the build of the module diagnoses.
+  std::vector<std::string> BuildStack;
+  for (const auto &Building :
+       ImportingInstance.getSourceManager().getModuleBuildStack())
+    BuildStack.push_back(Building.first);
+  BuildStack.push_back(Module->getTopLevelModuleName());
+
+  bool ScheduledAny = false;
+  for (clang::Module *Dep : Deps) {
+    if (std::find(BuildStack.begin(), BuildStack.end(), Dep->Name) !=
+        BuildStack.end())
+      continue;
+    if (!Dep->isAvailable() || Dep->HasIncompatibleModuleFile ||
+        (ImportingPPOpts.FailedModules &&
+         ImportingPPOpts.FailedModules->hasAlreadyFailed(Dep->Name)))
+      continue;
+
+    // Modules with inferred module maps are only built as they are imported.
+    const FileEntry *ModuleMapFile = ModMap.getContainingModuleMapFile(Dep);
+    if (!ModuleMapFile)
+      continue;
+
+    std::string ModuleFileName = HS.getModuleFileName(Dep);
+    if (ModuleFileName.empty() || llvm::sys::fs::exists(ModuleFileName))
+      continue;
+
+    ModuleBuildScheduler::Job J;
+    J.Invocation =
+        createModuleInvocation(ImportingInstance, Dep, ModuleFileName);
+    FrontendOptions &FrontendOpts = J.Invocation->getFrontendOpts();
+    FrontendOpts.Inputs.emplace_back(
+        ModuleMapFile->getName(),
+        getSourceInputKindFromOptions(*J.Invocation->getLangOpts()));
+    // Builds that nobody waits for don't report anything, and don't schedule
+    // builds of their own.
+    FrontendOpts.ShowStats = false;
+    FrontendOpts.ShowTimers = false;
+    FrontendOpts.ModulesBuildJobs = 0;
+    J.Invocation->getDependencyOutputOpts() = DependencyOutputOptions();
+    // The failed-module set of the importing instance is not thread-safe.
+    J.Invocation->getPreprocessorOpts().FailedModules =
+        new PreprocessorOptions::FailedModulesSet;
+
+    J.ModuleName = Dep->Name;
+    J.BuildStack = BuildStack;
+    J.ModuleFileName = ModuleFileName;
+    J.ModuleMapFileForUniquing =
+        ModMap.getModuleMapFileForUniquing(Dep)->getName();
+    J.IsSystem = Dep->IsSystem;
+    J.VFS = &ImportingInstance.getVirtualFileSystem();
+    J.SharedCache = ImportingInstance.getFileManager().getSharedCache();
+    J.PCHContainerOps = ImportingInstance.getPCHContainerOperations();
+    ScheduledAny |= Builds->schedule(std::move(J));
+  }
+
+  // Modules built by the scheduler are loaded like existing ones, so make
+  // sure the global module index still gets updated.
+  if (ScheduledAny &&
+      ImportingInstance.getFrontendOpts().GenerateGlobalModuleIndex)
+    ImportingInstance.setBuildGlobalModuleIndex(true);
+}
+
 /// \brief Diagnose differences between the current definition of the given
 /// configuration macro and the definition provided on the command line.
 static void checkConfigMacro(Preprocessor &PP, StringRef ConfigMacro,
@@ -1299,10 +1465,13 @@ void CompilerInstance::createModuleManager() {
     HeaderSearchOptions &HSOpts = getHeaderSearchOpts();
     std::string Sysroot = HSOpts.Sysroot;
     const PreprocessorOptions &PPOpts = getPreprocessorOpts();
-    std::unique_ptr<llvm::Timer> ReadTimer;
-    if (FrontendTimerGroup)
+    std::unique_ptr<llvm::Timer> ReadTimer, GlobalIndexTimer;
+    if (FrontendTimerGroup) {
       ReadTimer = llvm::make_unique<llvm::Timer>("Reading modules",
                                                  *FrontendTimerGroup);
+      GlobalIndexTimer = llvm::make_unique<llvm::Timer>(
+          "Loading the global module index", *FrontendTimerGroup);
+    }
     ModuleManager = new ASTReader(
         getPreprocessor(), getASTContext(), getPCHContainerReader(),
         getFrontendOpts().ModuleFileExtensions,
@@ -1311,7 +1480,7 @@ void CompilerInstance::createModuleManager() {
         /*AllowConfigurationMismatch=*/false,
         HSOpts.ModulesValidateSystemHeaders,
         getFrontendOpts().UseGlobalModuleIndex,
-        std::move(ReadTimer));
+        std::move(ReadTimer), std::move(GlobalIndexTimer));
     if (hasASTConsumer()) {
       ModuleManager->setDeserializationListener(
         getASTConsumer().GetASTDeserializationListener());
@@ -1517,6 +1686,10 @@ CompilerInstance::loadModule(SourceLocation ImportLoc,
         return ModuleLoadResult();
       }
 
+      // Build the modules it depends on concurrently with this one, if
+      // allowed.
+      scheduleDependencyBuilds(*this, Module);
+
       // Try to compile and then load the module.
       if (!compileAndLoadModule(*this, ImportLoc, ModuleNameLoc, Module,
                                 ModuleFileName)) {
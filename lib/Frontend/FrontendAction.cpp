@@ -462,9 +462,13 @@ bool FrontendAction::Execute() {
       CI.hasPreprocessor()) {
     StringRef Cache =
         CI.getPreprocessor().getHeaderSearchInfo().getModuleCachePath();
-    if (!Cache.empty())
-      GlobalModuleIndex::writeIndex(CI.getFileManager(),
-                                    CI.getPCHContainerReader(), Cache);
+    GlobalModuleIndex::WriteStats Stats;
+    if (!Cache.empty() &&
+        GlobalModuleIndex::writeIndex(CI.getFileManager(),
+                                      CI.getPCHContainerReader(), Cache,
+                                      &Stats) == GlobalModuleIndex::EC_None &&
+        CI.getFrontendOpts().ShowStats)
+      Stats.print();
   }
 
   return true;
@@ -477,8 +481,12 @@ void FrontendAction::EndSourceFile() {
   CI.getDiagnosticClient().EndSourceFile();
 
   // Inform the preprocessor we are done.
-  if (CI.hasPreprocessor())
+  if (CI.hasPreprocessor()) {
     CI.getPreprocessor().EndSourceFile();
+    HeaderSearch &HS = CI.getPreprocessor().getHeaderSearchInfo();
+    HS.writeLookupCache();
+    HS.writeGuardDB();
+  }
 
   // Finalize the action.
   EndSourceFileAction();
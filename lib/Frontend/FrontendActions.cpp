@@ -95,7 +95,8 @@ GeneratePCHAction::CreateASTConsumer(CompilerInstance &CI, StringRef InFile) {
                         Buffer, CI.getFrontendOpts().ModuleFileExtensions,
                         /*AllowASTWithErrors*/false,
                         /*IncludeTimestamps*/
-                          +CI.getFrontendOpts().IncludeTimestamps));
+                          +CI.getFrontendOpts().IncludeTimestamps,
+                        CI.getFrontendOpts().PCHWriteJobs));
   Consumers.push_back(CI.getPCHContainerWriter().CreatePCHContainerGenerator(
       CI, InFile, OutputFile, OS, Buffer));
 
@@ -143,7 +144,8 @@ GenerateModuleAction::CreateASTConsumer(CompilerInstance &CI,
                         Buffer, CI.getFrontendOpts().ModuleFileExtensions,
                         /*AllowASTWithErrors=*/false,
                         /*IncludeTimestamps=*/
-                          +CI.getFrontendOpts().BuildingImplicitModule));
+                          +CI.getFrontendOpts().BuildingImplicitModule,
+                        CI.getFrontendOpts().PCHWriteJobs));
   Consumers.push_back(CI.getPCHContainerWriter().CreatePCHContainerGenerator(
       CI, InFile, OutputFile, OS, Buffer));
   return llvm::make_unique<MultiplexConsumer>(std::move(Consumers));
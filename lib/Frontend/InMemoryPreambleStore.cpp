@@ -0,0 +1,267 @@
+//===--- InMemoryPreambleStore.cpp - Preambles kept in memory -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the InMemoryPreambleStore interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/InMemoryPreambleStore.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include <atomic>
+
+using namespace clang;
+
+InMemoryPreambleStore::InMemoryPreambleStore(uint64_t MaxSize)
+    : MaxSize(MaxSize), Size(0) {}
+
+InMemoryPreambleStore::~InMemoryPreambleStore() {}
+
+std::string InMemoryPreambleStore::createPath() {
+  static std::atomic<unsigned> Counter(0);
+  SmallString<128> Path;
+  llvm::sys::path::system_temp_directory(/*erasedOnReboot=*/true, Path);
+  unsigned Random = llvm::sys::Process::GetRandomNumber();
+  llvm::sys::path::append(Path, "preamble-" + Twine(Random) + "-" +
+                                    Twine(++Counter) + ".pch");
+  return Path.str();
+}
+
+void InMemoryPreambleStore::touch(StringRef Path) {
+  for (std::list<std::string>::iterator I = UseOrder.begin(),
+                                        E = UseOrder.end();
+       I != E; ++I) {
+    if (*I == Path) {
+      UseOrder.splice(UseOrder.begin(), UseOrder, I);
+      return;
+    }
+  }
+}
+
+void InMemoryPreambleStore::removeLocked(StringRef Path) {
+  llvm::StringMap<Entry>::iterator Known = Preambles.find(Path);
+  if (Known == Preambles.end())
+    return;
+  Size -= Known->second.Buffer->getBufferSize();
+  Preambles.erase(Known);
+  UseOrder.remove(Path);
+}
+
+/// \brief Evict the least recently used preambles that are not pinned until
+/// \p Needed more bytes fit in the store, or only pinned ones are left.
+void InMemoryPreambleStore::evictLocked(uint64_t Needed) {
+  std::list<std::string>::iterator I = UseOrder.end();
+  while (Size + Needed > MaxSize && I != UseOrder.begin()) {
+    --I;
+    if (Pins.count(*I))
+      continue;
+    std::string Path = *I++;
+    removeLocked(Path);
+  }
+}
+
+bool InMemoryPreambleStore::store(StringRef Path,
+                                  std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  removeLocked(Path);
+  uint64_t BufferSize = Buffer->getBufferSize();
+  uint64_t PinnedSize = 0;
+  for (const auto &Pinned : Pins) {
+    llvm::StringMap<Entry>::iterator Known = Preambles.find(Pinned.first());
+    if (Known != Preambles.end())
+      PinnedSize += Known->second.Buffer->getBufferSize();
+  }
+  if (PinnedSize + BufferSize > MaxSize)
+    return false;
+
+  evictLocked(BufferSize);
+
+  Entry &E = Preambles[Path];
+  E.Buffer = std::move(Buffer);
+  E.UniqueID = vfs::getNextVirtualUniqueID();
+  E.ModTime = llvm::sys::TimeValue::now();
+  UseOrder.push_front(Path);
+  Size += BufferSize;
+  return true;
+}
+
+bool InMemoryPreambleStore::contains(StringRef Path) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  if (!Preambles.count(Path))
+    return false;
+  touch(Path);
+  return true;
+}
+
+bool InMemoryPreambleStore::lookup(StringRef Path, Entry &Result) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  llvm::StringMap<Entry>::iterator Known = Preambles.find(Path);
+  if (Known == Preambles.end())
+    return false;
+  Result = Known->second;
+  return true;
+}
+
+std::shared_ptr<const InMemoryPreambleStore::Entry>
+InMemoryPreambleStore::pin(StringRef Path) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  llvm::StringMap<Entry>::iterator Known = Preambles.find(Path);
+  if (Known == Preambles.end())
+    return nullptr;
+  touch(Path);
+  ++Pins[Path];
+
+  IntrusiveRefCntPtr<InMemoryPreambleStore> Self(this);
+  std::string PinnedPath = Path;
+  return std::shared_ptr<const Entry>(new Entry(Known->second),
+                                      [Self, PinnedPath](const Entry *E) {
+                                        Self->unpin(PinnedPath);
+                                        delete E;
+                                      });
+}
+
+void InMemoryPreambleStore::unpin(StringRef Path) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  llvm::StringMap<unsigned>::iterator Pinned = Pins.find(Path);
+  assert(Pinned != Pins.end() && "Preamble is not pinned");
+  if (--Pinned->second)
+    return;
+  Pins.erase(Pinned);
+
+  // The store may have been shrunk while the preamble was pinned.
+  evictLocked(0);
+}
+
+void InMemoryPreambleStore::remove(StringRef Path) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  removeLocked(Path);
+}
+
+uint64_t InMemoryPreambleStore::getMaxSize() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return MaxSize;
+}
+
+void InMemoryPreambleStore::setMaxSize(uint64_t NewMaxSize) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  MaxSize = NewMaxSize;
+  evictLocked(0);
+}
+
+uint64_t InMemoryPreambleStore::getSize() const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  return Size;
+}
+
+namespace {
+/// \brief A buffer sharing the contents of a stored preamble, which stay alive
+/// even if the preamble is evicted.
+class StoredPreambleBuffer : public llvm::MemoryBuffer {
+  std::shared_ptr<llvm::MemoryBuffer> Preamble;
+
+public:
+  StoredPreambleBuffer(std::shared_ptr<llvm::MemoryBuffer> Preamble,
+                       bool RequiresNullTerminator)
+      : Preamble(std::move(Preamble)) {
+    init(this->Preamble->getBufferStart(), this->Preamble->getBufferEnd(),
+         RequiresNullTerminator);
+  }
+
+  const char *getBufferIdentifier() const override {
+    return Preamble->getBufferIdentifier();
+  }
+
+  BufferKind getBufferKind() const override { return MemoryBuffer_Malloc; }
+};
+
+class StoredPreambleFile : public vfs::File {
+  InMemoryPreambleStore::Entry Preamble;
+  vfs::Status Status;
+
+public:
+  StoredPreambleFile(const InMemoryPreambleStore::Entry &Preamble,
+                     vfs::Status Status)
+      : Preamble(Preamble), Status(std::move(Status)) {}
+
+  llvm::ErrorOr<vfs::Status> status() override { return Status; }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  getBuffer(const Twine &Name, int64_t FileSize, bool RequiresNullTerminator,
+            bool IsVolatile) override {
+    return std::unique_ptr<llvm::MemoryBuffer>(
+        new StoredPreambleBuffer(Preamble.Buffer, RequiresNullTerminator));
+  }
+
+  std::error_code close() override { return std::error_code(); }
+};
+
+/// \brief Serves the preambles of a store, and nothing else.
+class StoredPreambleFileSystem : public vfs::FileSystem {
+  IntrusiveRefCntPtr<InMemoryPreambleStore> Store;
+  std::string WorkingDirectory;
+
+  static vfs::Status getStatus(StringRef Path,
+                               const InMemoryPreambleStore::Entry &E) {
+    return vfs::Status(Path, E.UniqueID, E.ModTime, /*User=*/0, /*Group=*/0,
+                       E.Buffer->getBufferSize(),
+                       llvm::sys::fs::file_type::regular_file,
+                       llvm::sys::fs::all_read);
+  }
+
+public:
+  explicit StoredPreambleFileSystem(
+      IntrusiveRefCntPtr<InMemoryPreambleStore> Store)
+      : Store(std::move(Store)) {}
+
+  llvm::ErrorOr<vfs::Status> status(const Twine &Path) override {
+    SmallString<128> Storage;
+    StringRef Name = Path.toStringRef(Storage);
+    InMemoryPreambleStore::Entry E;
+    if (!Store->lookup(Name, E))
+      return make_error_code(llvm::errc::no_such_file_or_directory);
+    return getStatus(Name, E);
+  }
+
+  llvm::ErrorOr<std::unique_ptr<vfs::File>>
+  openFileForRead(const Twine &Path) override {
+    SmallString<128> Storage;
+    StringRef Name = Path.toStringRef(Storage);
+    InMemoryPreambleStore::Entry E;
+    if (!Store->lookup(Name, E))
+      return make_error_code(llvm::errc::no_such_file_or_directory);
+    return std::unique_ptr<vfs::File>(
+        new StoredPreambleFile(E, getStatus(Name, E)));
+  }
+
+  vfs::directory_iterator dir_begin(const Twine &Dir,
+                                    std::error_code &EC) override {
+    EC = make_error_code(llvm::errc::no_such_file_or_directory);
+    return vfs::directory_iterator();
+  }
+
+  llvm::ErrorOr<std::string> getCurrentWorkingDirectory() const override {
+    return WorkingDirectory;
+  }
+
+  std::error_code setCurrentWorkingDirectory(const Twine &Path) override {
+    WorkingDirectory = Path.str();
+    return std::error_code();
+  }
+};
+} // end anonymous namespace
+
+IntrusiveRefCntPtr<vfs::FileSystem>
+InMemoryPreambleStore::getFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> Base) {
+  IntrusiveRefCntPtr<vfs::OverlayFileSystem> Overlay(
+      new vfs::OverlayFileSystem(std::move(Base)));
+  Overlay->pushOverlay(new StoredPreambleFileSystem(this));
+  return Overlay;
+}
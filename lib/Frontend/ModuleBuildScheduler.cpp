@@ -0,0 +1,162 @@
+//===--- ModuleBuildScheduler.cpp - Parallel module builds ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the ModuleBuildScheduler interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/ModuleBuildScheduler.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace clang;
+
+ModuleBuildScheduler::ModuleBuildScheduler(unsigned MaxWorkers)
+    : MaxWorkers(MaxWorkers), NumIdleWorkers(0), ShuttingDown(false),
+      NumBuilt(0) {}
+
+ModuleBuildScheduler::~ModuleBuildScheduler() {
+  shutDown();
+}
+
+void ModuleBuildScheduler::shutDown() {
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Pending.clear();
+    ShuttingDown = true;
+  }
+  JobsAvailable.notify_all();
+  for (std::thread &Worker : Workers)
+    Worker.join();
+  Workers.clear();
+}
+
+bool ModuleBuildScheduler::schedule(Job J) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  if (ShuttingDown || !Scheduled.insert(J.ModuleFileName).second)
+    return false;
+
+  Pending.push_back(std::move(J));
+  if (NumIdleWorkers)
+    JobsAvailable.notify_one();
+  else if (Workers.size() < MaxWorkers)
+    Workers.emplace_back([this] { runWorker(); });
+  return true;
+}
+
+bool ModuleBuildScheduler::takeJob(Job &J) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  if (Pending.empty())
+    return false;
+  J = std::move(Pending.front());
+  Pending.pop_front();
+  return true;
+}
+
+void ModuleBuildScheduler::runWorker() {
+  std::unique_lock<std::mutex> Guard(Lock);
+  while (true) {
+    if (!Pending.empty()) {
+      Job J = std::move(Pending.front());
+      Pending.pop_front();
+      Guard.unlock();
+      bool Built = build(J);
+      Guard.lock();
+      if (Built)
+        ++NumBuilt;
+      continue;
+    }
+    if (ShuttingDown)
+      return;
+    ++NumIdleWorkers;
+    JobsAvailable.wait(Guard);
+    --NumIdleWorkers;
+  }
+}
+
+void ModuleBuildScheduler::runPendingWhileLocked(
+    StringRef LockFileName, ArrayRef<std::string> BuildStack) {
+  Job J;
+  while (llvm::sys::fs::exists(LockFileName) && takeJob(J)) {
+    // The job may have been scheduled by a compilation further out than the
+    // calling one. Continue the calling thread's build stack as well, so that
+    // importing a module whose lock this thread holds is diagnosed as a
+    // cycle rather than waited for until the lock times out.
+    for (const std::string &Name : BuildStack)
+      if (std::find(J.BuildStack.begin(), J.BuildStack.end(), Name) ==
+          J.BuildStack.end())
+        J.BuildStack.push_back(Name);
+    bool Built = build(J);
+    std::lock_guard<std::mutex> Guard(Lock);
+    if (Built)
+      ++NumBuilt;
+  }
+}
+
+void ModuleBuildScheduler::PrintStats() {
+  std::lock_guard<std::mutex> Guard(Lock);
+  llvm::errs() << "\n*** Module Build Scheduler Stats:\n";
+  llvm::errs() << Scheduled.size() << " module builds scheduled, "
+               << NumBuilt << " modules built by scheduled builds.\n";
+  llvm::errs() << Workers.size() << " worker threads started.\n";
+}
+
+bool ModuleBuildScheduler::build(Job &J) {
+  llvm::sys::fs::create_directories(
+      llvm::sys::path::parent_path(J.ModuleFileName));
+
+  // Only build the module if nobody else is building it, or has built it,
+  // already.
+  llvm::LockFileManager Locked(J.ModuleFileName);
+  if (Locked != llvm::LockFileManager::LFS_Owned ||
+      llvm::sys::fs::exists(J.ModuleFileName))
+    return false;
+
+  CompilerInstance Instance(J.PCHContainerOps, /*BuildingModule=*/true);
+  Instance.setInvocation(J.Invocation.get());
+  Instance.createDiagnostics(new IgnoringDiagConsumer(),
+                             /*ShouldOwnClient=*/true);
+  Instance.setVirtualFileSystem(J.VFS.get());
+  Instance.createFileManager();
+  Instance.getFileManager().setSharedCache(J.SharedCache);
+  Instance.createSourceManager(Instance.getFileManager());
+  // Continue the module build stack of the compilation that scheduled the
+  // job. If this module imports one of those, the cycle is diagnosed right
+  // away rather than by waiting for the lock held by its build.
+  SourceManager &SourceMgr = Instance.getSourceManager();
+  for (const std::string &Name : J.BuildStack)
+    SourceMgr.pushModuleBuildStack(Name, FullSourceLoc());
+  SourceMgr.pushModuleBuildStack(J.ModuleName, FullSourceLoc());
+
+  const FileEntry *ModuleMap =
+      Instance.getFileManager().getFile(J.ModuleMapFileForUniquing);
+  if (!ModuleMap)
+    return false;
+  GenerateModuleAction CreateModuleAction(ModuleMap, J.IsSystem);
+
+  // Use a separate thread so that we get a stack large enough, as
+  // compileModuleImpl does.
+  const unsigned ThreadStackSize = 8 << 20;
+  llvm::CrashRecoveryContext CRC;
+  bool Succeeded = CRC.RunSafelyOnThread(
+      [&]() { Instance.ExecuteAction(CreateModuleAction); }, ThreadStackSize);
+  Instance.clearOutputFiles(/*EraseFiles=*/true);
+  Instance.getFileManager().invalidateSharedCache(J.ModuleFileName);
+
+  return Succeeded && !Instance.getDiagnostics().hasErrorOccurred();
+}
@@ -14,6 +14,7 @@
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/IdentifierTable.h"
+#include "clang/Basic/Version.h"
 #include "clang/Lex/ExternalPreprocessorSource.h"
 #include "clang/Lex/HeaderMap.h"
 #include "clang/Lex/HeaderSearchOptions.h"
@@ -23,8 +24,13 @@
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Capacity.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
@@ -68,6 +74,12 @@ HeaderSearch::HeaderSearch(IntrusiveRefCntPtr<HeaderSearchOptions> HSOpts,
   NumIncluded = 0;
   NumMultiIncludeFileOptzn = 0;
   NumFrameworkLookups = NumSubFrameworkLookups = 0;
+  NumLookupCacheEntriesLoaded = 0;
+  NumGuardDBEntriesLoaded = NumGuardDBIncludesSkipped = 0;
+
+  LookupCacheLoaded = false;
+  LookupCacheChanged = false;
+  GuardDBLoaded = false;
 }
 
 HeaderSearch::~HeaderSearch() {
@@ -96,6 +108,435 @@ void HeaderSearch::PrintStats() {
 
   fprintf(stderr, "%d framework lookups.\n", NumFrameworkLookups);
   fprintf(stderr, "%d subframework lookups.\n", NumSubFrameworkLookups);
+  if (!HSOpts->HeaderLookupCachePath.empty())
+    fprintf(stderr, "%d lookups loaded from the persistent lookup cache.\n",
+            NumLookupCacheEntriesLoaded);
+  if (!HSOpts->HeaderGuardDBPath.empty()) {
+    fprintf(stderr, "%d header guards loaded from the guard database.\n",
+            NumGuardDBEntriesLoaded);
+    fprintf(stderr, "  %d #includes skipped using the guard database.\n",
+            NumGuardDBIncludesSkipped);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Persistent #include lookup cache
+//===----------------------------------------------------------------------===//
+//
+// The persistent lookup cache stores the LookupFileCache entries of previous
+// compilations using the same search paths, so that a header found in the
+// N-th search directory doesn't require stat'ing N-1 candidates first. The
+// file layout (all integers little-endian) is:
+//
+//   "CLHC" <version: u32> <search path signature: u64>
+//   <number of search dirs: u32> <modification time: u64>...
+//   <number of entries: u32>
+//   (<start index: u32> <hit index: u32> <name length: u32> <name>)...
+//
+// The cache is discarded when any search directory has been modified since it
+// was written. Only headers that were found are recorded: a header that is
+// not found may later be generated, possibly in a subdirectory of a search
+// directory (e.g. "gen/" for "gen/foo.h"), which doesn't change the search
+// directory's modification time. For the same reason, a header added to a
+// subdirectory of an earlier search directory than the one it was found in
+// is not detected; the cache should be removed when such headers can shadow
+// one another.
+//
+// Concurrent compilations update the cache under a lock file, merging their
+// entries with the ones already on disk.
+
+/// Write \p Data to a temporary file and rename it into place at \p Path, so
+/// concurrent compilations never see a partially written file.
+static bool writeFileAtomically(StringRef Path, StringRef Data) {
+  int FD;
+  SmallString<128> TempPath;
+  if (llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%", FD, TempPath))
+    return false;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return false;
+    }
+  }
+  if (llvm::sys::fs::rename(TempPath, Path)) {
+    llvm::sys::fs::remove(TempPath);
+    return false;
+  }
+  return true;
+}
+
+/// Rewrite the file at \p Path while holding its lock file, so that concurrent
+/// compilations updating the same file merge their changes rather than
+/// overwrite each other's. \p Update is given the current contents of the
+/// file, if any, and produces the new ones.
+///
+/// \returns false if the file could not be locked or written; the persistent
+/// caches are only an optimization, so this is not an error.
+static bool updateFileLocked(
+    StringRef Path,
+    llvm::function_ref<void(StringRef, SmallVectorImpl<char> &)> Update) {
+  while (true) {
+    llvm::LockFileManager Locked(Path);
+    switch (Locked) {
+    case llvm::LockFileManager::LFS_Error:
+      return false;
+
+    case llvm::LockFileManager::LFS_Owned: {
+      llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Existing =
+          llvm::MemoryBuffer::getFile(Path, -1,
+                                      /*RequiresNullTerminator=*/false);
+      SmallString<4096> Data;
+      Update(Existing ? (*Existing)->getBuffer() : StringRef(), Data);
+      return writeFileAtomically(Path, Data);
+    }
+
+    case llvm::LockFileManager::LFS_Shared:
+      switch (Locked.waitForUnlock()) {
+      case llvm::LockFileManager::Res_Success:
+      case llvm::LockFileManager::Res_OwnerDied:
+        continue; // try again to get the lock.
+      case llvm::LockFileManager::Res_Timeout:
+        // Clear the lock file so that future compilations can make progress,
+        // and leave the update to them.
+        Locked.unsafeRemoveLockFile();
+        return false;
+      }
+    }
+  }
+}
+
+static const char LookupCacheMagic[] = {'C', 'L', 'H', 'C'};
+static const uint32_t LookupCacheVersion = 2;
+
+/// Parse the persistent lookup cache \p Data, calling \p AddEntry for each
+/// of its entries.
+///
+/// \returns false if \p Data is not a lookup cache written for the given
+/// search path signature and search directory modification times.
+static bool readLookupCache(
+    StringRef Data, uint64_t Signature, ArrayRef<uint64_t> DirModTimes,
+    llvm::function_ref<void(StringRef, uint32_t, uint32_t)> AddEntry) {
+  using namespace llvm::support;
+  const unsigned char *Ptr = Data.bytes_begin();
+  const unsigned char *End = Data.bytes_end();
+  auto HasBytes = [&](size_t N) { return size_t(End - Ptr) >= N; };
+
+  // Validate the header against the current search paths.
+  if (!HasBytes(sizeof(LookupCacheMagic) + 4 + 8 + 4) ||
+      memcmp(Ptr, LookupCacheMagic, sizeof(LookupCacheMagic)) != 0)
+    return false;
+  Ptr += sizeof(LookupCacheMagic);
+  if (endian::readNext<uint32_t, little, unaligned>(Ptr) !=
+          LookupCacheVersion ||
+      endian::readNext<uint64_t, little, unaligned>(Ptr) != Signature ||
+      endian::readNext<uint32_t, little, unaligned>(Ptr) !=
+          DirModTimes.size() ||
+      !HasBytes(DirModTimes.size() * 8 + 4))
+    return false;
+  for (uint64_t ModTime : DirModTimes)
+    if (endian::readNext<uint64_t, little, unaligned>(Ptr) != ModTime)
+      return false;
+
+  // A truncated file still yields the entries read so far, which are all
+  // complete.
+  uint32_t NumEntries = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  for (uint32_t I = 0; I != NumEntries && HasBytes(12); ++I) {
+    uint32_t StartIdx = endian::readNext<uint32_t, little, unaligned>(Ptr);
+    uint32_t HitIdx = endian::readNext<uint32_t, little, unaligned>(Ptr);
+    uint32_t NameLen = endian::readNext<uint32_t, little, unaligned>(Ptr);
+    if (!HasBytes(NameLen))
+      break;
+    StringRef Name(reinterpret_cast<const char *>(Ptr), NameLen);
+    Ptr += NameLen;
+
+    // Only headers that were found are recorded.
+    if (StartIdx == 0 || StartIdx > DirModTimes.size() ||
+        HitIdx + 1 < StartIdx || HitIdx >= DirModTimes.size())
+      continue;
+    AddEntry(Name, StartIdx, HitIdx);
+  }
+  return true;
+}
+
+uint64_t HeaderSearch::getSearchPathSignature() const {
+  llvm::hash_code Code = llvm::hash_value(getClangFullRepositoryVersion());
+  Code = llvm::hash_combine(Code, AngledDirIdx, SystemDirIdx, NoCurDirSearch);
+  for (const DirectoryLookup &DL : SearchDirs)
+    Code = llvm::hash_combine(Code, StringRef(DL.getName()),
+                              unsigned(DL.getLookupType()),
+                              unsigned(DL.getDirCharacteristic()),
+                              DL.isIndexHeaderMap());
+  for (const auto &Prefix : SystemHeaderPrefixes)
+    Code = llvm::hash_combine(Code, Prefix.first, Prefix.second);
+  return Code;
+}
+
+void HeaderSearch::getSearchDirModTimes(SmallVectorImpl<uint64_t> &ModTimes) {
+  ModTimes.clear();
+  for (const DirectoryLookup &DL : SearchDirs) {
+    vfs::Status Status;
+    if (FileMgr.getNoncachedStatValue(DL.getName(), Status))
+      ModTimes.push_back(0);
+    else
+      ModTimes.push_back(Status.getLastModificationTime().toEpochTime());
+  }
+}
+
+void HeaderSearch::loadLookupCache() {
+  LookupCacheLoaded = true;
+  if (HSOpts->HeaderLookupCachePath.empty())
+    return;
+
+  getSearchDirModTimes(LookupCacheDirModTimes);
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufOrErr =
+      llvm::MemoryBuffer::getFile(HSOpts->HeaderLookupCachePath, -1,
+                                  /*RequiresNullTerminator=*/false);
+  if (!BufOrErr ||
+      !readLookupCache((*BufOrErr)->getBuffer(), getSearchPathSignature(),
+                       LookupCacheDirModTimes,
+                       [&](StringRef Name, uint32_t StartIdx,
+                           uint32_t HitIdx) {
+                         // Seed the in-memory cache.
+                         LookupFileCacheInfo &Info = LookupFileCache[Name];
+                         if (Info.StartIdx)
+                           return;
+                         Info.StartIdx = StartIdx;
+                         Info.HitIdx = HitIdx;
+                         ++NumLookupCacheEntriesLoaded;
+                       }))
+    LookupCacheChanged = true;
+}
+
+void HeaderSearch::writeLookupCache() {
+  if (HSOpts->HeaderLookupCachePath.empty() || !LookupCacheLoaded ||
+      !LookupCacheChanged)
+    return;
+
+  // Search paths added after the cache was loaded (e.g. by AddSearchPath)
+  // invalidate the recorded indices.
+  if (LookupCacheDirModTimes.size() != SearchDirs.size())
+    return;
+
+  uint64_t Signature = getSearchPathSignature();
+  auto Update = [&](StringRef Existing, SmallVectorImpl<char> &Buffer) {
+    // The headers found by this compilation, merged with the ones that other
+    // compilations recorded since the cache was loaded. Lookups that found
+    // nothing and entries for names mapped through a header map are not
+    // persisted; the mapped name lives in this HeaderSearch's allocator.
+    llvm::StringMap<std::pair<uint32_t, uint32_t>> Entries;
+    for (const auto &Entry : LookupFileCache)
+      if (Entry.second.StartIdx && !Entry.second.MappedName &&
+          Entry.second.HitIdx < SearchDirs.size())
+        Entries[Entry.getKey()] =
+            std::make_pair(Entry.second.StartIdx, Entry.second.HitIdx);
+    readLookupCache(Existing, Signature, LookupCacheDirModTimes,
+                    [&](StringRef Name, uint32_t StartIdx, uint32_t HitIdx) {
+                      Entries.insert(std::make_pair(
+                          Name, std::make_pair(StartIdx, HitIdx)));
+                    });
+
+    llvm::raw_svector_ostream OS(Buffer);
+    using namespace llvm::support;
+    endian::Writer<little> W(OS);
+    OS.write(LookupCacheMagic, sizeof(LookupCacheMagic));
+    W.write<uint32_t>(LookupCacheVersion);
+    W.write<uint64_t>(Signature);
+    W.write<uint32_t>(SearchDirs.size());
+    for (uint64_t ModTime : LookupCacheDirModTimes)
+      W.write<uint64_t>(ModTime);
+    W.write<uint32_t>(Entries.size());
+    for (const auto &Entry : Entries) {
+      W.write<uint32_t>(Entry.second.first);
+      W.write<uint32_t>(Entry.second.second);
+      W.write<uint32_t>(Entry.getKey().size());
+      OS << Entry.getKey();
+    }
+  };
+
+  if (updateFileLocked(HSOpts->HeaderLookupCachePath, Update))
+    LookupCacheChanged = false;
+}
+
+//===----------------------------------------------------------------------===//
+// Persistent header guard database
+//===----------------------------------------------------------------------===//
+//
+// The guard database records the controlling macros that the multiple-include
+// optimization detected in earlier compilations, so that a header whose guard
+// macro is already defined can be skipped the first time it is included in a
+// translation unit (e.g. another copy of the same header, or a header whose
+// guard was defined by a prior header) after just the stat done by lookup,
+// without opening and lexing it. Later inclusions are already skipped by the
+// multiple-include optimization itself, as are #import and #pragma once
+// headers. The file layout (all integers little-endian) is:
+//
+//   "CLGD" <version: u32> <compiler version hash: u64>
+//   <number of entries: u32>
+//   (<size: u64> <modification time: u64> <name length: u32> <name>
+//    <macro length: u32> <macro>)...
+//
+// Entries are only used while the header's size and modification time match.
+
+static const char GuardDBMagic[] = {'C', 'L', 'G', 'D'};
+static const uint32_t GuardDBVersion = 1;
+
+void HeaderSearch::getGuardDBKey(const FileEntry *File,
+                                 SmallVectorImpl<char> &Key) const {
+  Key.clear();
+  Key.append(File->getName(), File->getName() + strlen(File->getName()));
+  FileMgr.makeAbsolutePath(Key);
+  llvm::sys::path::remove_dots(Key, /*remove_dot_dot=*/true);
+}
+
+/// Parse the guard database \p Data, calling \p AddEntry with the name,
+/// size, modification time and controlling macro of each of its entries.
+static void readGuardDB(
+    StringRef Data,
+    llvm::function_ref<void(StringRef, uint64_t, uint64_t, StringRef)>
+        AddEntry) {
+  using namespace llvm::support;
+  const unsigned char *Ptr = Data.bytes_begin();
+  const unsigned char *End = Data.bytes_end();
+  auto HasBytes = [&](size_t N) { return size_t(End - Ptr) >= N; };
+
+  if (!HasBytes(sizeof(GuardDBMagic) + 4 + 8 + 4) ||
+      memcmp(Ptr, GuardDBMagic, sizeof(GuardDBMagic)) != 0)
+    return;
+  Ptr += sizeof(GuardDBMagic);
+  if (endian::readNext<uint32_t, little, unaligned>(Ptr) != GuardDBVersion ||
+      endian::readNext<uint64_t, little, unaligned>(Ptr) !=
+          uint64_t(llvm::hash_value(getClangFullRepositoryVersion())))
+    return;
+
+  uint32_t NumEntries = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  for (uint32_t I = 0; I != NumEntries && HasBytes(20); ++I) {
+    uint64_t Size = endian::readNext<uint64_t, little, unaligned>(Ptr);
+    uint64_t ModTime = endian::readNext<uint64_t, little, unaligned>(Ptr);
+    uint32_t NameLen = endian::readNext<uint32_t, little, unaligned>(Ptr);
+    if (!HasBytes(NameLen + 4))
+      break;
+    StringRef Name(reinterpret_cast<const char *>(Ptr), NameLen);
+    Ptr += NameLen;
+    uint32_t MacroLen = endian::readNext<uint32_t, little, unaligned>(Ptr);
+    if (!HasBytes(MacroLen))
+      break;
+    StringRef Macro(reinterpret_cast<const char *>(Ptr), MacroLen);
+    Ptr += MacroLen;
+
+    if (!Macro.empty())
+      AddEntry(Name, Size, ModTime, Macro);
+  }
+}
+
+void HeaderSearch::loadGuardDB() {
+  GuardDBLoaded = true;
+  if (HSOpts->HeaderGuardDBPath.empty())
+    return;
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufOrErr =
+      llvm::MemoryBuffer::getFile(HSOpts->HeaderGuardDBPath, -1,
+                                  /*RequiresNullTerminator=*/false);
+  if (!BufOrErr)
+    return;
+
+  readGuardDB((*BufOrErr)->getBuffer(),
+              [&](StringRef Name, uint64_t Size, uint64_t ModTime,
+                  StringRef Macro) {
+                GuardDBEntry &Entry = GuardDB[Name];
+                Entry.Size = Size;
+                Entry.ModTime = ModTime;
+                Entry.ControllingMacro = Macro;
+                ++NumGuardDBEntriesLoaded;
+              });
+}
+
+const IdentifierInfo *HeaderSearch::lookupGuardDB(Preprocessor &PP,
+                                                  const FileEntry *File) {
+  if (!GuardDBLoaded)
+    loadGuardDB();
+  if (GuardDB.empty())
+    return nullptr;
+
+  SmallString<256> Key;
+  getGuardDBKey(File, Key);
+  auto Known = GuardDB.find(Key);
+  if (Known == GuardDB.end() ||
+      Known->second.Size != uint64_t(File->getSize()) ||
+      Known->second.ModTime != uint64_t(File->getModificationTime()))
+    return nullptr;
+  return PP.getIdentifierInfo(Known->second.ControllingMacro);
+}
+
+void HeaderSearch::writeGuardDB() {
+  if (HSOpts->HeaderGuardDBPath.empty())
+    return;
+  if (!GuardDBLoaded)
+    loadGuardDB();
+
+  // Merge in the guards detected in this compilation.
+  bool Changed = false;
+  SmallVector<const FileEntry *, 64> FilesByUID;
+  FileMgr.GetUniqueIDMapping(FilesByUID);
+  llvm::StringSet<> Detected;
+  SmallString<256> Key;
+  for (unsigned UID = 0, E = std::min<size_t>(FileInfo.size(),
+                                              FilesByUID.size());
+       UID != E; ++UID) {
+    const FileEntry *File = FilesByUID[UID];
+    const IdentifierInfo *Macro = FileInfo[UID].ControllingMacro;
+    if (!File || !Macro || FileInfo[UID].External)
+      continue;
+
+    getGuardDBKey(File, Key);
+    Detected.insert(Key);
+    GuardDBEntry &Entry = GuardDB[Key];
+    if (Entry.Size == uint64_t(File->getSize()) &&
+        Entry.ModTime == uint64_t(File->getModificationTime()) &&
+        Entry.ControllingMacro == Macro->getName())
+      continue;
+    Entry.Size = File->getSize();
+    Entry.ModTime = File->getModificationTime();
+    Entry.ControllingMacro = Macro->getName();
+    Changed = true;
+  }
+  if (!Changed)
+    return;
+
+  auto Update = [&](StringRef Existing, SmallVectorImpl<char> &Buffer) {
+    // Other compilations may have recorded guards since the database was
+    // loaded; keep them, unless this compilation detected the guard itself.
+    readGuardDB(Existing, [&](StringRef Name, uint64_t Size,
+                              uint64_t ModTime, StringRef Macro) {
+      if (Detected.count(Name))
+        return;
+      GuardDBEntry &Entry = GuardDB[Name];
+      Entry.Size = Size;
+      Entry.ModTime = ModTime;
+      Entry.ControllingMacro = Macro;
+    });
+
+    llvm::raw_svector_ostream OS(Buffer);
+    using namespace llvm::support;
+    endian::Writer<little> W(OS);
+    OS.write(GuardDBMagic, sizeof(GuardDBMagic));
+    W.write<uint32_t>(GuardDBVersion);
+    W.write<uint64_t>(llvm::hash_value(getClangFullRepositoryVersion()));
+    W.write<uint32_t>(GuardDB.size());
+    for (const auto &Entry : GuardDB) {
+      W.write<uint64_t>(Entry.second.Size);
+      W.write<uint64_t>(Entry.second.ModTime);
+      W.write<uint32_t>(Entry.getKey().size());
+      OS << Entry.getKey();
+      W.write<uint32_t>(Entry.second.ControllingMacro.size());
+      OS << Entry.second.ControllingMacro;
+    }
+  };
+  updateFileLocked(HSOpts->HeaderGuardDBPath, Update);
 }
 
 /// CreateHeaderMap - This method returns a HeaderMap for the specified
@@ -145,15 +586,35 @@ std::string HeaderSearch::getModuleFileName(StringRef ModuleName,
     //
     // To avoid false-negatives, we form as canonical a path as we can, and map
     // to lower-case in case we're on a case-insensitive file system.
-   auto *Dir =
-        FileMgr.getDirectory(llvm::sys::path::parent_path(ModuleMapPath));
-    if (!Dir)
-      return std::string();
-    auto DirName = FileMgr.getCanonicalName(Dir);
+    //
+    // If input files are validated by content, use the contents of the module
+    // map instead of its directory, so that the same module built from
+    // another copy of the source tree has the same name.
     auto FileName = llvm::sys::path::filename(ModuleMapPath);
-
-    llvm::hash_code Hash =
-      llvm::hash_combine(DirName.lower(), FileName.lower());
+    llvm::hash_code Hash;
+    if (HSOpts->ValidateASTInputFilesContent) {
+      const FileEntry *File = FileMgr.getFile(ModuleMapPath);
+      if (!File)
+        return std::string();
+      auto Known = ModuleMapContentHashes.find(File);
+      if (Known == ModuleMapContentHashes.end()) {
+        auto Buffer = FileMgr.getBufferForFile(File);
+        if (!Buffer)
+          return std::string();
+        Known = ModuleMapContentHashes
+                    .insert(std::make_pair(
+                        File, llvm::hash_value((*Buffer)->getBuffer())))
+                    .first;
+      }
+      Hash = llvm::hash_combine(Known->second, FileName.lower());
+    } else {
+      auto *Dir =
+          FileMgr.getDirectory(llvm::sys::path::parent_path(ModuleMapPath));
+      if (!Dir)
+        return std::string();
+      auto DirName = FileMgr.getCanonicalName(Dir);
+      Hash = llvm::hash_combine(DirName.lower(), FileName.lower());
+    }
 
     SmallString<128> HashStr;
     llvm::APInt(64, size_t(Hash)).toStringUnsigned(HashStr, /*Radix*/36);
@@ -691,6 +1152,8 @@ const FileEntry *HeaderSearch::LookupFile(
   // multiply included, and the "pragma once" optimization prevents them from
   // being relex/pp'd, but they would still have to search through a
   // (potentially huge) series of SearchDirs to find it.
+  if (!LookupCacheLoaded)
+    loadLookupCache();
   LookupFileCacheInfo &CacheLookup = LookupFileCache[Filename];
 
   // If the entry has been previously looked up, the first value will be
@@ -706,6 +1169,7 @@ const FileEntry *HeaderSearch::LookupFile(
     // our search start.  We will fill in our found location below, so prime the
     // start point value.
     CacheLookup.reset(/*StartIdx=*/i+1);
+    LookupCacheChanged = true;
   }
 
   SmallString<64> MappedName;
@@ -1071,6 +1535,16 @@ bool HeaderSearch::ShouldEnterIncludeFile(Preprocessor &PP,
       ++NumMultiIncludeFileOptzn;
       return false;
     }
+  } else if (!M && !FileInfo.NumIncludes &&
+             !HSOpts->HeaderGuardDBPath.empty()) {
+    // This header hasn't been lexed yet; an earlier compilation may have
+    // found its guard already.
+    if (const IdentifierInfo *ControllingMacro = lookupGuardDB(PP, File)) {
+      if (PP.isMacroDefined(ControllingMacro)) {
+        ++NumGuardDBIncludesSkipped;
+        return false;
+      }
+    }
   }
 
   // Increment the number of times this file has been included.
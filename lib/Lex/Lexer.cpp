@@ -19,13 +19,23 @@
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/LiteralSupport.h"
 #include "clang/Lex/Preprocessor.h"
+#include "clang/Lex/PreprocessorOptions.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ConvertUTF.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif __ALTIVEC__
+#include <altivec.h>
+#undef bool
+#endif
+
 using namespace clang;
 
 //===----------------------------------------------------------------------===//
@@ -77,6 +87,7 @@ void Lexer::InitLexer(const char *BufStart, const char *BufPtr,
   }
 
   Is_PragmaLexer = false;
+  DirectivesOnly = false;
   CurrentConflictMarkerState = CMK_None;
 
   // Start of the file is a start of line.
@@ -114,6 +125,8 @@ Lexer::Lexer(FileID FID, const llvm::MemoryBuffer *InputFile, Preprocessor &PP)
   InitLexer(InputFile->getBufferStart(), InputFile->getBufferStart(),
             InputFile->getBufferEnd());
 
+  DirectivesOnly = PP.getPreprocessorOpts().DependencyDirectivesOnly;
+
   resetExtendedTokenMode();
 }
 
@@ -1499,9 +1512,131 @@ bool Lexer::tryConsumeIdentifierUTF8Char(const char *&CurPtr) {
   return true;
 }
 
+//===----------------------------------------------------------------------===//
+// Vectorized scanners
+//===----------------------------------------------------------------------===//
+//
+// Each of these skips, 16 bytes at a time, a prefix of [CurPtr, BufferEnd)
+// made only of characters that the corresponding scalar loop would consume
+// without further checks, and returns a pointer to the first byte that may
+// need attention (which may be CurPtr itself). Blocks are only loaded when
+// they lie entirely before BufferEnd; the caller's scalar loop handles the
+// remaining bytes. Without SSE2 they return CurPtr unchanged.
+
+#ifdef __SSE2__
+/// Return a mask with a bit set for each byte of \p Block equal to \p C.
+static inline unsigned matchByte(__m128i Block, char C) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(Block, _mm_set1_epi8(C)));
+}
+
+/// Return a mask with a bit set for each byte of \p Block in [Lo, Hi]. Bytes
+/// with the high bit set compare as negative and never match.
+static inline unsigned matchRange(__m128i Block, char Lo, char Hi) {
+  return _mm_movemask_epi8(
+      _mm_and_si128(_mm_cmpgt_epi8(Block, _mm_set1_epi8(Lo - 1)),
+                    _mm_cmplt_epi8(Block, _mm_set1_epi8(Hi + 1))));
+}
+
+static inline __m128i loadBlock(const char *Ptr) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+}
+#endif
+
+/// Skip [_A-Za-z0-9]*.
+static const char *skipIdentifierBody(const char *CurPtr,
+                                      const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Block = loadBlock(CurPtr);
+    // Setting bit 5 maps 'A'-'Z' onto 'a'-'z' and leaves digits and '_'
+    // distinguishable.
+    __m128i Lower = _mm_or_si128(Block, _mm_set1_epi8(0x20));
+    unsigned Body = matchRange(Lower, 'a', 'z') |
+                    matchRange(Block, '0', '9') | matchByte(Block, '_');
+    if (Body != 0xFFFF)
+      return CurPtr + llvm::countTrailingOnes(Body);
+    CurPtr += 16;
+  }
+#endif
+  return CurPtr;
+}
+
+/// Skip horizontal whitespace: ' ', '\t', '\f' and '\v'.
+static const char *skipHorizontalWhitespace(const char *CurPtr,
+                                            const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Block = loadBlock(CurPtr);
+    unsigned Space = matchByte(Block, ' ') | matchByte(Block, '\t') |
+                     matchByte(Block, '\f') | matchByte(Block, '\v');
+    if (Space != 0xFFFF)
+      return CurPtr + llvm::countTrailingOnes(Space);
+    CurPtr += 16;
+  }
+#endif
+  return CurPtr;
+}
+
+/// Skip the body of a line comment up to a newline or a nul character.
+static const char *skipLineCommentBody(const char *CurPtr,
+                                       const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Block = loadBlock(CurPtr);
+    unsigned Stop = matchByte(Block, '\n') | matchByte(Block, '\r') |
+                    matchByte(Block, '\0');
+    if (Stop)
+      return CurPtr + llvm::countTrailingZeros(Stop);
+    CurPtr += 16;
+  }
+#endif
+  return CurPtr;
+}
+
+/// Skip the characters of a string literal which are obviously simple (see
+/// Lexer::isObviouslySimpleCharacter) and can't end or escape anything:
+/// everything but '"', '\\', '?', newlines and nul characters.
+static const char *skipStringLiteralBody(const char *CurPtr,
+                                         const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Block = loadBlock(CurPtr);
+    unsigned Stop = matchByte(Block, '"') | matchByte(Block, '\\') |
+                    matchByte(Block, '?') | matchByte(Block, '\n') |
+                    matchByte(Block, '\r') | matchByte(Block, '\0');
+    if (Stop)
+      return CurPtr + llvm::countTrailingZeros(Stop);
+    CurPtr += 16;
+  }
+#endif
+  return CurPtr;
+}
+
+/// Skip the characters that can't start a comment, a literal, a directive or
+/// a _Pragma operator, or end a line, when skipping non-directive lines (see
+/// Lexer::SkipToNextDirective).
+static const char *skipNonDirectiveText(const char *CurPtr,
+                                        const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Block = loadBlock(CurPtr);
+    unsigned Stop = matchByte(Block, '\n') | matchByte(Block, '\r') |
+                    matchByte(Block, '\0') | matchByte(Block, '\\') |
+                    matchByte(Block, '/') | matchByte(Block, '#') |
+                    matchByte(Block, '"') | matchByte(Block, '\'') |
+                    matchByte(Block, 'R') | matchByte(Block, '_');
+    if (Stop)
+      return CurPtr + llvm::countTrailingZeros(Stop);
+    CurPtr += 16;
+  }
+#endif
+  return CurPtr;
+}
+
 bool Lexer::LexIdentifier(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
   unsigned Size;
+  CurPtr = skipIdentifierBody(CurPtr, BufferEnd);
   unsigned char C = *CurPtr++;
   while (isIdentifierBody(C))
     C = *CurPtr++;
@@ -1754,6 +1889,7 @@ bool Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
            ? diag::warn_cxx98_compat_unicode_literal
            : diag::warn_c99_compat_unicode_literal);
 
+  CurPtr = skipStringLiteralBody(CurPtr, BufferEnd);
   char C = getAndAdvanceChar(CurPtr, Result);
   while (C != '"') {
     // Skip escaped characters.  Escaped newlines will already be processed by
@@ -1779,6 +1915,7 @@ bool Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
 
       NulCharacter = CurPtr-1;
     }
+    CurPtr = skipStringLiteralBody(CurPtr, BufferEnd);
     C = getAndAdvanceChar(CurPtr, Result);
   }
 
@@ -1993,7 +2130,12 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr,
 
   // Skip consecutive spaces efficiently.
   while (1) {
-    // Skip horizontal whitespace very aggressively.
+    // Skip horizontal whitespace very aggressively. Runs of indentation are
+    // often long enough to be worth scanning in blocks.
+    if (isHorizontalWhitespace(Char)) {
+      CurPtr = skipHorizontalWhitespace(CurPtr, BufferEnd);
+      Char = *CurPtr;
+    }
     while (isHorizontalWhitespace(Char))
       Char = *++CurPtr;
 
@@ -2060,6 +2202,7 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr,
   // them.  As such, optimize for this case with the inner loop.
   char C;
   do {
+    CurPtr = skipLineCommentBody(CurPtr, BufferEnd);
     C = *CurPtr;
     // Skip over characters in the fast loop.
     while (C != 0 &&                // Potentially EOF.
@@ -2265,13 +2408,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 /// We have just read from input the / and * characters that started a comment.
 /// Read until we find the * and / characters that terminate the comment.
 /// Note that we don't bother decoding trigraphs or escaped newlines in block
@@ -2923,6 +3059,206 @@ bool Lexer::Lex(Token &Result) {
   return returnedToken;
 }
 
+/// isDigitSeparator - Return true if the quote at CurPtr is a C++14 digit
+/// separator, i.e. it follows a pp-number and is followed by a digit or a
+/// nondigit, as in LexNumericConstant.
+bool Lexer::isDigitSeparator(const char *CurPtr) const {
+  if (!LangOpts.CPlusPlus14 || CurPtr == BufferStart ||
+      !isIdentifierBody(CurPtr[1]))
+    return false;
+
+  // Find the start of the token the quote would continue.
+  const char *Start = CurPtr;
+  while (Start != BufferStart) {
+    char C = Start[-1];
+    if (isIdentifierBody(C) || C == '.' || C == '\'')
+      --Start;
+    else if ((C == '+' || C == '-') && Start - 1 != BufferStart &&
+             (Start[-2] == 'e' || Start[-2] == 'E' || Start[-2] == 'p' ||
+              Start[-2] == 'P'))
+      Start -= 2;
+    else
+      break;
+  }
+  return isDigit(Start[0]) || (Start[0] == '.' && isDigit(Start[1]));
+}
+
+/// SkipToNextDirective - In dependency-directives-only mode, skip every line
+/// that isn't a preprocessor directive, starting at the start of the physical
+/// line at CurPtr.  Comments, string and character literals and raw string
+/// literals are skipped as a whole, since they may hide a '#' or span several
+/// lines.  Returns a pointer to the '#' (or '%:' or '??=') of the next
+/// directive, to the next _Pragma operator, or to the end of the buffer.
+const char *Lexer::SkipToNextDirective(const char *CurPtr) {
+  // Whether only whitespace and comments were seen on the current line.
+  bool AtLineStart = true;
+  bool SawTokens = false;
+
+  while (true) {
+    switch (*CurPtr) {
+    case 0:
+      if (CurPtr == BufferEnd)
+        goto Done;
+      ++CurPtr;
+      continue;
+    case ' ':
+    case '\t':
+    case '\f':
+    case '\v':
+      ++CurPtr;
+      continue;
+    case '\n':
+    case '\r':
+      ++CurPtr;
+      AtLineStart = true;
+      continue;
+    case '\\': {
+      const char *AfterEscape = SkipEscapedNewLines(CurPtr);
+      if (AfterEscape != CurPtr) {
+        CurPtr = AfterEscape;
+        continue;
+      }
+      ++CurPtr;
+      break;
+    }
+    case '/':
+      if (CurPtr[1] == '/') {
+        // Skip to the end of the line comment, which may be continued by
+        // escaped newlines.
+        CurPtr += 2;
+        while (true) {
+          CurPtr = skipLineCommentBody(CurPtr, BufferEnd);
+          while (*CurPtr != '\n' && *CurPtr != '\r' &&
+                 (*CurPtr != 0 || CurPtr != BufferEnd))
+            ++CurPtr;
+          if (CurPtr == BufferEnd)
+            goto Done;
+          const char *EscapePtr = CurPtr - 1;
+          while (isHorizontalWhitespace(*EscapePtr))
+            --EscapePtr;
+          if (*EscapePtr != '\\')
+            break;
+          CurPtr += Lexer::getEscapedNewLineSize(CurPtr);
+        }
+        continue;
+      }
+      if (CurPtr[1] == '*') {
+        size_t End = StringRef(CurPtr + 2, BufferEnd - CurPtr - 2).find("*/");
+        CurPtr = End == StringRef::npos ? BufferEnd : CurPtr + 2 + End + 2;
+        continue;
+      }
+      ++CurPtr;
+      break;
+    case '#':
+      if (AtLineStart)
+        goto Done;
+      ++CurPtr;
+      break;
+    case '%':
+      // The '%:' digraph.
+      if (AtLineStart && LangOpts.Digraphs && CurPtr[1] == ':')
+        goto Done;
+      CurPtr = skipNonDirectiveText(CurPtr + 1, BufferEnd);
+      break;
+    case '?':
+      // The '??=' trigraph.
+      if (AtLineStart && LangOpts.Trigraphs && CurPtr[1] == '?' &&
+          CurPtr[2] == '=')
+        goto Done;
+      CurPtr = skipNonDirectiveText(CurPtr + 1, BufferEnd);
+      break;
+    case '_':
+      // A _Pragma operator can't be skipped, since it may act on macros (e.g.
+      // push_macro) or on the file (e.g. once), just like #pragma.
+      if (StringRef(CurPtr, BufferEnd - CurPtr).startswith("_Pragma") &&
+          !isIdentifierBody(CurPtr[7]) &&
+          (CurPtr == BufferStart || !isIdentifierBody(CurPtr[-1])))
+        goto Done;
+      CurPtr = skipNonDirectiveText(CurPtr + 1, BufferEnd);
+      break;
+    case '\'':
+      if (isDigitSeparator(CurPtr)) {
+        ++CurPtr;
+        break;
+      }
+      // Fall through.
+    case '"': {
+      char Quote = *CurPtr++;
+      while (true) {
+        if (Quote == '"')
+          CurPtr = skipStringLiteralBody(CurPtr, BufferEnd);
+        char C = *CurPtr;
+        if (C == Quote) {
+          ++CurPtr;
+          break;
+        }
+        // An unterminated literal ends at the end of the line.
+        if (C == '\n' || C == '\r' || (C == 0 && CurPtr == BufferEnd))
+          break;
+        if (C == '\\') {
+          const char *AfterEscape = SkipEscapedNewLines(CurPtr);
+          if (AfterEscape != CurPtr) {
+            CurPtr = AfterEscape;
+            continue;
+          }
+          // Skip the escaped character, unless it's the end of the line.
+          if (CurPtr[1] != '\n' && CurPtr[1] != '\r' &&
+              (CurPtr[1] != 0 || CurPtr + 1 != BufferEnd))
+            ++CurPtr;
+        }
+        ++CurPtr;
+      }
+      break;
+    }
+    case 'R': {
+      // A raw string literal, with an optional encoding prefix.
+      const char *Prefix = CurPtr;
+      if (Prefix - BufferStart >= 2 && Prefix[-2] == 'u' && Prefix[-1] == '8')
+        Prefix -= 2;
+      else if (Prefix != BufferStart &&
+               (Prefix[-1] == 'u' || Prefix[-1] == 'U' || Prefix[-1] == 'L'))
+        --Prefix;
+      if (!LangOpts.CPlusPlus11 || CurPtr[1] != '"' ||
+          (Prefix != BufferStart && isIdentifierBody(Prefix[-1]))) {
+        ++CurPtr;
+        break;
+      }
+      const char *Delim = CurPtr + 2;
+      const char *Paren = Delim;
+      while (Paren - Delim <= 16 && *Paren != '(' && *Paren != '"' &&
+             !isWhitespace(*Paren) && *Paren != '\\' && *Paren != ')' &&
+             (*Paren != 0 || Paren != BufferEnd))
+        ++Paren;
+      if (*Paren != '(' || Paren - Delim > 16) {
+        ++CurPtr;
+        break;
+      }
+      SmallString<20> Terminator(")");
+      Terminator += StringRef(Delim, Paren - Delim);
+      Terminator += '"';
+      size_t End =
+          StringRef(Paren + 1, BufferEnd - Paren - 1).find(Terminator);
+      CurPtr = End == StringRef::npos ? BufferEnd
+                                      : Paren + 1 + End + Terminator.size();
+      break;
+    }
+    default:
+      CurPtr = skipNonDirectiveText(CurPtr + 1, BufferEnd);
+      break;
+    }
+
+    // Anything but whitespace and comments gets here.
+    AtLineStart = false;
+    SawTokens = true;
+  }
+
+Done:
+  // The skipped tokens still count against the multiple-include optimization.
+  if (SawTokens)
+    MIOpt.ReadToken();
+  return CurPtr;
+}
+
 /// LexTokenInternal - This implements a simple C family lexer.  It is an
 /// extremely performance critical piece of code.  This assumes that the buffer
 /// has a null character at the end of the file.  This returns a preprocessing
@@ -2934,6 +3270,11 @@ LexNextToken:
   Result.clearFlag(Token::NeedsCleaning);
   Result.setIdentifierInfo(nullptr);
 
+  // When only directives matter, skip straight to the next one.
+  if (DirectivesOnly && TokAtPhysicalStartOfLine && !LexingRawMode &&
+      !ParsingPreprocessorDirective && !Is_PragmaLexer)
+    BufferPtr = SkipToNextDirective(BufferPtr);
+
   // CurPtr - Cache BufferPtr in an automatic variable.
   const char *CurPtr = BufferPtr;
 
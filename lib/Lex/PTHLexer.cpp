@@ -15,6 +15,7 @@
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/IdentifierTable.h"
+#include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TokenKinds.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/PTHManager.h"
@@ -23,6 +24,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/EndianStream.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <memory>
 #include <system_error>
@@ -307,12 +309,20 @@ namespace {
 class PTHFileData {
   const uint32_t TokenOff;
   const uint32_t PPCondOff;
+  const uint64_t ContentHash;
+  const uint64_t ModTime;
+  const uint64_t Size;
 public:
-  PTHFileData(uint32_t tokenOff, uint32_t ppCondOff)
-    : TokenOff(tokenOff), PPCondOff(ppCondOff) {}
+  PTHFileData(uint32_t tokenOff, uint32_t ppCondOff, uint64_t contentHash,
+              uint64_t modTime, uint64_t size)
+    : TokenOff(tokenOff), PPCondOff(ppCondOff), ContentHash(contentHash),
+      ModTime(modTime), Size(size) {}
 
   uint32_t getTokenOffset() const { return TokenOff; }
   uint32_t getPPCondOffset() const { return PPCondOff; }
+  uint64_t getContentHash() const { return ContentHash; }
+  uint64_t getModTime() const { return ModTime; }
+  uint64_t getSize() const { return Size; }
 };
 
 
@@ -362,7 +372,12 @@ public:
     using namespace llvm::support;
     uint32_t x = endian::readNext<uint32_t, little, unaligned>(d);
     uint32_t y = endian::readNext<uint32_t, little, unaligned>(d);
-    return PTHFileData(x, y);
+    uint64_t h = endian::readNext<uint64_t, little, unaligned>(d);
+    // Skip the unique ID in the stat information that follows.
+    d += 2 * sizeof(uint64_t);
+    uint64_t ModTime = endian::readNext<uint64_t, little, unaligned>(d);
+    uint64_t Size = endian::readNext<uint64_t, little, unaligned>(d);
+    return PTHFileData(x, y, h, ModTime, Size);
   }
 };
 
@@ -418,11 +433,13 @@ PTHManager::PTHManager(
     std::unique_ptr<PTHFileLookup> fileLookup, const unsigned char *idDataTable,
     std::unique_ptr<IdentifierInfo *[], llvm::FreeDeleter> perIDCache,
     std::unique_ptr<PTHStringIdLookup> stringIdLookup, unsigned numIds,
-    const unsigned char *spellingBase, const char *originalSourceFile)
+    const unsigned char *spellingBase, const char *originalSourceFile,
+    uint32_t langOptsSignature)
     : Buf(std::move(buf)), PerIDCache(std::move(perIDCache)),
       FileLookup(std::move(fileLookup)), IdDataTable(idDataTable),
       StringIdLookup(std::move(stringIdLookup)), NumIds(numIds), PP(nullptr),
-      SpellingBase(spellingBase), OriginalSourceFile(originalSourceFile) {}
+      SpellingBase(spellingBase), OriginalSourceFile(originalSourceFile),
+      LangOptsSignature(langOptsSignature), UseCachedTokens(true) {}
 
 PTHManager::~PTHManager() {
 }
@@ -461,7 +478,7 @@ PTHManager *PTHManager::Create(StringRef file, DiagnosticsEngine &Diags) {
   const unsigned char *p = BufBeg + (sizeof("cfe-pth"));
   unsigned Version = endian::readNext<uint32_t, little, aligned>(p);
 
-  if (Version < PTHManager::Version) {
+  if (Version != PTHManager::Version) {
     InvalidPTH(Diags,
         Version < PTHManager::Version
         ? "PTH file uses an older PTH format that is no longer supported"
@@ -544,8 +561,13 @@ PTHManager *PTHManager::Create(StringRef file, DiagnosticsEngine &Diags) {
     }
   }
 
+  // Get the signature of the language options the tokens were lexed with.
+  const unsigned char* LangOptsOffset = PrologueOffset + sizeof(uint32_t)*4;
+  uint32_t LangOptsSignature =
+      endian::readNext<uint32_t, little, aligned>(LangOptsOffset);
+
   // Compute the address of the original source file.
-  const unsigned char* originalSourceBase = PrologueOffset + sizeof(uint32_t)*4;
+  const unsigned char* originalSourceBase = PrologueOffset + sizeof(uint32_t)*5;
   unsigned len =
       endian::readNext<uint16_t, little, unaligned>(originalSourceBase);
   if (!len) originalSourceBase = nullptr;
@@ -553,7 +575,50 @@ PTHManager *PTHManager::Create(StringRef file, DiagnosticsEngine &Diags) {
   // Create the new PTHManager.
   return new PTHManager(std::move(File), std::move(FL), IData,
                         std::move(PerIDCache), std::move(SL), NumIds,
-                        spellingBase, (const char *)originalSourceBase);
+                        spellingBase, (const char *)originalSourceBase,
+                        LangOptsSignature);
+}
+
+uint64_t PTHManager::getContentHash(StringRef Contents) {
+  // PTH files outlive the compiler that wrote them, so use a hash that is
+  // stable across hosts and builds (unlike llvm::hash_value).
+  llvm::MD5 Hash;
+  Hash.update(Contents);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  using namespace llvm::support;
+  return endian::read<uint64_t, little, unaligned>(Result);
+}
+
+uint32_t PTHManager::getLangOptsSignature(const LangOptions &LangOpts) {
+  // Keyword recognition and the lexer itself depend on the language options,
+  // so be conservative and use all of the non-benign ones.
+  llvm::MD5 Hash;
+  auto AddValue = [&Hash](uint32_t Value) {
+    unsigned char Bytes[4];
+    llvm::support::endian::write32le(Bytes, Value);
+    Hash.update(Bytes);
+  };
+#define LANGOPT(Name, Bits, Default, Description) \
+  AddValue(LangOpts.Name);
+#define ENUM_LANGOPT(Name, Type, Bits, Default, Description) \
+  AddValue(static_cast<unsigned>(LangOpts.get##Name()));
+#define BENIGN_LANGOPT(Name, Bits, Default, Description)
+#define BENIGN_ENUM_LANGOPT(Name, Type, Bits, Default, Description)
+#include "clang/Basic/LangOptions.def"
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  using namespace llvm::support;
+  return endian::read<uint32_t, little, unaligned>(Result);
+}
+
+void PTHManager::setPreprocessor(Preprocessor *pp) {
+  PP = pp;
+  UseCachedTokens =
+      LangOptsSignature == getLangOptsSignature(PP->getLangOpts());
+  if (!UseCachedTokens)
+    PP->getDiagnostics().Report(diag::warn_pth_lang_opts_mismatch)
+        << Buf->getBufferIdentifier();
 }
 
 IdentifierInfo* PTHManager::LazilyCreateIdentifierInfo(unsigned PersistentID) {
@@ -593,7 +658,11 @@ IdentifierInfo* PTHManager::get(StringRef Name) {
 }
 
 PTHLexer *PTHManager::CreateLexer(FileID FID) {
-  const FileEntry *FE = PP->getSourceManager().getFileEntryForID(FID);
+  if (!UseCachedTokens)
+    return nullptr;
+
+  SourceManager &SM = PP->getSourceManager();
+  const FileEntry *FE = SM.getFileEntryForID(FID);
   if (!FE)
     return nullptr;
 
@@ -609,6 +678,20 @@ PTHLexer *PTHManager::CreateLexer(FileID FID) {
 
   const PTHFileData& FileData = *I;
 
+  // Only use the cached tokens if the file still has the contents they were
+  // lexed from; otherwise the file is lexed from source. A file with the
+  // recorded size and modification time is taken to be unchanged without
+  // reading it; one with another size certainly changed.
+  if (uint64_t(FE->getSize()) != FileData.getSize())
+    return nullptr;
+  if (uint64_t(FE->getModificationTime()) != FileData.getModTime()) {
+    bool Invalid = false;
+    const llvm::MemoryBuffer *Contents = SM.getBuffer(FID, &Invalid);
+    if (Invalid ||
+        getContentHash(Contents->getBuffer()) != FileData.getContentHash())
+      return nullptr;
+  }
+
   const unsigned char *BufStart = (const unsigned char *)Buf->getBufferStart();
   // Compute the offset of the token data within the buffer.
   const unsigned char* data = BufStart + FileData.getTokenOffset();
@@ -666,7 +749,7 @@ public:
       bool IsDirectory = true;
       if (k.first == 0x1 /* File */) {
         IsDirectory = false;
-        d += 4 * 2; // Skip the first 2 words.
+        d += 4 * 2 + 8; // Skip the token offsets and the content hash.
       }
 
       using namespace llvm::support;
@@ -707,8 +790,11 @@ public:
 
     const PTHStatData &D = *I;
 
-    if (!D.HasData)
-      return CacheMissing;
+    // Files may have changed, or been created, since the PTH file was
+    // generated; their cached tokens are validated by content instead.  Only
+    // directories are answered from the PTH file.
+    if (!D.HasData || !D.IsDirectory)
+      return statChained(Path, Data, isFile, F, FS);
 
     Data.Name = Path;
     Data.Size = D.Size;
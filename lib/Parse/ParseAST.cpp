@@ -16,6 +16,8 @@
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/ExternalASTSource.h"
 #include "clang/AST/Stmt.h"
+#include "clang/Basic/TimeTrace.h"
+#include "clang/Lex/PPCallbacks.h"
 #include "clang/Parse/ParseDiagnostic.h"
 #include "clang/Parse/Parser.h"
 #include "clang/Sema/CodeCompleteConsumer.h"
@@ -85,6 +87,35 @@ void PrettyStackTraceParserEntry::print(raw_ostream &OS) const {
   }
 }
 
+/// Records the parsing of each included file in the time trace.
+class TimeTraceIncludeCallbacks : public PPCallbacks {
+  SourceManager &SM;
+
+  /// Whether an interval was begun for each file being parsed, innermost
+  /// last.
+  SmallVector<bool, 16> IncludeStack;
+
+public:
+  explicit TimeTraceIncludeCallbacks(SourceManager &SM) : SM(SM) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override {
+    TimeTraceProfiler *Profiler = getTimeTraceProfiler();
+    if (Reason == EnterFile) {
+      FileID FID = SM.getFileID(Loc);
+      const FileEntry *FE = SM.getFileEntryForID(FID);
+      bool Begun = Profiler && FE && SM.getIncludeLoc(FID).isValid();
+      if (Begun)
+        Profiler->begin("Source", [&]() { return std::string(FE->getName()); });
+      IncludeStack.push_back(Begun);
+    } else if (Reason == ExitFile && !IncludeStack.empty()) {
+      if (IncludeStack.pop_back_val() && Profiler)
+        Profiler->end("Source");
+    }
+  }
+};
+
 }  // namespace
 
 //===----------------------------------------------------------------------===//
@@ -135,29 +166,38 @@ void clang::ParseAST(Sema &S, bool PrintStats, bool SkipFunctionBodies) {
   llvm::CrashRecoveryContextCleanupRegistrar<Parser>
     CleanupParser(ParseOP.get());
 
-  S.getPreprocessor().EnterMainSourceFile();
-  P.Initialize();
-
-  // C11 6.9p1 says translation units must have at least one top-level
-  // declaration. C++ doesn't have this restriction. We also don't want to
-  // complain if we have a precompiled header, although technically if the PCH
-  // is empty we should still emit the (pedantic) diagnostic.
-  Parser::DeclGroupPtrTy ADecl;
-  ExternalASTSource *External = S.getASTContext().getExternalSource();
-  if (External)
-    External->StartTranslationUnit(Consumer);
-
-  if (P.ParseTopLevelDecl(ADecl)) {
-    if (!External && !S.getLangOpts().CPlusPlus)
-      P.Diag(diag::ext_empty_translation_unit);
-  } else {
-    do {
-      // If we got a null return and something *was* parsed, ignore it.  This
-      // is due to a top-level semicolon, an action override, or a parse error
-      // skipping something.
-      if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
-        return;
-    } while (!P.ParseTopLevelDecl(ADecl));
+  if (timeTraceProfilerEnabled())
+    S.getPreprocessor().addPPCallbacks(
+        llvm::make_unique<TimeTraceIncludeCallbacks>(S.getSourceManager()));
+
+  {
+    // Entering the main file may already enter the first included file, whose
+    // interval must be nested in this one.
+    TimeTraceScope TimeScope("Frontend", StringRef());
+    S.getPreprocessor().EnterMainSourceFile();
+    P.Initialize();
+
+    // C11 6.9p1 says translation units must have at least one top-level
+    // declaration. C++ doesn't have this restriction. We also don't want to
+    // complain if we have a precompiled header, although technically if the
+    // PCH is empty we should still emit the (pedantic) diagnostic.
+    Parser::DeclGroupPtrTy ADecl;
+    ExternalASTSource *External = S.getASTContext().getExternalSource();
+    if (External)
+      External->StartTranslationUnit(Consumer);
+
+    if (P.ParseTopLevelDecl(ADecl)) {
+      if (!External && !S.getLangOpts().CPlusPlus)
+        P.Diag(diag::ext_empty_translation_unit);
+    } else {
+      do {
+        // If we got a null return and something *was* parsed, ignore it.
+        // This is due to a top-level semicolon, an action override, or a
+        // parse error skipping something.
+        if (ADecl && !Consumer->HandleTopLevelDecl(ADecl.get()))
+          return;
+      } while (!P.ParseTopLevelDecl(ADecl));
+    }
   }
 
   // Process any TopLevelDecls generated by #pragma weak.
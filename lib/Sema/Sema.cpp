@@ -101,6 +101,8 @@ Sema::Sema(Preprocessor &pp, ASTContext &ctxt, ASTConsumer &consumer,
     GlobalNewDeleteDeclared(false),
     TUKind(TUKind),
     NumSFINAEErrors(0),
+    NumCandidatesRejectedByArity(0), NumCandidateConversions(0),
+    NumCandidateConversionsPruned(0), NumCandidateConversionsReused(0),
     CachedFakeTopLevelModule(nullptr),
     AccessCheckingSFINAE(false), InNonInstantiationSFINAEContext(false),
     NonInstantiationEntries(0), ArgumentPackSubstitutionIndex(-1),
@@ -343,6 +345,12 @@ void Sema::addExternalSource(ExternalSemaSource *E) {
 void Sema::PrintStats() const {
   llvm::errs() << "\n*** Semantic Analysis Stats:\n";
   llvm::errs() << NumSFINAEErrors << " SFINAE diagnostics trapped.\n";
+  llvm::errs() << NumCandidatesRejectedByArity
+               << " overload candidates rejected by arity.\n";
+  llvm::errs() << NumCandidateConversions
+               << " candidate argument conversions computed, "
+               << NumCandidateConversionsPruned << " pruned by type class, "
+               << NumCandidateConversionsReused << " reused.\n";
 
   BumpAlloc.PrintStats();
   AnalysisWarnings.PrintStats();
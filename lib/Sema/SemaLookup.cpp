@@ -3458,7 +3458,7 @@ static void LookupVisibleDecls(DeclContext *Ctx, LookupResult &Result,
 
     // Walk all lookup results in the TU for each identifier.
     for (const auto &Ident : Idents) {
-      for (auto I = S.IdResolver.begin(Ident.getValue()),
+      for (auto I = S.IdResolver.begin(Ident.second),
                 E = S.IdResolver.end();
            I != E; ++I) {
         if (S.IdResolver.isDeclInScope(*I, Ctx)) {
@@ -4566,7 +4566,7 @@ std::unique_ptr<TypoCorrectionConsumer> Sema::makeTypoCorrectionConsumer(
     // seen in this translation unit.
     // FIXME: Re-add the ability to skip very unlikely potential corrections.
     for (const auto &I : Context.Idents)
-      Consumer->FoundName(I.getKey());
+      Consumer->FoundName(I.first);
 
     // Walk through identifiers in external identifier sources.
     // FIXME: Re-add the ability to skip very unlikely potential corrections.
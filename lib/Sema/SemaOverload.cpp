@@ -815,6 +815,7 @@ void OverloadCandidateSet::clear() {
   NumInlineSequences = 0;
   Candidates.clear();
   Functions.clear();
+  CachedConversions.clear();
 }
 
 namespace {
@@ -4853,6 +4854,131 @@ static bool TryCopyInitialization(const CanQualType FromQTy,
   return !ICS.isBad();
 }
 
+namespace {
+/// \brief The classes of scalar types between which the standard conversions
+/// are cheap to rule out.
+enum ScalarTypeClass {
+  STC_Other,
+  STC_Integral,
+  STC_Bool,
+  STC_Floating,
+  STC_Pointer,
+  STC_MemberPointer,
+  STC_NullPtr
+};
+} // end anonymous namespace
+
+static ScalarTypeClass classifyScalarType(QualType T) {
+  if (T->isNullPtrType())
+    return STC_NullPtr;
+  if (T->isBooleanType())
+    return STC_Bool;
+  if (const EnumType *ET = T->getAs<EnumType>())
+    return ET->getDecl()->isScoped() ? STC_Other : STC_Integral;
+  if (T->isIntegerType())
+    return STC_Integral;
+  if (T->isRealFloatingType())
+    return STC_Floating;
+  // Arrays and functions decay to pointers.
+  if (T->isPointerType() || T->isArrayType() || T->isFunctionType())
+    return STC_Pointer;
+  if (T->isMemberPointerType())
+    return STC_MemberPointer;
+  return STC_Other;
+}
+
+/// \brief Determine, without performing any lookup or instantiation, whether
+/// no implicit conversion sequence exists from the argument \p From to a
+/// parameter of type \p ToType.
+///
+/// This only recognizes conversions for which TryCopyInitialization would
+/// produce a no_conversion bad conversion sequence: conversions to a scalar
+/// type that is not a reference, either from a class without conversion
+/// functions, or from a scalar that no standard conversion can turn into a
+/// scalar of that type class. Anything else is left to TryCopyInitialization.
+static bool isArgumentConversionImpossible(Sema &S, Expr *From,
+                                           QualType ToType) {
+  const LangOptions &LangOpts = S.getLangOpts();
+  if (!LangOpts.CPlusPlus || LangOpts.ObjC1 || LangOpts.OpenCL)
+    return false;
+
+  QualType FromType = From->getType();
+  if (isa<InitListExpr>(From) || FromType->isDependentType() ||
+      FromType->isPlaceholderType() || ToType->isDependentType() ||
+      ToType->isReferenceType() || ToType->isEnumeralType())
+    return false;
+
+  ScalarTypeClass ToClass = classifyScalarType(ToType);
+  if (ToClass == STC_Other)
+    return false;
+
+  // A class with no conversion functions only converts to other classes.
+  if (CXXRecordDecl *FromRecord = FromType->getAsCXXRecordDecl()) {
+    if (!FromRecord->hasDefinition() || FromRecord->isBeingDefined())
+      return false;
+    FromRecord = FromRecord->getDefinition();
+    auto ConvFns = FromRecord->getVisibleConversionFunctions();
+    return ConvFns.begin() == ConvFns.end();
+  }
+
+  ScalarTypeClass FromClass = classifyScalarType(FromType);
+  switch (ToClass) {
+  case STC_Integral:
+  case STC_Floating:
+    return FromClass == STC_Pointer || FromClass == STC_MemberPointer ||
+           FromClass == STC_NullPtr;
+  case STC_Pointer:
+    return FromClass == STC_Floating || FromClass == STC_MemberPointer;
+  case STC_MemberPointer:
+    return FromClass == STC_Floating || FromClass == STC_Pointer;
+  case STC_NullPtr:
+    return FromClass == STC_Floating || FromClass == STC_Pointer ||
+           FromClass == STC_MemberPointer;
+  case STC_Bool:
+  case STC_Other:
+    break;
+  }
+  return false;
+}
+
+/// \brief Try to copy-initialize the parameter of type \p ParamType of an
+/// overload candidate in \p CandidateSet from the argument \p From.
+///
+/// The conversion is ruled out early when the type classes of the argument
+/// and the parameter make it impossible, and reused when another candidate of
+/// the set already converted the same argument to the same parameter type.
+static ImplicitConversionSequence
+TryCandidateArgumentInitialization(Sema &S, OverloadCandidateSet &CandidateSet,
+                                   Expr *From, QualType ParamType,
+                                   bool SuppressUserConversions,
+                                   bool InOverloadResolution,
+                                   bool AllowExplicit = false) {
+  if (isArgumentConversionImpossible(S, From, ParamType)) {
+    ++S.NumCandidateConversionsPruned;
+    ImplicitConversionSequence ICS;
+    ICS.setBad(BadConversionSequence::no_conversion, From, ParamType);
+    return ICS;
+  }
+
+  unsigned Flags = (SuppressUserConversions ? 1 : 0) |
+                   (InOverloadResolution ? 2 : 0) | (AllowExplicit ? 4 : 0);
+  if (const ImplicitConversionSequence *Cached =
+          CandidateSet.getCachedConversion(From, ParamType, Flags)) {
+    ++S.NumCandidateConversionsReused;
+    return *Cached;
+  }
+
+  ++S.NumCandidateConversions;
+  ImplicitConversionSequence ICS =
+      TryCopyInitialization(S, From, ParamType, SuppressUserConversions,
+                            InOverloadResolution,
+                            /*AllowObjCWritebackConversion=*/
+                              S.getLangOpts().ObjCAutoRefCount,
+                            AllowExplicit);
+  CandidateSet.addCachedConversion(From, ParamType, Flags, ICS);
+  return ICS;
+}
+
 /// TryObjectArgumentInitialization - Try to initialize the object
 /// parameter of the given member function (@c Method) from the
 /// expression @p From.
@@ -5794,6 +5920,7 @@ Sema::AddOverloadCandidate(FunctionDecl *Function,
       !Proto->isVariadic()) {
     Candidate.Viable = false;
     Candidate.FailureKind = ovl_fail_too_many_arguments;
+    ++NumCandidatesRejectedByArity;
     return;
   }
 
@@ -5807,6 +5934,7 @@ Sema::AddOverloadCandidate(FunctionDecl *Function,
     // Not enough arguments.
     Candidate.Viable = false;
     Candidate.FailureKind = ovl_fail_too_few_arguments;
+    ++NumCandidatesRejectedByArity;
     return;
   }
 
@@ -5833,12 +5961,11 @@ Sema::AddOverloadCandidate(FunctionDecl *Function,
       // parameter of F.
       QualType ParamType = Proto->getParamType(ArgIdx);
       Candidate.Conversions[ArgIdx]
-        = TryCopyInitialization(*this, Args[ArgIdx], ParamType,
-                                SuppressUserConversions,
-                                /*InOverloadResolution=*/true,
-                                /*AllowObjCWritebackConversion=*/
-                                  getLangOpts().ObjCAutoRefCount,
-                                AllowExplicit);
+        = TryCandidateArgumentInitialization(*this, CandidateSet,
+                                             Args[ArgIdx], ParamType,
+                                             SuppressUserConversions,
+                                             /*InOverloadResolution=*/true,
+                                             AllowExplicit);
       if (Candidate.Conversions[ArgIdx].isBad()) {
         Candidate.Viable = false;
         Candidate.FailureKind = ovl_fail_bad_conversion;
@@ -6157,6 +6284,7 @@ Sema::AddMethodCandidate(CXXMethodDecl *Method, DeclAccessPair FoundDecl,
       !Proto->isVariadic()) {
     Candidate.Viable = false;
     Candidate.FailureKind = ovl_fail_too_many_arguments;
+    ++NumCandidatesRejectedByArity;
     return;
   }
 
@@ -6170,6 +6298,7 @@ Sema::AddMethodCandidate(CXXMethodDecl *Method, DeclAccessPair FoundDecl,
     // Not enough arguments.
     Candidate.Viable = false;
     Candidate.FailureKind = ovl_fail_too_few_arguments;
+    ++NumCandidatesRejectedByArity;
     return;
   }
 
@@ -6210,11 +6339,10 @@ Sema::AddMethodCandidate(CXXMethodDecl *Method, DeclAccessPair FoundDecl,
       // parameter of F.
       QualType ParamType = Proto->getParamType(ArgIdx);
       Candidate.Conversions[ArgIdx + 1]
-        = TryCopyInitialization(*this, Args[ArgIdx], ParamType,
-                                SuppressUserConversions,
-                                /*InOverloadResolution=*/true,
-                                /*AllowObjCWritebackConversion=*/
-                                  getLangOpts().ObjCAutoRefCount);
+        = TryCandidateArgumentInitialization(*this, CandidateSet,
+                                             Args[ArgIdx], ParamType,
+                                             SuppressUserConversions,
+                                             /*InOverloadResolution=*/true);
       if (Candidate.Conversions[ArgIdx + 1].isBad()) {
         Candidate.Viable = false;
         Candidate.FailureKind = ovl_fail_bad_conversion;
@@ -6649,6 +6777,7 @@ void Sema::AddSurrogateCandidate(CXXConversionDecl *Conversion,
   if (Args.size() > NumParams && !Proto->isVariadic()) {
     Candidate.Viable = false;
     Candidate.FailureKind = ovl_fail_too_many_arguments;
+    ++NumCandidatesRejectedByArity;
     return;
   }
 
@@ -6658,6 +6787,7 @@ void Sema::AddSurrogateCandidate(CXXConversionDecl *Conversion,
     // Not enough arguments.
     Candidate.Viable = false;
     Candidate.FailureKind = ovl_fail_too_few_arguments;
+    ++NumCandidatesRejectedByArity;
     return;
   }
 
@@ -6671,11 +6801,10 @@ void Sema::AddSurrogateCandidate(CXXConversionDecl *Conversion,
       // parameter of F.
       QualType ParamType = Proto->getParamType(ArgIdx);
       Candidate.Conversions[ArgIdx + 1]
-        = TryCopyInitialization(*this, Args[ArgIdx], ParamType,
-                                /*SuppressUserConversions=*/false,
-                                /*InOverloadResolution=*/false,
-                                /*AllowObjCWritebackConversion=*/
-                                  getLangOpts().ObjCAutoRefCount);
+        = TryCandidateArgumentInitialization(*this, CandidateSet,
+                                             Args[ArgIdx], ParamType,
+                                             /*SuppressUserConversions=*/false,
+                                             /*InOverloadResolution=*/false);
       if (Candidate.Conversions[ArgIdx + 1].isBad()) {
         Candidate.Viable = false;
         Candidate.FailureKind = ovl_fail_bad_conversion;
@@ -6799,12 +6928,10 @@ void Sema::AddBuiltinCandidate(QualType ResultTy, QualType *ParamTys,
       Candidate.Conversions[ArgIdx]
         = TryContextuallyConvertToBool(*this, Args[ArgIdx]);
     } else {
-      Candidate.Conversions[ArgIdx]
-        = TryCopyInitialization(*this, Args[ArgIdx], ParamTys[ArgIdx],
-                                ArgIdx == 0 && IsAssignmentOperator,
-                                /*InOverloadResolution=*/false,
-                                /*AllowObjCWritebackConversion=*/
-                                  getLangOpts().ObjCAutoRefCount);
+      Candidate.Conversions[ArgIdx] = TryCandidateArgumentInitialization(
+          *this, CandidateSet, Args[ArgIdx], ParamTys[ArgIdx],
+          ArgIdx == 0 && IsAssignmentOperator,
+          /*InOverloadResolution=*/false);
     }
     if (Candidate.Conversions[ArgIdx].isBad()) {
       Candidate.Viable = false;
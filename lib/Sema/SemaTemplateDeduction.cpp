@@ -3335,17 +3335,21 @@ Sema::TemplateDeductionResult Sema::DeduceTemplateArguments(
   //   parameter type (call it P) with the type of the corresponding argument
   //   of the call (call it A) as described below.
   unsigned CheckArgs = Args.size();
-  if (Args.size() < Function->getMinRequiredArguments() && !PartialOverloading)
+  if (Args.size() < Function->getMinRequiredArguments() &&
+      !PartialOverloading) {
+    ++NumCandidatesRejectedByArity;
     return TDK_TooFewArguments;
-  else if (TooManyArguments(NumParams, Args.size(), PartialOverloading)) {
+  } else if (TooManyArguments(NumParams, Args.size(), PartialOverloading)) {
     const FunctionProtoType *Proto
       = Function->getType()->getAs<FunctionProtoType>();
     if (Proto->isTemplateVariadic())
       /* Do nothing */;
     else if (Proto->isVariadic())
       CheckArgs = NumParams;
-    else
+    else {
+      ++NumCandidatesRejectedByArity;
       return TDK_TooManyArguments;
+    }
   }
 
   // The types of the parameters from which we will perform template argument
@@ -17,6 +17,8 @@
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Serialization/ASTDeserializationListener.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MD5.h"
 
 using namespace clang;
 
@@ -175,6 +177,15 @@ unsigned serialization::ComputeHash(Selector Sel) {
   return R;
 }
 
+uint64_t serialization::ComputeContentHash(StringRef Contents) {
+  llvm::MD5 Hasher;
+  Hasher.update(Contents);
+  llvm::MD5::MD5Result Result;
+  Hasher.final(Result);
+  uint64_t Hash = llvm::support::endian::read64le(Result);
+  return Hash ? Hash : 1;
+}
+
 const DeclContext *
 serialization::getDefinitiveDeclContext(const DeclContext *DC) {
   switch (DC->getDeclKind()) {
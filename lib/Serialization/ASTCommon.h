@@ -70,6 +70,12 @@ TypeID MakeTypeID(ASTContext &Context, QualType T, IdxForTypeTy IdxForType) {
 
 unsigned ComputeHash(Selector Sel);
 
+/// \brief Compute the hash of the contents of an input file recorded in AST
+/// files whose input files are validated by content.
+///
+/// The result is never zero, which stands for "no hash recorded".
+uint64_t ComputeContentHash(StringRef Contents);
+
 /// \brief Retrieve the "definitive" declaration that provides all of the
 /// visible entries for the given declaration context, if there is one.
 ///
@@ -1920,6 +1920,8 @@ ASTReader::readInputFileInfo(ModuleFile &F, unsigned ID) {
   R.StoredTime = static_cast<time_t>(Record[2]);
   R.Overridden = static_cast<bool>(Record[3]);
   R.Transient = static_cast<bool>(Record[4]);
+  R.ContentHash =
+      Record.size() > 6 ? Record[5] | (uint64_t(Record[6]) << 32) : 0;
   R.Filename = Blob;
   ResolveImportedPath(F, R.Filename);
   return R;
@@ -2005,14 +2007,24 @@ InputFile ASTReader::getInputFile(ModuleFile &F, unsigned ID, bool Complain) {
                             StoredSize, StoredTime);
   }
 
+  auto HasContentChanged = [&]() {
+    // A file whose contents were recorded is checked against them instead of
+    // its modification time.
+    if (!FI.ContentHash || DisableValidation)
+      return false;
+    bool Invalid = false;
+    llvm::MemoryBuffer *Buffer = SM.getMemoryBufferForFile(File, &Invalid);
+    return Invalid || ComputeContentHash(Buffer->getBuffer()) != FI.ContentHash;
+  };
+
   bool IsOutOfDate = false;
 
   // For an overridden file, there is nothing to validate.
   if (!Overridden && //
       (StoredSize != File->getSize() ||
        (StoredTime && StoredTime != File->getModificationTime() &&
-        !DisableValidation)
-       )) {
+        !DisableValidation) ||
+       HasContentChanged())) {
     if (Complain) {
       // Build a list of the PCH imports that got us here (in reverse).
       SmallVector<ModuleFile *, 4> ImportStack(1, &F);
@@ -2353,6 +2365,19 @@ ASTReader::ReadControlBlock(ModuleFile &F,
         ASTFileSignature StoredSignature = Record[Idx++];
         auto ImportedFile = ReadPath(F, Record, Idx);
 
+        // Implicit modules validated by content are named after their
+        // contents, and live in the same module cache directory as the
+        // implicit modules importing them, wherever that cache is now.
+        if (F.Kind == MK_ImplicitModule && ImportedKind == MK_ImplicitModule &&
+            PP.getHeaderSearchInfo()
+                .getHeaderSearchOpts()
+                .ValidateASTInputFilesContent) {
+          SmallString<128> Rebased(llvm::sys::path::parent_path(F.FileName));
+          llvm::sys::path::append(Rebased,
+                                  llvm::sys::path::filename(ImportedFile));
+          ImportedFile = Rebased.str();
+        }
+
         // If our client can't cope with us being out of date, we can't cope with
         // our dependency being missing.
         unsigned Capabilities = ClientLoadCapabilities;
@@ -2412,8 +2437,12 @@ ASTReader::ReadControlBlock(ModuleFile &F,
       Module *M = PP.getHeaderSearchInfo().lookupModule(F.ModuleName);
       if (M && M->Directory) {
         // If we're implicitly loading a module, the base directory can't
-        // change between the build and use.
-        if (F.Kind != MK_ExplicitModule) {
+        // change between the build and use, unless the module's input files
+        // are validated by content.
+        if (F.Kind != MK_ExplicitModule &&
+            !PP.getHeaderSearchInfo()
+                 .getHeaderSearchOpts()
+                 .ValidateASTInputFilesContent) {
           const DirectoryEntry *BuildDir =
               PP.getFileManager().getDirectory(Blob);
           if (!BuildDir || BuildDir != M->Directory) {
@@ -3414,6 +3443,7 @@ bool ASTReader::loadGlobalIndex() {
   
   // Try to load the global index.
   TriedLoadingGlobalIndex = true;
+  llvm::TimeRegion TimeLoading(GlobalIndexTimer.get());
   StringRef ModuleCachePath
     = getPreprocessor().getHeaderSearchInfo().getModuleCachePath();
   std::pair<GlobalModuleIndex *, GlobalModuleIndex::ErrorCode> Result
@@ -3651,12 +3681,17 @@ ASTReader::ASTReadResult ASTReader::ReadAST(StringRef FileName,
   if (DeserializationListener)
     DeserializationListener->ReaderInitialized(this);
 
+  // Translate the original source file IDs of the AST files we just loaded
+  // into file IDs of the source manager.
+  for (ImportedModule &M : Loaded) {
+    ModuleFile &F = *M.Mod;
+    if (F.OriginalSourceFileID.isValid())
+      F.OriginalSourceFileID = FileID::get(
+          F.SLocEntryBaseID + F.OriginalSourceFileID.getOpaqueValue() - 1);
+  }
+
   ModuleFile &PrimaryModule = ModuleMgr.getPrimaryModule();
   if (PrimaryModule.OriginalSourceFileID.isValid()) {
-    PrimaryModule.OriginalSourceFileID 
-      = FileID::get(PrimaryModule.SLocEntryBaseID
-                    + PrimaryModule.OriginalSourceFileID.getOpaqueValue() - 1);
-
     // If this AST file is a precompiled preamble, then set the
     // preamble file ID of the source manager to the file source file
     // from which the preamble was built.
@@ -6514,7 +6549,13 @@ Stmt *ASTReader::GetExternalDeclStmt(uint64_t Offset) {
   // Offset here is a global offset across the entire chain.
   RecordLocation Loc = getLocalBitOffset(Offset);
   Loc.F->DeclsCursor.JumpToBit(Loc.Offset);
-  return ReadStmtFromStream(*Loc.F);
+  Stmt *S = ReadStmtFromStream(*Loc.F);
+
+  // Keep track of the function bodies that were actually needed.
+  auto Body = LazyFunctionBodies.find(Offset);
+  if (Body != LazyFunctionBodies.end())
+    Body->second = Loc.F->DeclsCursor.GetCurrentBitNo() - Loc.Offset;
+  return S;
 }
 
 void ASTReader::FindExternalLexicalDecls(
@@ -6798,6 +6839,29 @@ void ASTReader::PrintStats() {
     std::fprintf(stderr, "  %u/%u statements read (%f%%)\n",
                  NumStatementsRead, TotalNumStatements,
                  ((float)NumStatementsRead/TotalNumStatements * 100));
+  if (!LazyFunctionBodies.empty()) {
+    // Measure the bodies that were never needed by skipping over them.
+    unsigned NumBodiesRead = 0;
+    uint64_t BodyBitsRead = 0, BodyBitsSkipped = 0;
+    for (const auto &Body : LazyFunctionBodies) {
+      if (Body.second) {
+        ++NumBodiesRead;
+        BodyBitsRead += Body.second;
+        continue;
+      }
+      RecordLocation Loc = getLocalBitOffset(Body.first);
+      SavedStreamPosition SavedPosition(Loc.F->DeclsCursor);
+      Loc.F->DeclsCursor.JumpToBit(Loc.Offset);
+      BodyBitsSkipped += SkipStmtFromStream(*Loc.F);
+    }
+    std::fprintf(stderr, "  %u/%u function bodies read (%f%%)\n",
+                 NumBodiesRead, (unsigned)LazyFunctionBodies.size(),
+                 ((float)NumBodiesRead/LazyFunctionBodies.size() * 100));
+    std::fprintf(stderr,
+                 "  %llu bytes of function bodies read, %llu bytes not read\n",
+                 (unsigned long long)(BodyBitsRead + 7) / 8,
+                 (unsigned long long)(BodyBitsSkipped + 7) / 8);
+  }
   if (TotalNumMacros)
     std::fprintf(stderr, "  %u/%u macros read (%f%%)\n",
                  NumMacrosRead, TotalNumMacros,
@@ -8446,14 +8510,18 @@ void ASTReader::finishPendingActions() {
     if (FunctionDecl *FD = dyn_cast<FunctionDecl>(PB->first)) {
       // FIXME: Check for =delete/=default?
       // FIXME: Complain about ODR violations here?
-      if (!getContext().getLangOpts().Modules || !FD->hasBody())
+      if (!getContext().getLangOpts().Modules || !FD->hasBody()) {
         FD->setLazyBody(PB->second);
+        LazyFunctionBodies.insert(std::make_pair(PB->second, 0));
+      }
       continue;
     }
 
     ObjCMethodDecl *MD = cast<ObjCMethodDecl>(PB->first);
-    if (!getContext().getLangOpts().Modules || !MD->hasBody())
+    if (!getContext().getLangOpts().Modules || !MD->hasBody()) {
       MD->setLazyBody(PB->second);
+      LazyFunctionBodies.insert(std::make_pair(PB->second, 0));
+    }
   }
   PendingBodies.clear();
 
@@ -8692,7 +8760,8 @@ ASTReader::ASTReader(
   bool AllowASTWithCompilerErrors,
   bool AllowConfigurationMismatch, bool ValidateSystemInputs,
   bool UseGlobalIndex,
-  std::unique_ptr<llvm::Timer> ReadTimer)
+  std::unique_ptr<llvm::Timer> ReadTimer,
+  std::unique_ptr<llvm::Timer> GlobalIndexTimer)
     : Listener(new PCHValidator(PP, *this)), DeserializationListener(nullptr),
       OwnsDeserializationListener(false), SourceMgr(PP.getSourceManager()),
       FileMgr(PP.getFileManager()), PCHContainerRdr(PCHContainerRdr),
@@ -8700,6 +8769,7 @@ ASTReader::ASTReader(
       Consumer(nullptr), ModuleMgr(PP.getFileManager(), PCHContainerRdr),
       DummyIdResolver(PP),
       ReadTimer(std::move(ReadTimer)),
+      GlobalIndexTimer(std::move(GlobalIndexTimer)),
       PragmaMSStructState(-1),
       PragmaMSPointersToMembersState(-1),
       isysroot(isysroot), DisableValidation(DisableValidation),
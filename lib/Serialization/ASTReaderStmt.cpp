@@ -3720,3 +3720,20 @@ Done:
   assert(StmtStack.size() == PrevNumStmts + 1 && "Extra expressions on stack!");
   return StmtStack.pop_back_val();
 }
+
+uint64_t ASTReader::SkipStmtFromStream(ModuleFile &F) {
+  llvm::BitstreamCursor &Cursor = F.DeclsCursor;
+  uint64_t StartBit = Cursor.GetCurrentBitNo();
+
+  // Like ReadStmtFromStream, stop at the first STMT_STOP record, but without
+  // building anything from the records before it.
+  while (true) {
+    llvm::BitstreamEntry Entry = Cursor.advanceSkippingSubblocks();
+    if (Entry.Kind != llvm::BitstreamEntry::Record)
+      break;
+    if ((StmtCode)Cursor.skipRecord(Entry.ID) == STMT_STOP)
+      break;
+  }
+
+  return Cursor.GetCurrentBitNo() - StartBit;
+}
@@ -57,6 +57,7 @@
 #include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadPool.h"
 #include <algorithm>
 #include <cstdio>
 #include <string.h>
@@ -1540,6 +1541,7 @@ namespace  {
     bool IsSystemFile;
     bool IsTransient;
     bool BufferOverridden;
+    uint64_t ContentHash;
   };
 } // end anonymous namespace
 
@@ -1557,6 +1559,8 @@ void ASTWriter::WriteInputFiles(SourceManager &SourceMgr,
   IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 32)); // Modification time
   IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 1)); // Overridden
   IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 1)); // Transient
+  IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32)); // Hash (low)
+  IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32)); // Hash (high)
   IFAbbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob)); // File name
   unsigned IFAbbrevCode = Stream.EmitAbbrev(IFAbbrev);
 
@@ -1580,6 +1584,15 @@ void ASTWriter::WriteInputFiles(SourceManager &SourceMgr,
     Entry.IsSystemFile = Cache->IsSystemFile;
     Entry.IsTransient = Cache->IsTransient;
     Entry.BufferOverridden = Cache->BufferOverridden;
+    Entry.ContentHash = 0;
+    if (HSOpts.ValidateASTInputFilesContent && !Cache->BufferOverridden) {
+      bool Invalid = false;
+      llvm::MemoryBuffer *Buffer =
+          Cache->getBuffer(PP->getDiagnostics(), SourceMgr, SourceLocation(),
+                           &Invalid);
+      if (!Invalid)
+        Entry.ContentHash = ComputeContentHash(Buffer->getBuffer());
+    }
     if (Cache->IsSystemFile)
       SortedFiles.push_back(Entry);
     else
@@ -1604,13 +1617,16 @@ void ASTWriter::WriteInputFiles(SourceManager &SourceMgr,
 
     // Emit size/modification time for this file.
     // And whether this file was overridden.
+    // And the hash of its contents, if we validate input files by content.
     RecordData::value_type Record[] = {
         INPUT_FILE,
         InputFileOffsets.size(),
         (uint64_t)Entry.File->getSize(),
         (uint64_t)getTimestampForOutput(Entry.File),
         Entry.BufferOverridden,
-        Entry.IsTransient};
+        Entry.IsTransient,
+        uint32_t(Entry.ContentHash),
+        uint32_t(Entry.ContentHash >> 32)};
 
     EmitRecordWithPath(IFAbbrevCode, Record, Entry.File->getName());
   }
@@ -1889,6 +1905,58 @@ void ASTWriter::WriteHeaderSearch(const HeaderSearch &HS) {
     free(const_cast<char *>(SavedStrings[I]));
 }
 
+namespace {
+/// \brief Compresses the contents of the files and buffers embedded in an AST
+/// file, a window of them at a time, on a thread pool.
+///
+/// Compression is by far the most expensive part of embedding the contents,
+/// and each buffer is compressed independently of the others, so the results
+/// do not depend on the number of threads. Only one window of compressed
+/// blobs is kept at a time.
+class EmbeddedBufferCompressor {
+  ArrayRef<StringRef> Blobs;
+  std::unique_ptr<llvm::ThreadPool> Pool;
+  unsigned WindowSize;
+  unsigned WindowStart;
+  std::vector<SmallString<0>> Window;
+
+  void compress(unsigned I) {
+    if (llvm::zlib::compress(Blobs[WindowStart + I], Window[I]) !=
+        llvm::zlib::StatusOK)
+      Window[I].clear();
+  }
+
+public:
+  EmbeddedBufferCompressor(ArrayRef<StringRef> Blobs, unsigned Jobs)
+      : Blobs(Blobs), WindowSize(1), WindowStart(0) {
+    if (Jobs > 1 && Blobs.size() > 1) {
+      Pool.reset(new llvm::ThreadPool(Jobs));
+      WindowSize = 4 * Jobs;
+    }
+  }
+
+  /// \brief Retrieve the compressed contents of the \p I'th blob, or an empty
+  /// string if it could not be compressed. Blobs must be retrieved in order.
+  const SmallString<0> &get(unsigned I) {
+    assert(I >= WindowStart && "compressed blobs retrieved out of order");
+    if (I - WindowStart >= Window.size()) {
+      WindowStart = I;
+      Window.clear();
+      Window.resize(std::min<size_t>(WindowSize, Blobs.size() - I));
+      for (unsigned J = 0, N = Window.size(); J != N; ++J) {
+        if (Pool)
+          Pool->async([this, J] { compress(J); });
+        else
+          compress(J);
+      }
+      if (Pool)
+        Pool->wait();
+    }
+    return Window[I - WindowStart];
+  }
+};
+} // end anonymous namespace
+
 /// \brief Writes the block containing the serialized form of the
 /// source manager.
 ///
@@ -1912,6 +1980,24 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
       CreateSLocBufferBlobAbbrev(Stream, true);
   unsigned SLocExpansionAbbrv = CreateSLocExpansionAbbrev(Stream);
 
+  // Collect the contents of the files and buffers we embed, in the order
+  // they are emitted below, so that they can be compressed ahead of time.
+  std::vector<StringRef> Blobs;
+  for (unsigned I = 1, N = SourceMgr.local_sloc_entry_size(); I != N; ++I) {
+    const SrcMgr::SLocEntry &SLoc = SourceMgr.getLocalSLocEntry(I);
+    if (!SLoc.isFile())
+      continue;
+    const SrcMgr::ContentCache *Content = SLoc.getFile().getContentCache();
+    if (Content->OrigEntry && !Content->BufferOverridden &&
+        !Content->IsTransient)
+      continue;
+    Blobs.push_back(
+        Content->getBuffer(PP.getDiagnostics(), PP.getSourceManager())
+            ->getBuffer());
+  }
+  EmbeddedBufferCompressor Compressor(Blobs, WriteJobs);
+  unsigned NextBlob = 0;
+
   // Write out the source location entry table. We skip the first
   // entry, which is always the same dummy entry.
   std::vector<uint32_t> SLocEntryOffsets;
@@ -2001,9 +2087,8 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
 
         // Compress the buffer if possible. We expect that almost all PCM
         // consumers will not want its contents.
-        SmallString<0> CompressedBuffer;
-        if (llvm::zlib::compress(Blob.drop_back(1), CompressedBuffer) ==
-            llvm::zlib::StatusOK) {
+        const SmallString<0> &CompressedBuffer = Compressor.get(NextBlob++);
+        if (!CompressedBuffer.empty()) {
           RecordData::value_type Record[] = {SM_SLOC_BUFFER_BLOB_COMPRESSED,
                                              Blob.size() - 1};
           Stream.EmitRecordWithBlob(SLocBufferBlobCompressedAbbrv, Record,
@@ -4071,9 +4156,10 @@ void ASTWriter::SetSelectorOffset(Selector Sel, uint32_t Offset) {
 ASTWriter::ASTWriter(
   llvm::BitstreamWriter &Stream,
   ArrayRef<llvm::IntrusiveRefCntPtr<ModuleFileExtension>> Extensions,
-  bool IncludeTimestamps)
+  bool IncludeTimestamps, unsigned WriteJobs)
     : Stream(Stream), Context(nullptr), PP(nullptr), Chain(nullptr),
       WritingModule(nullptr), IncludeTimestamps(IncludeTimestamps),
+      WriteJobs(WriteJobs),
       WritingAST(false), DoneWritingDeclsAndTypes(false),
       ASTHasCompilerErrors(false), FirstDeclID(NUM_PREDEF_DECL_IDS),
       NextDeclID(FirstDeclID), FirstTypeID(NUM_PREDEF_TYPE_IDS),
@@ -4128,12 +4214,22 @@ uint64_t ASTWriter::WriteAST(Sema &SemaRef, const std::string &OutputFile,
   Context = &SemaRef.Context;
   PP = &SemaRef.PP;
   this->WritingModule = WritingModule;
+
+  // Files validated by content are written without timestamps, so that they
+  // do not depend on when, or where, their inputs were checked out.
+  bool SavedIncludeTimestamps = IncludeTimestamps;
+  if (PP->getHeaderSearchInfo()
+          .getHeaderSearchOpts()
+          .ValidateASTInputFilesContent)
+    IncludeTimestamps = false;
+
   ASTFileSignature Signature =
       WriteASTCore(SemaRef, isysroot, OutputFile, WritingModule);
   Context = nullptr;
   PP = nullptr;
   this->WritingModule = nullptr;
   this->BaseDirectory.clear();
+  IncludeTimestamps = SavedIncludeTimestamps;
 
   WritingAST = false;
   return Signature;
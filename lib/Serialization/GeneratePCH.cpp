@@ -28,10 +28,10 @@ PCHGenerator::PCHGenerator(
   clang::Module *Module, StringRef isysroot,
   std::shared_ptr<PCHBuffer> Buffer,
   ArrayRef<llvm::IntrusiveRefCntPtr<ModuleFileExtension>> Extensions,
-  bool AllowASTWithErrors, bool IncludeTimestamps)
+  bool AllowASTWithErrors, bool IncludeTimestamps, unsigned WriteJobs)
     : PP(PP), OutputFile(OutputFile), Module(Module), isysroot(isysroot.str()),
       SemaPtr(nullptr), Buffer(Buffer), Stream(Buffer->Data),
-      Writer(Stream, Extensions, IncludeTimestamps),
+      Writer(Stream, Extensions, IncludeTimestamps, WriteJobs),
       AllowASTWithErrors(AllowASTWithErrors) {
   Buffer->IsComplete = false;
 }
@@ -18,6 +18,7 @@
 #include "clang/Serialization/ASTBitCodes.h"
 #include "clang/Serialization/GlobalModuleIndex.h"
 #include "clang/Serialization/Module.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallString.h"
@@ -25,10 +26,12 @@
 #include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/LockFileManager.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <cstdio>
 using namespace clang;
 using namespace serialization;
@@ -58,75 +61,71 @@ namespace {
 static const char * const IndexFileName = "modules.idx";
 
 /// \brief The global index file version.
-static const unsigned CurrentVersion = 1;
+static const unsigned CurrentVersion = 2;
 
 //----------------------------------------------------------------------------//
 // Global module index reader.
 //----------------------------------------------------------------------------//
 
-namespace {
-
-/// \brief Trait used to read the identifier index from the on-disk hash
-/// table.
-class IdentifierIndexReaderTrait {
-public:
-  typedef StringRef external_key_type;
-  typedef StringRef internal_key_type;
-  typedef SmallVector<unsigned, 2> data_type;
-  typedef unsigned hash_value_type;
-  typedef unsigned offset_type;
-
-  static bool EqualKey(const internal_key_type& a, const internal_key_type& b) {
-    return a == b;
-  }
-
-  static hash_value_type ComputeHash(const internal_key_type& a) {
-    return llvm::HashString(a);
-  }
-
-  static std::pair<unsigned, unsigned>
-  ReadKeyDataLength(const unsigned char*& d) {
-    using namespace llvm::support;
-    unsigned KeyLen = endian::readNext<uint16_t, little, unaligned>(d);
-    unsigned DataLen = endian::readNext<uint16_t, little, unaligned>(d);
-    return std::make_pair(KeyLen, DataLen);
-  }
-
-  static const internal_key_type&
-  GetInternalKey(const external_key_type& x) { return x; }
-
-  static const external_key_type&
-  GetExternalKey(const internal_key_type& x) { return x; }
-
-  static internal_key_type ReadKey(const unsigned char* d, unsigned n) {
-    return StringRef((const char *)d, n);
-  }
+// The identifier index starts with the number of identifiers, followed by a
+// (hash, offset) pair for each identifier, sorted by hash. Each offset points
+// at an entry made of the length of the identifier, the identifier, the
+// number of module files that know about it and their IDs, all as ULEB128.
+// Each ID is shifted left by one, with the low bit set if the module file
+// considers the identifier interesting.
+
+/// \brief Retrieve the hash of the \p I'th identifier in \p Index.
+static uint32_t getIdentifierHash(StringRef Index, unsigned I) {
+  using namespace llvm::support;
+  return endian::read<uint32_t, little, unaligned>(
+      Index.data() + sizeof(uint32_t) + 2 * sizeof(uint32_t) * I);
+}
 
-  static data_type ReadData(const internal_key_type& k,
-                            const unsigned char* d,
-                            unsigned DataLen) {
-    using namespace llvm::support;
+/// \brief Read the \p I'th identifier in \p Index into \p Name and, if
+/// \p IDs is non-null, the IDs of the module files that know about it.
+///
+/// \returns false if the entry is malformed, in which case the index is out
+/// of date.
+static bool readIdentifierEntry(StringRef Index, unsigned I, StringRef &Name,
+                                SmallVectorImpl<unsigned> *IDs) {
+  using namespace llvm::support;
+  uint32_t Offset = endian::read<uint32_t, little, unaligned>(
+      Index.data() + 2 * sizeof(uint32_t) * (I + 1));
+  if (Offset >= Index.size())
+    return false;
 
-    data_type Result;
-    while (DataLen > 0) {
-      unsigned ID = endian::readNext<uint32_t, little, unaligned>(d);
-      Result.push_back(ID);
-      DataLen -= 4;
+  const unsigned char *Data = (const unsigned char *)Index.data() + Offset;
+  const unsigned char *End = (const unsigned char *)Index.end();
+  unsigned N;
+  const char *Error = nullptr;
+  uint64_t Length = llvm::decodeULEB128(Data, &N, End, &Error);
+  if (Error)
+    return false;
+  Data += N;
+  if (Length > uint64_t(End - Data))
+    return false;
+  Name = StringRef((const char *)Data, Length);
+  Data += Length;
+
+  if (IDs) {
+    uint64_t NumIDs = llvm::decodeULEB128(Data, &N, End, &Error);
+    if (Error)
+      return false;
+    for (Data += N; NumIDs; --NumIDs) {
+      uint64_t ID = llvm::decodeULEB128(Data, &N, End, &Error);
+      if (Error)
+        return false;
+      IDs->push_back(ID);
+      Data += N;
     }
-
-    return Result;
   }
-};
-
-typedef llvm::OnDiskIterableChainedHashTable<IdentifierIndexReaderTrait>
-    IdentifierIndexTable;
-
+  return true;
 }
 
 GlobalModuleIndex::GlobalModuleIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer,
                                      llvm::BitstreamCursor Cursor)
-    : Buffer(std::move(Buffer)), IdentifierIndex(), NumIdentifierLookups(),
-      NumIdentifierLookupHits() {
+    : Buffer(std::move(Buffer)), IdentifierIndex(), NumIdentifiers(),
+      NumIdentifierLookups(), NumIdentifierLookupHits() {
   // Read the global index.
   bool InGlobalIndexBlock = false;
   bool Done = false;
@@ -215,21 +214,34 @@ GlobalModuleIndex::GlobalModuleIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer,
       break;
     }
 
-    case IDENTIFIER_INDEX:
-      // Wire up the identifier index.
-      if (Record[0]) {
-        IdentifierIndex = IdentifierIndexTable::Create(
-            (const unsigned char *)Blob.data() + Record[0],
-            (const unsigned char *)Blob.data() + sizeof(uint32_t),
-            (const unsigned char *)Blob.data(), IdentifierIndexReaderTrait());
-      }
+    case IDENTIFIER_INDEX: {
+      // Wire up the identifier index, provided that the table of hashes and
+      // offsets fits in it.
+      using namespace llvm::support;
+      if (Blob.size() < sizeof(uint32_t))
+        break;
+      uint32_t Count = endian::read<uint32_t, little, unaligned>(Blob.data());
+      if ((Blob.size() - sizeof(uint32_t)) / (2 * sizeof(uint32_t)) < Count)
+        break;
+      IdentifierIndex = Blob;
+      NumIdentifiers = Count;
       break;
     }
+    }
   }
 }
 
-GlobalModuleIndex::~GlobalModuleIndex() {
-  delete static_cast<IdentifierIndexTable *>(IdentifierIndex);
+GlobalModuleIndex::~GlobalModuleIndex() { }
+
+bool GlobalModuleIndex::identifierIndexIsWellFormed() const {
+  SmallVector<unsigned, 4> IDs;
+  for (unsigned I = 0; I != NumIdentifiers; ++I) {
+    IDs.clear();
+    StringRef Name;
+    if (!readIdentifierEntry(IdentifierIndex, I, Name, &IDs))
+      return false;
+  }
+  return true;
 }
 
 std::pair<GlobalModuleIndex *, GlobalModuleIndex::ErrorCode>
@@ -286,7 +298,7 @@ void GlobalModuleIndex::getModuleDependencies(
   Dependencies.clear();
   ArrayRef<unsigned> StoredDependencies = Modules[Known->second].Dependencies;
   for (unsigned I = 0, N = StoredDependencies.size(); I != N; ++I) {
-    if (ModuleFile *MF = Modules[I].File)
+    if (ModuleFile *MF = Modules[StoredDependencies[I]].File)
       Dependencies.push_back(MF);
   }
 }
@@ -295,25 +307,49 @@ bool GlobalModuleIndex::lookupIdentifier(StringRef Name, HitSet &Hits) {
   Hits.clear();
   
   // If there's no identifier index, there is nothing we can do.
-  if (!IdentifierIndex)
+  if (IdentifierIndex.empty())
     return false;
 
-  // Look into the identifier index.
+  // Look into the identifier index: find the first identifier with the same
+  // hash, then compare names.
   ++NumIdentifierLookups;
-  IdentifierIndexTable &Table
-    = *static_cast<IdentifierIndexTable *>(IdentifierIndex);
-  IdentifierIndexTable::iterator Known = Table.find(Name);
-  if (Known == Table.end()) {
-    return true;
+  uint32_t Hash = llvm::HashString(Name);
+  unsigned Lo = 0, Hi = NumIdentifiers;
+  while (Lo != Hi) {
+    unsigned Mid = Lo + (Hi - Lo) / 2;
+    if (getIdentifierHash(IdentifierIndex, Mid) < Hash)
+      Lo = Mid + 1;
+    else
+      Hi = Mid;
   }
 
-  SmallVector<unsigned, 2> ModuleIDs = *Known;
-  for (unsigned I = 0, N = ModuleIDs.size(); I != N; ++I) {
-    if (ModuleFile *MF = Modules[ModuleIDs[I]].File)
-      Hits.insert(MF);
+  SmallVector<unsigned, 4> ModuleIDs;
+  for (; Lo != NumIdentifiers && getIdentifierHash(IdentifierIndex, Lo) == Hash;
+       ++Lo) {
+    ModuleIDs.clear();
+    StringRef Found;
+    if (!readIdentifierEntry(IdentifierIndex, Lo, Found, &ModuleIDs)) {
+      // The index is out of date; look into all of the module files.
+      Hits.clear();
+      return false;
+    }
+    if (Found != Name)
+      continue;
+
+    // Only the module files that consider the identifier interesting are
+    // worth looking into.
+    for (unsigned I = 0, N = ModuleIDs.size(); I != N; ++I) {
+      unsigned ID = ModuleIDs[I] >> 1;
+      if (!(ModuleIDs[I] & 0x01) || ID >= Modules.size())
+        continue;
+      if (ModuleFile *MF = Modules[ID].File)
+        Hits.insert(MF);
+    }
+
+    ++NumIdentifierLookupHits;
+    return true;
   }
 
-  ++NumIdentifierLookupHits;
   return true;
 }
 
@@ -346,6 +382,12 @@ bool GlobalModuleIndex::loadedModuleFile(ModuleFile *File) {
 
 void GlobalModuleIndex::printStats() {
   std::fprintf(stderr, "*** Global Module Index Statistics:\n");
+  unsigned NumModules = 0;
+  for (auto &MI : Modules)
+    if (!MI.FileName.empty())
+      ++NumModules;
+  std::fprintf(stderr, "  %u module files and %u identifiers indexed\n",
+               NumModules, NumIdentifiers);
   if (NumIdentifierLookups) {
     fprintf(stderr, "  %u / %u identifier lookups succeeded (%f%%)\n",
             NumIdentifierLookupHits, NumIdentifierLookups,
@@ -354,6 +396,13 @@ void GlobalModuleIndex::printStats() {
   std::fprintf(stderr, "\n");
 }
 
+void GlobalModuleIndex::WriteStats::print() const {
+  std::fprintf(stderr, "*** Global Module Index Build Statistics:\n");
+  std::fprintf(stderr, "  %u module files carried over, %u module files read\n",
+               NumCarriedOver, NumRead);
+  std::fprintf(stderr, "\n");
+}
+
 LLVM_DUMP_METHOD void GlobalModuleIndex::dump() {
   llvm::errs() << "*** Global Module Index Dump:\n";
   llvm::errs() << "Module files:\n";
@@ -394,12 +443,12 @@ namespace {
     ModuleFilesMap ModuleFiles;
 
     /// \brief Mapping from identifiers to the list of module file IDs that
-    /// consider this identifier to be interesting.
-    typedef llvm::StringMap<SmallVector<unsigned, 2> > InterestingIdentifierMap;
+    /// know about this identifier, in the format of the identifier index.
+    typedef llvm::StringMap<SmallVector<unsigned, 2> > IdentifierMap;
 
-    /// \brief A mapping from all interesting identifiers to the set of module
-    /// files in which those identifiers are considered interesting.
-    InterestingIdentifierMap InterestingIdentifiers;
+    /// \brief A mapping from all identifiers to the set of module files that
+    /// know about them, and whether they consider them interesting.
+    IdentifierMap Identifiers;
     
     /// \brief Write the block-info block for the global module index file.
     void emitBlockInfoBlock(llvm::BitstreamWriter &Stream);
@@ -427,6 +476,26 @@ namespace {
     /// \returns true if an error occurred, false otherwise.
     bool loadModuleFile(const FileEntry *File);
 
+    /// \brief Add the given module file, which depends on \p Dependencies,
+    /// without loading it.
+    ///
+    /// \returns the ID of the module file.
+    unsigned addModuleFile(const FileEntry *File,
+                           ArrayRef<const FileEntry *> Dependencies) {
+      SmallVector<unsigned, 4> DependencyIDs;
+      for (const FileEntry *Dependency : Dependencies)
+        DependencyIDs.push_back(getModuleFileInfo(Dependency).ID);
+      ModuleFileInfo &Info = getModuleFileInfo(File);
+      Info.Dependencies.append(DependencyIDs.begin(), DependencyIDs.end());
+      return Info.ID;
+    }
+
+    /// \brief Note that the module file with the given ID knows about the
+    /// identifier \p Name.
+    void addIdentifier(StringRef Name, unsigned ID, bool IsInteresting) {
+      Identifiers[Name].push_back(ID << 1 | IsInteresting);
+    }
+
     /// \brief Write the index to the given bitstream.
     void writeIndex(llvm::BitstreamWriter &Stream);
   };
@@ -631,10 +700,7 @@ bool GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
                                                      DEnd = Table->data_end();
            D != DEnd; ++D) {
         std::pair<StringRef, bool> Ident = *D;
-        if (Ident.second)
-          InterestingIdentifiers[Ident.first].push_back(ID);
-        else
-          (void)InterestingIdentifiers[Ident.first];
+        addIdentifier(Ident.first, ID, Ident.second);
       }
     }
 
@@ -644,48 +710,6 @@ bool GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
   return false;
 }
 
-namespace {
-
-/// \brief Trait used to generate the identifier index as an on-disk hash
-/// table.
-class IdentifierIndexWriterTrait {
-public:
-  typedef StringRef key_type;
-  typedef StringRef key_type_ref;
-  typedef SmallVector<unsigned, 2> data_type;
-  typedef const SmallVector<unsigned, 2> &data_type_ref;
-  typedef unsigned hash_value_type;
-  typedef unsigned offset_type;
-
-  static hash_value_type ComputeHash(key_type_ref Key) {
-    return llvm::HashString(Key);
-  }
-
-  std::pair<unsigned,unsigned>
-  EmitKeyDataLength(raw_ostream& Out, key_type_ref Key, data_type_ref Data) {
-    using namespace llvm::support;
-    endian::Writer<little> LE(Out);
-    unsigned KeyLen = Key.size();
-    unsigned DataLen = Data.size() * 4;
-    LE.write<uint16_t>(KeyLen);
-    LE.write<uint16_t>(DataLen);
-    return std::make_pair(KeyLen, DataLen);
-  }
-  
-  void EmitKey(raw_ostream& Out, key_type_ref Key, unsigned KeyLen) {
-    Out.write(Key.data(), KeyLen);
-  }
-
-  void EmitData(raw_ostream& Out, key_type_ref Key, data_type_ref Data,
-                unsigned DataLen) {
-    using namespace llvm::support;
-    for (unsigned I = 0, N = Data.size(); I != N; ++I)
-      endian::Writer<little>(Out).write<uint32_t>(Data[I]);
-  }
-};
-
-}
-
 void GlobalModuleIndexBuilder::writeIndex(llvm::BitstreamWriter &Stream) {
   using namespace llvm;
   
@@ -728,36 +752,55 @@ void GlobalModuleIndexBuilder::writeIndex(llvm::BitstreamWriter &Stream) {
 
   // Write the identifier -> module file mapping.
   {
-    llvm::OnDiskChainedHashTableGenerator<IdentifierIndexWriterTrait> Generator;
-    IdentifierIndexWriterTrait Trait;
-
-    // Populate the hash table.
-    for (InterestingIdentifierMap::iterator I = InterestingIdentifiers.begin(),
-                                            IEnd = InterestingIdentifiers.end();
-         I != IEnd; ++I) {
-      Generator.insert(I->first(), I->second, Trait);
-    }
-    
-    // Create the on-disk hash table in a buffer.
+    using namespace llvm::support;
+
+    // Sort the identifiers by hash, and identifiers with the same hash by
+    // name so that the index does not depend on the order of the map.
+    typedef std::pair<uint32_t, const IdentifierMap::value_type *> HashedEntry;
+    std::vector<HashedEntry> Sorted;
+    Sorted.reserve(Identifiers.size());
+    for (const auto &Ident : Identifiers)
+      Sorted.push_back(HashedEntry(llvm::HashString(Ident.first()), &Ident));
+    std::sort(Sorted.begin(), Sorted.end(),
+              [](const HashedEntry &X, const HashedEntry &Y) {
+                if (X.first != Y.first)
+                  return X.first < Y.first;
+                return X.second->first() < Y.second->first();
+              });
+
+    // Write the table of hashes and offsets, and the entries after it.
     SmallString<4096> IdentifierTable;
-    uint32_t BucketOffset;
+    SmallString<4096> Entries;
     {
-      using namespace llvm::support;
       llvm::raw_svector_ostream Out(IdentifierTable);
-      // Make sure that no bucket is at offset 0
-      endian::Writer<little>(Out).write<uint32_t>(0);
-      BucketOffset = Generator.Emit(Out, Trait);
+      llvm::raw_svector_ostream EntriesOut(Entries);
+      endian::Writer<little> LE(Out);
+      uint64_t TableSize =
+          sizeof(uint32_t) + 2 * sizeof(uint32_t) * Sorted.size();
+      LE.write<uint32_t>(Sorted.size());
+      for (const HashedEntry &Entry : Sorted) {
+        LE.write<uint32_t>(Entry.first);
+        LE.write<uint32_t>(TableSize + EntriesOut.tell());
+
+        StringRef Name = Entry.second->first();
+        const SmallVector<unsigned, 2> &IDs = Entry.second->second;
+        encodeULEB128(Name.size(), EntriesOut);
+        EntriesOut << Name;
+        encodeULEB128(IDs.size(), EntriesOut);
+        for (unsigned ID : IDs)
+          encodeULEB128(ID, EntriesOut);
+      }
     }
+    IdentifierTable += Entries;
 
     // Create a blob abbreviation
     BitCodeAbbrev *Abbrev = new BitCodeAbbrev();
     Abbrev->Add(BitCodeAbbrevOp(IDENTIFIER_INDEX));
-    Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
     Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
     unsigned IDTableAbbrev = Stream.EmitAbbrev(Abbrev);
 
     // Write the identifier table
-    uint64_t Record[] = {IDENTIFIER_INDEX, BucketOffset};
+    uint64_t Record[] = {IDENTIFIER_INDEX};
     Stream.EmitRecordWithBlob(IDTableAbbrev, Record, IdentifierTable);
   }
 
@@ -767,7 +810,7 @@ void GlobalModuleIndexBuilder::writeIndex(llvm::BitstreamWriter &Stream) {
 GlobalModuleIndex::ErrorCode
 GlobalModuleIndex::writeIndex(FileManager &FileMgr,
                               const PCHContainerReader &PCHContainerRdr,
-                              StringRef Path) {
+                              StringRef Path, WriteStats *Stats) {
   llvm::SmallString<128> IndexPath;
   IndexPath += Path;
   llvm::sys::path::append(IndexPath, IndexFileName);
@@ -792,7 +835,53 @@ GlobalModuleIndex::writeIndex(FileManager &FileMgr,
   // The module index builder.
   GlobalModuleIndexBuilder Builder(FileMgr, PCHContainerRdr);
 
-  // Load each of the module files.
+  // Find the module files listed in the existing index, if any, that have
+  // not changed since it was written.
+  std::unique_ptr<GlobalModuleIndex> OldIndex(readIndex(Path).first);
+  llvm::BitVector Unchanged;
+  SmallVector<const FileEntry *, 16> OldFiles;
+  llvm::DenseMap<const FileEntry *, unsigned> OldIDs;
+  if (OldIndex && !OldIndex->IdentifierIndex.empty() &&
+      OldIndex->identifierIndexIsWellFormed()) {
+    unsigned NumOldModules = OldIndex->Modules.size();
+    Unchanged.resize(NumOldModules);
+    OldFiles.resize(NumOldModules);
+    for (unsigned I = 0; I != NumOldModules; ++I) {
+      const ModuleInfo &Info = OldIndex->Modules[I];
+      if (Info.FileName.empty())
+        continue;
+      const FileEntry *File = FileMgr.getFile(Info.FileName, /*openFile=*/false,
+                                              /*cacheFailure=*/false);
+      if (File && File->getSize() == Info.Size &&
+          File->getModificationTime() == Info.ModTime) {
+        OldFiles[I] = File;
+        Unchanged.set(I);
+      }
+    }
+
+    // A module file depending on a module file that changed has to be read
+    // again, so that the stale dependency is caught.
+    for (bool Changed = true; Changed;) {
+      Changed = false;
+      for (int I = Unchanged.find_first(); I != -1;
+           I = Unchanged.find_next(I)) {
+        for (unsigned Dep : OldIndex->Modules[I].Dependencies) {
+          if (Dep >= NumOldModules || !Unchanged[Dep]) {
+            Unchanged.reset(I);
+            Changed = true;
+            break;
+          }
+        }
+      }
+    }
+
+    for (int I = Unchanged.find_first(); I != -1; I = Unchanged.find_next(I))
+      OldIDs[OldFiles[I]] = I;
+  }
+
+  // Load each of the module files that changed, and carry over the others.
+  llvm::DenseMap<unsigned, unsigned> CarriedOverIDs;
+  WriteStats Counts;
   std::error_code EC;
   for (llvm::sys::fs::directory_iterator D(Path, EC), DEnd;
        D != DEnd && !EC;
@@ -813,9 +902,38 @@ GlobalModuleIndex::writeIndex(FileManager &FileMgr,
     if (!ModuleFile)
       continue;
 
+    // Carry over this module file if it has not changed.
+    auto Known = OldIDs.find(ModuleFile);
+    if (Known != OldIDs.end()) {
+      SmallVector<const FileEntry *, 4> Dependencies;
+      for (unsigned Dep : OldIndex->Modules[Known->second].Dependencies)
+        Dependencies.push_back(OldFiles[Dep]);
+      CarriedOverIDs[Known->second] =
+          Builder.addModuleFile(ModuleFile, Dependencies);
+      ++Counts.NumCarriedOver;
+      continue;
+    }
+
     // Load this module file.
     if (Builder.loadModuleFile(ModuleFile))
       return EC_IOError;
+    ++Counts.NumRead;
+  }
+
+  // Carry over the identifiers known to the module files we did not load.
+  if (!CarriedOverIDs.empty()) {
+    SmallVector<unsigned, 4> IDs;
+    for (unsigned I = 0, N = OldIndex->NumIdentifiers; I != N; ++I) {
+      IDs.clear();
+      StringRef Name;
+      if (!readIdentifierEntry(OldIndex->IdentifierIndex, I, Name, &IDs))
+        continue;
+      for (unsigned ID : IDs) {
+        auto Known = CarriedOverIDs.find(ID >> 1);
+        if (Known != CarriedOverIDs.end())
+          Builder.addIdentifier(Name, Known->second, ID & 0x01);
+      }
+    }
   }
 
   // The output buffer, into which the global index will be written.
@@ -854,36 +972,38 @@ GlobalModuleIndex::writeIndex(FileManager &FileMgr,
   }
 
   // We're done.
+  if (Stats)
+    *Stats = Counts;
   return EC_None;
 }
 
 namespace {
   class GlobalIndexIdentifierIterator : public IdentifierIterator {
-    /// \brief The current position within the identifier lookup table.
-    IdentifierIndexTable::key_iterator Current;
+    /// \brief The identifier index.
+    StringRef Index;
+
+    /// \brief The position of the next identifier within the index.
+    unsigned Current;
 
-    /// \brief The end position within the identifier lookup table.
-    IdentifierIndexTable::key_iterator End;
+    /// \brief The number of identifiers in the index.
+    unsigned End;
 
   public:
-    explicit GlobalIndexIdentifierIterator(IdentifierIndexTable &Idx) {
-      Current = Idx.key_begin();
-      End = Idx.key_end();
-    }
+    GlobalIndexIdentifierIterator(StringRef Index, unsigned NumIdentifiers)
+        : Index(Index), Current(0), End(NumIdentifiers) {}
 
     StringRef Next() override {
-      if (Current == End)
-        return StringRef();
-
-      StringRef Result = *Current;
-      ++Current;
-      return Result;
+      while (Current != End) {
+        StringRef Result;
+        if (readIdentifierEntry(Index, Current++, Result, nullptr) &&
+            !Result.empty())
+          return Result;
+      }
+      return StringRef();
     }
   };
 }
 
 IdentifierIterator *GlobalModuleIndex::createIdentifierIterator() const {
-  IdentifierIndexTable &Table =
-    *static_cast<IdentifierIndexTable *>(IdentifierIndex);
-  return new GlobalIndexIdentifierIterator(Table);
+  return new GlobalIndexIdentifierIterator(IdentifierIndex, NumIdentifiers);
 }
@@ -127,9 +127,14 @@ ModuleManager::addModule(StringRef FileName, ModuleKind Type,
         // ModuleManager it must be the same underlying file.
         // FIXME: Because FileManager::getFile() doesn't guarantee that it will
         // give us an open file, this may not be 100% reliable.
+        // The bitstream doesn't need a null terminator, so the file can be
+        // mapped rather than read; with a shared file system cache, every
+        // ASTReader in the process then uses the same image, and the offset
+        // tables (DeclOffsets, TypeOffsets, ...) that point into it.
         Buf = FileMgr.getBufferForFile(New->File,
                                        /*IsVolatile=*/false,
-                                       /*ShouldClose=*/false);
+                                       /*ShouldClose=*/false,
+                                       /*RequiresNullTerminator=*/false);
       }
 
       if (!Buf) {
@@ -232,9 +237,13 @@ void ModuleManager::removeModules(
 
     // Files that didn't make it through ReadASTCore successfully will be
     // rebuilt (or there was an error). Invalidate them so that we can load the
-    // new files that will be renamed over the old ones.
+    // new files that will be renamed over the old ones. Any of the others may
+    // be rebuilt too, so at least make sure that the shared file cache will
+    // not hand out their current contents again.
     if (LoadedSuccessfully.count(*victim) == 0)
       FileMgr.invalidateCache((*victim)->File);
+    else
+      FileMgr.invalidateSharedCache((*victim)->File->getName());
 
     delete *victim;
   }
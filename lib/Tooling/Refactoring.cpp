@@ -33,11 +33,27 @@ RefactoringTool::RefactoringTool(
 
 Replacements &RefactoringTool::getReplacements() { return Replace; }
 
+void RefactoringTool::addReplacements(const Replacements &Replaces) {
+  std::lock_guard<std::mutex> Guard(ReplaceLock);
+  Replace.insert(Replaces.begin(), Replaces.end());
+}
+
 int RefactoringTool::runAndSave(FrontendActionFactory *ActionFactory) {
   if (int Result = run(ActionFactory)) {
     return Result;
   }
+  return applyAndSave();
+}
+
+int RefactoringTool::runConcurrentlyAndSave(
+    FrontendActionFactory *ActionFactory, unsigned ThreadCount) {
+  if (int Result = runConcurrently(ActionFactory, ThreadCount)) {
+    return Result;
+  }
+  return applyAndSave();
+}
 
+int RefactoringTool::applyAndSave() {
   LangOptions DefaultLangOptions;
   IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
   TextDiagnosticPrinter DiagnosticPrinter(llvm::errs(), &*DiagOpts);
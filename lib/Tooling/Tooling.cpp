@@ -24,6 +24,7 @@
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Option/Option.h"
@@ -31,6 +32,9 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <utility>
 
 #define DEBUG_TYPE "clang-tooling"
@@ -267,6 +271,8 @@ bool ToolInvocation::run() {
     Invocation->getPreprocessorOpts().addRemappedFile(It.getKey(),
                                                       Input.release());
   }
+  if (IdentifierPool)
+    Invocation->getPreprocessorOpts().IdentifierPool = IdentifierPool;
   return runInvocation(BinaryName, Compilation.get(), Invocation.release(),
                        std::move(PCHContainerOps));
 }
@@ -329,6 +335,12 @@ ClangTool::ClangTool(const CompilationDatabase &Compilations,
 
 ClangTool::~ClangTool() {}
 
+void ClangTool::setSharedFileSystemCache(
+    IntrusiveRefCntPtr<SharedFileSystemCache> Cache) {
+  SharedCache = Cache;
+  Files->setSharedCache(std::move(Cache));
+}
+
 void ClangTool::mapVirtualFile(StringRef FilePath, StringRef Content) {
   MappedFileContents.push_back(std::make_pair(FilePath, Content));
 }
@@ -357,11 +369,45 @@ static void injectResourceDir(CommandLineArguments &Args, const char *Argv0,
                  CompilerInvocation::GetResourcesPath(Argv0, MainAddr));
 }
 
-int ClangTool::run(ToolAction *Action) {
-  // Exists solely for the purpose of lookup of the resource path.
-  // This just needs to be some symbol in the binary.
-  static int StaticSymbol;
+// Exists solely for the purpose of lookup of the resource path.
+// This just needs to be some symbol in the binary.
+static int StaticSymbol;
+
+void ClangTool::mapVirtualFilesForDirectory(StringRef Directory) {
+  // Absolute paths are global for all compile commands and are inserted once,
+  // keyed by "/". Relative mappings are added for each new working directory
+  // so they resolve to the correct paths. We never remove mappings but that
+  // should be fine.
+  bool Absolute = Directory == "/";
+  if (!SeenWorkingDirectories.insert(Directory).second)
+    return;
+  for (const auto &MappedFile : MappedFileContents)
+    if (llvm::sys::path::is_absolute(MappedFile.first) == Absolute)
+      InMemoryFileSystem->addFile(
+          MappedFile.first, 0,
+          llvm::MemoryBuffer::getMemBuffer(MappedFile.second));
+}
 
+std::vector<std::string>
+ClangTool::getAdjustedCommandLine(const CompileCommand &Command) {
+  std::vector<std::string> CommandLine = Command.CommandLine;
+  if (ArgsAdjuster)
+    CommandLine = ArgsAdjuster(CommandLine, Command.Filename);
+  assert(!CommandLine.empty());
+
+  // Add the resource dir based on the binary of this tool. argv[0] in the
+  // compilation database may refer to a different compiler and we want to
+  // pick up the very same standard library that compiler is using. The
+  // builtin headers in the resource dir need to match the exact clang
+  // version the tool is using.
+  // FIXME: On linux, GetMainExecutable is independent of the value of the
+  // first argument, thus allowing ClangTool and runToolOnCode to just
+  // pass in made-up names here. Make sure this works on other platforms.
+  injectResourceDir(CommandLine, "clang_tool", &StaticSymbol);
+  return CommandLine;
+}
+
+int ClangTool::run(ToolAction *Action) {
   llvm::SmallString<128> InitialDirectory;
   if (std::error_code EC = llvm::sys::fs::current_path(InitialDirectory))
     llvm::report_fatal_error("Cannot detect current path: " +
@@ -369,12 +415,7 @@ int ClangTool::run(ToolAction *Action) {
 
   // First insert all absolute paths into the in-memory VFS. These are global
   // for all compile commands.
-  if (SeenWorkingDirectories.insert("/").second)
-    for (const auto &MappedFile : MappedFileContents)
-      if (llvm::sys::path::is_absolute(MappedFile.first))
-        InMemoryFileSystem->addFile(
-            MappedFile.first, 0,
-            llvm::MemoryBuffer::getMemBuffer(MappedFile.second));
+  mapVirtualFilesForDirectory("/");
 
   bool ProcessingFailed = false;
   for (const auto &SourcePath : SourcePaths) {
@@ -412,29 +453,11 @@ int ClangTool::run(ToolAction *Action) {
                                  Twine(CompileCommand.Directory) + "\n!");
 
       // Now fill the in-memory VFS with the relative file mappings so it will
-      // have the correct relative paths. We never remove mappings but that
-      // should be fine.
-      if (SeenWorkingDirectories.insert(CompileCommand.Directory).second)
-        for (const auto &MappedFile : MappedFileContents)
-          if (!llvm::sys::path::is_absolute(MappedFile.first))
-            InMemoryFileSystem->addFile(
-                MappedFile.first, 0,
-                llvm::MemoryBuffer::getMemBuffer(MappedFile.second));
-
-      std::vector<std::string> CommandLine = CompileCommand.CommandLine;
-      if (ArgsAdjuster)
-        CommandLine = ArgsAdjuster(CommandLine, CompileCommand.Filename);
-      assert(!CommandLine.empty());
-
-      // Add the resource dir based on the binary of this tool. argv[0] in the
-      // compilation database may refer to a different compiler and we want to
-      // pick up the very same standard library that compiler is using. The
-      // builtin headers in the resource dir need to match the exact clang
-      // version the tool is using.
-      // FIXME: On linux, GetMainExecutable is independent of the value of the
-      // first argument, thus allowing ClangTool and runToolOnCode to just
-      // pass in made-up names here. Make sure this works on other platforms.
-      injectResourceDir(CommandLine, "clang_tool", &StaticSymbol);
+      // have the correct relative paths.
+      mapVirtualFilesForDirectory(CompileCommand.Directory);
+
+      std::vector<std::string> CommandLine =
+          getAdjustedCommandLine(CompileCommand);
 
       // FIXME: We need a callback mechanism for the tool writer to output a
       // customized message for each file.
@@ -442,6 +465,7 @@ int ClangTool::run(ToolAction *Action) {
       ToolInvocation Invocation(std::move(CommandLine), Action, Files.get(),
                                 PCHContainerOps);
       Invocation.setDiagnosticConsumer(DiagConsumer);
+      Invocation.setIdentifierPool(IdentifierPool);
 
       if (!Invocation.run()) {
         // FIXME: Diagnostics should be used instead.
@@ -458,6 +482,105 @@ int ClangTool::run(ToolAction *Action) {
   return ProcessingFailed ? 1 : 0;
 }
 
+int ClangTool::runConcurrently(ToolAction *Action, unsigned ThreadCount) {
+  if (ThreadCount == 0)
+    ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+#if !LLVM_ENABLE_THREADS
+  ThreadCount = 1;
+#endif
+  if (ThreadCount == 1)
+    return run(Action);
+
+  llvm::SmallString<128> InitialDirectory;
+  if (std::error_code EC = llvm::sys::fs::current_path(InitialDirectory))
+    llvm::report_fatal_error("Cannot detect current path: " +
+                             Twine(EC.message()));
+
+  mapVirtualFilesForDirectory("/");
+
+  // Query the compilation database up front, on this thread. Compile commands
+  // are grouped by working directory: the working directory is process-wide
+  // state, so only commands sharing a directory can run at the same time.
+  struct PendingInvocation {
+    std::string File;
+    std::vector<std::string> CommandLine;
+  };
+  llvm::MapVector<StringRef, std::vector<PendingInvocation>> ByDirectory;
+  std::vector<CompileCommand> AllCommands;
+  std::vector<std::string> AllFiles;
+  for (const auto &SourcePath : SourcePaths) {
+    std::string File(getAbsolutePath(SourcePath));
+    std::vector<CompileCommand> CompileCommandsForFile =
+        Compilations.getCompileCommands(File);
+    if (CompileCommandsForFile.empty()) {
+      llvm::errs() << "Skipping " << File << ". Compile command not found.\n";
+      continue;
+    }
+    for (CompileCommand &CompileCommand : CompileCommandsForFile) {
+      AllCommands.push_back(std::move(CompileCommand));
+      AllFiles.push_back(File);
+    }
+  }
+  for (unsigned I = 0, E = AllCommands.size(); I != E; ++I)
+    ByDirectory[AllCommands[I].Directory].push_back(
+        {AllFiles[I], getAdjustedCommandLine(AllCommands[I])});
+
+  std::mutex OutputLock;
+  bool ProcessingFailed = false;
+  for (auto &DirectoryAndInvocations : ByDirectory) {
+    StringRef Directory = DirectoryAndInvocations.first;
+    std::vector<PendingInvocation> &Invocations =
+        DirectoryAndInvocations.second;
+
+    if (OverlayFileSystem->setCurrentWorkingDirectory(Directory))
+      llvm::report_fatal_error("Cannot chdir into \"" + Twine(Directory) +
+                               "\n!");
+    mapVirtualFilesForDirectory(Directory);
+
+    // Each worker owns its FileManager, which is not thread-safe, and reuses
+    // it for all the translation units it processes; only the shared cache,
+    // if any, is shared. The underlying overlay and in-memory file systems
+    // are only read while the workers run.
+    std::atomic<unsigned> NextInvocation(0);
+    auto Worker = [&] {
+      llvm::IntrusiveRefCntPtr<FileManager> WorkerFiles(
+          new FileManager(FileSystemOptions(), OverlayFileSystem));
+      WorkerFiles->setSharedCache(SharedCache);
+      for (unsigned I = NextInvocation++; I < Invocations.size();
+           I = NextInvocation++) {
+        DEBUG({
+          std::lock_guard<std::mutex> Guard(OutputLock);
+          llvm::dbgs() << "Processing: " << Invocations[I].File << ".\n";
+        });
+        ToolInvocation Invocation(std::move(Invocations[I].CommandLine),
+                                  Action, WorkerFiles.get(), PCHContainerOps);
+        Invocation.setDiagnosticConsumer(DiagConsumer);
+        Invocation.setIdentifierPool(IdentifierPool);
+        if (!Invocation.run()) {
+          std::lock_guard<std::mutex> Guard(OutputLock);
+          llvm::errs() << "Error while processing " << Invocations[I].File
+                       << ".\n";
+          ProcessingFailed = true;
+        }
+      }
+    };
+
+    std::vector<std::thread> Threads;
+    unsigned NumThreads =
+        std::min<size_t>(ThreadCount, Invocations.size());
+    for (unsigned I = 1; I < NumThreads; ++I)
+      Threads.emplace_back(Worker);
+    Worker();
+    for (std::thread &T : Threads)
+      T.join();
+
+    if (OverlayFileSystem->setCurrentWorkingDirectory(InitialDirectory.c_str()))
+      llvm::report_fatal_error("Cannot chdir into \"" +
+                               Twine(InitialDirectory) + "\n!");
+  }
+  return ProcessingFailed ? 1 : 0;
+}
+
 namespace {
 
 class ASTBuilderAction : public ToolAction {
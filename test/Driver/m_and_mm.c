@@ -1,3 +1,12 @@
 // RUN: %clang -### \
 // RUN:   -M -MM %s 2> %t
 // RUN: not grep '"-sys-header-deps"' %t
+
+// Dependency-only preprocessing skips everything but directives, unless
+// modules may be imported by declarations.
+// RUN: %clang -### -M %s 2>&1 | FileCheck --check-prefix=DIRECTIVES %s
+// DIRECTIVES: "-Eonly"
+// DIRECTIVES-SAME: "-dependency-directives-only"
+// RUN: %clang -### -M -fmodules %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=MODULES %s
+// MODULES-NOT: "-dependency-directives-only"
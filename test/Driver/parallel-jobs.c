@@ -0,0 +1,27 @@
+// Check the -j / --parallel-jobs= driver options.
+//
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cp %s %t/a.c && cp %s %t/b.c && cp %s %t/c.c
+// RUN: cd %t && %clang -fsyntax-only -j 2 a.c b.c c.c 2>&1 \
+// RUN:   | FileCheck --allow-empty --check-prefix=CHECK-OK %s
+// RUN: cd %t && %clang -c --parallel-jobs=3 a.c b.c c.c
+// RUN: test -f %t/a.o && test -f %t/b.o && test -f %t/c.o
+// CHECK-OK-NOT: error
+//
+// Failures are reported in input order, and independent commands that are
+// already running when one fails still complete.
+// RUN: echo "int f(void) { return undeclared; }" > %t/bad.c
+// RUN: rm -f %t/a.o
+// RUN: cd %t && not %clang -c -j4 bad.c a.c 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-FAIL %s
+// RUN: test -f %t/a.o && test ! -f %t/bad.o
+// CHECK-FAIL: bad.c:1:{{[0-9]+}}: error: use of undeclared identifier 'undeclared'
+//
+// RUN: not %clang -fsyntax-only -j0 %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-INVALID %s
+// RUN: not %clang -fsyntax-only --parallel-jobs=many %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-INVALID-EQ %s
+// CHECK-INVALID: error: invalid integral value '0' in '-j0'
+// CHECK-INVALID-EQ: error: invalid integral value 'many' in '--parallel-jobs=many'
+
+int parallel_jobs_test;
@@ -0,0 +1,2 @@
+template <typename T> struct S { T t; };
+template <typename T> T f(T t) { return t; }
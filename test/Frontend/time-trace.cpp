@@ -0,0 +1,29 @@
+// RUN: %clang_cc1 -std=c++11 -emit-llvm -o %t.ll -ftime-trace=%t.json -ftime-trace-granularity=0 %s
+// RUN: FileCheck %s < %t.json
+// RUN: FileCheck -check-prefix=NESTING %s < %t.json
+
+#include "Inputs/time-trace.h"
+
+S<int> s;
+int i = f(1);
+
+// CHECK: "traceEvents"
+// CHECK-DAG: "name": "Source", "args": { "detail": "{{.*}}time-trace.h" }
+// CHECK-DAG: "name": "InstantiateClass", "args": { "detail": "S<int>" }
+// CHECK-DAG: "name": "InstantiateFunction", "args": { "detail": "f<int>" }
+// CHECK-DAG: "name": "CodeGenFunction", "args": { "detail": "f<int>" }
+// CHECK-DAG: "name": "Frontend", "args": { "detail": "" }
+// CHECK-DAG: "name": "Backend", "args": { "detail": "" }
+// CHECK-DAG: "name": "Total InstantiateClass", "args": { "count": 1 }
+// CHECK-DAG: "name": "Total InstantiateFunction", "args": { "count": 1 }
+// CHECK: "name": "process_name"
+
+// Intervals are written as they end, so those nested in another one come
+// before it. The header is entered before the first declaration is parsed,
+// but still within the Frontend interval.
+// NESTING: "name": "Source", "args": { "detail": "{{.*}}time-trace.h" }
+// NESTING: "name": "InstantiateClass", "args": { "detail": "S<int>" }
+// NESTING: "name": "InstantiateFunction", "args": { "detail": "f<int>" }
+// NESTING: "name": "Frontend", "args": { "detail": "" }
+// NESTING: "name": "Backend", "args": { "detail": "" }
+// NESTING: "name": "ExecuteCompiler", "args": { "detail": "" }
@@ -0,0 +1 @@
+int in_decls_header;
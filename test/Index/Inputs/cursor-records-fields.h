@@ -0,0 +1 @@
+int in_fields_header;
@@ -0,0 +1 @@
+int fromHeader(void); int fromHeader2(void);
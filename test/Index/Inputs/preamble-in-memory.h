@@ -0,0 +1 @@
+int fromHeader(void);
@@ -0,0 +1,13 @@
+#include "complete-preamble.h"
+void f() {
+  std::
+}
+
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_COMPLETION_SNAPSHOT=1 \
+// RUN:   c-index-test -code-completion-at=%s:3:8 %s | FileCheck %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_COMPLETION_SNAPSHOT=1 \
+// RUN:     CINDEXTEST_PREAMBLE_IN_MEMORY=1 \
+// RUN:   c-index-test -code-completion-at=%s:3:8 %s | FileCheck %s
+
+// CHECK: {ResultType void}{TypedText wibble}{LeftParen (}{RightParen )} (50)
+// CHECK: Snapshot version: 2
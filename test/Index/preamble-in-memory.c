@@ -0,0 +1,15 @@
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_FAILONERROR=1 \
+// RUN:     CINDEXTEST_PREAMBLE_IN_MEMORY=1 \
+// RUN:   c-index-test -test-load-source-reparse 3 all \
+// RUN:     -remap-file-2="%S/Inputs/preamble-in-memory.h,%S/Inputs/preamble-in-memory-2.h" \
+// RUN:     -- %s | FileCheck %s
+
+#include "Inputs/preamble-in-memory.h"
+
+int useHeader(void) {
+  return fromHeader();
+}
+
+// CHECK: preamble-in-memory.h:1:5: FunctionDecl=fromHeader:1:5
+// CHECK: preamble-in-memory.h:1:27: FunctionDecl=fromHeader2:1:27
+// CHECK: preamble-in-memory.c:9:5: FunctionDecl=useHeader:9:5 (Definition)
@@ -0,0 +1,24 @@
+struct S { int x; };
+int f(struct S *s) { return s->x; }
+
+// RUN: c-index-test -test-print-cursor-records %s | FileCheck %s
+// CHECK: 0: StructDecl=S [1:1 - 1:20] [parent=-1] [usr=c:@S@S] [referenced=0]
+// CHECK: 1: FieldDecl=x [1:12 - 1:17] [parent=0] [usr=c:@S@S@FI@x] [referenced=1]
+// CHECK: 2: FunctionDecl=f [2:1 - 2:36] [parent=-1] [usr=c:@F@f] [referenced=2]
+// CHECK: 3: ParmDecl=s [2:7 - 2:18] [parent=2] [usr={{.*}}] [referenced=3]
+// CHECK: 4: TypeRef=struct S [2:14 - 2:15] [parent=3] [referenced=0]
+// CHECK: 5: CompoundStmt= [2:20 - 2:36] [parent=2]
+// CHECK: MemberRefExpr=x [2:29 - 2:33] [parent={{[0-9]+}}] [referenced=1]
+// CHECK: DeclRefExpr=s [2:29 - 2:30] [parent={{[0-9]+}}] [referenced=3]
+
+// Only the cursors at the top level are filtered by file: the fields of T are
+// described even though they start in another file.
+#include "Inputs/cursor-records-decls.h"
+struct T {
+#include "Inputs/cursor-records-fields.h"
+};
+
+// CHECK-NOT: VarDecl=in_decls_header
+// CHECK: [[T:[0-9]+]]: StructDecl=T [17:1 - 19:2] [parent=-1]
+// CHECK-NEXT: FieldDecl=in_fields_header [1:1 - 1:21] [parent=[[T]]]
+// CHECK-NOT: in_decls_header
@@ -0,0 +1 @@
+int fromA(void);
@@ -0,0 +1 @@
+int fromB(void);
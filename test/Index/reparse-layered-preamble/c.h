@@ -0,0 +1 @@
+int fromC0(void);
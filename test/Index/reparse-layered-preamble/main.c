@@ -0,0 +1,49 @@
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_FAILONERROR=1 \
+// RUN:     LIBCLANG_LAYERED_PREAMBLE=1 \
+// RUN:   c-index-test -test-load-source-reparse 3 all \
+// RUN:     -remap-file-1="%S/c.h,%S/c.h-1" -remap-file-2="%S/c.h,%S/c.h-2" \
+// RUN:     -- %s | FileCheck %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_FAILONERROR=1 \
+// RUN:     LIBCLANG_LAYERED_PREAMBLE=1 \
+// RUN:   c-index-test -test-load-source-reparse 3 local \
+// RUN:     -remap-file-1="%S/c.h,%S/c.h-1" -remap-file-2="%S/c.h,%S/c.h-2" \
+// RUN:     -- %s -Xclang -print-stats 2>&1 \
+// RUN:   | FileCheck -check-prefix=STATS %s
+// RUN: env CINDEXTEST_EDITING=1 CINDEXTEST_FAILONERROR=1 \
+// RUN:   c-index-test -test-load-source-reparse 3 local \
+// RUN:     -remap-file-1="%S/c.h,%S/c.h-1" -remap-file-2="%S/c.h,%S/c.h-2" \
+// RUN:     -- %s -Xclang -print-stats 2>&1 \
+// RUN:   | FileCheck -check-prefix=UNLAYERED %s
+
+// The first reparse builds the preamble. The second one splits it before the
+// inclusion of c.h, and the third one only rebuilds the part after it. Without
+// layering, each reparse rebuilds the whole preamble.
+
+#include "a.h"
+#include "b.h"
+#include "c.h"
+
+int useAll(void) {
+  return fromA() + fromB();
+}
+
+// CHECK: a.h:1:5: FunctionDecl=fromA:1:5
+// CHECK: b.h:1:5: FunctionDecl=fromB:1:5
+// CHECK-NOT: fromC0
+// CHECK-NOT: fromC1
+// CHECK: c.h:1:5: FunctionDecl=fromC2:1:5
+// CHECK: main.c:26:5: FunctionDecl=useAll:26:5 (Definition)
+
+// STATS: *** Preamble Stats:
+// STATS-NEXT: 1 preambles precompiled, 0 base layers precompiled, 0 base layers reused.
+// STATS: *** Preamble Stats:
+// STATS-NEXT: 2 preambles precompiled, 1 base layers precompiled, 0 base layers reused.
+// STATS: *** Preamble Stats:
+// STATS-NEXT: 3 preambles precompiled, 1 base layers precompiled, 1 base layers reused.
+
+// UNLAYERED: *** Preamble Stats:
+// UNLAYERED-NEXT: 1 preambles precompiled, 0 base layers precompiled, 0 base layers reused.
+// UNLAYERED: *** Preamble Stats:
+// UNLAYERED-NEXT: 2 preambles precompiled, 0 base layers precompiled, 0 base layers reused.
+// UNLAYERED: *** Preamble Stats:
+// UNLAYERED-NEXT: 3 preambles precompiled, 0 base layers precompiled, 0 base layers reused.
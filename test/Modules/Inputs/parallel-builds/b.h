@@ -0,0 +1 @@
+int parallel_b;
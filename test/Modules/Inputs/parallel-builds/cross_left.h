@@ -0,0 +1,3 @@
+#include "cross_left_dep.h"
+#include "cross_right_dep.h"
+int cross_left;
@@ -0,0 +1 @@
+int cross_left_dep;
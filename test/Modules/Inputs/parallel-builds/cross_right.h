@@ -0,0 +1,4 @@
+#include "cross_right_dep.h"
+#include "cross_left_dep.h"
+#include "cross_left.h"
+int cross_right;
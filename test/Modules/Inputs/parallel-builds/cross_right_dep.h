@@ -0,0 +1 @@
+int cross_right_dep;
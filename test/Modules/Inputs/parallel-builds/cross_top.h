@@ -0,0 +1,3 @@
+#include "cross_left.h"
+#include "cross_right.h"
+int cross_top;
@@ -0,0 +1 @@
+int diamond_base;
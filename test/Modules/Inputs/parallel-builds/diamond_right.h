@@ -0,0 +1,2 @@
+#include "diamond_base.h"
+int diamond_right;
@@ -0,0 +1,3 @@
+#include "diamond_left.h"
+#include "diamond_right.h"
+int diamond_top;
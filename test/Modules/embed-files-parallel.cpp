@@ -0,0 +1,39 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: echo 'module a { header "a.h" header "b.h" header "c.h" header "d.h" header "e.h" header "f.h" header "g.h" header "h.h" header "i.h" header "j.h" }' > %t/modulemap
+// RUN: echo 'extern int a;' > %t/a.h
+// RUN: echo 'extern int b;' > %t/b.h
+// RUN: echo 'extern int c;' > %t/c.h
+// RUN: echo 'extern int d;' > %t/d.h
+// RUN: echo 'extern int e;' > %t/e.h
+// RUN: echo 'extern int f;' > %t/f.h
+// RUN: echo 'extern int g;' > %t/g.h
+// RUN: echo 'extern int h;' > %t/h.h
+// RUN: echo 'extern int i;' > %t/i.h
+// RUN: echo 'extern int j;' > %t/j.h
+
+// Compressing the embedded files on several threads gives the same module
+// file as compressing them one at a time, whether they all fit in one window
+// of buffers compressed together or not.
+// RUN: %clang_cc1 -fmodules -fno-implicit-modules -I%t -fmodules-embed-all-files %t/modulemap -fmodule-name=a -x c++ -emit-module -o %t/a.pcm
+// RUN: %clang_cc1 -fmodules -fno-implicit-modules -I%t -fmodules-embed-all-files %t/modulemap -fmodule-name=a -x c++ -emit-module -fpch-write-jobs=1 -o %t/a-serial.pcm
+// RUN: %clang_cc1 -fmodules -fno-implicit-modules -I%t -fmodules-embed-all-files %t/modulemap -fmodule-name=a -x c++ -emit-module -fpch-write-jobs=2 -o %t/a-windows.pcm
+// RUN: %clang_cc1 -fmodules -fno-implicit-modules -I%t -fmodules-embed-all-files %t/modulemap -fmodule-name=a -x c++ -emit-module -fpch-write-jobs=4 -o %t/a-parallel.pcm
+// RUN: diff %t/a.pcm %t/a-serial.pcm
+// RUN: diff %t/a.pcm %t/a-windows.pcm
+// RUN: diff %t/a.pcm %t/a-parallel.pcm
+
+// RUN: rm %t/a.h %t/b.h %t/c.h %t/d.h %t/e.h %t/f.h %t/g.h %t/h.h %t/i.h %t/j.h
+// RUN: %clang_cc1 -fmodules -fno-implicit-modules -I%t -fmodule-map-file=%t/modulemap -fmodule-file=%t/a-windows.pcm %s -verify
+// expected-no-diagnostics
+#include "a.h"
+#include "b.h"
+#include "c.h"
+#include "d.h"
+#include "e.h"
+#include "f.h"
+#include "g.h"
+#include "h.h"
+#include "i.h"
+#include "j.h"
+int *p[] = {&a, &b, &c, &d, &e, &f, &g, &h, &i, &j};
@@ -0,0 +1,39 @@
+// RUN: rm -rf %t
+// RUN: mkdir -p %t/include
+// RUN: cp %S/Inputs/Modified/A.h %S/Inputs/Modified/B.h %t/include
+// RUN: echo 'int getC();' > %t/include/C.h
+// RUN: cat %S/Inputs/Modified/module.map > %t/include/module.map
+// RUN: echo 'module ModC { header "C.h" }' >> %t/include/module.map
+
+// Build the modules and the global module index.
+// RUN: %clang_cc1 -fdisable-module-hash -fmodules-cache-path=%t/cache -fmodules -fimplicit-module-maps -I %t/include %s -verify -print-stats 2>&1 | FileCheck --check-prefix=FIRST-BUILD %s
+// RUN: ls %t/cache | grep modules.idx
+// RUN: %clang_cc1 -fdisable-module-hash -fmodules-cache-path=%t/cache -fmodules -fimplicit-module-maps -I %t/include %s -verify -print-stats 2>&1 | FileCheck %s
+
+// Modify ModA, which rebuilds ModA and ModB. The index is rebuilt with ModC
+// carried over, and still knows about all three modules.
+// RUN: echo 'int getA(); int getA2();' > %t/include/A.h
+// RUN: %clang_cc1 -fdisable-module-hash -fmodules-cache-path=%t/cache -fmodules -fimplicit-module-maps -I %t/include %s -verify -DUSE_A2 -print-stats 2>&1 | FileCheck --check-prefix=REBUILD %s
+// RUN: %clang_cc1 -fdisable-module-hash -fmodules-cache-path=%t/cache -fmodules -fimplicit-module-maps -I %t/include %s -verify -DUSE_A2 -print-stats 2>&1 | FileCheck %s
+
+// expected-no-diagnostics
+@import ModB;
+@import ModC;
+
+// CHECK: *** Global Module Index Statistics:
+// CHECK-NEXT: 3 module files and {{[0-9]+}} identifiers indexed
+// CHECK-NOT: Global Module Index Build Statistics
+
+// FIRST-BUILD: *** Global Module Index Build Statistics:
+// FIRST-BUILD-NEXT: 0 module files carried over, 3 module files read
+
+// REBUILD: *** Global Module Index Build Statistics:
+// REBUILD-NEXT: 1 module files carried over, 2 module files read
+
+int getValue() {
+#ifdef USE_A2
+  return getA2() + getB() + getC();
+#else
+  return getA() + getB() + getC();
+#endif
+}
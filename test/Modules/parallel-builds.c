@@ -0,0 +1,94 @@
+// Building ParallelTop schedules builds of the modules it exports, which run
+// alongside it.
+
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t \
+// RUN:            -fmodules-build-jobs=4 -I %S/Inputs/parallel-builds \
+// RUN:            -fsyntax-only %s -Rmodule-build -print-stats 2>&1 \
+// RUN:   | FileCheck %s
+// RUN: ls %t/*/ParallelA-*.pcm %t/*/ParallelB-*.pcm %t/*/ParallelTop-*.pcm
+
+// The module cache is usable as usual afterwards.
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t \
+// RUN:            -fmodules-build-jobs=4 -I %S/Inputs/parallel-builds \
+// RUN:            -fsyntax-only %s -Rmodule-build 2>&1 \
+// RUN:   | FileCheck -allow-empty -check-prefix=NO-REBUILD %s
+
+// Without extra jobs, nothing is scheduled.
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t \
+// RUN:            -fmodules-build-jobs=1 -I %S/Inputs/parallel-builds \
+// RUN:            -fsyntax-only %s -print-stats 2>&1 \
+// RUN:   | FileCheck -check-prefix=SERIAL %s
+
+// Modules shared by several scheduled builds are built once.
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t \
+// RUN:            -fmodules-build-jobs=4 -I %S/Inputs/parallel-builds \
+// RUN:            -fsyntax-only %s -DDIAMOND -print-stats 2>&1 \
+// RUN:   | FileCheck -check-prefix=DIAMOND %s
+// RUN: ls %t/*/DiamondBase-*.pcm %t/*/DiamondLeft-*.pcm \
+// RUN:    %t/*/DiamondRight-*.pcm %t/*/DiamondTop-*.pcm
+
+// A scheduled build that imports a module still being built by the
+// compilation that scheduled it fails right away instead of waiting for the
+// module's lock, and the cycle is diagnosed as usual.
+// RUN: rm -rf %t
+// RUN: not %clang_cc1 -fmodules -fimplicit-module-maps \
+// RUN:            -fmodules-cache-path=%t -fmodules-build-jobs=4 \
+// RUN:            -I %S/Inputs/parallel-builds -fsyntax-only %s -DCYCLE 2>&1 \
+// RUN:   | FileCheck -check-prefix=CYCLE %s
+
+// While building CrossTop, this compilation holds the lock of CrossLeft as it
+// waits for the worker to build CrossLeftDep, and may run the scheduled build
+// of CrossRight in the meantime. That build imports CrossLeft, so it is
+// abandoned as a cycle instead of waiting for a lock held by its own thread.
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t \
+// RUN:            -fmodules-build-jobs=2 -I %S/Inputs/parallel-builds \
+// RUN:            -fsyntax-only %s -DCROSS -print-stats 2>&1 \
+// RUN:   | FileCheck -check-prefix=CROSS %s
+// RUN: ls %t/*/CrossLeftDep-*.pcm %t/*/CrossRightDep-*.pcm \
+// RUN:    %t/*/CrossLeft-*.pcm %t/*/CrossRight-*.pcm %t/*/CrossTop-*.pcm
+
+// RUN: %clang -fmodules -fmodules-build-jobs=4 -### -c %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=DRIVER %s
+
+#if defined(DIAMOND)
+#include "diamond_top.h"
+
+int use(void) {
+  return diamond_base + diamond_left + diamond_right + diamond_top;
+}
+#elif defined(CYCLE)
+#include "cycle_a.h"
+#elif defined(CROSS)
+#include "cross_top.h"
+
+int use(void) {
+  return cross_left_dep + cross_right_dep + cross_left + cross_right +
+         cross_top;
+}
+#else
+#include "top.h"
+
+int use(void) { return parallel_a + parallel_b + parallel_top; }
+#endif
+
+// CHECK: remark: building module 'ParallelTop'
+// CHECK-NOT: error
+// CHECK: *** Module Build Scheduler Stats:
+// CHECK-NEXT: 2 module builds scheduled, {{[0-2]}} modules built by scheduled builds.
+// CHECK-NEXT: {{[1-2]}} worker threads started.
+// NO-REBUILD-NOT: building module
+// SERIAL-NOT: Module Build Scheduler Stats
+// DIAMOND-NOT: error
+// DIAMOND: *** Module Build Scheduler Stats:
+// DIAMOND-NEXT: 3 module builds scheduled, {{[0-3]}} modules built by scheduled builds.
+// DIAMOND-NEXT: {{[1-3]}} worker threads started.
+// CYCLE: fatal error: cyclic dependency in module 'CycleA': CycleA -> CycleB -> CycleA
+// CROSS-NOT: error
+// CROSS: *** Module Build Scheduler Stats:
+// CROSS-NEXT: 4 module builds scheduled, {{[0-4]}} modules built by scheduled builds.
+// CROSS-NEXT: 1 worker threads started.
+// DRIVER: "-fmodules-build-jobs=4"
@@ -0,0 +1,29 @@
+// RUN: rm -rf %t
+// RUN: mkdir -p %t/src1
+// RUN: echo 'module Foo { header "foo.h" }' > %t/src1/module.modulemap
+// RUN: echo 'int foo(void);' > %t/src1/foo.h
+
+// Build the module.
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t/cache -fmodules-validate-input-files-content -I %t/src1 -fsyntax-only %s -Rmodule-build 2>&1 | FileCheck -check-prefix=BUILD %s
+
+// Changing the modification time of the header doesn't invalidate the module.
+// RUN: touch -m -a -t 201101010000 %t/src1/foo.h
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t/cache -fmodules-validate-input-files-content -I %t/src1 -fsyntax-only %s -Rmodule-build 2>&1 | FileCheck -allow-empty -check-prefix=NO-BUILD %s
+
+// Neither does using it from a copy of the source tree.
+// RUN: cp -R %t/src1 %t/src2
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t/cache -fmodules-validate-input-files-content -I %t/src2 -fsyntax-only %s -Rmodule-build 2>&1 | FileCheck -allow-empty -check-prefix=NO-BUILD %s
+
+// Changing the contents of the header, even without changing its size, does.
+// RUN: echo 'int bar(void);' > %t/src2/foo.h
+// RUN: touch -m -a -t 201101010000 %t/src2/foo.h
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t/cache -fmodules-validate-input-files-content -I %t/src2 -fsyntax-only %s -Rmodule-build 2>&1 | FileCheck -check-prefix=BUILD %s
+
+// Without the option, the copy of the source tree has its own module.
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t/cache2 -I %t/src1 -fsyntax-only %s
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fmodules-cache-path=%t/cache2 -I %t/src2 -fsyntax-only %s -Rmodule-build 2>&1 | FileCheck -check-prefix=BUILD %s
+
+// BUILD: building module 'Foo'
+// NO-BUILD-NOT: building module
+
+@import Foo;
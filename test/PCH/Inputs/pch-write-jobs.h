@@ -0,0 +1,2 @@
+#define WRITE_JOBS 4
+static inline int pch_write_jobs(int n) { return n; }
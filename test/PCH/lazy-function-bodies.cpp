@@ -0,0 +1,27 @@
+// Check that the bodies of functions from a PCH file are only deserialized
+// when they are needed.
+
+// RUN: %clang_cc1 -std=c++11 -x c++-header -emit-pch -o %t %s
+// RUN: %clang_cc1 -std=c++11 -include-pch %t -fsyntax-only -verify %s -print-stats 2>&1 | FileCheck %s
+
+// CHECK: 1/2 function bodies read
+// CHECK: bytes of function bodies read, {{[1-9][0-9]*}} bytes not read
+
+#ifndef HEADER
+#define HEADER
+
+constexpr int used() { return 42; }
+
+int unused(int X) {
+  int Sum = 0;
+  for (int I = 0; I != X; ++I)
+    Sum += I * I;
+  return Sum;
+}
+
+#else
+
+// expected-no-diagnostics
+static_assert(used() == 42, "");
+
+#endif
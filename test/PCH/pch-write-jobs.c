@@ -0,0 +1,12 @@
+// Test this without pch.
+// RUN: %clang_cc1 -include %S/Inputs/pch-write-jobs.h -fsyntax-only -verify %s
+
+// Writing a PCH on several threads gives the same file as writing it on one.
+// RUN: %clang_cc1 -emit-pch -fpch-write-jobs=1 -o %t-serial.pch %S/Inputs/pch-write-jobs.h
+// RUN: %clang_cc1 -emit-pch -fpch-write-jobs=4 -o %t-parallel.pch %S/Inputs/pch-write-jobs.h
+// RUN: diff %t-serial.pch %t-parallel.pch
+// RUN: %clang_cc1 -include-pch %t-parallel.pch -fsyntax-only -verify %s
+
+// expected-no-diagnostics
+
+int use(void) { return pch_write_jobs(WRITE_JOBS); }
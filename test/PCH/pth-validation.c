@@ -0,0 +1,28 @@
+// Cached tokens are only used for files whose contents are unchanged, and
+// only with the language options they were lexed with.
+
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo 'int pth_value = 1;' > %t/header.h
+// RUN: %clang_cc1 -triple i386-unknown-unknown -emit-pth -o %t/header.pth %t/header.h
+// RUN: %clang_cc1 -triple i386-unknown-unknown -include-pth %t/header.pth -E %s | FileCheck -check-prefix=ORIG %s
+
+// Modify the header, including its size; the new contents must be used.
+// RUN: echo 'int pth_value = 22; int pth_other = 3;' > %t/header.h
+// RUN: %clang_cc1 -triple i386-unknown-unknown -include-pth %t/header.pth -E %s | FileCheck -check-prefix=MODIFIED %s
+
+// Modify the header without changing its size; the new modification time
+// makes the contents be checked.
+// RUN: %clang_cc1 -triple i386-unknown-unknown -emit-pth -o %t/header.pth %t/header.h
+// RUN: echo 'int pth_value = 44; int pth_other = 5;' > %t/header.h
+// RUN: touch -t 200001010000 %t/header.h
+// RUN: %clang_cc1 -triple i386-unknown-unknown -include-pth %t/header.pth -E %s | FileCheck -check-prefix=SAMESIZE %s
+
+// Use the PTH file with different language options.
+// RUN: %clang_cc1 -triple i386-unknown-unknown -emit-pth -o %t/header.pth %t/header.h
+// RUN: %clang_cc1 -triple i386-unknown-unknown -x c++ -include-pth %t/header.pth -E %s 2>&1 | FileCheck -check-prefix=LANGOPTS %s
+
+// ORIG: int pth_value = 1;
+// MODIFIED: int pth_value = 22; int pth_other = 3;
+// SAMESIZE: int pth_value = 44; int pth_other = 5;
+// LANGOPTS: warning: PTH file '{{.*}}header.pth' was built with different language options; its cached tokens will not be used
+// LANGOPTS: int pth_value = 44; int pth_other = 5;
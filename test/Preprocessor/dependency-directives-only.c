@@ -0,0 +1,80 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: touch %t/h1.h %t/h2.h %t/h3.h %t/h4.h %t/h5.h %t/h6.h %t/h7.h \
+// RUN:   %t/h8.h %t/h9.h %t/h10.h
+//
+// Skipping non-directive lines must find the same dependencies as a full
+// preprocess; the hidden*.h headers don't exist.
+// RUN: %clang_cc1 -Eonly -I %t -dependency-file %t/full.d -MT out %s
+// RUN: %clang_cc1 -Eonly -dependency-directives-only -I %t \
+// RUN:   -dependency-file %t/fast.d -MT out %s
+// RUN: diff %t/full.d %t/fast.d
+// RUN: FileCheck --check-prefix=C %s < %t/fast.d
+//
+// RUN: %clang_cc1 -x c++ -std=c++14 -Eonly -I %t \
+// RUN:   -dependency-file %t/full-cxx.d -MT out %s
+// RUN: %clang_cc1 -x c++ -std=c++14 -Eonly -dependency-directives-only -I %t \
+// RUN:   -dependency-file %t/fast-cxx.d -MT out %s
+// RUN: diff %t/full-cxx.d %t/fast-cxx.d
+// RUN: FileCheck --check-prefix=CXX %s < %t/fast-cxx.d
+
+// C: h1.h
+// C: h2.h
+// C: h3.h
+// C: h4.h
+// C-NOT: h5.h
+// C: h6.h
+// C: h7.h
+// C-NOT: h8.h
+// C: h9.h
+// C-NOT: h10.h
+
+// CXX: h1.h
+// CXX: h2.h
+// CXX: h3.h
+// CXX: h4.h
+// CXX: h5.h
+// CXX: h6.h
+// CXX: h7.h
+// CXX: h8.h
+// CXX: h9.h
+// CXX: h10.h
+
+#include "h1.h"
+const char *s = "#include \"hidden1.h\"";
+/*
+#include "hidden2.h"
+*/
+// A continued comment \
+#include "hidden3.h"
+  /* leading comment */ #include "h2.h"
+#define HEADER "h3.h"
+#include HEADER
+#if 0
+#include "hidden4.h"
+#endif
+char c = '"';
+#include "h4.h"
+#ifdef __cplusplus
+const char *r = R"x(
+#include "hidden5.h"
+)x";
+int n = 1'000'000;
+#include "h5.h"
+#endif
+const char *m = "a\
+#include \"hidden6.h\"";
+#include "h6.h"
+%:include "h7.h"
+// Trigraphs are only enabled in the C++14 run.
+??=include "h8.h"
+#define HEADER9 "h9.h"
+int p; _Pragma("push_macro(\"HEADER9\")")
+#undef HEADER9
+_Pragma("pop_macro(\"HEADER9\")")
+#include HEADER9
+#ifdef __cplusplus
+// Not a digit separator: the quote starts the literal '/*'.
+int e = 0xE'/*';
+#include "h10.h"
+int f = 1e+1'0 /* */;
+#endif
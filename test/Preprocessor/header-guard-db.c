@@ -0,0 +1,42 @@
+// REQUIRES: shell
+// RUN: rm -rf %t && mkdir -p %t/a %t/b
+// RUN: printf '#ifndef GUARD_H\n#define GUARD_H\nint guarded;\n#endif\n' > %t/a/guard.h
+// RUN: cp %t/a/guard.h %t/b/guard.h
+//
+// The first compilation lexes both copies and records their guards.
+// RUN: %clang_cc1 -fsyntax-only -I %t -header-guard-db %t/db %s \
+// RUN:   -print-stats 2>&1 | FileCheck --check-prefix=FIRST %s
+// RUN: test -f %t/db
+// FIRST: 0 header guards loaded from the guard database.
+// FIRST-NEXT: 0 #includes skipped using the guard database.
+//
+// The second one skips the second copy without lexing it.
+// RUN: %clang_cc1 -fsyntax-only -I %t -header-guard-db %t/db %s \
+// RUN:   -print-stats 2>&1 | FileCheck --check-prefix=SECOND %s
+// SECOND: 2 header guards loaded from the guard database.
+// SECOND-NEXT: 1 #includes skipped using the guard database.
+//
+// The skipped copy is still a dependency.
+// RUN: %clang_cc1 -fsyntax-only -I %t -header-guard-db %t/db %s \
+// RUN:   -dependency-file %t/deps -MT main.o -print-stats 2>&1 \
+// RUN:   | FileCheck --check-prefix=SECOND %s
+// RUN: FileCheck --check-prefix=DEPS %s < %t/deps
+// DEPS: main.o:
+// DEPS: a{{/|\\}}guard.h
+// DEPS: b{{/|\\}}guard.h
+//
+// A modified header is lexed again.
+// RUN: printf '#ifndef GUARD_H\n#define GUARD_H\nint guarded;\nint extra;\n#endif\n' > %t/b/guard.h
+// RUN: %clang_cc1 -fsyntax-only -I %t -header-guard-db %t/db %s \
+// RUN:   -print-stats 2>&1 | FileCheck --check-prefix=MODIFIED %s
+// MODIFIED: 0 #includes skipped using the guard database.
+//
+// A corrupt database is ignored.
+// RUN: echo garbage > %t/db
+// RUN: %clang_cc1 -fsyntax-only -I %t -header-guard-db %t/db %s \
+// RUN:   -print-stats 2>&1 | FileCheck --check-prefix=FIRST %s
+
+#include "a/guard.h"
+#include "b/guard.h"
+
+int *p = &guarded;
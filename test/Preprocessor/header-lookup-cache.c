@@ -0,0 +1,59 @@
+// REQUIRES: shell
+// RUN: rm -rf %t && mkdir -p %t/a %t/b
+// RUN: echo 'int from_b;' > %t/b/h.h
+// RUN: touch -t 200001010000 %t/a %t/b
+//
+// The first compilation populates the cache.
+// RUN: %clang_cc1 -fsyntax-only -I %t/a -I %t/b -header-lookup-cache %t/cache \
+// RUN:   -DEXPECT_B %s -print-stats 2>&1 | FileCheck --check-prefix=FIRST %s
+// RUN: test -f %t/cache
+// FIRST: 0 lookups loaded from the persistent lookup cache.
+//
+// The second one is seeded from it.
+// RUN: %clang_cc1 -fsyntax-only -I %t/a -I %t/b -header-lookup-cache %t/cache \
+// RUN:   -DEXPECT_B %s -print-stats 2>&1 | FileCheck --check-prefix=SECOND %s
+// SECOND: 1 lookups loaded from the persistent lookup cache.
+//
+// Different search paths don't use it.
+// RUN: %clang_cc1 -fsyntax-only -I %t/b -header-lookup-cache %t/cache \
+// RUN:   -DEXPECT_B %s -print-stats 2>&1 | FileCheck --check-prefix=FIRST %s
+//
+// Adding a header to an earlier search directory invalidates it.
+// RUN: %clang_cc1 -fsyntax-only -I %t/a -I %t/b -header-lookup-cache %t/cache \
+// RUN:   -DEXPECT_B %s
+// RUN: echo 'int from_a;' > %t/a/h.h
+// RUN: %clang_cc1 -fsyntax-only -I %t/a -I %t/b -header-lookup-cache %t/cache \
+// RUN:   -DEXPECT_A %s -print-stats 2>&1 | FileCheck --check-prefix=FIRST %s
+//
+// A corrupt cache is ignored.
+// RUN: echo garbage > %t/cache
+// RUN: %clang_cc1 -fsyntax-only -I %t/a -I %t/b -header-lookup-cache %t/cache \
+// RUN:   -DEXPECT_A %s
+//
+// Headers that were not found are not recorded, so a header generated later
+// in a subdirectory of a search directory, which doesn't change the search
+// directory's modification time, is found.
+// RUN: %clang_cc1 -fsyntax-only -I %t/a -I %t/b -header-lookup-cache %t/cache \
+// RUN:   -DEXPECT_A -DEXPECT_NO_GEN %s
+// RUN: mkdir %t/b/gen && echo 'int generated;' > %t/b/gen/g.h
+// RUN: touch -t 200001010000 %t/b
+// RUN: %clang_cc1 -fsyntax-only -I %t/a -I %t/b -header-lookup-cache %t/cache \
+// RUN:   -DEXPECT_A -DEXPECT_GEN %s -print-stats 2>&1 \
+// RUN:   | FileCheck --check-prefix=SECOND %s
+
+#include "h.h"
+
+#ifdef EXPECT_A
+int *p = &from_a;
+#else
+int *p = &from_b;
+#endif
+
+#ifdef EXPECT_GEN
+#include "gen/g.h"
+int *q = &generated;
+#elif defined(EXPECT_NO_GEN)
+#if __has_include("gen/g.h")
+#error gen/g.h does not exist yet
+#endif
+#endif
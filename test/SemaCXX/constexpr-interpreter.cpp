@@ -0,0 +1,133 @@
+// RUN: %clang_cc1 -std=c++14 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++14 -fsyntax-only -verify %s -fexperimental-constexpr-interpreter
+// RUN: not %clang_cc1 -std=c++14 -fsyntax-only %s -fexperimental-constexpr-interpreter -print-stats 2>&1 | FileCheck %s
+
+// The bytecode interpreter must agree with the tree-walking evaluator, both on
+// the values it computes and on the calls it leaves to the evaluator to
+// diagnose.
+
+constexpr int sum(int n) {
+  int s = 0;
+  for (int i = 1; i <= n; ++i)
+    s += i;
+  return s;
+}
+static_assert(sum(100) == 5050, "");
+
+constexpr unsigned collatz(unsigned long long n) {
+  unsigned steps = 0;
+  while (n != 1) {
+    n = n % 2 ? 3 * n + 1 : n / 2;
+    steps++;
+  }
+  return steps;
+}
+static_assert(collatz(27) == 111, "");
+
+constexpr bool isPrime(int n) {
+  if (n < 2)
+    return false;
+  for (int d = 2; d * d <= n; ++d) {
+    if (n % d == 0)
+      return false;
+  }
+  return true;
+}
+static_assert(isPrime(7919) && !isPrime(7917), "");
+
+constexpr int countPrimes(int n) {
+  int count = 0, i = 0;
+  do {
+    if (!isPrime(i))
+      continue;
+    ++count;
+  } while (i++ < n);
+  return count;
+}
+static_assert(countPrimes(100) == 25, "");
+
+constexpr int firstMultiple(int n, int k) {
+  int i = n;
+  while (true) {
+    if (i % k == 0)
+      break;
+    ++i;
+  }
+  return i;
+}
+static_assert(firstMultiple(100, 7) == 105, "");
+
+constexpr int gcd(int a, int b) { return b ? gcd(b, a % b) : a; }
+static_assert(gcd(1071, 462) == 21, "");
+
+constexpr int compound(int n) {
+  int x = n;
+  x *= 3;
+  x -= 1;
+  x /= 2;
+  x %= 7;
+  x <<= 4;
+  x >>= 1;
+  x |= 1;
+  x &= 0x3f;
+  x ^= 0x10;
+  return x;
+}
+static_assert(compound(12) == 9, "");
+
+constexpr int chain(int n) {
+  int a = 0, b = 0;
+  a = b = n;
+  return ++a + b;
+}
+static_assert(chain(4) == 9, "");
+
+// Narrow and unsigned types, and conversions between them.
+constexpr unsigned char next(unsigned char c) { return c + 1; }
+static_assert(next(255) == 0, "");
+constexpr signed char narrow(int n) { return n; }
+static_assert(narrow(200) == -56, "");
+constexpr unsigned negate(unsigned n) { return -n; }
+static_assert(negate(1) == 0xffffffffu, "");
+constexpr bool toBool(int n) {
+  bool b = n;
+  return b;
+}
+static_assert(toBool(2) && !toBool(0), "");
+constexpr unsigned long long popcount(unsigned long long n) {
+  unsigned long long result = 0;
+  for (; n; n >>= 1)
+    result += n & 1;
+  return result;
+}
+static_assert(popcount(~0ULL) == 64, "");
+constexpr long long shl(long long n, int s) { return n << s; }
+static_assert(shl(1, 63) >> 62 == -2, "");
+
+enum class Color : unsigned char { Red, Green = 200, Blue };
+constexpr int value(Color c) { return static_cast<int>(c); }
+static_assert(value(Color::Blue) == 201, "");
+
+template <int N> constexpr int scaled(int n) { return N * n; }
+static_assert(scaled<3>(14) == 42, "");
+
+// Calls the interpreter does not support are left to the evaluator.
+constexpr int kSeven = 7;
+constexpr int seven() { return kSeven; }
+constexpr int addSeven(int n) { return n + seven(); }
+static_assert(addSeven(1) == 8, "");
+
+int notConstexpr(int n) { return n; } // expected-note {{declared here}}
+constexpr int callsNotConstexpr(int n) { return n ? notConstexpr(n) : 0; } // expected-note {{non-constexpr function 'notConstexpr'}}
+static_assert(callsNotConstexpr(0) == 0, "");
+static_assert(callsNotConstexpr(1) == 1, ""); // expected-error {{constant expression}} expected-note {{in call to 'callsNotConstexpr(1)'}}
+
+constexpr int square(int n) { return n * n; } // expected-note {{value 10000000000 is outside the range}}
+static_assert(square(100000) > 0, ""); // expected-error {{constant expression}} expected-note {{in call to 'square(100000)'}}
+
+constexpr int divide(int a, int b) { return a / b; } // expected-note {{division by zero}}
+static_assert(divide(1, 0), ""); // expected-error {{constant expression}} expected-note {{in call to 'divide(1, 0)'}}
+
+// CHECK: *** Constexpr Interpreter Stats:
+// CHECK-NEXT: {{[0-9]+}} functions compiled, {{[0-9]+}} not supported
+// CHECK-NEXT: {{[0-9]+}} calls interpreted, {{[0-9]+}} left to the evaluator
@@ -0,0 +1,30 @@
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s -fconstexpr-cache-size 0 -DNO_CACHE
+// RUN: not %clang_cc1 -std=c++11 -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+
+constexpr unsigned long long fib(unsigned n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+
+#ifdef NO_CACHE
+// Without memoization, this takes billions of steps.
+// expected-note@5 {{step limit}} expected-note@5 +{{}}
+constexpr unsigned long long kFib = fib(60); // expected-error {{must be initialized by a constant expression}} expected-note {{in call to 'fib(60)'}}
+#else
+constexpr unsigned long long kFib = fib(60);
+static_assert(kFib == 1548008755920ULL, "");
+
+// Calls with reference arguments are not memoized.
+constexpr int get(const int &n) { return n; }
+constexpr int kOne = 1;
+static_assert(get(kOne) == 1, "");
+#endif
+
+// A call that hits a diagnostic is not memoized, even if the diagnostic is
+// dropped because an earlier one is kept, so that later calls diagnose it.
+const double d = 1; // expected-note 2{{declared here}}
+constexpr int f(bool b) { return b ? (int)d : 0; } // expected-note {{read of non-constexpr variable 'd'}}
+constexpr int a = (int)d + f(true); // expected-error {{must be initialized by a constant expression}} expected-note {{read of non-constexpr variable 'd'}}
+constexpr int b = f(true); // expected-error {{must be initialized by a constant expression}} expected-note {{in call to 'f(true)'}}
+
+// CHECK: *** Constexpr Call Cache Stats:
+// CHECK-NEXT: {{[0-9]+}}/65536 memoized constexpr calls
+// CHECK-NEXT: {{[0-9]+}} hits, {{[0-9]+}} misses, 0 evictions
@@ -0,0 +1,52 @@
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s
+// RUN: not %clang_cc1 -std=c++11 -fsyntax-only %s -print-stats 2>&1 | FileCheck %s
+
+// Conversions ruled out by the type classes of the argument and the parameter
+// must be diagnosed exactly like the ones that were attempted.
+
+struct NoConversions {};
+struct ToInt { operator int() const; };
+struct Base {};
+struct Derived : Base {};
+
+void f(int); // expected-note {{candidate function not viable: no known conversion from 'NoConversions' to 'int' for 1st argument}}
+void f(int *); // expected-note {{candidate function not viable: no known conversion from 'NoConversions' to 'int *' for 1st argument}}
+void f(int Base::*); // expected-note {{candidate function not viable: no known conversion from 'NoConversions' to 'int Base::*' for 1st argument}}
+void f(decltype(nullptr)); // expected-note {{candidate function not viable: no known conversion from 'NoConversions' to 'decltype(nullptr)'}}
+
+void test_class(NoConversions nc, ToInt ti) {
+  f(nc); // expected-error {{no matching function for call to 'f'}}
+  f(ti);
+}
+
+int g(float);
+int *g(char *);
+char g(int Derived::*);
+
+void k(float); // expected-note {{candidate function not viable: no known conversion from 'const char *' to 'float' for 1st argument}}
+void k(int Derived::*); // expected-note {{candidate function not viable: no known conversion from 'const char *' to 'int Derived::*' for 1st argument}}
+
+void test_scalar(double d, char buf[4], int Base::*pm, const char *s) {
+  int a = g(d);
+  int *b = g(buf);
+  char c = g(pm);
+  (void)a; (void)b; (void)c;
+  k(s); // expected-error {{no matching function for call to 'k'}}
+}
+
+// Arguments converted by many candidates with the same parameter type, such
+// as the built-in operator candidates, are converted once.
+enum E { e0 };
+bool test_builtin(E x, E y) {
+  return x < y && x + y == 1;
+}
+
+void h(int, int); // expected-note {{candidate function not viable: requires 2 arguments, but 1 was provided}}
+template <typename T> void h(T, T, T); // expected-note {{candidate function template not viable: requires 3 arguments, but 1 was provided}}
+void test_arity() {
+  h(1); // expected-error {{no matching function for call to 'h'}}
+}
+
+// CHECK: *** Semantic Analysis Stats:
+// CHECK: {{[1-9][0-9]*}} overload candidates rejected by arity.
+// CHECK-NEXT: {{[0-9]+}} candidate argument conversions computed, {{[1-9][0-9]*}} pruned by type class, {{[1-9][0-9]*}} reused.
@@ -82,6 +82,8 @@ static unsigned getDefaultParsingOptions() {
     options |= CXTranslationUnit_CreatePreambleOnFirstParse;
   if (getenv("CINDEXTEST_KEEP_GOING"))
     options |= CXTranslationUnit_KeepGoing;
+  if (getenv("CINDEXTEST_PREAMBLE_IN_MEMORY"))
+    options |= CXTranslationUnit_StorePreamblesInMemory;
 
   return options;
 }
@@ -1539,6 +1541,37 @@ static enum CXChildVisitResult PrintTypeDeclaration(CXCursor cursor, CXCursor p,
   return CXChildVisit_Recurse;
 }
 
+/******************************************************************************/
+/* Cursor records testing.                                                    */
+/******************************************************************************/
+
+static void PrintCursorRecords(CXTranslationUnit TU) {
+  CXString MainFileName = clang_getTranslationUnitSpelling(TU);
+  CXFile MainFile = clang_getFile(TU, clang_getCString(MainFileName));
+  CXCursorRecordList *Records =
+      clang_getCursorRecords(clang_getTranslationUnitCursor(TU), MainFile,
+                             CXCursorRecord_IncludeUSRs);
+  unsigned I;
+
+  for (I = 0; I != Records->count; ++I) {
+    CXCursorRecord *R = &Records->records[I];
+    CXString KindSpelling = clang_getCursorKindSpelling(R->kind);
+    printf("%u: %s=%s ", I, clang_getCString(KindSpelling), R->spelling);
+    clang_disposeString(KindSpelling);
+    PrintExtent(stdout, R->startLine, R->startColumn, R->endLine,
+                R->endColumn);
+    printf(" [parent=%d]", R->parent);
+    if (R->usr[0])
+      printf(" [usr=%s]", R->usr);
+    if (R->referenced >= 0)
+      printf(" [referenced=%d]", R->referenced);
+    printf("\n");
+  }
+
+  clang_disposeCursorRecordList(Records);
+  clang_disposeString(MainFileName);
+}
+
 /******************************************************************************/
 /* Loading ASTs/source.                                                       */
 /******************************************************************************/
@@ -2167,6 +2200,8 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
     completionOptions |= CXCodeComplete_IncludeCodePatterns;
   if (getenv("CINDEXTEST_COMPLETION_BRIEF_COMMENTS"))
     completionOptions |= CXCodeComplete_IncludeBriefComments;
+  if (getenv("CINDEXTEST_COMPLETION_SNAPSHOT"))
+    completionOptions |= CXCodeComplete_UseSnapshot;
   
   if (timing_only)
     input += strlen("-code-completion-timing=");
@@ -2268,6 +2303,10 @@ int perform_code_completion(int argc, const char **argv, int timing_only) {
       printf("Objective-C selector: %s\n", selectorString);
     }
     clang_disposeString(objCSelector);
+
+    if (completionOptions & CXCodeComplete_UseSnapshot)
+      printf("Snapshot version: %u\n",
+             clang_codeCompleteGetSnapshotVersion(results));
     
     clang_disposeCodeCompleteResults(results);
   }
@@ -4271,6 +4310,7 @@ static void print_usage(void) {
     "       c-index-test -test-print-type {<args>}*\n"
     "       c-index-test -test-print-type-size {<args>}*\n"
     "       c-index-test -test-print-bitwidth {<args>}*\n"
+    "       c-index-test -test-print-cursor-records {<args>}*\n"
     "       c-index-test -test-print-type-declaration {<args>}*\n"
     "       c-index-test -print-usr [<CursorKind> {<args>}]*\n"
     "       c-index-test -print-usr-file <file>\n"
@@ -4377,6 +4417,9 @@ int cindextest_main(int argc, const char **argv) {
   else if (argc > 2 && strcmp(argv[1], "-test-print-bitwidth") == 0)
     return perform_test_load_source(argc - 2, argv + 2, "all",
                                     PrintBitWidth, 0);
+  else if (argc > 2 && strcmp(argv[1], "-test-print-cursor-records") == 0)
+    return perform_test_load_source(argc - 2, argv + 2, "all", NULL,
+                                    PrintCursorRecords);
   else if (argc > 2 && strcmp(argv[1], "-test-print-mangle") == 0)
     return perform_test_load_tu(argv[2], "all", NULL, PrintMangledName, NULL);
   else if (argc > 2 && strcmp(argv[1], "-test-print-manglings") == 0)
@@ -14,6 +14,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Option/Arg.h"
+#include "clang/Basic/TimeTrace.h"
 #include "clang/CodeGen/ObjectFilePCHContainerOperations.h"
 #include "clang/Driver/DriverDiagnostic.h"
 #include "clang/Driver/Options.h"
@@ -29,6 +30,7 @@
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
@@ -112,8 +114,29 @@ int cc1_main(ArrayRef<const char *> Argv, const char *Argv0, void *MainAddr) {
   if (!Success)
     return 1;
 
+  const std::string &TimeTraceFile = Clang->getFrontendOpts().TimeTraceFile;
+  if (!TimeTraceFile.empty())
+    timeTraceProfilerInitialize(
+        Clang->getFrontendOpts().TimeTraceGranularity);
+
   // Execute the frontend actions.
-  Success = ExecuteCompilerInvocation(Clang.get());
+  {
+    TimeTraceScope TimeScope("ExecuteCompiler", StringRef());
+    Success = ExecuteCompilerInvocation(Clang.get());
+  }
+
+  if (!TimeTraceFile.empty()) {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(TimeTraceFile, EC, llvm::sys::fs::F_Text);
+    if (EC) {
+      Clang->getDiagnostics().Report(diag::err_fe_unable_to_open_output)
+          << TimeTraceFile << EC.message();
+      Success = false;
+    } else {
+      getTimeTraceProfiler()->write(OS);
+    }
+    timeTraceProfilerCleanup();
+  }
 
   // If any timers were active but haven't been destroyed yet, print their
   // results now.  This happens in -disable-free mode.
@@ -3079,6 +3079,15 @@ CXIndex clang_createIndex(int excludeDeclarationsFromPCH,
   if (displayDiagnostics)
     CIdxr->setDisplayDiagnostics();
 
+  // Share stats and the contents of non-volatile (system) files between the
+  // translation units of this index.
+  if (getenv("LIBCLANG_SHARED_FILE_CACHE"))
+    CIdxr->setSharedFileCache(new SharedFileSystemCache());
+
+  // Rebuild only the part of a preamble after the first change to it.
+  if (getenv("LIBCLANG_LAYERED_PREAMBLE"))
+    CIdxr->setLayeredPreambles();
+
   if (getenv("LIBCLANG_BGPRIO_INDEX"))
     CIdxr->setCXGlobalOptFlags(CIdxr->getCXGlobalOptFlags() |
                                CXGlobalOpt_ThreadBackgroundPriorityForIndexing);
@@ -3105,6 +3114,13 @@ unsigned clang_CXIndex_getGlobalOptions(CXIndex CIdx) {
   return 0;
 }
 
+void clang_CXIndex_setInMemoryPreambleLimit(CXIndex CIdx,
+                                            unsigned long long MaxBytes) {
+  if (CIdx)
+    static_cast<CIndexer *>(CIdx)->getInMemoryPreambleStore()->setMaxSize(
+        MaxBytes);
+}
+
 void clang_toggleCrashRecovery(unsigned isEnabled) {
   if (isEnabled)
     llvm::CrashRecoveryContext::Enable();
@@ -3202,6 +3218,8 @@ clang_parseTranslationUnit_Impl(CXIndex CIdx, const char *source_filename,
     = options & CXTranslationUnit_IncludeBriefCommentsInCodeCompletion;
   bool SkipFunctionBodies = options & CXTranslationUnit_SkipFunctionBodies;
   bool ForSerialization = options & CXTranslationUnit_ForSerialization;
+  bool StorePreamblesInMemory =
+      options & CXTranslationUnit_StorePreamblesInMemory;
 
   // Configure the diagnostics.
   IntrusiveRefCntPtr<DiagnosticsEngine>
@@ -3285,7 +3303,8 @@ clang_parseTranslationUnit_Impl(CXIndex CIdx, const char *source_filename,
       /*AllowPCHWithCompilerErrors=*/true, SkipFunctionBodies,
       /*UserFilesAreVolatile=*/true, ForSerialization,
       CXXIdx->getPCHContainerOperations()->getRawReader().getFormat(),
-      &ErrUnit));
+      &ErrUnit, CXXIdx->getSharedFileCache(),
+      StorePreamblesInMemory ? CXXIdx->getInMemoryPreambleStore() : nullptr));
 
   // Early failures in LoadFromCommandLine may return with ErrUnit unset.
   if (!Unit && !ErrUnit)
@@ -3300,6 +3319,9 @@ clang_parseTranslationUnit_Impl(CXIndex CIdx, const char *source_filename,
   if (isASTReadError(Unit ? Unit.get() : ErrUnit.get()))
     return CXError_ASTReadError;
 
+  if (Unit)
+    Unit->setLayeredPreamble(CXXIdx->getLayeredPreambles());
+
   *out_TU = MakeCXTranslationUnit(CXXIdx, Unit.release());
   return *out_TU ? CXError_Success : CXError_Failure;
 }
@@ -3868,6 +3890,15 @@ CXString clang_getTranslationUnitSpelling(CXTranslationUnit CTUnit) {
   return cxstring::createDup(CXXUnit->getOriginalSourceFileName());
 }
 
+unsigned clang_getTranslationUnitSnapshotVersion(CXTranslationUnit TU) {
+  if (isNotUsableTU(TU)) {
+    LOG_BAD_TU(TU);
+    return 0;
+  }
+
+  return cxtu::getASTUnit(TU)->getSnapshotVersion();
+}
+
 CXCursor clang_getTranslationUnitCursor(CXTranslationUnit TU) {
   if (isNotUsableTU(TU)) {
     LOG_BAD_TU(TU);
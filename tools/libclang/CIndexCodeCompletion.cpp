@@ -308,6 +308,10 @@ struct AllocatedCXCodeCompleteResults : public CXCodeCompleteResults {
   /// \brief A string containing the Objective-C selector entered thus far for a
   /// message send.
   std::string Selector;
+
+  /// \brief The version of the translation unit snapshot the results were
+  /// computed against.
+  unsigned SnapshotVersion;
 };
 
 } // end anonymous namespace
@@ -327,7 +331,8 @@ AllocatedCXCodeCompleteResults::AllocatedCXCodeCompleteResults(
       FileMgr(FileMgr), SourceMgr(new SourceManager(*Diag, *FileMgr)),
       CodeCompletionAllocator(new clang::GlobalCodeCompletionAllocator),
       Contexts(CXCompletionContext_Unknown),
-      ContainerKind(CXCursor_InvalidCode), ContainerIsIncomplete(1) {
+      ContainerKind(CXCursor_InvalidCode), ContainerIsIncomplete(1),
+      SnapshotVersion(0) {
   if (getenv("LIBCLANG_OBJTRACKING"))
     fprintf(stderr, "+++ %u completion results\n",
             ++CodeCompletionResultObjects);
@@ -525,14 +530,11 @@ namespace {
     AllocatedCXCodeCompleteResults &AllocatedResults;
     CodeCompletionTUInfo CCTUInfo;
     SmallVector<CXCompletionResult, 16> StoredResults;
-    CXTranslationUnit *TU;
   public:
     CaptureCompletionResults(const CodeCompleteOptions &Opts,
-                             AllocatedCXCodeCompleteResults &Results,
-                             CXTranslationUnit *TranslationUnit)
+                             AllocatedCXCodeCompleteResults &Results)
       : CodeCompleteConsumer(Opts, false), 
-        AllocatedResults(Results), CCTUInfo(Results.CodeCompletionAllocator),
-        TU(TranslationUnit) { }
+        AllocatedResults(Results), CCTUInfo(Results.CodeCompletionAllocator) { }
     ~CaptureCompletionResults() override { Finish(); }
 
     void ProcessCodeCompleteResults(Sema &S, 
@@ -589,13 +591,17 @@ namespace {
       }
 
       if (D != nullptr) {
-        CXCursor cursor = cxcursor::MakeCXCursor(D, *TU);
-
-        AllocatedResults.ContainerKind = clang_getCursorKind(cursor);
-
-        CXString CursorUSR = clang_getCursorUSR(cursor);
-        AllocatedResults.ContainerUSR = clang_getCString(CursorUSR);
-        clang_disposeString(CursorUSR);
+        AllocatedResults.ContainerKind = getCursorKindForDecl(D);
+
+        // Generate the USR into storage of our own rather than into the
+        // translation unit's string pool, which isn't thread-safe: code
+        // completion from a snapshot runs while the translation unit may be
+        // in use on another thread.
+        SmallString<128> USR;
+        if (cxcursor::getDeclCursorUSR(D, USR))
+          AllocatedResults.ContainerUSR.clear();
+        else
+          AllocatedResults.ContainerUSR = USR.str();
 
         const Type *type = baseType.getTypePtrOrNull();
         if (type) {
@@ -674,7 +680,17 @@ clang_codeCompleteAt_Impl(CXTranslationUnit TU, const char *complete_filename,
   if (CXXIdx->isOptEnabled(CXGlobalOpt_ThreadBackgroundPriorityForEditing))
     setThreadBackgroundPriority();
 
-  ASTUnit::ConcurrencyCheck Check(*AST);
+  // Completing against a snapshot leaves the ASTUnit alone, so that it can be
+  // reparsed concurrently.
+  std::shared_ptr<const ASTUnit::CompletionSnapshot> Snapshot;
+  std::unique_ptr<ASTUnit::ConcurrencyCheck> Check;
+  if (options & CXCodeComplete_UseSnapshot) {
+    Snapshot = AST->getCompletionSnapshot();
+    if (!Snapshot)
+      return nullptr;
+  } else {
+    Check.reset(new ASTUnit::ConcurrencyCheck(*AST));
+  }
 
   // Perform the remapping of source files.
   SmallVector<ASTUnit::RemappedFile, 4> RemappedFiles;
@@ -691,32 +707,45 @@ clang_codeCompleteAt_Impl(CXTranslationUnit TU, const char *complete_filename,
 
   // Parse the resulting source file to find code-completion results.
   AllocatedCXCodeCompleteResults *Results = new AllocatedCXCodeCompleteResults(
-      &AST->getFileManager());
+      Snapshot ? Snapshot->createFileManager() : &AST->getFileManager());
   Results->Results = nullptr;
   Results->NumResults = 0;
   
   // Create a code-completion consumer to capture the results.
   CodeCompleteOptions Opts;
   Opts.IncludeBriefComments = IncludeBriefComments;
-  CaptureCompletionResults Capture(Opts, *Results, &TU);
+  CaptureCompletionResults Capture(Opts, *Results);
 
   // Perform completion.
-  AST->CodeComplete(complete_filename, complete_line, complete_column,
-                    RemappedFiles, (options & CXCodeComplete_IncludeMacros),
-                    (options & CXCodeComplete_IncludeCodePatterns),
-                    IncludeBriefComments, Capture,
-                    CXXIdx->getPCHContainerOperations(), *Results->Diag,
-                    Results->LangOpts, *Results->SourceMgr, *Results->FileMgr,
-                    Results->Diagnostics, Results->TemporaryBuffers);
+  if (Snapshot) {
+    ASTUnit::CodeComplete(
+        *Snapshot, complete_filename, complete_line, complete_column,
+        RemappedFiles, (options & CXCodeComplete_IncludeMacros),
+        (options & CXCodeComplete_IncludeCodePatterns), IncludeBriefComments,
+        Capture, CXXIdx->getPCHContainerOperations(), *Results->Diag,
+        Results->LangOpts, *Results->SourceMgr, *Results->FileMgr,
+        Results->Diagnostics, Results->TemporaryBuffers);
+    Results->SnapshotVersion = Snapshot->getVersion();
+  } else {
+    AST->CodeComplete(complete_filename, complete_line, complete_column,
+                      RemappedFiles, (options & CXCodeComplete_IncludeMacros),
+                      (options & CXCodeComplete_IncludeCodePatterns),
+                      IncludeBriefComments, Capture,
+                      CXXIdx->getPCHContainerOperations(), *Results->Diag,
+                      Results->LangOpts, *Results->SourceMgr,
+                      *Results->FileMgr, Results->Diagnostics,
+                      Results->TemporaryBuffers);
+    Results->SnapshotVersion = AST->getSnapshotVersion();
+
+    // Keep a reference to the allocator used for cached global completions, so
+    // that we can be sure that the memory used by our code completion strings
+    // doesn't get freed due to subsequent reparses (while the code completion
+    // results are still active).
+    Results->CachedCompletionAllocator = AST->getCachedCompletionAllocator();
+  }
 
   Results->DiagnosticsWrappers.resize(Results->Diagnostics.size());
 
-  // Keep a reference to the allocator used for cached global completions, so
-  // that we can be sure that the memory used by our code completion strings
-  // doesn't get freed due to subsequent reparses (while the code completion
-  // results are still active).
-  Results->CachedCompletionAllocator = AST->getCachedCompletionAllocator();
-
   
 
 #ifdef UDP_CODE_COMPLETION_LOGGER
@@ -828,7 +857,8 @@ CXCodeCompleteResults *clang_codeCompleteAt(CXTranslationUnit TU,
     fprintf(stderr, "libclang: crash detected in code completion\n");
     cxtu::getASTUnit(TU)->setUnsafeToFree(true);
     return nullptr;
-  } else if (getenv("LIBCLANG_RESOURCE_USAGE"))
+  } else if (getenv("LIBCLANG_RESOURCE_USAGE") &&
+             !(options & CXCodeComplete_UseSnapshot))
     PrintLibclangResourceUsage(TU);
 
   return result;
@@ -915,6 +945,16 @@ CXString clang_codeCompleteGetObjCSelector(CXCodeCompleteResults *ResultsIn) {
   
   return cxstring::createDup(Results->Selector);
 }
+
+unsigned
+clang_codeCompleteGetSnapshotVersion(CXCodeCompleteResults *ResultsIn) {
+  AllocatedCXCodeCompleteResults *Results =
+    static_cast<AllocatedCXCodeCompleteResults *>(ResultsIn);
+  if (!Results)
+    return 0;
+
+  return Results->SnapshotVersion;
+}
   
 } // end extern "C"
 
@@ -0,0 +1,172 @@
+//===- CIndexCursorRecords.cpp - Batch cursor queries ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements clang_getCursorRecords(), which describes all the
+// descendants of a cursor in one call.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CLog.h"
+#include "CXCursor.h"
+#include "CXString.h"
+#include "CXTranslationUnit.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
+#include <vector>
+
+using namespace clang;
+
+namespace {
+
+/// \brief The CXCursorRecordList we allocate internally. The records, and the
+/// strings they point to, are allocated in its arena.
+struct AllocatedCXCursorRecordList : public CXCursorRecordList {
+  llvm::BumpPtrAllocator Arena;
+};
+
+/// \brief Collects the records of the descendants of a cursor.
+class CursorRecordCollector {
+  CXFile File;
+  bool IncludeUSRs;
+  llvm::BumpPtrAllocator &Arena;
+
+  /// \brief The strings the records point to, uniqued and kept in the arena.
+  llvm::StringMap<char, llvm::BumpPtrAllocator &> Strings;
+
+  std::vector<CXCursorRecord> Records;
+
+  /// \brief The indices of the records of the ancestors of the cursor being
+  /// visited, innermost last.
+  SmallVector<int, 32> Ancestors;
+
+  /// \brief The index of the record of each declaration or macro definition,
+  /// keyed by the entity its cursor refers to.
+  llvm::DenseMap<const void *, int> EntityRecords;
+
+  const char *getString(CXString Str);
+
+public:
+  CursorRecordCollector(CXFile File, bool IncludeUSRs,
+                        llvm::BumpPtrAllocator &Arena)
+      : File(File), IncludeUSRs(IncludeUSRs), Arena(Arena), Strings(Arena) {}
+
+  CXChildVisitResult visit(CXCursor C, CXCursor Parent);
+
+  /// \brief Resolve the references between records and move them into the
+  /// arena.
+  void finish(CXCursorRecordList &List);
+};
+
+} // end anonymous namespace
+
+const char *CursorRecordCollector::getString(CXString Str) {
+  const char *Chars = clang_getCString(Str);
+  StringRef Key = Chars ? Chars : "";
+  const char *Result =
+      Strings.insert(std::make_pair(Key, '\0')).first->getKeyData();
+  clang_disposeString(Str);
+  return Result;
+}
+
+/// \brief Whether cursors of the given kind may be referenced by others, and
+/// refer to their entity through their first data pointer.
+static bool isReferenceableKind(CXCursorKind K) {
+  return clang_isDeclaration(K) || K == CXCursor_MacroDefinition;
+}
+
+CXChildVisitResult CursorRecordCollector::visit(CXCursor C, CXCursor Parent) {
+  // The traversal is in preorder, so the parent of the cursor is the
+  // innermost ancestor whose descendants have not all been visited yet.
+  while (!Ancestors.empty() &&
+         !clang_equalCursors(Records[Ancestors.back()].cursor, Parent))
+    Ancestors.pop_back();
+
+  CXCursorRecord Record;
+  CXSourceRange Extent = clang_getCursorExtent(C);
+  clang_getExpansionLocation(clang_getRangeStart(Extent), &Record.file,
+                             &Record.startLine, &Record.startColumn,
+                             &Record.startOffset);
+  // Only the children of the parent cursor are filtered; the descendants of
+  // those that are kept are described wherever they start.
+  if (File && Ancestors.empty() && Record.file != File)
+    return CXChildVisit_Continue;
+  clang_getExpansionLocation(clang_getRangeEnd(Extent), nullptr,
+                             &Record.endLine, &Record.endColumn,
+                             &Record.endOffset);
+
+  Record.cursor = C;
+  Record.referencedCursor = clang_getCursorReferenced(C);
+  Record.kind = C.kind;
+  Record.spelling = getString(clang_getCursorSpelling(C));
+  Record.usr = IncludeUSRs ? getString(clang_getCursorUSR(C)) : "";
+  Record.parent = Ancestors.empty() ? -1 : Ancestors.back();
+  Record.referenced = -1;
+
+  int Index = Records.size();
+  Records.push_back(Record);
+  if (isReferenceableKind(C.kind))
+    EntityRecords.insert(std::make_pair(C.data[0], Index));
+  Ancestors.push_back(Index);
+  return CXChildVisit_Recurse;
+}
+
+void CursorRecordCollector::finish(CXCursorRecordList &List) {
+  for (CXCursorRecord &Record : Records) {
+    if (!isReferenceableKind(Record.referencedCursor.kind))
+      continue;
+    llvm::DenseMap<const void *, int>::iterator Known =
+        EntityRecords.find(Record.referencedCursor.data[0]);
+    if (Known != EntityRecords.end())
+      Record.referenced = Known->second;
+  }
+
+  List.count = Records.size();
+  List.records = Arena.Allocate<CXCursorRecord>(Records.size());
+  std::copy(Records.begin(), Records.end(), List.records);
+}
+
+static CXChildVisitResult visitCursorForRecords(CXCursor C, CXCursor Parent,
+                                                CXClientData Data) {
+  return static_cast<CursorRecordCollector *>(Data)->visit(C, Parent);
+}
+
+extern "C" {
+
+CXCursorRecordList *clang_getCursorRecords(CXCursor parent, CXFile file,
+                                           unsigned options) {
+  AllocatedCXCursorRecordList *List = new AllocatedCXCursorRecordList;
+  List->count = 0;
+  List->records = nullptr;
+
+  if (clang_Cursor_isNull(parent))
+    return List;
+  CXTranslationUnit TU = cxcursor::getCursorTU(parent);
+  if (cxtu::isNotUsableTU(TU)) {
+    LOG_BAD_TU(TU);
+    return List;
+  }
+
+  CursorRecordCollector Collector(file, options & CXCursorRecord_IncludeUSRs,
+                                  List->Arena);
+  clang_visitChildren(parent, visitCursorForRecords, &Collector);
+  Collector.finish(*List);
+
+  LOG_FUNC_SECTION {
+    *Log << parent << ": " << List->count << " records";
+  }
+  return List;
+}
+
+void clang_disposeCursorRecordList(CXCursorRecordList *records) {
+  delete static_cast<AllocatedCXCursorRecordList *>(records);
+}
+
+} // end extern "C"
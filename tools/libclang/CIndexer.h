@@ -16,6 +16,8 @@
 #define LLVM_CLANG_TOOLS_LIBCLANG_CINDEXER_H
 
 #include "clang-c/Index.h"
+#include "clang/Basic/FileSystemStatCache.h"
+#include "clang/Frontend/InMemoryPreambleStore.h"
 #include "clang/Frontend/PCHContainerOperations.h"
 #include "clang/Lex/ModuleLoader.h"
 #include "llvm/ADT/StringRef.h"
@@ -43,13 +45,30 @@ class CIndexer {
   std::string ResourcesPath;
   std::shared_ptr<PCHContainerOperations> PCHContainerOps;
 
+  /// \brief Stat and file content cache shared by the translation units of
+  /// this index, if enabled.
+  IntrusiveRefCntPtr<SharedFileSystemCache> SharedFileCache;
+
+  /// \brief Whether the precompiled preambles of the translation units of
+  /// this index are layered.
+  bool LayeredPreambles;
+
+  /// \brief The precompiled preambles that translation units of this index
+  /// keep in memory.
+  IntrusiveRefCntPtr<InMemoryPreambleStore> PreambleStore;
+
 public:
   CIndexer(std::shared_ptr<PCHContainerOperations> PCHContainerOps =
                std::make_shared<PCHContainerOperations>())
       : OnlyLocalDecls(false), DisplayDiagnostics(false),
-        Options(CXGlobalOpt_None), PCHContainerOps(std::move(PCHContainerOps)) {
+        Options(CXGlobalOpt_None), PCHContainerOps(std::move(PCHContainerOps)),
+        LayeredPreambles(false),
+        PreambleStore(new InMemoryPreambleStore(DefaultInMemoryPreambleLimit)) {
   }
 
+  /// \brief The default number of bytes of preambles kept in memory.
+  static const uint64_t DefaultInMemoryPreambleLimit = 1ULL << 30;
+
   /// \brief Whether we only want to see "local" declarations (that did not
   /// come from a previous precompiled header). If false, we want to see all
   /// declarations.
@@ -72,6 +91,20 @@ public:
     return Options & opt;
   }
 
+  SharedFileSystemCache *getSharedFileCache() const {
+    return SharedFileCache.get();
+  }
+  void setSharedFileCache(IntrusiveRefCntPtr<SharedFileSystemCache> Cache) {
+    SharedFileCache = std::move(Cache);
+  }
+
+  InMemoryPreambleStore *getInMemoryPreambleStore() const {
+    return PreambleStore.get();
+  }
+
+  bool getLayeredPreambles() const { return LayeredPreambles; }
+  void setLayeredPreambles(bool Layered = true) { LayeredPreambles = Layered; }
+
   /// \brief Get the path of the clang resource files.
   const std::string &getClangResourcesPath();
 };
@@ -10,8 +10,10 @@
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/FileSystemOptions.h"
 #include "clang/Basic/FileSystemStatCache.h"
+#include "clang/Basic/VirtualFileSystem.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/llvm-config.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -246,6 +248,236 @@ TEST_F(FileManagerTest, addRemoveStatCache) {
   manager.removeStatCache(statCache);
 }
 
+// Files stat'ed and read through one FileManager are served from the shared
+// cache to other FileManagers using it over the same file system.
+TEST_F(FileManagerTest, sharedCacheIsUsedAcrossFileManagers) {
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+
+  IntrusiveRefCntPtr<vfs::InMemoryFileSystem> FS(
+      new vfs::InMemoryFileSystem);
+  FS->addFile("/dir/a.h", 0, MemoryBuffer::getMemBuffer("int a;"));
+  FileManager First(options, FS);
+  First.setSharedCache(Cache);
+  const FileEntry *FirstEntry = First.getFile("/dir/a.h");
+  ASSERT_TRUE(FirstEntry != nullptr);
+  auto FirstBuffer = First.getBufferForFile(FirstEntry);
+  ASSERT_TRUE(bool(FirstBuffer));
+  EXPECT_EQ("int a;", (*FirstBuffer)->getBuffer());
+
+  FileManager Second(options, FS);
+  Second.setSharedCache(Cache);
+  const FileEntry *SecondEntry = Second.getFile("/dir/a.h");
+  ASSERT_TRUE(SecondEntry != nullptr);
+  EXPECT_EQ(FirstEntry->getUniqueID(), SecondEntry->getUniqueID());
+  auto SecondBuffer = Second.getBufferForFile(SecondEntry);
+  ASSERT_TRUE(bool(SecondBuffer));
+  EXPECT_EQ((*FirstBuffer)->getBufferStart(),
+            (*SecondBuffer)->getBufferStart());
+
+  // Volatile reads bypass the cache.
+  Cache->clear();
+  auto VolatileBuffer = Second.getBufferForFile(SecondEntry,
+                                                /*isVolatile=*/true);
+  ASSERT_TRUE(bool(VolatileBuffer));
+  EXPECT_EQ("int a;", (*VolatileBuffer)->getBuffer());
+  EXPECT_EQ(0u, Cache->getNumBuffers());
+}
+
+// Entries cached for one file system are not visible through another.
+TEST_F(FileManagerTest, sharedCacheIsPerFileSystem) {
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+
+  IntrusiveRefCntPtr<vfs::InMemoryFileSystem> FS(
+      new vfs::InMemoryFileSystem);
+  FS->addFile("/dir/a.h", 0, MemoryBuffer::getMemBuffer("int a;"));
+  FileManager First(options, FS);
+  First.setSharedCache(Cache);
+  const FileEntry *FirstEntry = First.getFile("/dir/a.h");
+  ASSERT_TRUE(FirstEntry != nullptr);
+  ASSERT_TRUE(bool(First.getBufferForFile(FirstEntry)));
+
+  // The second file system doesn't contain the file at all.
+  FileManager Second(options, new vfs::InMemoryFileSystem);
+  Second.setSharedCache(Cache);
+  EXPECT_EQ(nullptr, Second.getFile("/dir/a.h"));
+}
+
+// Cached stats and contents are trusted until the file is invalidated, which
+// drops both.
+TEST_F(FileManagerTest, sharedCacheIsTrustedUntilInvalidated) {
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+
+  IntrusiveRefCntPtr<vfs::InMemoryFileSystem> Old(
+      new vfs::InMemoryFileSystem);
+  Old->addFile("/dir/a.h", 0, MemoryBuffer::getMemBuffer("int a;"));
+  IntrusiveRefCntPtr<vfs::OverlayFileSystem> FS(
+      new vfs::OverlayFileSystem(Old));
+  FileManager First(options, FS);
+  First.setSharedCache(Cache);
+  const FileEntry *FirstEntry = First.getFile("/dir/a.h");
+  ASSERT_TRUE(FirstEntry != nullptr);
+  ASSERT_TRUE(bool(First.getBufferForFile(FirstEntry)));
+  EXPECT_EQ(1u, Cache->getNumBuffers());
+
+  // Edit the file: it gets a new size and modification time.
+  IntrusiveRefCntPtr<vfs::InMemoryFileSystem> New(
+      new vfs::InMemoryFileSystem);
+  New->addFile("/dir/a.h", 1, MemoryBuffer::getMemBuffer("int aa;"));
+  FS->pushOverlay(New);
+
+  // Until the file is invalidated, the other FileManagers get the cached
+  // stat and contents without looking at the file again.
+  FileManager Second(options, FS);
+  Second.setSharedCache(Cache);
+  const FileEntry *SecondEntry = Second.getFile("/dir/a.h");
+  ASSERT_TRUE(SecondEntry != nullptr);
+  EXPECT_EQ(6, SecondEntry->getSize());
+  auto SecondBuffer = Second.getBufferForFile(SecondEntry);
+  ASSERT_TRUE(bool(SecondBuffer));
+  EXPECT_EQ("int a;", (*SecondBuffer)->getBuffer());
+
+  First.invalidateSharedCache("/dir/a.h");
+  EXPECT_EQ(0u, Cache->getNumBuffers());
+  EXPECT_EQ(0u, Cache->getBufferBytes());
+
+  // The stale stat was dropped along with the contents.
+  FileManager Third(options, FS);
+  Third.setSharedCache(Cache);
+  const FileEntry *ThirdEntry = Third.getFile("/dir/a.h");
+  ASSERT_TRUE(ThirdEntry != nullptr);
+  EXPECT_EQ(7, ThirdEntry->getSize());
+  auto ThirdBuffer = Third.getBufferForFile(ThirdEntry);
+  ASSERT_TRUE(bool(ThirdBuffer));
+  EXPECT_EQ("int aa;", (*ThirdBuffer)->getBuffer());
+  EXPECT_EQ(1u, Cache->getNumBuffers());
+
+  Third.invalidateCache(ThirdEntry);
+  EXPECT_EQ(0u, Cache->getNumBuffers());
+  EXPECT_EQ(0u, Cache->getBufferBytes());
+}
+
+// The cached contents are bounded, the least recently used ones are dropped
+// first, and buffers handed out outlive their entries.
+TEST_F(FileManagerTest, sharedCacheIsBounded) {
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(
+      new SharedFileSystemCache(/*MaxBufferBytes=*/12));
+
+  IntrusiveRefCntPtr<vfs::InMemoryFileSystem> FS(
+      new vfs::InMemoryFileSystem);
+  FS->addFile("/dir/a.h", 0, MemoryBuffer::getMemBuffer("int a;"));
+  FS->addFile("/dir/b.h", 0, MemoryBuffer::getMemBuffer("int b;"));
+  FS->addFile("/dir/c.h", 0, MemoryBuffer::getMemBuffer("int c;"));
+  FileManager Files(options, FS);
+  Files.setSharedCache(Cache);
+
+  const FileEntry *A = Files.getFile("/dir/a.h");
+  ASSERT_TRUE(A != nullptr);
+  auto ABuffer = Files.getBufferForFile(A);
+  ASSERT_TRUE(bool(ABuffer));
+  const FileEntry *B = Files.getFile("/dir/b.h");
+  ASSERT_TRUE(B != nullptr);
+  auto BBuffer = Files.getBufferForFile(B);
+  ASSERT_TRUE(bool(BBuffer));
+  EXPECT_EQ(2u, Cache->getNumBuffers());
+
+  // Using a.h again makes b.h the least recently used.
+  auto AAgain = Files.getBufferForFile(A);
+  ASSERT_TRUE(bool(AAgain));
+  EXPECT_EQ((*ABuffer)->getBufferStart(), (*AAgain)->getBufferStart());
+
+  const FileEntry *C = Files.getFile("/dir/c.h");
+  ASSERT_TRUE(C != nullptr);
+  auto CBuffer = Files.getBufferForFile(C);
+  ASSERT_TRUE(bool(CBuffer));
+  EXPECT_EQ(2u, Cache->getNumBuffers());
+  EXPECT_EQ(12u, Cache->getBufferBytes());
+
+  auto BAgain = Files.getBufferForFile(B);
+  ASSERT_TRUE(bool(BAgain));
+  EXPECT_NE((*BBuffer)->getBufferStart(), (*BAgain)->getBufferStart());
+  EXPECT_EQ("int a;", (*ABuffer)->getBuffer());
+  EXPECT_EQ("int b;", (*BBuffer)->getBuffer());
+  EXPECT_EQ("int c;", (*CBuffer)->getBuffer());
+}
+
+// Contents read without a null terminator are only shared with clients that
+// don't need one either.
+TEST_F(FileManagerTest, sharedCacheTracksNullTermination) {
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+
+  IntrusiveRefCntPtr<vfs::InMemoryFileSystem> FS(
+      new vfs::InMemoryFileSystem);
+  FS->addFile("/dir/a.pcm", 0, MemoryBuffer::getMemBuffer("CPCH"));
+  FileManager First(options, FS);
+  First.setSharedCache(Cache);
+  const FileEntry *FirstEntry = First.getFile("/dir/a.pcm");
+  ASSERT_TRUE(FirstEntry != nullptr);
+  auto FirstBuffer =
+      First.getBufferForFile(FirstEntry, /*isVolatile=*/false,
+                             /*ShouldCloseOpenFile=*/true,
+                             /*RequiresNullTerminator=*/false);
+  ASSERT_TRUE(bool(FirstBuffer));
+
+  FileManager Second(options, FS);
+  Second.setSharedCache(Cache);
+  const FileEntry *SecondEntry = Second.getFile("/dir/a.pcm");
+  ASSERT_TRUE(SecondEntry != nullptr);
+  auto SecondBuffer =
+      Second.getBufferForFile(SecondEntry, /*isVolatile=*/false,
+                              /*ShouldCloseOpenFile=*/true,
+                              /*RequiresNullTerminator=*/false);
+  ASSERT_TRUE(bool(SecondBuffer));
+  EXPECT_EQ((*FirstBuffer)->getBufferStart(),
+            (*SecondBuffer)->getBufferStart());
+  EXPECT_EQ(1u, Cache->getNumBuffers());
+
+  // A client that needs the terminator reads the file again, and then both
+  // kinds of clients can use the null-terminated copy.
+  auto Terminated = Second.getBufferForFile(SecondEntry);
+  ASSERT_TRUE(bool(Terminated));
+  EXPECT_EQ("CPCH", (*Terminated)->getBuffer());
+  EXPECT_EQ(2u, Cache->getNumBuffers());
+}
+
+// A file replaced by another one of the same size and modification time, as
+// a rebuilt module file can be, can be invalidated by path.
+TEST_F(FileManagerTest, sharedCacheHandlesReplacedFiles) {
+  IntrusiveRefCntPtr<SharedFileSystemCache> Cache(new SharedFileSystemCache);
+
+  IntrusiveRefCntPtr<vfs::InMemoryFileSystem> Old(
+      new vfs::InMemoryFileSystem);
+  Old->addFile("/dir/a.pcm", 0, MemoryBuffer::getMemBuffer("CPCH"));
+  IntrusiveRefCntPtr<vfs::OverlayFileSystem> FS(
+      new vfs::OverlayFileSystem(Old));
+  FileManager First(options, FS);
+  First.setSharedCache(Cache);
+  const FileEntry *FirstEntry = First.getFile("/dir/a.pcm");
+  ASSERT_TRUE(FirstEntry != nullptr);
+  ASSERT_TRUE(bool(First.getBufferForFile(FirstEntry)));
+  EXPECT_EQ(1u, Cache->getNumBuffers());
+
+  IntrusiveRefCntPtr<vfs::InMemoryFileSystem> New(
+      new vfs::InMemoryFileSystem);
+  New->addFile("/dir/a.pcm", 0, MemoryBuffer::getMemBuffer("DPCH"));
+  FS->pushOverlay(New);
+  First.invalidateSharedCache("/dir/a.pcm");
+  EXPECT_EQ(0u, Cache->getNumBuffers());
+
+  FileManager Second(options, FS);
+  Second.setSharedCache(Cache);
+  const FileEntry *SecondEntry = Second.getFile("/dir/a.pcm");
+  ASSERT_TRUE(SecondEntry != nullptr);
+  auto SecondBuffer = Second.getBufferForFile(SecondEntry);
+  ASSERT_TRUE(bool(SecondBuffer));
+  EXPECT_EQ("DPCH", (*SecondBuffer)->getBuffer());
+
+  ASSERT_TRUE(bool(Second.getBufferForFile(Second.getFile("/dir/a.pcm"))));
+  EXPECT_EQ(1u, Cache->getNumBuffers());
+  Second.invalidateSharedCache("/dir/a.pcm");
+  EXPECT_EQ(0u, Cache->getNumBuffers());
+  EXPECT_EQ(0u, Cache->getBufferBytes());
+}
+
 #endif  // !LLVM_ON_WIN32
 
 } // anonymous namespace
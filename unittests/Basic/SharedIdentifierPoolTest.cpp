@@ -0,0 +1,113 @@
+//===- unittests/Basic/SharedIdentifierPoolTest.cpp -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/SharedIdentifierPool.h"
+#include "clang/Basic/IdentifierTable.h"
+#include "clang/Basic/LangOptions.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/Twine.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+TEST(SharedIdentifierPoolTest, InternsNames) {
+  // Start small so that the pool has to grow.
+  SharedIdentifierPool Pool(4);
+  EXPECT_EQ(nullptr, Pool.find("foo"));
+
+  const SharedIdentifierPool::Entry *Foo = Pool.intern("foo");
+  ASSERT_NE(nullptr, Foo);
+  EXPECT_EQ("foo", Foo->getName());
+  EXPECT_EQ('\0', Foo->getNameStart()[3]);
+  EXPECT_EQ(Foo, Pool.find("foo"));
+  EXPECT_EQ(Foo, Pool.intern("foo"));
+
+  std::vector<const SharedIdentifierPool::Entry *> Entries;
+  for (unsigned I = 0; I != 1000; ++I)
+    Entries.push_back(Pool.intern(("name" + Twine(I)).str()));
+  EXPECT_EQ(1001U, Pool.size());
+  for (unsigned I = 0; I != 1000; ++I) {
+    EXPECT_EQ(Entries[I], Pool.find(("name" + Twine(I)).str()));
+    EXPECT_EQ(I + 1, Entries[I]->getID());
+  }
+  EXPECT_EQ(Foo, Pool.find("foo"));
+
+  EXPECT_EQ(nullptr,
+            Pool.intern(std::string(SharedIdentifierPool::MaxNameLength + 1,
+                                    'x')));
+}
+
+TEST(SharedIdentifierPoolTest, ConcurrentIntern) {
+  SharedIdentifierPool Pool(16);
+  const unsigned NumThreads = 4, NumNames = 2000;
+  std::vector<std::vector<const SharedIdentifierPool::Entry *>> Results(
+      NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Threads.emplace_back([&Pool, &Results, T] {
+      for (unsigned I = 0; I != NumNames; ++I)
+        Results[T].push_back(Pool.intern(("id" + Twine(I)).str()));
+    });
+  for (std::thread &T : Threads)
+    T.join();
+
+  EXPECT_EQ(NumNames, Pool.size());
+  for (unsigned T = 1; T != NumThreads; ++T)
+    EXPECT_EQ(Results[0], Results[T]);
+}
+
+TEST(SharedIdentifierPoolTest, IdentifierTablesShareNames) {
+  IntrusiveRefCntPtr<SharedIdentifierPool> Pool(new SharedIdentifierPool());
+  LangOptions LangOpts;
+  IdentifierTable Table1(LangOpts, nullptr, Pool);
+  IdentifierTable Table2(LangOpts, nullptr, Pool);
+
+  IdentifierInfo &A1 = Table1.get("some_identifier");
+  IdentifierInfo &A2 = Table2.get("some_identifier");
+  EXPECT_NE(&A1, &A2);
+  EXPECT_EQ("some_identifier", A1.getName());
+  EXPECT_EQ(A1.getNameStart(), A2.getNameStart());
+  EXPECT_EQ(&A1, &Table1.get("some_identifier"));
+
+  // Identifier state is not shared.
+  A1.setIsPoisoned(true);
+  EXPECT_FALSE(A2.isPoisoned());
+
+  // Keywords and contextual keywords are still set up per table.
+  EXPECT_EQ(tok::kw_int, Table1.get("int").getTokenID());
+  EXPECT_TRUE(Table2.get("import").isModulesImport());
+
+  // Names too long for the pool are stored in the table.
+  std::string Long(SharedIdentifierPool::MaxNameLength + 1, 'x');
+  IdentifierInfo &L = Table1.get(Long);
+  EXPECT_EQ(Long, L.getName());
+  EXPECT_EQ(&L, &Table1.get(Long));
+
+  // Iteration sees every identifier of the table once.
+  StringSet<> Seen;
+  unsigned Count = 0;
+  for (const auto &Id : Table1) {
+    EXPECT_EQ(Id.first, Id.second->getName());
+    Seen.insert(Id.first);
+    ++Count;
+  }
+  EXPECT_EQ(Table1.size(), Count);
+  EXPECT_EQ(Count, Seen.size());
+  EXPECT_TRUE(Seen.count("some_identifier"));
+  EXPECT_TRUE(Seen.count("int"));
+  EXPECT_TRUE(Seen.count(Long));
+}
+
+} // anonymous namespace
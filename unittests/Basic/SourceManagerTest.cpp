@@ -171,6 +171,45 @@ TEST_F(SourceManagerTest, getColumnNumber) {
   EXPECT_EQ(1U, SourceMgr.getColumnNumber(MainFileID, 0, nullptr));
 }
 
+TEST_F(SourceManagerTest, getLineNumberInLargeBuffer) {
+  // Enough lines, with a mix of line endings, that the line table is built
+  // in several chunks.
+  std::string Source;
+  std::vector<unsigned> LineStarts;
+  for (unsigned I = 0; I != 40000; ++I) {
+    LineStarts.push_back(Source.size());
+    Source += std::string(1 + I % 37, 'x');
+    Source += I % 3 == 0 ? "\r\n" : I % 3 == 1 ? "\n" : "\r";
+  }
+  LineStarts.push_back(Source.size());
+  Source += "last";
+
+  std::unique_ptr<llvm::MemoryBuffer> Buf =
+      llvm::MemoryBuffer::getMemBuffer(Source);
+  FileID MainFileID = SourceMgr.createFileID(std::move(Buf));
+  SourceMgr.setMainFileID(MainFileID);
+  SourceLocation StartLoc = SourceMgr.getLocForStartOfFile(MainFileID);
+
+  // Query near the end first, then jump around.
+  unsigned Lines[] = {39000, 2, 40001, 1, 20000, 39999, 12345, 30000};
+  for (unsigned Line : Lines) {
+    bool Invalid = false;
+    EXPECT_EQ(Line, SourceMgr.getLineNumber(MainFileID, LineStarts[Line - 1],
+                                            &Invalid));
+    EXPECT_FALSE(Invalid);
+    EXPECT_EQ(StartLoc.getLocWithOffset(LineStarts[Line - 1]),
+              SourceMgr.translateLineCol(MainFileID, Line, 1));
+  }
+
+  // Lines are found on demand when translating line numbers, too.
+  FileID OtherFileID = SourceMgr.createFileID(
+      llvm::MemoryBuffer::getMemBuffer(Source));
+  EXPECT_EQ(SourceMgr.getLocForStartOfFile(OtherFileID)
+                .getLocWithOffset(LineStarts[39999]),
+            SourceMgr.translateLineCol(OtherFileID, 40000, 1));
+  EXPECT_EQ(40000U, SourceMgr.getLineNumber(OtherFileID, LineStarts[39999]));
+}
+
 #if defined(LLVM_ON_UNIX)
 
 TEST_F(SourceManagerTest, getMacroArgExpandedLocation) {
@@ -0,0 +1,115 @@
+//===- unittests/Frontend/InMemoryPreambleStoreTest.cpp -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/InMemoryPreambleStore.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+std::unique_ptr<MemoryBuffer> makeBuffer(size_t Size) {
+  return MemoryBuffer::getMemBufferCopy(std::string(Size, 'x'));
+}
+
+TEST(InMemoryPreambleStore, EvictsLeastRecentlyUsed) {
+  IntrusiveRefCntPtr<InMemoryPreambleStore> Store(
+      new InMemoryPreambleStore(300));
+  std::string A = Store->createPath(), B = Store->createPath(),
+              C = Store->createPath();
+  EXPECT_NE(A, B);
+
+  ASSERT_TRUE(Store->store(A, makeBuffer(100)));
+  ASSERT_TRUE(Store->store(B, makeBuffer(100)));
+  EXPECT_EQ(200u, Store->getSize());
+
+  // Using A makes B the least recently used preamble.
+  EXPECT_TRUE(Store->contains(A));
+  ASSERT_TRUE(Store->store(C, makeBuffer(150)));
+  EXPECT_TRUE(Store->contains(A));
+  EXPECT_FALSE(Store->contains(B));
+  EXPECT_TRUE(Store->contains(C));
+  EXPECT_EQ(250u, Store->getSize());
+
+  // A preamble larger than the store is refused.
+  EXPECT_FALSE(Store->store(B, makeBuffer(301)));
+  EXPECT_EQ(250u, Store->getSize());
+
+  Store->setMaxSize(200);
+  EXPECT_FALSE(Store->contains(A));
+  EXPECT_EQ(150u, Store->getSize());
+
+  Store->remove(C);
+  EXPECT_EQ(0u, Store->getSize());
+}
+
+TEST(InMemoryPreambleStore, KeepsPinnedPreambles) {
+  IntrusiveRefCntPtr<InMemoryPreambleStore> Store(
+      new InMemoryPreambleStore(300));
+  std::string A = Store->createPath(), B = Store->createPath(),
+              C = Store->createPath();
+  ASSERT_TRUE(Store->store(A, makeBuffer(100)));
+  ASSERT_TRUE(Store->store(B, makeBuffer(100)));
+  EXPECT_FALSE(Store->pin(C));
+
+  // A is the least recently used preamble, but it is pinned, so B is evicted
+  // instead.
+  std::shared_ptr<const InMemoryPreambleStore::Entry> Pin = Store->pin(A);
+  ASSERT_TRUE(bool(Pin));
+  EXPECT_TRUE(Store->contains(B));
+  ASSERT_TRUE(Store->store(C, makeBuffer(150)));
+  EXPECT_TRUE(Store->contains(A));
+  EXPECT_FALSE(Store->contains(B));
+
+  // A preamble that only fits by evicting pinned ones is refused.
+  EXPECT_FALSE(Store->store(B, makeBuffer(250)));
+  EXPECT_TRUE(Store->contains(C));
+
+  // Shrinking the store leaves A alone until it is unpinned.
+  Store->setMaxSize(100);
+  EXPECT_TRUE(Store->contains(A));
+  EXPECT_FALSE(Store->contains(C));
+  Store->setMaxSize(50);
+  EXPECT_TRUE(Store->contains(A));
+  Pin.reset();
+  EXPECT_FALSE(Store->contains(A));
+  EXPECT_EQ(0u, Store->getSize());
+}
+
+TEST(InMemoryPreambleStore, ServesPreamblesThroughFileSystem) {
+  IntrusiveRefCntPtr<InMemoryPreambleStore> Store(
+      new InMemoryPreambleStore(1000));
+  IntrusiveRefCntPtr<vfs::InMemoryFileSystem> Base(
+      new vfs::InMemoryFileSystem);
+  Base->addFile("/other.h", 0, MemoryBuffer::getMemBuffer("int x;"));
+  IntrusiveRefCntPtr<vfs::FileSystem> FS = Store->getFileSystem(Base);
+
+  std::string Path = Store->createPath();
+  EXPECT_FALSE(FS->status(Path));
+  ASSERT_TRUE(Store->store(Path, MemoryBuffer::getMemBufferCopy("PCH")));
+
+  ErrorOr<vfs::Status> Status = FS->status(Path);
+  ASSERT_TRUE(bool(Status));
+  EXPECT_EQ(3u, Status->getSize());
+  EXPECT_TRUE(FS->exists("/other.h"));
+
+  // The buffer outlives the eviction of the preamble.
+  auto Buffer = FS->getBufferForFile(Path, -1, false);
+  ASSERT_TRUE(bool(Buffer));
+  auto Terminated = FS->getBufferForFile(Path, -1, true);
+  ASSERT_TRUE(bool(Terminated));
+  EXPECT_EQ('\0', *(*Terminated)->getBufferEnd());
+  Store->remove(Path);
+  EXPECT_FALSE(FS->exists(Path));
+  EXPECT_EQ("PCH", (*Buffer)->getBuffer());
+}
+
+} // anonymous namespace
@@ -380,4 +380,49 @@ TEST_F(LexerTest, DontMergeMacroArgsFromDifferentMacroFiles) {
   EXPECT_EQ(SourceMgr.getFileIDSize(SourceMgr.getFileID(helper1ArgLoc)), 8U);
 }
 
+TEST_F(LexerTest, LongTokensAcrossBlockBoundaries) {
+  // Identifiers, whitespace runs, line comments and string literals of every
+  // length up to a few 16-byte blocks, ending at every offset.
+  std::string Source;
+  std::vector<std::string> Identifiers, Strings;
+  for (unsigned Len = 1; Len != 50; ++Len) {
+    std::string Id(Len, 'a' + Len % 26);
+    Id[Len / 2] = Len % 2 ? '_' : 'Z';
+    if (Len > 2)
+      Id[Len - 1] = '0' + Len % 10;
+    Identifiers.push_back(Id);
+    Source += std::string(Len, Len % 3 ? ' ' : '\t') + Id;
+    Source += "// " + std::string(Len, '*') + "\n";
+
+    std::string Str = "\"" + std::string(Len, 'x');
+    if (Len % 5 == 0)
+      Str.insert(Len / 2, "\\\"");
+    Str += "\"";
+    Strings.push_back(Str);
+    Source += Str + "\n";
+  }
+  // An identifier running up to the end of the buffer.
+  Source += std::string(40, 'e');
+
+  std::vector<Token> Toks = Lex(Source);
+  auto Spelling = [&](const Token &Tok) {
+    return StringRef(SourceMgr.getCharacterData(Tok.getLocation()),
+                     Tok.getLength());
+  };
+  ASSERT_EQ(Identifiers.size() * 2 + 1, Toks.size());
+  for (unsigned I = 0, E = Identifiers.size(); I != E; ++I) {
+    const Token &Id = Toks[2 * I];
+    ASSERT_EQ(tok::identifier, Id.getKind());
+    EXPECT_EQ(Identifiers[I], Spelling(Id));
+    EXPECT_TRUE(Id.isAtStartOfLine());
+    EXPECT_TRUE(Id.hasLeadingSpace());
+
+    const Token &Str = Toks[2 * I + 1];
+    ASSERT_EQ(tok::string_literal, Str.getKind());
+    EXPECT_EQ(Strings[I], Spelling(Str));
+    EXPECT_TRUE(Str.isAtStartOfLine());
+  }
+  EXPECT_EQ(std::string(40, 'e'), Spelling(Toks.back()));
+}
+
 } // anonymous namespace
@@ -22,6 +22,7 @@
 #include "llvm/Support/TargetRegistry.h"
 #include "gtest/gtest.h"
 #include <algorithm>
+#include <atomic>
 #include <string>
 
 namespace clang {
@@ -460,6 +461,35 @@ TEST(ClangToolTest, BuildASTs) {
   EXPECT_EQ(2u, ASTs.size());
 }
 
+namespace {
+class CountingFrontendActionFactory : public FrontendActionFactory {
+public:
+  CountingFrontendActionFactory() : NumCreated(0) {}
+  FrontendAction *create() override {
+    ++NumCreated;
+    return new SyntaxOnlyAction;
+  }
+  std::atomic<unsigned> NumCreated;
+};
+} // end namespace
+
+TEST(ClangToolTest, RunConcurrently) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+
+  std::vector<std::string> Sources;
+  for (unsigned I = 0; I != 8; ++I)
+    Sources.push_back("/f" + std::to_string(I) + ".cc");
+  ClangTool Tool(Compilations, Sources);
+  for (unsigned I = 0; I != 8; ++I)
+    Tool.mapVirtualFile(Sources[I], I == 5 ? "int x = undeclared;"
+                                           : "#include \"/h.h\"\nvoid f();");
+  Tool.mapVirtualFile("/h.h", "struct S {};");
+
+  CountingFrontendActionFactory Action;
+  EXPECT_EQ(1, Tool.runConcurrently(&Action, 4));
+  EXPECT_EQ(8u, Action.NumCreated);
+}
+
 struct TestDiagnosticConsumer : public DiagnosticConsumer {
   TestDiagnosticConsumer() : NumDiagnosticsSeen(0) {}
   void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
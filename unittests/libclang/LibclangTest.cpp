@@ -15,6 +15,7 @@
 #include "gtest/gtest.h"
 #include <fstream>
 #include <set>
+#include <thread>
 #define DEBUG_TYPE "libclang-test"
 
 TEST(libclang, clang_parseTranslationUnit2_InvalidArgs) {
@@ -433,6 +434,61 @@ TEST_F(LibclangReparseTest, Reparse) {
   EXPECT_EQ(0U, clang_getNumDiagnostics(ClangTU));
 }
 
+static bool hasCompletion(CXCodeCompleteResults *Results, const char *Name) {
+  for (unsigned I = 0; I != Results->NumResults; ++I) {
+    CXCompletionString Completion = Results->Results[I].CompletionString;
+    for (unsigned J = 0, N = clang_getNumCompletionChunks(Completion); J != N;
+         ++J) {
+      if (clang_getCompletionChunkKind(Completion, J) !=
+          CXCompletionChunk_TypedText)
+        continue;
+      CXString Text = clang_getCompletionChunkText(Completion, J);
+      bool Found = llvm::StringRef(clang_getCString(Text)) == Name;
+      clang_disposeString(Text);
+      if (Found)
+        return true;
+    }
+  }
+  return false;
+}
+
+TEST_F(LibclangReparseTest, CodeCompleteSnapshotDuringReparse) {
+  std::string HeaderName = "HeaderFile.h";
+  std::string CppName = "CppFile.cpp";
+  WriteFile(HeaderName, "struct Foo { int bar; };\n");
+  WriteFile(CppName, "#include \"HeaderFile.h\"\n"
+                     "void f(Foo foo) {\n"
+                     "  foo.\n"
+                     "}\n");
+
+  ClangTU = clang_parseTranslationUnit(Index, CppName.c_str(), nullptr, 0,
+                                       nullptr, 0, TUFlags);
+  ASSERT_TRUE(ReparseTU(0, nullptr /* No unsaved files. */));
+  unsigned Version = clang_getTranslationUnitSnapshotVersion(ClangTU);
+  EXPECT_EQ(2U, Version);
+
+  // Complete against the snapshot while the translation unit is reparsed to
+  // pick up a change to the header, which replaces the preamble.
+  WriteFile(HeaderName, "struct Foo { int bar; int baz; };\n");
+  std::thread Reparse([this] { EXPECT_TRUE(ReparseTU(0, nullptr)); });
+  for (unsigned I = 0; I != 5; ++I) {
+    CXCodeCompleteResults *Results =
+        clang_codeCompleteAt(ClangTU, CppName.c_str(), 3, 7, nullptr, 0,
+                             CXCodeComplete_UseSnapshot);
+    EXPECT_TRUE(Results);
+    if (!Results)
+      continue;
+    unsigned ResultsVersion = clang_codeCompleteGetSnapshotVersion(Results);
+    EXPECT_TRUE(ResultsVersion == Version || ResultsVersion == Version + 1);
+    // Either way, completion sees the header as it is now.
+    EXPECT_TRUE(hasCompletion(Results, "bar"));
+    EXPECT_TRUE(hasCompletion(Results, "baz"));
+    clang_disposeCodeCompleteResults(Results);
+  }
+  Reparse.join();
+  EXPECT_EQ(Version + 1, clang_getTranslationUnitSnapshotVersion(ClangTU));
+}
+
 TEST_F(LibclangReparseTest, ReparseWithModule) {
   const char *HeaderTop = "#ifndef H\n#define H\nstruct Foo { int bar;";
   const char *HeaderBottom = "\n};\n#endif\n";
@@ -0,0 +1,77 @@
+#!/usr/bin/env python
+
+"""
+Lexer microbenchmark.
+
+Generates a large synthetic header made of long identifiers, deep indentation,
+line comments and string literals, then times 'clang -cc1 -Eonly' over it.
+-Eonly runs the preprocessor without printing, so the time is dominated by
+the raw lexer.
+
+Usage: lexer-bench.py [--clang PATH] [--lines N] [--runs N] [--keep FILE]
+"""
+
+import optparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+def generate(out, lines):
+    for i in range(lines):
+        indent = ' ' * (4 * (i % 8))
+        ident = 'some_reasonably_long_identifier_name_%d' % i
+        if i % 4 == 0:
+            out.write('%s// %s\n' % (indent,
+                      'A line comment that runs past a few vector widths.'))
+        elif i % 4 == 1:
+            out.write('%sint %s = %d;\n' % (indent, ident, i))
+        elif i % 4 == 2:
+            out.write('%sconst char *%s_str = "%s \\"quoted\\" text";\n' %
+                      (indent, ident, 'string literal contents ' * 3))
+        else:
+            out.write('%s/* %s */\n' % (indent, 'block comment ' * 4))
+
+def main():
+    parser = optparse.OptionParser(usage=__doc__.strip())
+    parser.add_option('--clang', default='clang',
+                      help='clang binary to benchmark [%default]')
+    parser.add_option('--lines', type=int, default=1000000,
+                      help='number of lines to generate [%default]')
+    parser.add_option('--runs', type=int, default=5,
+                      help='number of timed runs [%default]')
+    parser.add_option('--keep', metavar='FILE',
+                      help='write the generated header to FILE and keep it')
+    opts, args = parser.parse_args()
+    if args:
+        parser.error('unexpected arguments')
+
+    if opts.keep:
+        path = opts.keep
+        out = open(path, 'w')
+    else:
+        fd, path = tempfile.mkstemp(suffix='.h')
+        out = os.fdopen(fd, 'w')
+    with out:
+        generate(out, opts.lines)
+
+    size = os.path.getsize(path)
+    try:
+        cmd = [opts.clang, '-cc1', '-Eonly', path]
+        times = []
+        for i in range(opts.runs):
+            start = time.time()
+            subprocess.check_call(cmd)
+            times.append(time.time() - start)
+    finally:
+        if not opts.keep:
+            os.remove(path)
+
+    times.sort()
+    print('runs: %d  min: %.3fs  median: %.3fs  max: %.3fs' %
+          (len(times), times[0], times[len(times) // 2], times[-1]))
+    print('throughput: %.1f MB/s' % (size / times[0] / 1e6))
+
+if __name__ == '__main__':
+    main()
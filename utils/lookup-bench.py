@@ -0,0 +1,99 @@
+#!/usr/bin/env python
+
+"""
+Name lookup microbenchmark.
+
+Generates a translation unit with one very large namespace, in the style of
+generated protocol buffer code: one class, one accessor and one overload of a
+shared 'serialize' function per message, spread over several reopenings of
+the namespace. It then looks each member up, both by qualified name and
+through a using-directive, and times 'clang -cc1 -fsyntax-only' over it, so
+the time is dominated by Sema::LookupName and the DeclContext lookup tables.
+
+Usage: lookup-bench.py [--clang PATH] [--members N] [--reopen N]
+                       [--runs N] [--keep FILE]
+"""
+
+import optparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+def generate(out, members, reopen):
+    per_block = (members + reopen - 1) // reopen
+    for block in range(reopen):
+        out.write('namespace gen {\n')
+        end = min(members, (block + 1) * per_block)
+        for i in range(block * per_block, end):
+            out.write('class Message%d { public: int field_%d; };\n' % (i, i))
+            out.write('inline int get_message%d(const Message%d &m) '
+                      '{ return m.field_%d; }\n' % (i, i, i))
+            out.write('void serialize(const Message%d &);\n' % i)
+            out.write('enum Message%d_Kind { Message%d_kind_a, '
+                      'Message%d_kind_b };\n' % (i, i, i))
+        out.write('} // namespace gen\n')
+
+    out.write('int qualified() {\n  int sum = 0;\n')
+    for i in range(members):
+        out.write('  { gen::Message%d m; sum += gen::get_message%d(m) + '
+                  'gen::Message%d_kind_b; gen::serialize(m); }\n' % (i, i, i))
+    out.write('  return sum;\n}\n')
+
+    out.write('int unqualified() {\n  using namespace gen;\n  int sum = 0;\n')
+    for i in range(members):
+        out.write('  { Message%d m; sum += get_message%d(m) + '
+                  'Message%d_kind_a; }\n' % (i, i, i))
+    out.write('  return sum;\n}\n')
+
+def main():
+    parser = optparse.OptionParser(usage=__doc__.strip())
+    parser.add_option('--clang', default='clang',
+                      help='clang binary to benchmark [%default]')
+    parser.add_option('--members', type=int, default=20000,
+                      help='number of messages in the namespace [%default]')
+    parser.add_option('--reopen', type=int, default=16,
+                      help='number of times the namespace is opened '
+                           '[%default]')
+    parser.add_option('--runs', type=int, default=5,
+                      help='number of timed runs [%default]')
+    parser.add_option('--keep', metavar='FILE',
+                      help='write the generated source to FILE and keep it')
+    opts, args = parser.parse_args()
+    if args:
+        parser.error('unexpected arguments')
+    if opts.members < 1 or opts.reopen < 1:
+        parser.error('--members and --reopen must be positive')
+
+    if opts.keep:
+        path = opts.keep
+        out = open(path, 'w')
+    else:
+        fd, path = tempfile.mkstemp(suffix='.cpp')
+        out = os.fdopen(fd, 'w')
+    with out:
+        generate(out, opts.members, opts.reopen)
+
+    try:
+        cmd = [opts.clang, '-cc1', '-fsyntax-only', '-std=c++11', path]
+        times = []
+        for i in range(opts.runs):
+            start = time.time()
+            subprocess.check_call(cmd)
+            times.append(time.time() - start)
+    finally:
+        if not opts.keep:
+            os.remove(path)
+
+    # Per member, 'qualified' names the class, the accessor, the enumerator,
+    # 'serialize' and the local variable twice, and 'unqualified' names the
+    # class, the accessor, the enumerator and the local variable.
+    lookups = opts.members * 10
+    times.sort()
+    print('runs: %d  min: %.3fs  median: %.3fs  max: %.3fs' %
+          (len(times), times[0], times[len(times) // 2], times[-1]))
+    print('lookups: %d  %.0f lookups/s' % (lookups, lookups / times[0]))
+
+if __name__ == '__main__':
+    main()